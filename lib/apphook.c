@@ -26,6 +26,7 @@
 #include "messages.h"
 #include "children.h"
 #include "dnscache.h"
+#include "host-resolve.h"
 #include "alarms.h"
 #include "stats/stats-registry.h"
 #include "logmsg/logmsg.h"
@@ -168,6 +169,7 @@ app_startup(void)
   hostname_global_init();
   dns_caching_global_init();
   dns_caching_thread_init();
+  host_resolve_global_init();
   afinter_global_init();
   child_manager_init();
   alarm_init();
@@ -227,6 +229,7 @@ app_shutdown(void)
   child_manager_deinit();
   g_list_foreach(application_hooks, (GFunc) g_free, NULL);
   g_list_free(application_hooks);
+  host_resolve_global_deinit();
   dns_caching_thread_deinit();
   dns_caching_global_deinit();
   hostname_global_deinit();
@@ -193,6 +193,9 @@
 %token KW_CHECK_HOSTNAME              10093
 %token KW_BAD_HOSTNAME                10094
 
+%token KW_PARTITION_KEY               10095
+%token KW_STATS_SHARDED_COUNTERS      10096
+
 %token KW_KEEP_TIMESTAMP              10100
 
 %token KW_USE_DNS                     10110
@@ -201,6 +204,7 @@
 
 %token KW_DNS_CACHE                   10120
 %token KW_DNS_CACHE_SIZE              10121
+%token KW_DNS_ASYNC_TIMEOUT           10122
 
 %token KW_DNS_CACHE_EXPIRE            10130
 %token KW_DNS_CACHE_EXPIRE_FAILED     10131
@@ -209,6 +213,7 @@
 %token KW_PERSIST_ONLY                10140
 %token KW_USE_RCPTID                  10141
 %token KW_USE_UNIQID                  10142
+%token KW_ASYNC                       10143
 
 %token KW_TZ_CONVERT                  10150
 %token KW_TS_FORMAT                   10151
@@ -223,6 +228,7 @@
 
 %token KW_THROTTLE                    10170
 %token KW_THREADED                    10171
+%token KW_ADAPTIVE_FILTER_ORDER       10172
 %token KW_PASS_UNIX_CREDENTIALS       10231
 
 %token KW_PERSIST_NAME                10302
@@ -926,6 +932,7 @@ options_item
 	| KW_TIME_SLEEP '(' nonnegative_integer ')'	{}
 	| KW_SUPPRESS '(' nonnegative_integer ')'		{ configuration->suppress = $3; }
 	| KW_THREADED '(' yesno ')'		{ configuration->threaded = $3; }
+	| KW_ADAPTIVE_FILTER_ORDER '(' yesno ')' { configuration->adaptive_filter_order = $3; }
 	| KW_PASS_UNIX_CREDENTIALS '(' yesno ')' { configuration->pass_unix_credentials = $3; }
 	| KW_USE_RCPTID '(' yesno ')'		{ cfg_set_use_uniqid($3); }
 	| KW_USE_UNIQID '(' yesno ')'		{ cfg_set_use_uniqid($3); }
@@ -964,6 +971,7 @@ stat_option
 	| KW_STATS_LEVEL '(' nonnegative_integer ')'         { last_stats_options->level = $3; }
 	| KW_STATS_LIFETIME '(' positive_integer ')'      { last_stats_options->lifetime = $3; }
   | KW_STATS_MAX_DYNAMIC '(' nonnegative_integer ')'   { last_stats_options->max_dynamic = $3; }
+	| KW_STATS_SHARDED_COUNTERS '(' yesno ')'        { last_stats_options->sharded_counters = $3; }
 	;
 
 dns_cache_option
@@ -991,7 +999,8 @@ yesno
 
 dnsmode
 	: yesno					{ $$ = $1; }
-	| KW_PERSIST_ONLY                       { $$ = 2; }
+	| KW_PERSIST_ONLY                       { $$ = HRO_USE_DNS_PERSIST_ONLY; }
+	| KW_ASYNC                              { $$ = HRO_USE_DNS_ASYNC; }
 	;
 
 nonnegative_integer64
@@ -1202,6 +1211,7 @@ threaded_dest_driver_batch_option
 
 threaded_dest_driver_workers_option
         : KW_WORKERS '(' positive_integer ')'  { log_threaded_dest_driver_set_num_workers(last_driver, $3); }
+        | KW_PARTITION_KEY '(' template_content ')' { log_threaded_dest_driver_set_partition_key(last_driver, $3); }
         ;
 
 /* implies dest_driver_option */
@@ -1290,6 +1300,7 @@ host_resolve_option
         | KW_USE_DNS '(' dnsmode ')'            { last_host_resolve_options->use_dns = $3; }
 	| KW_DNS_CACHE '(' yesno ')' 		{ last_host_resolve_options->use_dns_cache = $3; }
 	| KW_NORMALIZE_HOSTNAMES '(' yesno ')'	{ last_host_resolve_options->normalize_hostnames = $3; }
+	| KW_DNS_ASYNC_TIMEOUT '(' nonnegative_integer ')' { last_host_resolve_options->dns_async_timeout = $3; }
 	;
 
 msg_format_option
@@ -74,6 +74,7 @@ struct _GlobalConfig
   gint flush_lines;
   gint mark_mode;
   gboolean threaded;
+  gboolean adaptive_filter_order;
   gboolean pass_unix_credentials;
   gboolean chain_hostnames;
   gboolean keep_hostname;
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "dns-resolver-pool.h"
+#include "messages.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <string.h>
+
+/* upper limit of lookups waiting for a resolver thread */
+#define DNS_RESOLVER_POOL_MAX_PENDING 4096
+
+/*
+ * Finished lookups are kept around for a while, so that every thread that
+ * asked for the same address while it was in progress can pick up the
+ * result (and store it in its own DNS cache).
+ */
+#define DNS_RESOLVER_POOL_RESULT_RETENTION (10 * G_USEC_PER_SEC)
+
+typedef struct _DNSResolverKey
+{
+  gint family;
+  union
+  {
+    struct in_addr ip;
+#if SYSLOG_NG_ENABLE_IPV6
+    struct in6_addr ip6;
+#endif
+  } addr;
+} DNSResolverKey;
+
+typedef struct _DNSResolverRequest
+{
+  DNSResolverKey key;
+  GSockAddr *saddr;
+  gboolean done;
+  gboolean positive;
+  gint64 resolved;
+  gchar hostname[256];
+} DNSResolverRequest;
+
+struct _DNSResolverPool
+{
+  GMutex lock;
+  GCond resolved_cond;
+  GHashTable *requests;
+  GQueue finished;
+  gint pending;
+  GThreadPool *threads;
+  DNSResolverPoolResolveFunc resolve;
+};
+
+static gboolean
+_key_equal(const DNSResolverKey *k1, const DNSResolverKey *k2)
+{
+  if (k1->family != k2->family)
+    return FALSE;
+
+  if (k1->family == AF_INET)
+    return memcmp(&k1->addr.ip, &k2->addr.ip, sizeof(k1->addr.ip)) == 0;
+#if SYSLOG_NG_ENABLE_IPV6
+  if (k1->family == AF_INET6)
+    return memcmp(&k1->addr.ip6, &k2->addr.ip6, sizeof(k1->addr.ip6)) == 0;
+#endif
+  return FALSE;
+}
+
+static guint
+_key_hash(const DNSResolverKey *key)
+{
+#if SYSLOG_NG_ENABLE_IPV6
+  if (key->family == AF_INET6)
+    {
+      guint32 *a32 = (guint32 *) &key->addr.ip6.s6_addr;
+      return (0x80000000 | (a32[0] ^ a32[1] ^ a32[2] ^ a32[3]));
+    }
+#endif
+  return ntohl(key->addr.ip.s_addr);
+}
+
+static gboolean
+_fill_key(DNSResolverKey *key, GSockAddr *saddr)
+{
+  memset(key, 0, sizeof(*key));
+  key->family = saddr->sa.sa_family;
+  switch (key->family)
+    {
+    case AF_INET:
+      key->addr.ip = ((struct sockaddr_in *) &saddr->sa)->sin_addr;
+      return TRUE;
+#if SYSLOG_NG_ENABLE_IPV6
+    case AF_INET6:
+      key->addr.ip6 = ((struct sockaddr_in6 *) &saddr->sa)->sin6_addr;
+      return TRUE;
+#endif
+    default:
+      return FALSE;
+    }
+}
+
+static DNSResolverRequest *
+_request_new(const DNSResolverKey *key, GSockAddr *saddr)
+{
+  DNSResolverRequest *request = g_new0(DNSResolverRequest, 1);
+
+  request->key = *key;
+  request->saddr = g_sockaddr_new(&saddr->sa, saddr->salen);
+  return request;
+}
+
+static void
+_request_free(DNSResolverRequest *request)
+{
+  g_sockaddr_unref(request->saddr);
+  g_free(request);
+}
+
+/* runs in one of the resolver threads */
+static void
+_resolve_request(gpointer data, gpointer user_data)
+{
+  DNSResolverRequest *request = (DNSResolverRequest *) data;
+  DNSResolverPool *self = (DNSResolverPool *) user_data;
+  gchar hostname[sizeof(request->hostname)];
+  gboolean positive;
+
+  positive = self->resolve(request->saddr, hostname, sizeof(hostname));
+
+  g_mutex_lock(&self->lock);
+  if (positive)
+    g_strlcpy(request->hostname, hostname, sizeof(request->hostname));
+  request->positive = positive;
+  request->resolved = g_get_monotonic_time();
+  request->done = TRUE;
+  self->pending--;
+  g_queue_push_tail(&self->finished, request);
+  g_cond_broadcast(&self->resolved_cond);
+  g_mutex_unlock(&self->lock);
+}
+
+static void
+_expire_finished_requests(DNSResolverPool *self, gint64 now)
+{
+  DNSResolverRequest *request;
+
+  while ((request = g_queue_peek_head(&self->finished)) &&
+         request->resolved + DNS_RESOLVER_POOL_RESULT_RETENTION < now)
+    {
+      g_queue_pop_head(&self->finished);
+      g_hash_table_remove(self->requests, &request->key);
+    }
+}
+
+static DNSResolverRequest *
+_start_request(DNSResolverPool *self, const DNSResolverKey *key, GSockAddr *saddr)
+{
+  if (self->pending >= DNS_RESOLVER_POOL_MAX_PENDING)
+    {
+      msg_debug("Too many pending asynchronous DNS lookups, address is not resolved this time",
+                evt_tag_int("pending", self->pending));
+      return NULL;
+    }
+
+  DNSResolverRequest *request = _request_new(key, saddr);
+
+  g_hash_table_insert(self->requests, &request->key, request);
+  self->pending++;
+  g_thread_pool_push(self->threads, request, NULL);
+  return request;
+}
+
+gboolean
+dns_resolver_pool_lookup(DNSResolverPool *self, GSockAddr *saddr, gint timeout_msec,
+                         gchar *buf, gsize buflen, gboolean *positive)
+{
+  DNSResolverKey key;
+  DNSResolverRequest *request;
+  gboolean finished = FALSE;
+
+  if (!_fill_key(&key, saddr))
+    {
+      *positive = FALSE;
+      return TRUE;
+    }
+
+  g_mutex_lock(&self->lock);
+
+  gint64 now = g_get_monotonic_time();
+  _expire_finished_requests(self, now);
+
+  request = g_hash_table_lookup(self->requests, &key);
+  if (!request)
+    request = _start_request(self, &key, saddr);
+
+  if (request && !request->done && timeout_msec > 0)
+    {
+      gint64 deadline = now + timeout_msec * G_TIME_SPAN_MILLISECOND;
+
+      /* look the request up again after each wakeup, it may have expired in the meantime */
+      while (g_cond_wait_until(&self->resolved_cond, &self->lock, deadline))
+        {
+          request = g_hash_table_lookup(self->requests, &key);
+          if (!request || request->done)
+            break;
+        }
+      request = g_hash_table_lookup(self->requests, &key);
+    }
+
+  if (request && request->done)
+    {
+      *positive = request->positive;
+      if (request->positive)
+        g_strlcpy(buf, request->hostname, buflen);
+      finished = TRUE;
+    }
+  g_mutex_unlock(&self->lock);
+  return finished;
+}
+
+DNSResolverPool *
+dns_resolver_pool_new(gint num_threads, DNSResolverPoolResolveFunc resolve)
+{
+  DNSResolverPool *self = g_new0(DNSResolverPool, 1);
+
+  g_mutex_init(&self->lock);
+  g_cond_init(&self->resolved_cond);
+  g_queue_init(&self->finished);
+  self->requests = g_hash_table_new_full((GHashFunc) _key_hash, (GEqualFunc) _key_equal,
+                                         NULL, (GDestroyNotify) _request_free);
+  self->resolve = resolve;
+  self->threads = g_thread_pool_new(_resolve_request, self, num_threads, FALSE, NULL);
+  return self;
+}
+
+void
+dns_resolver_pool_free(DNSResolverPool *self)
+{
+  /* drop the queued lookups, but wait for the ones in progress */
+  g_thread_pool_free(self->threads, TRUE, TRUE);
+
+  g_queue_clear(&self->finished);
+  g_hash_table_destroy(self->requests);
+  g_cond_clear(&self->resolved_cond);
+  g_mutex_clear(&self->lock);
+  g_free(self);
+}
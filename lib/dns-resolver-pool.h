@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef DNS_RESOLVER_POOL_H_INCLUDED
+#define DNS_RESOLVER_POOL_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "gsockaddr.h"
+
+/*
+ * A set of background threads performing reverse lookups, so that a slow
+ * DNS server does not stall the thread that processes the message.
+ * Concurrent lookups of the same address are merged into a single request.
+ */
+typedef struct _DNSResolverPool DNSResolverPool;
+
+/* returns TRUE and fills buf if the address could be resolved to a name */
+typedef gboolean (*DNSResolverPoolResolveFunc)(GSockAddr *saddr, gchar *buf, gsize buflen);
+
+/*
+ * Returns TRUE if the lookup has finished, in which case positive tells
+ * whether buf contains a resolved name.  Returns FALSE if the lookup is
+ * still in progress after waiting at most timeout_msec milliseconds.
+ */
+gboolean dns_resolver_pool_lookup(DNSResolverPool *self, GSockAddr *saddr, gint timeout_msec,
+                                  gchar *buf, gsize buflen, gboolean *positive);
+
+DNSResolverPool *dns_resolver_pool_new(gint num_threads, DNSResolverPoolResolveFunc resolve);
+void dns_resolver_pool_free(DNSResolverPool *self);
+
+#endif
@@ -109,6 +109,33 @@ fop_cmp_free(FilterExprNode *s)
   g_free((gchar *) self->super.type);
 }
 
+/* string "==" between a single name-value pair and a literal */
+static gboolean
+fop_cmp_get_equality_test(FilterExprNode *s, NVHandle *handle, const gchar **value)
+{
+  FilterCmp *self = (FilterCmp *) s;
+  LogTemplate *ref = self->left, *literal = self->right;
+
+  if (self->cmp_op != FCMP_EQ)
+    return FALSE;
+
+  if (log_template_is_literal_string(ref))
+    {
+      ref = self->right;
+      literal = self->left;
+    }
+
+  if (!log_template_is_literal_string(literal) || !log_template_is_trivial(ref))
+    return FALSE;
+
+  *handle = log_template_get_trivial_value_handle(ref);
+  if (*handle == LM_V_NONE)
+    return FALSE;
+
+  *value = log_template_get_literal_value(literal, NULL);
+  return TRUE;
+}
+
 FilterExprNode *
 fop_cmp_clone(FilterExprNode *s)
 {
@@ -120,6 +147,7 @@ fop_cmp_clone(FilterExprNode *s)
   cloned_self->super.eval = fop_cmp_eval;
   cloned_self->super.free_fn = fop_cmp_free;
   cloned_self->super.clone = fop_cmp_clone;
+  cloned_self->super.get_equality_test = fop_cmp_get_equality_test;
   cloned_self->left = log_template_ref(self->left);
   cloned_self->right = log_template_ref(self->right);
   cloned_self->cmp_op = self->cmp_op;
@@ -203,6 +231,7 @@ fop_cmp_new(LogTemplate *left, LogTemplate *right, gint token)
   self->super.eval = fop_cmp_eval;
   self->super.free_fn = fop_cmp_free;
   self->super.clone = fop_cmp_clone;
+  self->super.get_equality_test = fop_cmp_get_equality_test;
   self->left = left;
   self->right = right;
 
@@ -60,6 +60,7 @@ static CfgLexerKeyword filter_expr_keywords[] =
   { "rate",               KW_RATE },
   { "tags",               KW_TAGS },
   { "in_list",            KW_IN_LIST },
+  { "netmask_list",       KW_NETMASK_LIST },
 #if SYSLOG_NG_ENABLE_IPV6
   { "netmask6",           KW_NETMASK6 },
 #endif
@@ -36,13 +36,17 @@ typedef struct _FilterExprNode FilterExprNode;
 struct _FilterExprNode
 {
   guint32 ref_cnt;
-  guint32 comp:1,   /* this not is negated */
-          modify:1; /* this filter changes the log message */
+  guint32 comp:1,     /* this not is negated */
+          modify:1,   /* this filter changes the log message */
+          stateful:1; /* evaluation has side effects beyond the message, e.g. rate limiting */
   const gchar *type;
   gboolean (*init)(FilterExprNode *self, GlobalConfig *cfg);
   gboolean (*eval)(FilterExprNode *self, LogMessage **msg, gint num_msg, LogTemplateEvalOptions *options);
   FilterExprNode *(*clone)(FilterExprNode *self);
   void (*free_fn)(FilterExprNode *self);
+  /* optional: returns TRUE if the expression can only match when the
+   * value of *handle is exactly *value, used to index log paths */
+  gboolean (*get_equality_test)(FilterExprNode *self, NVHandle *handle, const gchar **value);
   StatsCounterItem *matched;
   StatsCounterItem *not_matched;
 };
@@ -56,6 +60,15 @@ filter_expr_init(FilterExprNode *self, GlobalConfig *cfg)
   return TRUE;
 }
 
+static inline gboolean
+filter_expr_get_equality_test(FilterExprNode *self, NVHandle *handle, const gchar **value)
+{
+  if (self->comp || !self->get_equality_test)
+    return FALSE;
+
+  return self->get_equality_test(self, handle, value);
+}
+
 gboolean filter_expr_eval(FilterExprNode *self, LogMessage *msg);
 gboolean filter_expr_eval_with_context(FilterExprNode *self, LogMessage **msgs, gint num_msg,
                                        LogTemplateEvalOptions *options);
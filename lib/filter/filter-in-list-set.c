@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "filter-in-list-set.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+/*
+ * Layout of the image:
+ *
+ *   InListSetHeader | InListSetSlot[num_slots] | strings[strings_len]
+ *
+ * A slot with zero length is empty, as empty lines are never stored.  The
+ * number of slots is a power of two, at least twice the number of
+ * entries, collisions are resolved by linear probing.
+ *
+ * The header records the modification time and size of the list the
+ * image was built from, the image is only used while they still match.
+ */
+
+#define IN_LIST_SET_MAGIC "SNGINLS2"
+#define IN_LIST_SET_BYTE_ORDER 0x01020304
+#define IN_LIST_SET_MIN_SLOTS 16
+
+typedef struct _InListSetHeader
+{
+  gchar magic[8];
+  guint32 byte_order;
+  guint32 num_entries;
+  guint32 num_slots;
+  guint32 strings_len;
+  gint64 source_mtime_nsec;
+  gint64 source_size;
+} InListSetHeader;
+
+typedef struct _InListSetSlot
+{
+  guint32 hash;
+  guint32 length;
+  guint32 offset;
+} InListSetSlot;
+
+struct _InListSet
+{
+  const InListSetHeader *header;
+  const InListSetSlot *slots;
+  const gchar *strings;
+
+  gpointer image;
+  gsize image_len;
+  gboolean mapped;
+};
+
+/* FNV-1a */
+static inline guint32
+_hash(const gchar *value, gsize value_len)
+{
+  guint32 hash = 2166136261U;
+
+  for (gsize i = 0; i < value_len; i++)
+    {
+      hash ^= (guchar) value[i];
+      hash *= 16777619U;
+    }
+  return hash;
+}
+
+static inline gsize
+_image_len(guint32 num_slots, guint32 strings_len)
+{
+  return sizeof(InListSetHeader) + num_slots * sizeof(InListSetSlot) + strings_len;
+}
+
+static InListSet *
+_new_from_image(gpointer image, gsize image_len, gboolean mapped)
+{
+  InListSet *self = g_new0(InListSet, 1);
+
+  self->image = image;
+  self->image_len = image_len;
+  self->mapped = mapped;
+  self->header = (const InListSetHeader *) image;
+  self->slots = (const InListSetSlot *) (self->header + 1);
+  self->strings = (const gchar *) (self->slots + self->header->num_slots);
+  return self;
+}
+
+gboolean
+in_list_set_contains(InListSet *self, const gchar *value, gsize value_len)
+{
+  guint32 mask = self->header->num_slots - 1;
+  guint32 hash = _hash(value, value_len);
+
+  for (guint32 i = hash & mask; ; i = (i + 1) & mask)
+    {
+      const InListSetSlot *slot = &self->slots[i];
+
+      if (slot->length == 0)
+        return FALSE;
+      if (slot->hash == hash && slot->length == value_len &&
+          memcmp(self->strings + slot->offset, value, value_len) == 0)
+        return TRUE;
+    }
+}
+
+guint32
+in_list_set_get_size(InListSet *self)
+{
+  return self->header->num_entries;
+}
+
+/****************************************************************************
+ * Building the image from a list of lines
+ ****************************************************************************/
+
+static guint32
+_calculate_num_slots(guint32 num_lines)
+{
+  guint32 num_slots = IN_LIST_SET_MIN_SLOTS;
+
+  while (num_slots < 2 * num_lines)
+    num_slots <<= 1;
+  return num_slots;
+}
+
+static gboolean
+_insert_line(gchar *image, guint32 num_slots, const gchar *line, gsize line_len, guint32 offset)
+{
+  InListSetSlot *slots = (InListSetSlot *) (image + sizeof(InListSetHeader));
+  const gchar *strings = (const gchar *) (slots + num_slots);
+  guint32 mask = num_slots - 1;
+  guint32 hash = _hash(line, line_len);
+  guint32 i;
+
+  for (i = hash & mask; slots[i].length != 0; i = (i + 1) & mask)
+    {
+      if (slots[i].hash == hash && slots[i].length == line_len &&
+          memcmp(strings + slots[i].offset, line, line_len) == 0)
+        return FALSE;
+    }
+
+  slots[i].hash = hash;
+  slots[i].length = line_len;
+  slots[i].offset = offset;
+  return TRUE;
+}
+
+static inline const gchar *
+_next_line(const gchar *pos, const gchar *end, gsize *line_len)
+{
+  const gchar *eol = memchr(pos, '\n', end - pos);
+
+  *line_len = (eol ? eol : end) - pos;
+  return eol ? eol + 1 : end;
+}
+
+InListSet *
+in_list_set_new_from_lines(const gchar *lines, gsize lines_len)
+{
+  const gchar *end = lines + lines_len;
+  const gchar *pos, *line;
+  gsize line_len;
+  guint32 num_lines = 0;
+
+  for (pos = lines; pos < end; )
+    {
+      line = pos;
+      pos = _next_line(pos, end, &line_len);
+      if (line_len > 0)
+        num_lines++;
+    }
+
+  guint32 num_slots = _calculate_num_slots(num_lines);
+  gsize image_len = _image_len(num_slots, lines_len);
+  gchar *image = g_malloc0(image_len);
+  gchar *strings = image + _image_len(num_slots, 0);
+  InListSetHeader *header = (InListSetHeader *) image;
+  guint32 strings_len = 0;
+  guint32 num_entries = 0;
+
+  for (pos = lines; pos < end; )
+    {
+      line = pos;
+      pos = _next_line(pos, end, &line_len);
+      if (line_len == 0)
+        continue;
+
+      if (_insert_line(image, num_slots, line, line_len, strings_len))
+        {
+          memcpy(strings + strings_len, line, line_len);
+          strings_len += line_len;
+          num_entries++;
+        }
+    }
+
+  memcpy(header->magic, IN_LIST_SET_MAGIC, sizeof(header->magic));
+  header->byte_order = IN_LIST_SET_BYTE_ORDER;
+  header->num_entries = num_entries;
+  header->num_slots = num_slots;
+  header->strings_len = strings_len;
+
+  return _new_from_image(image, _image_len(num_slots, strings_len), FALSE);
+}
+
+/****************************************************************************
+ * Loading and saving
+ ****************************************************************************/
+
+static gint64
+_get_mtime_nsec(const struct stat *st)
+{
+#if defined(__APPLE__) && defined(__MACH__)
+  return st->st_mtimespec.tv_sec * G_GINT64_CONSTANT(1000000000) + st->st_mtimespec.tv_nsec;
+#else
+  return st->st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st->st_mtim.tv_nsec;
+#endif
+}
+
+static gboolean
+_validate_header(const InListSetHeader *header, gsize image_len)
+{
+  if (image_len < sizeof(InListSetHeader) ||
+      memcmp(header->magic, IN_LIST_SET_MAGIC, sizeof(header->magic)) != 0 ||
+      header->byte_order != IN_LIST_SET_BYTE_ORDER)
+    return FALSE;
+
+  if (header->num_slots < IN_LIST_SET_MIN_SLOTS || (header->num_slots & (header->num_slots - 1)) != 0 ||
+      header->num_slots > G_MAXUINT32 / sizeof(InListSetSlot) ||
+      header->num_entries >= header->num_slots ||
+      header->source_mtime_nsec < 0 || header->source_size < 0)
+    return FALSE;
+
+  return image_len == _image_len(header->num_slots, header->strings_len);
+}
+
+static gboolean
+_validate_image(const gchar *image, gsize image_len)
+{
+  const InListSetHeader *header = (const InListSetHeader *) image;
+
+  if (!_validate_header(header, image_len))
+    return FALSE;
+
+  /* a corrupted image should not make the lookup run out of the strings area or loop forever */
+  const InListSetSlot *slots = (const InListSetSlot *) (header + 1);
+  guint32 num_used = 0;
+
+  for (guint32 i = 0; i < header->num_slots; i++)
+    {
+      if (slots[i].length == 0)
+        continue;
+      if (slots[i].offset > header->strings_len || slots[i].length > header->strings_len - slots[i].offset)
+        return FALSE;
+      num_used++;
+    }
+  return num_used == header->num_entries && num_used < header->num_slots;
+}
+
+/* loads a list with one entry per line */
+InListSet *
+in_list_set_load(const gchar *filename, GError **error)
+{
+  InListSet *self;
+  gchar *contents;
+  gsize contents_len;
+  struct stat st;
+
+  /* stat before reading, so a change made in between makes the image look out of date */
+  if (stat(filename, &st) < 0)
+    {
+      g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno),
+                  "Error opening list file %s: %s", filename, g_strerror(errno));
+      return NULL;
+    }
+
+  if (!g_file_get_contents(filename, &contents, &contents_len, error))
+    return NULL;
+
+  if (contents_len > G_MAXUINT32)
+    {
+      g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FBIG, "List file %s is too large", filename);
+      g_free(contents);
+      return NULL;
+    }
+
+  self = in_list_set_new_from_lines(contents, contents_len);
+  g_free(contents);
+
+  /* the image was allocated by us, it is only mapped read-only when loaded from a compiled file */
+  InListSetHeader *header = (InListSetHeader *) self->image;
+  header->source_mtime_nsec = _get_mtime_nsec(&st);
+  header->source_size = st.st_size;
+  return self;
+}
+
+static gboolean
+_is_source_unchanged(const InListSetHeader *header, const gchar *source_filename, GError **error)
+{
+  struct stat st;
+
+  if (stat(source_filename, &st) < 0)
+    {
+      g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno),
+                  "Error opening list file %s: %s", source_filename, g_strerror(errno));
+      return FALSE;
+    }
+
+  if (header->source_mtime_nsec != _get_mtime_nsec(&st) || header->source_size != st.st_size)
+    {
+      g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                  "Compiled list file is out of date, %s has changed since", source_filename);
+      return FALSE;
+    }
+  return TRUE;
+}
+
+/* loads a list saved by in_list_set_save(), provided source_filename has not changed since it was built */
+InListSet *
+in_list_set_load_compiled(const gchar *filename, const gchar *source_filename, GError **error)
+{
+  struct stat st;
+  gint fd;
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0)
+    {
+      g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno),
+                  "Error opening compiled list file %s: %s", filename, g_strerror(errno));
+      if (fd >= 0)
+        close(fd);
+      return NULL;
+    }
+
+  gsize image_len = st.st_size;
+  gpointer image = image_len >= sizeof(InListSetHeader) ? mmap(NULL, image_len, PROT_READ, MAP_SHARED, fd, 0) : NULL;
+  close(fd);
+
+  if (image == MAP_FAILED)
+    {
+      g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno),
+                  "Error mapping compiled list file %s: %s", filename, g_strerror(errno));
+      return NULL;
+    }
+
+  if (!image || !_validate_image(image, image_len))
+    {
+      if (image)
+        munmap(image, image_len);
+      g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Invalid compiled list file %s", filename);
+      return NULL;
+    }
+
+  if (!_is_source_unchanged((const InListSetHeader *) image, source_filename, error))
+    {
+      munmap(image, image_len);
+      return NULL;
+    }
+  return _new_from_image(image, image_len, TRUE);
+}
+
+gboolean
+in_list_set_save(InListSet *self, const gchar *filename, GError **error)
+{
+  return g_file_set_contents(filename, self->image, self->image_len, error);
+}
+
+void
+in_list_set_free(InListSet *self)
+{
+  if (self->mapped)
+    munmap(self->image, self->image_len);
+  else
+    g_free(self->image);
+  g_free(self);
+}
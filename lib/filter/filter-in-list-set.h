@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef FILTER_IN_LIST_SET_H_INCLUDED
+#define FILTER_IN_LIST_SET_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/*
+ * Read-only set of strings used by the in-list() filter.
+ *
+ * It is an open addressing hash table stored in a single, position
+ * independent memory image, so it can be saved to a file as is and mapped
+ * back into memory when the list is loaded again, without parsing it.
+ * A saved image is only loaded while the list it was built from is
+ * unchanged.
+ */
+typedef struct _InListSet InListSet;
+
+gboolean in_list_set_contains(InListSet *self, const gchar *value, gsize value_len);
+guint32 in_list_set_get_size(InListSet *self);
+
+InListSet *in_list_set_new_from_lines(const gchar *lines, gsize lines_len);
+InListSet *in_list_set_load(const gchar *filename, GError **error);
+InListSet *in_list_set_load_compiled(const gchar *filename, const gchar *source_filename, GError **error);
+gboolean in_list_set_save(InListSet *self, const gchar *filename, GError **error);
+void in_list_set_free(InListSet *self);
+
+#endif
@@ -23,19 +23,17 @@
  */
 
 #include "filter-in-list.h"
+#include "filter-in-list-set.h"
 #include "logmsg/logmsg.h"
-#include "str-utils.h"
 
-#include <errno.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
+/* suffix of the precompiled list preferred over the list itself, see filter_in_list_compile() */
+#define COMPILED_LIST_SUFFIX ".compiled"
 
 typedef struct _FilterInList
 {
   FilterExprNode super;
   NVHandle value_handle;
-  GTree *tree;
+  InListSet *set;
 } FilterInList;
 
 static gboolean
@@ -47,11 +45,10 @@ filter_in_list_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTempl
   gssize len = 0;
 
   value = log_msg_get_value(msg, self->value_handle, &len);
-  APPEND_ZERO(value, value, len);
 
-  gboolean result = (g_tree_lookup(self->tree, value) != NULL);
+  gboolean result = in_list_set_contains(self->set, value, len);
   msg_trace("in-list() evaluation started",
-            evt_tag_str("value", value),
+            evt_tag_printf("value", "%.*s", (gint) len, value),
             evt_tag_printf("msg", "%p", msg));
 
   return result ^ s->comp;
@@ -62,39 +59,93 @@ filter_in_list_free(FilterExprNode *s)
 {
   FilterInList *self = (FilterInList *)s;
 
-  g_tree_destroy(self->tree);
+  in_list_set_free(self->set);
 }
 
-FilterExprNode *
-filter_in_list_new(const gchar *list_file, const gchar *property)
+static InListSet *
+_load_list(const gchar *list_file)
 {
-  FilterInList *self;
-  FILE *stream;
-  gchar line[16384];
+  gchar *compiled_file = g_strconcat(list_file, COMPILED_LIST_SUFFIX, NULL);
+  GError *error = NULL;
+  InListSet *set = NULL;
 
-  stream = fopen(list_file, "r");
-  if (!stream)
+  if (g_file_test(compiled_file, G_FILE_TEST_EXISTS))
+    {
+      set = in_list_set_load_compiled(compiled_file, list_file, &error);
+      if (!set)
+        {
+          msg_warning("Error loading compiled in-list filter list file, using the list file instead",
+                      evt_tag_str("file", compiled_file),
+                      evt_tag_str("error", error->message));
+          g_clear_error(&error);
+        }
+    }
+  g_free(compiled_file);
+
+  if (!set)
+    set = in_list_set_load(list_file, &error);
+  if (!set)
     {
       msg_error("Error opening in-list filter list file",
                 evt_tag_str("file", list_file),
-                evt_tag_error("errno"));
-      return NULL;
+                evt_tag_str("error", error->message));
+      g_clear_error(&error);
     }
+  return set;
+}
+
+FilterExprNode *
+filter_in_list_new(const gchar *list_file, const gchar *property)
+{
+  FilterInList *self;
+  InListSet *set;
+
+  set = _load_list(list_file);
+  if (!set)
+    return NULL;
 
   self = g_new0(FilterInList, 1);
   filter_expr_node_init_instance(&self->super);
   self->value_handle = log_msg_get_value_handle(property);
-  self->tree = g_tree_new_full((GCompareDataFunc)strcmp, NULL, g_free, NULL);
-
-  while (fgets(line, sizeof(line), stream) != NULL)
-    {
-      line[strlen(line) - 1] = '\0';
-      if (line[0])
-        g_tree_insert(self->tree, g_strdup(line), GINT_TO_POINTER(1));
-    }
-  fclose(stream);
+  self->set = set;
 
   self->super.eval = filter_in_list_eval;
   self->super.free_fn = filter_in_list_free;
   return &self->super;
 }
+
+/*
+ * Saves the list in a form that can be mapped into memory as is.  While
+ * the list is left unchanged, in-list() uses the compiled file instead of
+ * parsing the list, so reloading a large list is instant.
+ */
+gboolean
+filter_in_list_compile(const gchar *list_file)
+{
+  gchar *compiled_file = g_strconcat(list_file, COMPILED_LIST_SUFFIX, NULL);
+  GError *error = NULL;
+  gboolean result = FALSE;
+  InListSet *set;
+
+  set = in_list_set_load(list_file, &error);
+  if (set && in_list_set_save(set, compiled_file, &error))
+    {
+      msg_info("in-list() filter list file compiled",
+               evt_tag_str("file", list_file),
+               evt_tag_str("compiled_file", compiled_file),
+               evt_tag_int("entries", in_list_set_get_size(set)));
+      result = TRUE;
+    }
+  else
+    {
+      msg_error("Error compiling in-list filter list file",
+                evt_tag_str("file", list_file),
+                evt_tag_str("error", error->message));
+      g_clear_error(&error);
+    }
+
+  if (set)
+    in_list_set_free(set);
+  g_free(compiled_file);
+  return result;
+}
@@ -29,5 +29,6 @@
 
 FilterExprNode *filter_in_list_new(const gchar *list_file,
                                    const gchar *property);
+gboolean filter_in_list_compile(const gchar *list_file);
 
 #endif
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "filter-netmask-list.h"
+#include "filter-netmask-trie.h"
+#include "gsocket.h"
+#include "logmsg/logmsg.h"
+
+#include <arpa/inet.h>
+#include <string.h>
+
+typedef struct _FilterNetmaskList
+{
+  FilterExprNode super;
+  /* LM_V_NONE to match the source address of the message */
+  NVHandle value_handle;
+  NetmaskTrie *trie;
+} FilterNetmaskList;
+
+/* local messages are considered to come from the loopback address, like in netmask() */
+static gboolean
+_lookup_loopback(FilterNetmaskList *self)
+{
+  struct in_addr loopback = { .s_addr = htonl(INADDR_LOOPBACK) };
+
+  return netmask_trie_lookup_ipv4(self->trie, &loopback) || netmask_trie_lookup_ipv6(self->trie, &in6addr_loopback);
+}
+
+static gboolean
+_lookup_saddr(FilterNetmaskList *self, LogMessage *msg)
+{
+  if (msg->saddr && g_sockaddr_inet_check(msg->saddr))
+    return netmask_trie_lookup_ipv4(self->trie, &((struct sockaddr_in *) &msg->saddr->sa)->sin_addr);
+
+#if SYSLOG_NG_ENABLE_IPV6
+  if (msg->saddr && g_sockaddr_inet6_check(msg->saddr))
+    return netmask_trie_lookup_ipv6(self->trie, &((struct sockaddr_in6 *) &msg->saddr->sa)->sin6_addr);
+#endif
+
+  if (!msg->saddr || msg->saddr->sa.sa_family == AF_UNIX)
+    return _lookup_loopback(self);
+
+  return FALSE;
+}
+
+static gboolean
+_lookup_value(FilterNetmaskList *self, const gchar *value, gssize value_len)
+{
+  gchar buf[INET6_ADDRSTRLEN];
+  struct in6_addr address6;
+  struct in_addr address;
+
+  if (value_len <= 0 || (gsize) value_len >= sizeof(buf))
+    return FALSE;
+
+  memcpy(buf, value, value_len);
+  buf[value_len] = 0;
+
+  if (inet_pton(AF_INET, buf, &address) == 1)
+    return netmask_trie_lookup_ipv4(self->trie, &address);
+  if (inet_pton(AF_INET6, buf, &address6) == 1)
+    return netmask_trie_lookup_ipv6(self->trie, &address6);
+  return FALSE;
+}
+
+static gboolean
+filter_netmask_list_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEvalOptions *options)
+{
+  FilterNetmaskList *self = (FilterNetmaskList *) s;
+  LogMessage *msg = msgs[num_msg - 1];
+  gboolean result;
+
+  if (self->value_handle == LM_V_NONE)
+    {
+      result = _lookup_saddr(self, msg);
+      msg_trace("netmask-list() evaluation started",
+                evt_tag_printf("msg", "%p", msg));
+    }
+  else
+    {
+      gssize len = 0;
+      const gchar *value = log_msg_get_value(msg, self->value_handle, &len);
+
+      result = _lookup_value(self, value, len);
+      msg_trace("netmask-list() evaluation started",
+                evt_tag_printf("value", "%.*s", (gint) len, value),
+                evt_tag_printf("msg", "%p", msg));
+    }
+
+  return result ^ s->comp;
+}
+
+static void
+filter_netmask_list_free(FilterExprNode *s)
+{
+  FilterNetmaskList *self = (FilterNetmaskList *) s;
+
+  netmask_trie_free(self->trie);
+}
+
+/*
+ * The list is loaded while the configuration is parsed, so a reload builds
+ * a new trie next to the one in use, and the old one is freed together with
+ * the old configuration.  If the list cannot be loaded, the reload fails and
+ * the running configuration keeps its list.
+ */
+FilterExprNode *
+filter_netmask_list_new(const gchar *list_file, const gchar *property)
+{
+  FilterNetmaskList *self;
+  GError *error = NULL;
+  NetmaskTrie *trie;
+
+  trie = netmask_trie_load(list_file, &error);
+  if (!trie)
+    {
+      msg_error("Error loading netmask-list filter list file",
+                evt_tag_str("file", list_file),
+                evt_tag_str("error", error->message));
+      g_clear_error(&error);
+      return NULL;
+    }
+
+  msg_debug("netmask-list() filter list file loaded",
+            evt_tag_str("file", list_file),
+            evt_tag_int("networks", netmask_trie_get_size(trie)));
+
+  self = g_new0(FilterNetmaskList, 1);
+  filter_expr_node_init_instance(&self->super);
+  self->value_handle = property ? log_msg_get_value_handle(property) : LM_V_NONE;
+  self->trie = trie;
+
+  self->super.eval = filter_netmask_list_eval;
+  self->super.free_fn = filter_netmask_list_free;
+  self->super.type = "netmask-list";
+  return &self->super;
+}
@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "filter-netmask-trie.h"
+
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Node layout: bit N of leaf is set if the networks cover every address
+ * whose byte at this level is N, bit N of children is set if there is a
+ * child node for it.  The children of a node are stored from first_child
+ * on, in the order of their slots.
+ *
+ * Networks covered by a shorter one are not stored, the lookup returns as
+ * soon as it reaches a leaf slot.
+ */
+
+#define NETMASK_TRIE_IPV4_ROOT 0
+#define NETMASK_TRIE_IPV6_ROOT 1
+
+typedef struct _NetmaskTrieNode
+{
+  guint64 leaf[4];
+  guint64 children[4];
+  guint32 first_child;
+} NetmaskTrieNode;
+
+struct _NetmaskTrie
+{
+  NetmaskTrieNode *nodes;
+  guint32 num_nodes;
+  guint32 num_networks;
+};
+
+typedef struct _NetmaskTrieNetwork
+{
+  guint8 root;
+  guint8 prefix;
+  guint8 address[16];
+} NetmaskTrieNetwork;
+
+static inline gboolean
+_slot_is_set(const guint64 *bits, guint8 slot)
+{
+  return (bits[slot >> 6] >> (slot & 63)) & 1;
+}
+
+static inline void
+_set_slot(guint64 *bits, guint8 slot)
+{
+  bits[slot >> 6] |= G_GUINT64_CONSTANT(1) << (slot & 63);
+}
+
+/* number of slots set before slot */
+static inline guint32
+_rank(const guint64 *bits, guint8 slot)
+{
+  gint word = slot >> 6;
+  guint32 rank = __builtin_popcountll(bits[word] & ((G_GUINT64_CONSTANT(1) << (slot & 63)) - 1));
+
+  for (gint i = 0; i < word; i++)
+    rank += __builtin_popcountll(bits[i]);
+  return rank;
+}
+
+static gboolean
+_lookup(NetmaskTrie *self, guint32 root, const guint8 *address, gsize address_len)
+{
+  const NetmaskTrieNode *node = &self->nodes[root];
+
+  for (gsize i = 0; i < address_len; i++)
+    {
+      guint8 slot = address[i];
+
+      if (_slot_is_set(node->leaf, slot))
+        return TRUE;
+      if (!_slot_is_set(node->children, slot))
+        return FALSE;
+      node = &self->nodes[node->first_child + _rank(node->children, slot)];
+    }
+  return FALSE;
+}
+
+gboolean
+netmask_trie_lookup_ipv4(NetmaskTrie *self, const struct in_addr *address)
+{
+  return _lookup(self, NETMASK_TRIE_IPV4_ROOT, (const guint8 *) &address->s_addr, 4);
+}
+
+/* IPv4-mapped addresses are looked up among the IPv4 networks */
+gboolean
+netmask_trie_lookup_ipv6(NetmaskTrie *self, const struct in6_addr *address)
+{
+  if (IN6_IS_ADDR_V4MAPPED(address))
+    return _lookup(self, NETMASK_TRIE_IPV4_ROOT, &address->s6_addr[12], 4);
+
+  return _lookup(self, NETMASK_TRIE_IPV6_ROOT, address->s6_addr, 16);
+}
+
+guint32
+netmask_trie_get_size(NetmaskTrie *self)
+{
+  return self->num_networks;
+}
+
+/****************************************************************************
+ * Building the trie
+ ****************************************************************************/
+
+static gint
+_compare_networks(gconstpointer a, gconstpointer b)
+{
+  const NetmaskTrieNetwork *na = (const NetmaskTrieNetwork *) a;
+  const NetmaskTrieNetwork *nb = (const NetmaskTrieNetwork *) b;
+
+  if (na->root != nb->root)
+    return na->root - nb->root;
+
+  gint result = memcmp(na->address, nb->address, sizeof(na->address));
+  if (result != 0)
+    return result;
+  return na->prefix - nb->prefix;
+}
+
+static inline NetmaskTrieNode *
+_node(GArray *nodes, guint32 index)
+{
+  return &g_array_index(nodes, NetmaskTrieNode, index);
+}
+
+/* networks[lo..hi) all share their first depth bytes and are longer than depth bytes */
+static void
+_build_node(GArray *nodes, guint32 index, NetmaskTrieNetwork *networks, gint lo, gint hi, gint depth)
+{
+  gint first_bit = depth * 8;
+
+  for (gint i = lo; i < hi; i++)
+    {
+      NetmaskTrieNetwork *network = &networks[i];
+
+      if (network->prefix > first_bit + 8)
+        continue;
+
+      gint num_slots = 1 << (first_bit + 8 - network->prefix);
+      for (gint slot = network->address[depth]; slot < network->address[depth] + num_slots; slot++)
+        _set_slot(_node(nodes, index)->leaf, slot);
+    }
+
+  guint32 num_children = 0;
+  for (gint i = lo; i < hi; i++)
+    {
+      NetmaskTrieNetwork *network = &networks[i];
+      guint8 slot = network->address[depth];
+
+      if (network->prefix > first_bit + 8 &&
+          !_slot_is_set(_node(nodes, index)->leaf, slot) &&
+          !_slot_is_set(_node(nodes, index)->children, slot))
+        {
+          _set_slot(_node(nodes, index)->children, slot);
+          num_children++;
+        }
+    }
+
+  if (num_children == 0)
+    return;
+
+  guint32 first_child = nodes->len;
+  g_array_set_size(nodes, nodes->len + num_children);
+  _node(nodes, index)->first_child = first_child;
+
+  for (gint i = lo, end; i < hi; i = end)
+    {
+      guint8 slot = networks[i].address[depth];
+
+      for (end = i; end < hi && networks[end].address[depth] == slot; end++)
+        ;
+
+      if (!_slot_is_set(_node(nodes, index)->children, slot))
+        continue;
+
+      /* skip the networks ending at this level */
+      gint start = i;
+      while (start < end && networks[start].prefix <= first_bit + 8)
+        start++;
+
+      _build_node(nodes, first_child + _rank(_node(nodes, index)->children, slot), networks, start, end, depth + 1);
+    }
+}
+
+static void
+_build_root(GArray *nodes, guint32 root, NetmaskTrieNetwork *networks, gint num_networks)
+{
+  gint lo, hi;
+
+  for (lo = 0; lo < num_networks && networks[lo].root != root; lo++)
+    ;
+  for (hi = lo; hi < num_networks && networks[hi].root == root; hi++)
+    ;
+
+  if (lo < hi)
+    _build_node(nodes, root, networks, lo, hi, 0);
+}
+
+static NetmaskTrie *
+_new_from_networks(GArray *networks)
+{
+  NetmaskTrie *self = g_new0(NetmaskTrie, 1);
+  GArray *nodes = g_array_sized_new(FALSE, TRUE, sizeof(NetmaskTrieNode), 2);
+  guint32 num_unique = 0;
+
+  g_array_sort(networks, _compare_networks);
+  for (guint32 i = 0; i < networks->len; i++)
+    {
+      if (num_unique > 0 &&
+          _compare_networks(&g_array_index(networks, NetmaskTrieNetwork, i),
+                            &g_array_index(networks, NetmaskTrieNetwork, num_unique - 1)) == 0)
+        continue;
+      g_array_index(networks, NetmaskTrieNetwork, num_unique++) = g_array_index(networks, NetmaskTrieNetwork, i);
+    }
+
+  g_array_set_size(nodes, 2);
+  _build_root(nodes, NETMASK_TRIE_IPV4_ROOT, (NetmaskTrieNetwork *) networks->data, num_unique);
+  _build_root(nodes, NETMASK_TRIE_IPV6_ROOT, (NetmaskTrieNetwork *) networks->data, num_unique);
+
+  self->num_networks = num_unique;
+  self->num_nodes = nodes->len;
+  self->nodes = (NetmaskTrieNode *) g_array_free(nodes, FALSE);
+  return self;
+}
+
+/****************************************************************************
+ * Parsing
+ ****************************************************************************/
+
+static gboolean
+_parse_prefix(const gchar *prefix_str, gint max_prefix, gint *prefix)
+{
+  gchar *end;
+  glong value = strtol(prefix_str, &end, 10);
+
+  if (end == prefix_str || *end || value < 0 || value > max_prefix)
+    return FALSE;
+
+  *prefix = value;
+  return TRUE;
+}
+
+/* dotted netmask, as accepted by netmask() as well */
+static gboolean
+_parse_ipv4_netmask(const gchar *netmask_str, gint *prefix)
+{
+  struct in_addr netmask;
+
+  if (inet_pton(AF_INET, netmask_str, &netmask) != 1)
+    return FALSE;
+
+  guint32 host_bits = ~ntohl(netmask.s_addr);
+  if (host_bits & (host_bits + 1))
+    return FALSE;
+
+  *prefix = 32 - __builtin_popcount(host_bits);
+  return TRUE;
+}
+
+static void
+_mask_address(NetmaskTrieNetwork *network)
+{
+  for (gint i = 0; i < (gint) sizeof(network->address); i++)
+    {
+      gint bits = network->prefix - i * 8;
+
+      if (bits <= 0)
+        network->address[i] = 0;
+      else if (bits < 8)
+        network->address[i] &= 0xFF << (8 - bits);
+    }
+}
+
+static gboolean
+_parse_address_and_prefix(const gchar *address, const gchar *prefix_str, NetmaskTrieNetwork *network)
+{
+  gint prefix;
+
+  memset(network, 0, sizeof(*network));
+  if (strchr(address, ':'))
+    {
+      if (inet_pton(AF_INET6, address, network->address) != 1)
+        return FALSE;
+      network->root = NETMASK_TRIE_IPV6_ROOT;
+      prefix = 128;
+      if (prefix_str && !_parse_prefix(prefix_str, 128, &prefix))
+        return FALSE;
+    }
+  else
+    {
+      if (inet_pton(AF_INET, address, network->address) != 1)
+        return FALSE;
+      network->root = NETMASK_TRIE_IPV4_ROOT;
+      prefix = 32;
+      if (prefix_str && !(strchr(prefix_str, '.')
+                          ? _parse_ipv4_netmask(prefix_str, &prefix)
+                          : _parse_prefix(prefix_str, 32, &prefix)))
+        return FALSE;
+    }
+
+  network->prefix = prefix;
+  _mask_address(network);
+  return TRUE;
+}
+
+static gboolean
+_parse_network(gchar *line, NetmaskTrieNetwork *network)
+{
+  gchar *slash = strchr(line, '/');
+  gboolean result;
+
+  if (slash)
+    *slash = 0;
+  result = _parse_address_and_prefix(line, slash ? slash + 1 : NULL, network);
+  if (slash)
+    *slash = '/';
+  return result;
+}
+
+/* one network per line in CIDR notation, empty lines and lines starting with '#' are ignored */
+NetmaskTrie *
+netmask_trie_new_from_lines(const gchar *lines, gsize lines_len, GError **error)
+{
+  GArray *networks = g_array_new(FALSE, FALSE, sizeof(NetmaskTrieNetwork));
+  const gchar *end = lines + lines_len;
+  const gchar *pos = lines;
+  NetmaskTrie *self = NULL;
+  gint lineno = 0;
+
+  while (pos < end)
+    {
+      const gchar *eol = memchr(pos, '\n', end - pos);
+      gchar *line = g_strstrip(g_strndup(pos, (eol ? eol : end) - pos));
+      NetmaskTrieNetwork network;
+
+      pos = eol ? eol + 1 : end;
+      lineno++;
+
+      if (line[0] == 0 || line[0] == '#')
+        {
+          g_free(line);
+          continue;
+        }
+
+      if (!_parse_network(line, &network))
+        {
+          g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Invalid network at line %d: %s", lineno, line);
+          g_free(line);
+          goto exit;
+        }
+      g_array_append_val(networks, network);
+      g_free(line);
+    }
+
+  self = _new_from_networks(networks);
+exit:
+  g_array_free(networks, TRUE);
+  return self;
+}
+
+NetmaskTrie *
+netmask_trie_load(const gchar *filename, GError **error)
+{
+  NetmaskTrie *self;
+  gchar *contents;
+  gsize contents_len;
+
+  if (!g_file_get_contents(filename, &contents, &contents_len, error))
+    return NULL;
+
+  self = netmask_trie_new_from_lines(contents, contents_len, error);
+  g_free(contents);
+  return self;
+}
+
+void
+netmask_trie_free(NetmaskTrie *self)
+{
+  g_free(self->nodes);
+  g_free(self);
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef FILTER_NETMASK_TRIE_H_INCLUDED
+#define FILTER_NETMASK_TRIE_H_INCLUDED
+
+#include "syslog-ng.h"
+
+#include <netinet/in.h>
+
+/*
+ * Read-only set of IPv4 and IPv6 networks used by the netmask-list()
+ * filter, answering whether an address is in any of them.
+ *
+ * It is a multibit trie consuming a byte of the address per level, where
+ * prefixes not ending on a byte boundary are expanded to the slots they
+ * cover.  The children of a node are stored next to each other and found
+ * by counting the bits set in a bitmap, so a lookup touches at most one
+ * node per address byte, regardless of the number of networks.
+ */
+typedef struct _NetmaskTrie NetmaskTrie;
+
+gboolean netmask_trie_lookup_ipv4(NetmaskTrie *self, const struct in_addr *address);
+gboolean netmask_trie_lookup_ipv6(NetmaskTrie *self, const struct in6_addr *address);
+guint32 netmask_trie_get_size(NetmaskTrie *self);
+
+NetmaskTrie *netmask_trie_new_from_lines(const gchar *lines, gsize lines_len, GError **error);
+NetmaskTrie *netmask_trie_load(const gchar *filename, GError **error);
+void netmask_trie_free(NetmaskTrie *self);
+
+#endif
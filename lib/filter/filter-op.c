@@ -22,13 +22,348 @@
  *
  */
 #include "filter-op.h"
+#include "cfg.h"
+#include "messages.h"
+#include "timeutils/misc.h"
+
+#include <time.h>
+
+/*
+ * adaptive-filter-order(yes) support
+ *
+ * A chain of the same operator (e.g. "a and b and c") is flattened into
+ * its operands when the filter is initialized.  One in
+ * FILTER_OP_SAMPLE_INTERVAL evaluations of each such chain by each thread
+ * is sampled: the cost of each operand evaluated is measured along with
+ * how often it decided the result (FALSE for AND, TRUE for OR).  After
+ * FILTER_OP_REORDER_SAMPLES samples the operands are sorted by cost per
+ * decision, so that cheap and selective ones are tried first.  Operands
+ * that modify the message or have other side effects (e.g. throttle())
+ * are never moved, and others are never moved across them.
+ *
+ * The order is rewritten in place while other threads may be evaluating
+ * the same filter, so the evaluation keeps track of which operands it has
+ * tried and falls back to the configured order for the ones it missed.
+ */
+#define FILTER_OP_MAX_OPERANDS 64
+#define FILTER_OP_SAMPLE_INTERVAL 16
+#define FILTER_OP_REORDER_SAMPLES 256
+#define FILTER_OP_MIN_OPERAND_SAMPLES 16
+#define FILTER_OP_MAX_SAMPLED_COST 1000000
+
+typedef struct _FilterOpOperand
+{
+  FilterExprNode *expr;
+  /* operands between a pinned one and the next are reordered as a group */
+  gint group_end;
+  gint evals;
+  gint decisive;
+  gint cost_nsec;
+} FilterOpOperand;
 
 typedef struct _FilterOp
 {
   FilterExprNode super;
   FilterExprNode *left, *right;
+
+  /* adaptive evaluation, NULL unless enabled */
+  FilterOpOperand *operands;
+  gint *order;
+  gint num_operands;
+  /* indexes the per-thread evaluation counters, see _get_sample_tick() */
+  gint sample_id;
+  gint samples;
 } FilterOp;
 
+/*
+ * Evaluations are counted per thread and per node, so the hot path does
+ * not contend on a shared counter, and chains evaluated one after the
+ * other are still sampled at the same rate.  Nodes get a small integer id
+ * to index the per-thread array, ids of freed nodes are reused.
+ */
+static GMutex sample_ids_lock;
+static GArray *free_sample_ids;
+static gint next_sample_id;
+
+static gint
+_alloc_sample_id(void)
+{
+  gint id;
+
+  g_mutex_lock(&sample_ids_lock);
+  if (free_sample_ids && free_sample_ids->len > 0)
+    {
+      id = g_array_index(free_sample_ids, gint, free_sample_ids->len - 1);
+      g_array_set_size(free_sample_ids, free_sample_ids->len - 1);
+    }
+  else
+    {
+      id = next_sample_id++;
+    }
+  g_mutex_unlock(&sample_ids_lock);
+  return id;
+}
+
+static void
+_release_sample_id(gint id)
+{
+  g_mutex_lock(&sample_ids_lock);
+  if (!free_sample_ids)
+    free_sample_ids = g_array_new(FALSE, FALSE, sizeof(gint));
+  g_array_append_val(free_sample_ids, id);
+  g_mutex_unlock(&sample_ids_lock);
+}
+
+static void
+_sample_ticks_free(gpointer s)
+{
+  g_array_free((GArray *) s, TRUE);
+}
+
+static GPrivate sample_ticks = G_PRIVATE_INIT(_sample_ticks_free);
+
+static guint *
+_get_sample_tick(FilterOp *self)
+{
+  GArray *ticks = g_private_get(&sample_ticks);
+
+  if (!ticks)
+    {
+      ticks = g_array_new(FALSE, TRUE, sizeof(guint));
+      g_private_set(&sample_ticks, ticks);
+    }
+  if ((guint) self->sample_id >= ticks->len)
+    g_array_set_size(ticks, self->sample_id + 1);
+  return &g_array_index(ticks, guint, self->sample_id);
+}
+
+static inline gboolean
+_is_pinned(FilterExprNode *expr)
+{
+  return expr->modify || expr->stateful;
+}
+
+static gint
+_count_operands(FilterExprNode *s, FilterExprNode *root)
+{
+  FilterOp *self = (FilterOp *) s;
+
+  if (s != root && (s->eval != root->eval || s->comp))
+    return 1;
+
+  return _count_operands(self->left, root) + _count_operands(self->right, root);
+}
+
+static void
+_drop_adaptive_order(FilterOp *self)
+{
+  if (self->operands)
+    _release_sample_id(self->sample_id);
+  g_free(self->operands);
+  g_free(self->order);
+  self->operands = NULL;
+  self->order = NULL;
+  self->num_operands = 0;
+}
+
+static void
+_collect_operands(FilterExprNode *s, FilterOp *root)
+{
+  FilterOp *self = (FilterOp *) s;
+
+  if (s != &root->super && (s->eval != root->super.eval || s->comp))
+    {
+      root->operands[root->num_operands++].expr = s;
+      return;
+    }
+
+  /* nested nodes are evaluated as part of the root, drop what their own
+   * init set up */
+  if (s != &root->super)
+    _drop_adaptive_order(self);
+
+  _collect_operands(self->left, root);
+  _collect_operands(self->right, root);
+}
+
+static void
+_setup_adaptive_order(FilterOp *self)
+{
+  gint num_operands = _count_operands(&self->super, &self->super);
+
+  _drop_adaptive_order(self);
+  if (num_operands > FILTER_OP_MAX_OPERANDS)
+    return;
+
+  self->operands = g_new0(FilterOpOperand, num_operands);
+  self->order = g_new(gint, num_operands);
+  _collect_operands(&self->super, self);
+
+  gint group_end = self->num_operands;
+  for (gint i = self->num_operands - 1; i >= 0; i--)
+    {
+      if (_is_pinned(self->operands[i].expr))
+        {
+          self->operands[i].group_end = i + 1;
+          group_end = i;
+        }
+      else
+        {
+          self->operands[i].group_end = group_end;
+        }
+      self->order[i] = i;
+    }
+  self->sample_id = _alloc_sample_id();
+  self->samples = 0;
+}
+
+static gdouble
+_operand_rank(FilterOpOperand *operand)
+{
+  gint evals = g_atomic_int_get(&operand->evals);
+
+  /* operands we know little about are tried first, so they get measured */
+  if (evals < FILTER_OP_MIN_OPERAND_SAMPLES)
+    return 0;
+
+  return (g_atomic_int_get(&operand->cost_nsec) + 1.0) / (g_atomic_int_get(&operand->decisive) + 1.0);
+}
+
+/* halves the weight of past samples, but keeps what we know of operands
+ * that were not reached recently, as they are not measured again until
+ * the ones in front of them become less selective */
+static void
+_decay_operand_stats(FilterOpOperand *operand)
+{
+  if (g_atomic_int_get(&operand->evals) < 2 * FILTER_OP_MIN_OPERAND_SAMPLES)
+    return;
+
+  g_atomic_int_set(&operand->evals, g_atomic_int_get(&operand->evals) / 2);
+  g_atomic_int_set(&operand->decisive, g_atomic_int_get(&operand->decisive) / 2);
+  g_atomic_int_set(&operand->cost_nsec, g_atomic_int_get(&operand->cost_nsec) / 2);
+}
+
+static void
+_reorder_operands(FilterOp *self)
+{
+  gdouble ranks[FILTER_OP_MAX_OPERANDS];
+  gint order[FILTER_OP_MAX_OPERANDS];
+  gboolean changed = FALSE;
+
+  for (gint i = 0; i < self->num_operands; i++)
+    {
+      ranks[i] = _operand_rank(&self->operands[i]);
+      order[i] = g_atomic_int_get(&self->order[i]);
+    }
+
+  /* insertion sort within groups, stable so ties keep their order */
+  for (gint start = 0, end; start < self->num_operands; start = end)
+    {
+      end = self->operands[start].group_end;
+      for (gint i = start + 1; i < end; i++)
+        {
+          gint index = order[i];
+          gint j;
+
+          for (j = i; j > start && ranks[order[j - 1]] > ranks[index]; j--)
+            order[j] = order[j - 1];
+          order[j] = index;
+        }
+    }
+
+  for (gint i = 0; i < self->num_operands; i++)
+    {
+      if (order[i] != g_atomic_int_get(&self->order[i]))
+        {
+          g_atomic_int_set(&self->order[i], order[i]);
+          changed = TRUE;
+        }
+      _decay_operand_stats(&self->operands[i]);
+    }
+
+  if (changed)
+    msg_debug("Reordered filter operands by measured selectivity",
+              evt_tag_str("type", self->super.type),
+              evt_tag_int("operands", self->num_operands));
+}
+
+static inline gboolean
+_eval_operand(FilterOp *self, gint index, LogMessage **msgs, gint num_msg, LogTemplateEvalOptions *options,
+              gboolean decisive_result, gboolean sampled)
+{
+  FilterOpOperand *operand = &self->operands[index];
+
+  if (!sampled)
+    return filter_expr_eval_with_context(operand->expr, msgs, num_msg, options);
+
+  struct timespec start, stop;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  gboolean result = filter_expr_eval_with_context(operand->expr, msgs, num_msg, options);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  g_atomic_int_inc(&operand->evals);
+  if (result == decisive_result)
+    g_atomic_int_inc(&operand->decisive);
+  g_atomic_int_add(&operand->cost_nsec, MIN(timespec_diff_nsec(&stop, &start), FILTER_OP_MAX_SAMPLED_COST));
+  return result;
+}
+
+/* returns decisive_result as soon as an operand evaluates to it */
+static gboolean
+_eval_adaptive(FilterOp *self, LogMessage **msgs, gint num_msg, LogTemplateEvalOptions *options,
+               gboolean decisive_result)
+{
+  gboolean sampled = ((*_get_sample_tick(self))++ % FILTER_OP_SAMPLE_INTERVAL) == 0;
+  gboolean result = !decisive_result;
+  guint64 evaluated = 0;
+
+  for (gint start = 0, end; start < self->num_operands; start = end)
+    {
+      gint num_evaluated = 0;
+
+      end = self->operands[start].group_end;
+      for (gint i = start; i < end; i++)
+        {
+          gint index = g_atomic_int_get(&self->order[i]);
+
+          if (evaluated & (G_GUINT64_CONSTANT(1) << index))
+            continue;
+          evaluated |= G_GUINT64_CONSTANT(1) << index;
+          num_evaluated++;
+
+          if (_eval_operand(self, index, msgs, num_msg, options, decisive_result, sampled) == decisive_result)
+            {
+              result = decisive_result;
+              goto exit;
+            }
+        }
+
+      /* the order was rewritten while we were reading it */
+      for (gint index = start; num_evaluated < end - start && index < end; index++)
+        {
+          if (evaluated & (G_GUINT64_CONSTANT(1) << index))
+            continue;
+          evaluated |= G_GUINT64_CONSTANT(1) << index;
+          num_evaluated++;
+
+          if (_eval_operand(self, index, msgs, num_msg, options, decisive_result, sampled) == decisive_result)
+            {
+              result = decisive_result;
+              goto exit;
+            }
+        }
+    }
+
+exit:
+  if (sampled && g_atomic_int_add(&self->samples, 1) + 1 == FILTER_OP_REORDER_SAMPLES)
+    {
+      _reorder_operands(self);
+      g_atomic_int_set(&self->samples, 0);
+    }
+  return result;
+}
+
 static gboolean
 fop_init(FilterExprNode *s, GlobalConfig *cfg)
 {
@@ -44,6 +379,10 @@ fop_init(FilterExprNode *s, GlobalConfig *cfg)
     return FALSE;
 
   self->super.modify = self->left->modify || self->right->modify;
+  self->super.stateful = self->left->stateful || self->right->stateful;
+
+  if (cfg && cfg->adaptive_filter_order)
+    _setup_adaptive_order(self);
 
   return TRUE;
 }
@@ -53,6 +392,7 @@ fop_free(FilterExprNode *s)
 {
   FilterOp *self = (FilterOp *) s;
 
+  _drop_adaptive_order(self);
   filter_expr_unref(self->left);
   filter_expr_unref(self->right);
   g_free((gchar *) self->super.type);
@@ -69,6 +409,7 @@ fop_clone(FilterExprNode *s)
   cloned_self->super.free_fn = fop_free;
   cloned_self->super.clone = fop_clone;
   cloned_self->super.eval = self->super.eval;
+  cloned_self->super.get_equality_test = self->super.get_equality_test;
   cloned_self->left = filter_expr_clone(self->left);
   cloned_self->right = filter_expr_clone(self->right);
   cloned_self->super.type = g_strdup(self->super.type);
@@ -89,6 +430,9 @@ fop_or_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEvalO
 {
   FilterOp *self = (FilterOp *) s;
 
+  if (self->operands)
+    return _eval_adaptive(self, msgs, num_msg, options, TRUE) ^ s->comp;
+
   return (filter_expr_eval_with_context(self->left, msgs, num_msg, options)
           || filter_expr_eval_with_context(self->right, msgs, num_msg, options)) ^ s->comp;
 }
@@ -111,10 +455,22 @@ fop_and_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEval
 {
   FilterOp *self = (FilterOp *) s;
 
+  if (self->operands)
+    return _eval_adaptive(self, msgs, num_msg, options, FALSE) ^ s->comp;
+
   return (filter_expr_eval_with_context(self->left, msgs, num_msg, options)
           && filter_expr_eval_with_context(self->right, msgs, num_msg, options)) ^ s->comp;
 }
 
+static gboolean
+fop_and_get_equality_test(FilterExprNode *s, NVHandle *handle, const gchar **value)
+{
+  FilterOp *self = (FilterOp *) s;
+
+  return filter_expr_get_equality_test(self->left, handle, value)
+         || filter_expr_get_equality_test(self->right, handle, value);
+}
+
 FilterExprNode *
 fop_and_new(FilterExprNode *e1, FilterExprNode *e2)
 {
@@ -122,6 +478,7 @@ fop_and_new(FilterExprNode *e1, FilterExprNode *e2)
 
   fop_init_instance(self);
   self->super.eval = fop_and_eval;
+  self->super.get_equality_test = fop_and_get_equality_test;
   self->left = e1;
   self->right = e2;
   self->super.type = g_strdup("AND");
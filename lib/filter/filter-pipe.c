@@ -114,6 +114,17 @@ log_filter_pipe_free(LogPipe *s)
   log_pipe_free_method(s);
 }
 
+gboolean
+log_filter_pipe_get_equality_test(LogPipe *s, NVHandle *handle, const gchar **value)
+{
+  LogFilterPipe *self = (LogFilterPipe *) s;
+
+  if (s->queue != log_filter_pipe_queue)
+    return FALSE;
+
+  return filter_expr_get_equality_test(self->expr, handle, value);
+}
+
 LogPipe *
 log_filter_pipe_new(FilterExprNode *expr, GlobalConfig *cfg)
 {
@@ -44,5 +44,6 @@ typedef struct _LogFilterPipe
 } LogFilterPipe;
 
 LogPipe *log_filter_pipe_new(FilterExprNode *expr, GlobalConfig *cfg);
+gboolean log_filter_pipe_get_equality_test(LogPipe *s, NVHandle *handle, const gchar **value);
 
 #endif
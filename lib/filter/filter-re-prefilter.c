@@ -0,0 +1,453 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "filter-re-prefilter.h"
+#include "module-config.h"
+#include "cfg.h"
+#include "atomic.h"
+#include "messages.h"
+#include "logmsg/logmsg.h"
+
+#include <string.h>
+
+#define MODULE_CONFIG_KEY "filter-re-prefilter"
+
+/* with fewer filters the scan would not pay off */
+#define FILTER_RE_PREFILTER_MIN_FILTERS 4
+
+/* upper limit of the transition table, in entries */
+#define FILTER_RE_PREFILTER_MAX_TRANSITIONS (4 * 1024 * 1024)
+
+#define FILTER_RE_PREFILTER_SCAN_SLOTS 4
+
+struct _FilterREPrefilter
+{
+  GAtomicCounter ref_cnt;
+  gint id;
+  NVHandle value_handle;
+
+  GMutex lock;
+  gint compiled;
+  gboolean enabled;
+  gint num_filters;
+  GPtrArray *literals;
+  GHashTable *literal_ids;
+
+  /* the automaton, a DFA over the byte classes of the literals, class 0
+   * being the bytes that do not occur in any of them */
+  guint8 classes[256];
+  gint num_classes;
+  gint num_states;
+  gint32 *transitions;
+  /* literal ending in the state or -1 */
+  gint32 *outputs;
+  /* first state with an output among the state and its suffixes or 0 */
+  gint32 *reports;
+  /* next state with an output among the suffixes or 0 */
+  gint32 *dict_links;
+};
+
+static gint prefilter_id_serial;
+
+/* Aho-Corasick automaton */
+
+static void
+_compute_classes(FilterREPrefilter *self)
+{
+  memset(self->classes, 0, sizeof(self->classes));
+  self->num_classes = 1;
+
+  for (gint i = 0; i < self->literals->len; i++)
+    {
+      const guchar *literal = g_ptr_array_index(self->literals, i);
+
+      for (; *literal; literal++)
+        {
+          if (self->classes[*literal])
+            continue;
+
+          self->classes[*literal] = self->num_classes;
+          if (g_ascii_isalpha(*literal))
+            self->classes[(guchar) g_ascii_toupper(*literal)] = self->num_classes;
+          self->num_classes++;
+        }
+    }
+}
+
+static gint
+_add_state(FilterREPrefilter *self, GArray *transitions, GArray *outputs)
+{
+  gint32 output = -1;
+
+  g_array_set_size(transitions, transitions->len + self->num_classes);
+  g_array_append_val(outputs, output);
+  return outputs->len - 1;
+}
+
+/* builds the trie, transitions of state 0 (the root) mean missing edges */
+static void
+_build_trie(FilterREPrefilter *self, GArray *transitions, GArray *outputs)
+{
+  _add_state(self, transitions, outputs);
+
+  for (gint i = 0; i < self->literals->len; i++)
+    {
+      const guchar *literal = g_ptr_array_index(self->literals, i);
+      gint32 state = 0;
+
+      for (; *literal; literal++)
+        {
+          gint ndx = state * self->num_classes + self->classes[*literal];
+          gint32 next = g_array_index(transitions, gint32, ndx);
+
+          if (!next)
+            {
+              next = _add_state(self, transitions, outputs);
+              g_array_index(transitions, gint32, ndx) = next;
+            }
+          state = next;
+        }
+      g_array_index(outputs, gint32, state) = i;
+    }
+}
+
+/* turns the trie into a DFA by following the failure links in BFS order */
+static void
+_compute_failure_transitions(FilterREPrefilter *self)
+{
+  gint32 *failures = g_new0(gint32, self->num_states);
+  gint32 *queue = g_new(gint32, self->num_states);
+  gint head = 0, tail = 0;
+
+  self->reports = g_new0(gint32, self->num_states);
+  self->dict_links = g_new0(gint32, self->num_states);
+
+  for (gint c = 1; c < self->num_classes; c++)
+    {
+      gint32 child = self->transitions[c];
+
+      if (child)
+        queue[tail++] = child;
+    }
+
+  while (head < tail)
+    {
+      gint32 state = queue[head++];
+      gint32 failure = failures[state];
+      gint32 *row = &self->transitions[state * self->num_classes];
+      gint32 *failure_row = &self->transitions[failure * self->num_classes];
+
+      self->dict_links[state] = self->outputs[failure] >= 0 ? failure : self->dict_links[failure];
+      self->reports[state] = self->outputs[state] >= 0 ? state : self->dict_links[state];
+
+      for (gint c = 0; c < self->num_classes; c++)
+        {
+          if (row[c])
+            {
+              failures[row[c]] = failure_row[c];
+              queue[tail++] = row[c];
+            }
+          else
+            {
+              row[c] = failure_row[c];
+            }
+        }
+    }
+
+  g_free(queue);
+  g_free(failures);
+}
+
+static gboolean
+_compile_automaton(FilterREPrefilter *self)
+{
+  GArray *transitions = g_array_new(FALSE, TRUE, sizeof(gint32));
+  GArray *outputs = g_array_new(FALSE, FALSE, sizeof(gint32));
+
+  _compute_classes(self);
+  _build_trie(self, transitions, outputs);
+
+  self->num_states = outputs->len;
+  self->transitions = (gint32 *) g_array_free(transitions, FALSE);
+  self->outputs = (gint32 *) g_array_free(outputs, FALSE);
+
+  if ((gint64) self->num_states * self->num_classes > FILTER_RE_PREFILTER_MAX_TRANSITIONS)
+    return FALSE;
+
+  _compute_failure_transitions(self);
+  return TRUE;
+}
+
+static void
+_scan(FilterREPrefilter *self, const gchar *value, gsize value_len, guint8 *found)
+{
+  gint32 state = 0;
+
+  memset(found, 0, (self->literals->len + 7) / 8);
+  for (gsize i = 0; i < value_len; i++)
+    {
+      state = self->transitions[state * self->num_classes + self->classes[(guchar) value[i]]];
+
+      for (gint32 s = self->reports[state]; s; s = self->dict_links[s])
+        found[self->outputs[s] / 8] |= 1 << (self->outputs[s] % 8);
+    }
+}
+
+/* per-thread cache of the last scans */
+
+typedef struct _FilterREPrefilterScan
+{
+  gint prefilter_id;
+  GString *value;
+  guint8 *found;
+} FilterREPrefilterScan;
+
+typedef struct _FilterREPrefilterScanCache
+{
+  FilterREPrefilterScan slots[FILTER_RE_PREFILTER_SCAN_SLOTS];
+  gint next_slot;
+} FilterREPrefilterScanCache;
+
+static void
+_scan_cache_free(gpointer s)
+{
+  FilterREPrefilterScanCache *self = (FilterREPrefilterScanCache *) s;
+
+  for (gint i = 0; i < FILTER_RE_PREFILTER_SCAN_SLOTS; i++)
+    {
+      if (self->slots[i].value)
+        g_string_free(self->slots[i].value, TRUE);
+      g_free(self->slots[i].found);
+    }
+  g_free(self);
+}
+
+static GPrivate scan_cache = G_PRIVATE_INIT(_scan_cache_free);
+
+static FilterREPrefilterScanCache *
+_get_scan_cache(void)
+{
+  FilterREPrefilterScanCache *cache = g_private_get(&scan_cache);
+
+  if (!cache)
+    {
+      cache = g_new0(FilterREPrefilterScanCache, 1);
+      g_private_set(&scan_cache, cache);
+    }
+  return cache;
+}
+
+/* the value is compared as the message may have been changed in place */
+static const guint8 *
+_lookup_scan(FilterREPrefilter *self, const gchar *value, gsize value_len)
+{
+  FilterREPrefilterScanCache *cache = _get_scan_cache();
+  FilterREPrefilterScan *scan;
+
+  for (gint i = 0; i < FILTER_RE_PREFILTER_SCAN_SLOTS; i++)
+    {
+      scan = &cache->slots[i];
+      if (scan->prefilter_id == self->id &&
+          scan->value->len == value_len &&
+          memcmp(scan->value->str, value, value_len) == 0)
+        return scan->found;
+    }
+
+  scan = &cache->slots[cache->next_slot];
+  cache->next_slot = (cache->next_slot + 1) % FILTER_RE_PREFILTER_SCAN_SLOTS;
+
+  if (!scan->value)
+    scan->value = g_string_sized_new(value_len);
+  if (scan->prefilter_id != self->id)
+    {
+      g_free(scan->found);
+      scan->found = g_new(guint8, (self->literals->len + 7) / 8);
+      scan->prefilter_id = self->id;
+    }
+  g_string_truncate(scan->value, 0);
+  g_string_append_len(scan->value, value, value_len);
+  _scan(self, value, value_len, scan->found);
+  return scan->found;
+}
+
+/* FilterREPrefilter */
+
+static gboolean
+_ensure_compiled(FilterREPrefilter *self)
+{
+  if (G_LIKELY(g_atomic_int_get(&self->compiled)))
+    return self->enabled;
+
+  g_mutex_lock(&self->lock);
+  if (!self->compiled)
+    {
+      self->enabled = self->num_filters >= FILTER_RE_PREFILTER_MIN_FILTERS && _compile_automaton(self);
+      msg_debug("Compiled shared prefilter of regexp filters",
+                evt_tag_str("value", log_msg_get_value_name(self->value_handle, NULL)),
+                evt_tag_int("filters", self->num_filters),
+                evt_tag_int("literals", self->literals->len),
+                evt_tag_int("enabled", self->enabled));
+      g_atomic_int_set(&self->compiled, TRUE);
+    }
+  g_mutex_unlock(&self->lock);
+  return self->enabled;
+}
+
+/*
+ * Returns the id of the literal to pass to
+ * filter_re_prefilter_may_match() or -1 if the prefilter is already in
+ * use, in which case the filter has to go without it.
+ */
+gint
+filter_re_prefilter_register(FilterREPrefilter *self, const gchar *literal)
+{
+  gint literal_id = -1;
+
+  if (!literal[0])
+    return -1;
+
+  g_mutex_lock(&self->lock);
+  if (!self->compiled)
+    {
+      gchar *folded = g_ascii_strdown(literal, -1);
+      gpointer id = g_hash_table_lookup(self->literal_ids, folded);
+
+      if (id)
+        {
+          g_free(folded);
+        }
+      else
+        {
+          g_ptr_array_add(self->literals, folded);
+          id = GINT_TO_POINTER(self->literals->len);
+          g_hash_table_insert(self->literal_ids, folded, id);
+        }
+      literal_id = GPOINTER_TO_INT(id) - 1;
+      self->num_filters++;
+    }
+  g_mutex_unlock(&self->lock);
+  return literal_id;
+}
+
+gboolean
+filter_re_prefilter_may_match(FilterREPrefilter *self, gint literal_id, const gchar *value, gsize value_len)
+{
+  if (!_ensure_compiled(self))
+    return TRUE;
+
+  const guint8 *found = _lookup_scan(self, value, value_len);
+  return (found[literal_id / 8] & (1 << (literal_id % 8))) != 0;
+}
+
+static FilterREPrefilter *
+filter_re_prefilter_new(NVHandle value_handle)
+{
+  FilterREPrefilter *self = g_new0(FilterREPrefilter, 1);
+
+  self->value_handle = value_handle;
+  g_atomic_counter_set(&self->ref_cnt, 1);
+  self->id = g_atomic_int_add(&prefilter_id_serial, 1) + 1;
+  g_mutex_init(&self->lock);
+  self->literals = g_ptr_array_new_with_free_func(g_free);
+  self->literal_ids = g_hash_table_new(g_str_hash, g_str_equal);
+  return self;
+}
+
+static void
+filter_re_prefilter_free(FilterREPrefilter *self)
+{
+  g_free(self->transitions);
+  g_free(self->outputs);
+  g_free(self->reports);
+  g_free(self->dict_links);
+  g_hash_table_unref(self->literal_ids);
+  g_ptr_array_free(self->literals, TRUE);
+  g_mutex_clear(&self->lock);
+  g_free(self);
+}
+
+FilterREPrefilter *
+filter_re_prefilter_ref(FilterREPrefilter *self)
+{
+  g_assert(!self || g_atomic_counter_get(&self->ref_cnt) > 0);
+
+  if (self)
+    g_atomic_counter_inc(&self->ref_cnt);
+  return self;
+}
+
+void
+filter_re_prefilter_unref(FilterREPrefilter *self)
+{
+  g_assert(!self || g_atomic_counter_get(&self->ref_cnt));
+
+  if (self && (g_atomic_counter_dec_and_test(&self->ref_cnt)))
+    filter_re_prefilter_free(self);
+}
+
+/* prefilters of a configuration, one per name-value pair */
+
+typedef struct _FilterREPrefilterConfig
+{
+  ModuleConfig super;
+  GHashTable *prefilters;
+} FilterREPrefilterConfig;
+
+static void
+_prefilter_config_free(ModuleConfig *s)
+{
+  FilterREPrefilterConfig *self = (FilterREPrefilterConfig *) s;
+
+  g_hash_table_unref(self->prefilters);
+  module_config_free_method(s);
+}
+
+static FilterREPrefilterConfig *
+_prefilter_config_get(GlobalConfig *cfg)
+{
+  FilterREPrefilterConfig *pc = g_hash_table_lookup(cfg->module_config, MODULE_CONFIG_KEY);
+
+  if (!pc)
+    {
+      pc = g_new0(FilterREPrefilterConfig, 1);
+      pc->super.free_fn = _prefilter_config_free;
+      pc->prefilters = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify) filter_re_prefilter_unref);
+      g_hash_table_insert(cfg->module_config, g_strdup(MODULE_CONFIG_KEY), pc);
+    }
+  return pc;
+}
+
+/* returns a new reference */
+FilterREPrefilter *
+filter_re_prefilter_get(GlobalConfig *cfg, NVHandle value_handle)
+{
+  FilterREPrefilterConfig *pc = _prefilter_config_get(cfg);
+  FilterREPrefilter *prefilter = g_hash_table_lookup(pc->prefilters, GUINT_TO_POINTER(value_handle));
+
+  if (!prefilter)
+    {
+      prefilter = filter_re_prefilter_new(value_handle);
+      g_hash_table_insert(pc->prefilters, GUINT_TO_POINTER(value_handle), prefilter);
+    }
+  return filter_re_prefilter_ref(prefilter);
+}
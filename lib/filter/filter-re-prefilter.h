@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef FILTER_RE_PREFILTER_H_INCLUDED
+#define FILTER_RE_PREFILTER_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "logmsg/nvtable.h"
+
+/*
+ * Shared literal prefilter of the regexp/string/glob filters that match
+ * the same name-value pair.
+ *
+ * Each filter registers the literal that is present in every value it
+ * accepts (see log_matcher_get_required_literal()).  The literals are
+ * compiled into a single Aho-Corasick automaton on first use, which scans
+ * the value once and answers all filters: a filter only runs its own
+ * matcher if its literal occurs in the value.  The result of the last few
+ * scans is cached per thread, as the filters of the log paths evaluate the
+ * same value one after the other.
+ *
+ * Literals are matched ignoring ASCII case, which is a necessary
+ * condition for case sensitive matchers too.
+ */
+typedef struct _FilterREPrefilter FilterREPrefilter;
+
+FilterREPrefilter *filter_re_prefilter_get(GlobalConfig *cfg, NVHandle value_handle);
+gint filter_re_prefilter_register(FilterREPrefilter *self, const gchar *literal);
+gboolean filter_re_prefilter_may_match(FilterREPrefilter *self, gint literal_id, const gchar *value, gsize value_len);
+
+FilterREPrefilter *filter_re_prefilter_ref(FilterREPrefilter *self);
+void filter_re_prefilter_unref(FilterREPrefilter *self);
+
+#endif
@@ -23,6 +23,7 @@
  */
 
 #include "filter-re.h"
+#include "filter-re-prefilter.h"
 #include "str-utils.h"
 #include "messages.h"
 #include "scratch-buffers.h"
@@ -34,6 +35,8 @@ typedef struct _FilterRE
   NVHandle value_handle;
   LogMatcherOptions matcher_options;
   LogMatcher *matcher;
+  FilterREPrefilter *prefilter;
+  gint prefilter_literal;
 } FilterRE;
 
 
@@ -68,7 +71,18 @@ filter_re_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEv
   value = log_msg_get_value(msg, self->value_handle, &len);
   APPEND_ZERO(value, value, len);
 
-  rc = filter_re_eval_string(s, msg, self->value_handle, value, len);
+  if (self->prefilter && !filter_re_prefilter_may_match(self->prefilter, self->prefilter_literal, value, len))
+    {
+      msg_trace("match() skipped, required literal is missing",
+                evt_tag_str("pattern", self->matcher->pattern),
+                evt_tag_str("value", log_msg_get_value_name(self->value_handle, NULL)),
+                evt_tag_printf("msg", "%p", msg));
+      rc = s->comp;
+    }
+  else
+    {
+      rc = filter_re_eval_string(s, msg, self->value_handle, value, len);
+    }
 
   nv_table_unref(payload);
   return rc;
@@ -79,10 +93,29 @@ filter_re_free(FilterExprNode *s)
 {
   FilterRE *self = (FilterRE *) s;
 
+  filter_re_prefilter_unref(self->prefilter);
   log_matcher_unref(self->matcher);
   log_matcher_options_destroy(&self->matcher_options);
 }
 
+static void
+filter_re_register_prefilter(FilterRE *self, GlobalConfig *cfg)
+{
+  gchar *literal = log_matcher_get_required_literal(self->matcher);
+
+  if (!literal)
+    return;
+
+  self->prefilter = filter_re_prefilter_get(cfg, self->value_handle);
+  self->prefilter_literal = filter_re_prefilter_register(self->prefilter, literal);
+  if (self->prefilter_literal < 0)
+    {
+      filter_re_prefilter_unref(self->prefilter);
+      self->prefilter = NULL;
+    }
+  g_free(literal);
+}
+
 static gboolean
 filter_re_init(FilterExprNode *s, GlobalConfig *cfg)
 {
@@ -91,6 +124,10 @@ filter_re_init(FilterExprNode *s, GlobalConfig *cfg)
   if (self->matcher_options.flags & LMF_STORE_MATCHES)
     self->super.modify = TRUE;
 
+  /* an expression may be initialized once for each of its references */
+  if (cfg && self->matcher && !self->prefilter && self->value_handle != LM_V_NONE)
+    filter_re_register_prefilter(self, cfg);
+
   return TRUE;
 }
 
@@ -125,12 +162,30 @@ filter_re_init_instance(FilterRE *self, NVHandle value_handle)
   self->matcher_options.flags |= LMF_MATCH_ONLY;
 }
 
+/* only plain, case sensitive string matchers test for equality */
+static gboolean
+filter_re_get_equality_test(FilterExprNode *s, NVHandle *handle, const gchar **value)
+{
+  FilterRE *self = (FilterRE *) s;
+
+  if (!self->matcher || !self->matcher_options.type || strcmp(self->matcher_options.type, "string") != 0)
+    return FALSE;
+
+  if (self->matcher->flags & (LMF_ICASE | LMF_SUBSTRING | LMF_PREFIX | LMF_STORE_MATCHES))
+    return FALSE;
+
+  *handle = self->value_handle;
+  *value = self->matcher->pattern;
+  return TRUE;
+}
+
 FilterExprNode *
 filter_re_new(NVHandle value_handle)
 {
   FilterRE *self = g_new0(FilterRE, 1);
 
   filter_re_init_instance(self, value_handle);
+  self->super.get_equality_test = filter_re_get_equality_test;
   return &self->super;
 }
 
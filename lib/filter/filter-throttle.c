@@ -225,6 +225,7 @@ filter_throttle_new(void)
   self->super.eval = filter_throttle_eval;
   self->super.free_fn = filter_throttle_free;
   self->super.clone = filter_throttle_clone;
+  self->super.stateful = TRUE;
   g_mutex_init(&self->map_lock);
   self->rate_limits = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)throttle_ratelimit_free);
 
@@ -24,6 +24,7 @@
 #include <criterion/criterion.h>
 #include <criterion/parameterized.h>
 #include "test_filters_common.h"
+#include "libtest/perf_lib.h"
 
 #include "filter/filter-op.h"
 #include "filter/filter-expr.h"
@@ -31,6 +32,8 @@
 #include "filter/filter-expr-parser.h"
 #include "cfg-lexer.h"
 #include "apphook.h"
+#include "cfg.h"
+#include "logmsg/logmsg.h"
 
 static FilterExprNode *
 _compile_standalone_filter(gchar *config_snippet)
@@ -94,4 +97,187 @@ ParameterizedTest(FilterParams *params, filter_op, test_or_evaluation)
   testcase(msg, filter, params->expected_result);
 }
 
+typedef struct _CountingFilter
+{
+  FilterExprNode super;
+  gboolean result;
+  gint evals;
+} CountingFilter;
+
+static gboolean
+_counting_filter_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEvalOptions *options)
+{
+  CountingFilter *self = (CountingFilter *) s;
+
+  self->evals++;
+  return self->result ^ s->comp;
+}
+
+static CountingFilter *
+_counting_filter_new(gboolean result)
+{
+  CountingFilter *self = g_new0(CountingFilter, 1);
+
+  filter_expr_node_init_instance(&self->super);
+  self->super.eval = _counting_filter_eval;
+  self->super.type = "counting";
+  self->result = result;
+  return self;
+}
+
+static void
+_eval_repeatedly(FilterExprNode *filter, gint times, gboolean expected_result)
+{
+  const gchar *msg = "<16> openvpn[2499]: PTHREAD support initialized";
+  LogMessage *logmsg = log_msg_new(msg, strlen(msg), &parse_options);
+
+  for (gint i = 0; i < times; i++)
+    cr_assert_eq(filter_expr_eval(filter, logmsg), expected_result);
+
+  log_msg_unref(logmsg);
+}
+
+static void
+_reset_counters(CountingFilter **filters, gint num_filters)
+{
+  for (gint i = 0; i < num_filters; i++)
+    filters[i]->evals = 0;
+}
+
+Test(filter_op, test_adaptive_order_moves_selective_operands_first)
+{
+  CountingFilter *f[] = { _counting_filter_new(TRUE), _counting_filter_new(TRUE), _counting_filter_new(FALSE) };
+  FilterExprNode *filter = fop_and_new(fop_and_new(&f[0]->super, &f[1]->super), &f[2]->super);
+
+  configuration->adaptive_filter_order = TRUE;
+  cr_assert(filter_expr_init(filter, configuration));
+
+  _eval_repeatedly(filter, 20000, FALSE);
+  _reset_counters(f, G_N_ELEMENTS(f));
+  _eval_repeatedly(filter, 10000, FALSE);
+
+  cr_assert_eq(f[0]->evals, 0);
+  cr_assert_eq(f[1]->evals, 0);
+  cr_assert_eq(f[2]->evals, 10000);
+
+  filter->comp = TRUE;
+  _eval_repeatedly(filter, 100, TRUE);
+
+  filter_expr_unref(filter);
+}
+
+Test(filter_op, test_adaptive_order_or)
+{
+  CountingFilter *f[] = { _counting_filter_new(FALSE), _counting_filter_new(FALSE), _counting_filter_new(TRUE) };
+  FilterExprNode *filter = fop_or_new(&f[0]->super, fop_or_new(&f[1]->super, &f[2]->super));
+
+  configuration->adaptive_filter_order = TRUE;
+  cr_assert(filter_expr_init(filter, configuration));
+
+  _eval_repeatedly(filter, 20000, TRUE);
+  _reset_counters(f, G_N_ELEMENTS(f));
+  _eval_repeatedly(filter, 10000, TRUE);
+
+  cr_assert_eq(f[0]->evals, 0);
+  cr_assert_eq(f[1]->evals, 0);
+  cr_assert_eq(f[2]->evals, 10000);
+
+  filter_expr_unref(filter);
+}
+
+Test(filter_op, test_adaptive_order_of_nested_chains)
+{
+  CountingFilter *f[] = { _counting_filter_new(TRUE), _counting_filter_new(FALSE), _counting_filter_new(TRUE) };
+  FilterExprNode *filter = fop_or_new(fop_and_new(&f[0]->super, &f[1]->super), &f[2]->super);
+
+  /* both chains are evaluated for each message, each must be sampled on its own */
+  configuration->adaptive_filter_order = TRUE;
+  cr_assert(filter_expr_init(filter, configuration));
+
+  _eval_repeatedly(filter, 20000, TRUE);
+  _reset_counters(f, G_N_ELEMENTS(f));
+  _eval_repeatedly(filter, 10000, TRUE);
+
+  cr_assert_eq(f[0]->evals, 0);
+  cr_assert_eq(f[1]->evals, 0);
+  cr_assert_eq(f[2]->evals, 10000);
+
+  filter_expr_unref(filter);
+}
+
+Test(filter_op, test_adaptive_order_keeps_operands_with_side_effects_in_place)
+{
+  CountingFilter *f[] = { _counting_filter_new(TRUE), _counting_filter_new(TRUE), _counting_filter_new(FALSE) };
+  FilterExprNode *filter = fop_and_new(fop_and_new(&f[0]->super, &f[1]->super), &f[2]->super);
+
+  f[1]->super.modify = TRUE;
+  configuration->adaptive_filter_order = TRUE;
+  cr_assert(filter_expr_init(filter, configuration));
+  cr_assert(filter->modify);
+
+  _eval_repeatedly(filter, 20000, FALSE);
+  _reset_counters(f, G_N_ELEMENTS(f));
+  _eval_repeatedly(filter, 10000, FALSE);
+
+  /* f[2] may not be moved before f[1], which in turn stays after f[0] */
+  cr_assert_eq(f[0]->evals, 10000);
+  cr_assert_eq(f[1]->evals, 10000);
+  cr_assert_eq(f[2]->evals, 10000);
+
+  filter_expr_unref(filter);
+}
+
+Test(filter_op, test_configured_order_is_kept_by_default)
+{
+  CountingFilter *f[] = { _counting_filter_new(TRUE), _counting_filter_new(FALSE) };
+  FilterExprNode *filter = fop_and_new(&f[0]->super, &f[1]->super);
+
+  cr_assert(filter_expr_init(filter, configuration));
+
+  _eval_repeatedly(filter, 20000, FALSE);
+  cr_assert_eq(f[0]->evals, 20000);
+  cr_assert_eq(f[1]->evals, 20000);
+
+  filter_expr_unref(filter);
+}
+
+static gdouble
+_measure_filter(const gchar *config_snippet, gboolean adaptive, gint *matches)
+{
+  LogMessage *msgs[16];
+  const gint num_msgs = G_N_ELEMENTS(msgs);
+
+  configuration->adaptive_filter_order = adaptive;
+  FilterExprNode *filter = _compile_standalone_filter((gchar *) config_snippet);
+  cr_assert(filter_expr_init(filter, configuration));
+
+  for (gint i = 0; i < num_msgs; i++)
+    {
+      gchar *msg = g_strdup_printf("<%d> openvpn[2499]: PTHREAD support initialized, client %d connected",
+                                   i == 0 ? 16 : 14, i);
+      msgs[i] = log_msg_new(msg, strlen(msg), &parse_options);
+      g_free(msg);
+    }
+
+  gdouble rate = perf_measure_filter_rate(filter, msgs, num_msgs, num_msgs * PERF_MESSAGES, matches);
+
+  for (gint i = 0; i < num_msgs; i++)
+    log_msg_unref(msgs[i]);
+  filter_expr_unref(filter);
+  return rate;
+}
+
+Test(filter_op, test_adaptive_order_performance)
+{
+  const gchar *snippet = "message('client [0-9]+ connected$' type(pcre)) and program('^openvpn$' type(pcre)) "
+                         "and facility(2)";
+  gint configured_matches, adaptive_matches;
+
+  gdouble configured_rate = _measure_filter(snippet, FALSE, &configured_matches);
+  gdouble adaptive_rate = _measure_filter(snippet, TRUE, &adaptive_matches);
+
+  cr_assert_eq(configured_matches, adaptive_matches);
+  perf_print_rates("Filter evaluation", "configured order", configured_rate, "adaptive order", adaptive_rate);
+}
+
 TestSuite(filter_op, .init = setup, .fini = teardown);
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "filter/filter-in-list-set.h"
+#include "filter/filter-in-list.h"
+#include "timeutils/misc.h"
+#include "apphook.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define LINES "foo\nbar\n\nbaz\nfoo\nlast-line-without-newline"
+
+static gboolean
+_contains(InListSet *set, const gchar *value)
+{
+  return in_list_set_contains(set, value, strlen(value));
+}
+
+static gchar *
+_create_temp_file(const gchar *contents, gsize contents_len)
+{
+  gchar *filename;
+  gint fd = g_file_open_tmp("in-listXXXXXX", &filename, NULL);
+
+  cr_assert(fd >= 0);
+  close(fd);
+  cr_assert(g_file_set_contents(filename, contents, contents_len, NULL));
+  return filename;
+}
+
+static void
+_assert_set_contains_lines(InListSet *set)
+{
+  cr_assert_eq(in_list_set_get_size(set), 4);
+  cr_assert(_contains(set, "foo"));
+  cr_assert(_contains(set, "bar"));
+  cr_assert(_contains(set, "baz"));
+  cr_assert(_contains(set, "last-line-without-newline"));
+
+  cr_assert_not(_contains(set, ""));
+  cr_assert_not(_contains(set, "fo"));
+  cr_assert_not(_contains(set, "fooo"));
+  cr_assert_not(_contains(set, "qux"));
+}
+
+Test(in_list_set, test_lines_are_looked_up_by_their_length)
+{
+  InListSet *set = in_list_set_new_from_lines(LINES, strlen(LINES));
+
+  _assert_set_contains_lines(set);
+
+  /* the value does not need to be NUL terminated */
+  cr_assert(in_list_set_contains(set, "foobar", 3));
+  cr_assert(in_list_set_contains(set, "barfoo" + 3, 3));
+  in_list_set_free(set);
+}
+
+static gchar *
+_compile_temp_file(const gchar *list_file)
+{
+  InListSet *set = in_list_set_load(list_file, NULL);
+  gchar *filename = _create_temp_file("", 0);
+
+  cr_assert_not_null(set);
+  cr_assert(in_list_set_save(set, filename, NULL));
+  in_list_set_free(set);
+  return filename;
+}
+
+static void
+_set_mtime(const gchar *filename, time_t sec, glong nsec)
+{
+  struct timespec times[2] = { { .tv_sec = sec, .tv_nsec = nsec }, { .tv_sec = sec, .tv_nsec = nsec } };
+
+  cr_assert(utimensat(AT_FDCWD, filename, times, 0) == 0);
+}
+
+Test(in_list_set, test_saved_set_is_loaded_back)
+{
+  gchar *list_file = _create_temp_file(LINES, strlen(LINES));
+  gchar *filename = _compile_temp_file(list_file);
+
+  InListSet *set = in_list_set_load_compiled(filename, list_file, NULL);
+  cr_assert_not_null(set);
+  _assert_set_contains_lines(set);
+  in_list_set_free(set);
+
+  g_unlink(filename);
+  g_unlink(list_file);
+  g_free(filename);
+  g_free(list_file);
+}
+
+Test(in_list_set, test_corrupted_compiled_file_is_rejected)
+{
+  gchar *list_file = _create_temp_file(LINES, strlen(LINES));
+  gchar *filename = _compile_temp_file(list_file);
+  gchar *contents;
+  gsize contents_len;
+  GError *error = NULL;
+
+  /* truncate the string area */
+  cr_assert(g_file_get_contents(filename, &contents, &contents_len, NULL));
+  cr_assert(g_file_set_contents(filename, contents, contents_len - 1, NULL));
+  g_free(contents);
+
+  cr_assert_null(in_list_set_load_compiled(filename, list_file, &error));
+  cr_assert_not_null(error);
+  g_clear_error(&error);
+
+  g_unlink(filename);
+  g_unlink(list_file);
+  g_free(filename);
+  g_free(list_file);
+}
+
+Test(in_list_set, test_compiled_file_is_rejected_once_the_list_changes_within_the_same_second)
+{
+  gchar *list_file = _create_temp_file(LINES, strlen(LINES));
+  gchar *filename;
+  GError *error = NULL;
+
+  _set_mtime(list_file, 1600000000, 100);
+  filename = _compile_temp_file(list_file);
+
+  /* same size, same second */
+  _set_mtime(list_file, 1600000000, 200);
+  cr_assert_null(in_list_set_load_compiled(filename, list_file, &error));
+  cr_assert_not_null(error);
+  g_clear_error(&error);
+
+  /* same modification time, different size */
+  cr_assert(g_file_set_contents(list_file, "foo\n", 4, NULL));
+  _set_mtime(list_file, 1600000000, 100);
+  cr_assert_null(in_list_set_load_compiled(filename, list_file, &error));
+  cr_assert_not_null(error);
+  g_clear_error(&error);
+
+  g_unlink(filename);
+  g_unlink(list_file);
+  g_free(filename);
+  g_free(list_file);
+}
+
+Test(in_list_set, test_list_starting_with_the_magic_is_parsed_as_a_list)
+{
+  const gchar *lines = "SNGINLS2-looks-like-an-image-but-it-is-a-list\nfoo\n";
+  gchar *list_file = _create_temp_file(lines, strlen(lines));
+
+  InListSet *set = in_list_set_load(list_file, NULL);
+  cr_assert_not_null(set);
+  cr_assert_eq(in_list_set_get_size(set), 2);
+  cr_assert(_contains(set, "SNGINLS2-looks-like-an-image-but-it-is-a-list"));
+  cr_assert(_contains(set, "foo"));
+  in_list_set_free(set);
+
+  /* neither is it accepted as a compiled image */
+  cr_assert_null(in_list_set_load_compiled(list_file, list_file, NULL));
+
+  g_unlink(list_file);
+  g_free(list_file);
+}
+
+Test(in_list_set, test_list_file_is_compiled_next_to_the_list)
+{
+  const gchar *lines = "foo\n";
+  gchar *list_file = _create_temp_file(lines, strlen(lines));
+  gchar *compiled_file = g_strconcat(list_file, ".compiled", NULL);
+  InListSet *set;
+
+  cr_assert(filter_in_list_compile(list_file));
+
+  set = in_list_set_load_compiled(compiled_file, list_file, NULL);
+  cr_assert_not_null(set);
+  cr_assert(_contains(set, "foo"));
+  in_list_set_free(set);
+
+  g_unlink(compiled_file);
+  g_unlink(list_file);
+  g_free(compiled_file);
+  g_free(list_file);
+}
+
+#define PERF_NUM_ENTRIES 500000
+#define PERF_NUM_LOOKUPS 2000000
+
+static GString *
+_construct_ioc_list(void)
+{
+  GString *lines = g_string_sized_new(PERF_NUM_ENTRIES * 16);
+
+  for (gint i = 0; i < PERF_NUM_ENTRIES; i++)
+    g_string_append_printf(lines, "10.%d.%d.%d\n", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+  return lines;
+}
+
+static void
+_construct_lookup_values(gchar values[][32], gint num_values)
+{
+  for (gint i = 0; i < num_values; i++)
+    {
+      /* every other value is missing from the list */
+      gint n = g_random_int_range(0, PERF_NUM_ENTRIES);
+      g_snprintf(values[i], sizeof(values[i]), "%d.%d.%d.%d", (i % 2) ? 10 : 11,
+                 (n >> 16) & 0xff, (n >> 8) & 0xff, n & 0xff);
+    }
+}
+
+Test(in_list_set, test_performance_compared_to_gtree)
+{
+  GString *lines = _construct_ioc_list();
+  gchar (*values)[32] = g_malloc(1024 * sizeof(*values));
+  GTimeVal start, end;
+  gint found_in_set = 0, found_in_tree = 0;
+
+  _construct_lookup_values(values, 1024);
+
+  InListSet *set = in_list_set_new_from_lines(lines->str, lines->len);
+  cr_assert_eq(in_list_set_get_size(set), PERF_NUM_ENTRIES);
+
+  GTree *tree = g_tree_new_full((GCompareDataFunc) strcmp, NULL, g_free, NULL);
+  gchar **entries = g_strsplit(lines->str, "\n", -1);
+  for (gint i = 0; entries[i]; i++)
+    {
+      if (entries[i][0])
+        g_tree_insert(tree, g_strdup(entries[i]), GINT_TO_POINTER(1));
+    }
+  g_strfreev(entries);
+
+  g_get_current_time(&start);
+  for (gint i = 0; i < PERF_NUM_LOOKUPS; i++)
+    {
+      const gchar *value = values[i % 1024];
+      if (in_list_set_contains(set, value, strlen(value)))
+        found_in_set++;
+    }
+  g_get_current_time(&end);
+  printf("      in-list set: %12.3f lookups/sec\n", PERF_NUM_LOOKUPS * 1e6 / g_time_val_diff(&end, &start));
+
+  g_get_current_time(&start);
+  for (gint i = 0; i < PERF_NUM_LOOKUPS; i++)
+    {
+      if (g_tree_lookup(tree, values[i % 1024]))
+        found_in_tree++;
+    }
+  g_get_current_time(&end);
+  printf("      GTree      : %12.3f lookups/sec\n", PERF_NUM_LOOKUPS * 1e6 / g_time_val_diff(&end, &start));
+
+  cr_assert_eq(found_in_set, found_in_tree);
+  cr_assert_eq(found_in_set, PERF_NUM_LOOKUPS / 2);
+
+  g_tree_destroy(tree);
+  in_list_set_free(set);
+  g_free(values);
+  g_string_free(lines, TRUE);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+}
+
+static void
+teardown(void)
+{
+  app_shutdown();
+}
+
+TestSuite(in_list_set, .init = setup, .fini = teardown);
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "libtest/perf_lib.h"
+
+#include "filter/filter-netmask-trie.h"
+#include "filter/filter-netmask-list.h"
+#include "filter/filter-netmask.h"
+#include "filter/filter-op.h"
+#include "logmsg/logmsg.h"
+#include "gsockaddr.h"
+#include "apphook.h"
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#define NETWORKS \
+  "# private networks\n" \
+  "10.0.0.0/8\n" \
+  "  192.168.1.0/255.255.255.0  \n" \
+  "\n" \
+  "172.16.0.0/12\n" \
+  "10.1.0.0/16\n" \
+  "100.64.0.0/10\n" \
+  "5.6.7.0/25\n" \
+  "1.2.3.4\n" \
+  "2001:db8::/32\n" \
+  "::1"
+
+static gboolean
+_lookup(NetmaskTrie *trie, const gchar *address)
+{
+  struct in6_addr address6;
+  struct in_addr address4;
+
+  if (inet_pton(AF_INET, address, &address4) == 1)
+    return netmask_trie_lookup_ipv4(trie, &address4);
+
+  cr_assert_eq(inet_pton(AF_INET6, address, &address6), 1);
+  return netmask_trie_lookup_ipv6(trie, &address6);
+}
+
+static gchar *
+_create_temp_file(const gchar *contents, gsize contents_len)
+{
+  gchar *filename;
+  gint fd = g_file_open_tmp("netmask-listXXXXXX", &filename, NULL);
+
+  cr_assert(fd >= 0);
+  close(fd);
+  cr_assert(g_file_set_contents(filename, contents, contents_len, NULL));
+  return filename;
+}
+
+Test(netmask_trie, test_addresses_are_matched_against_all_networks)
+{
+  NetmaskTrie *trie = netmask_trie_new_from_lines(NETWORKS, strlen(NETWORKS), NULL);
+
+  cr_assert_not_null(trie);
+  cr_assert_eq(netmask_trie_get_size(trie), 9);
+
+  cr_assert(_lookup(trie, "10.0.0.0"));
+  cr_assert(_lookup(trie, "10.255.1.1"));
+  cr_assert_not(_lookup(trie, "9.255.255.255"));
+  cr_assert_not(_lookup(trie, "11.0.0.0"));
+
+  cr_assert(_lookup(trie, "192.168.1.77"));
+  cr_assert_not(_lookup(trie, "192.168.2.1"));
+
+  cr_assert(_lookup(trie, "172.16.0.1"));
+  cr_assert(_lookup(trie, "172.31.255.255"));
+  cr_assert_not(_lookup(trie, "172.15.255.255"));
+  cr_assert_not(_lookup(trie, "172.32.0.0"));
+
+  cr_assert(_lookup(trie, "100.127.0.1"));
+  cr_assert_not(_lookup(trie, "100.128.0.1"));
+  cr_assert(_lookup(trie, "5.6.7.127"));
+  cr_assert_not(_lookup(trie, "5.6.7.128"));
+  cr_assert(_lookup(trie, "1.2.3.4"));
+  cr_assert_not(_lookup(trie, "1.2.3.5"));
+
+  cr_assert(_lookup(trie, "2001:db8:1::5"));
+  cr_assert_not(_lookup(trie, "2001:db9::1"));
+  cr_assert(_lookup(trie, "::1"));
+  cr_assert_not(_lookup(trie, "::2"));
+
+  /* IPv4-mapped addresses are matched against the IPv4 networks */
+  cr_assert(_lookup(trie, "::ffff:10.2.3.4"));
+  cr_assert_not(_lookup(trie, "::ffff:11.2.3.4"));
+
+  netmask_trie_free(trie);
+}
+
+Test(netmask_trie, test_default_route_matches_every_address_of_its_family)
+{
+  const gchar *networks = "0.0.0.0/0\n";
+  NetmaskTrie *trie = netmask_trie_new_from_lines(networks, strlen(networks), NULL);
+
+  cr_assert(_lookup(trie, "0.0.0.0"));
+  cr_assert(_lookup(trie, "255.255.255.255"));
+  cr_assert_not(_lookup(trie, "2001:db8::1"));
+  netmask_trie_free(trie);
+}
+
+Test(netmask_trie, test_invalid_networks_are_rejected)
+{
+  const gchar *invalid_lines[] =
+  {
+    "10.0.0.0/33",
+    "10.0.0/8",
+    "10.0.0.0/255.0.255.0",
+    "10.0.0.0/",
+    "10.0.0.0/8x",
+    "2001:db8::/129",
+    "example.com",
+  };
+
+  for (gint i = 0; i < G_N_ELEMENTS(invalid_lines); i++)
+    {
+      gchar *lines = g_strdup_printf("10.0.0.0/8\n%s\n", invalid_lines[i]);
+      GError *error = NULL;
+
+      cr_assert_null(netmask_trie_new_from_lines(lines, strlen(lines), &error), "%s", invalid_lines[i]);
+      cr_assert_not_null(error);
+      cr_assert(strstr(error->message, "line 2"), "%s", error->message);
+      g_clear_error(&error);
+      g_free(lines);
+    }
+}
+
+static LogMessage *
+_create_message(const gchar *saddr)
+{
+  LogMessage *msg = log_msg_new_empty();
+
+  if (saddr && strchr(saddr, ':'))
+    {
+#if SYSLOG_NG_ENABLE_IPV6
+      log_msg_set_saddr_ref(msg, g_sockaddr_inet6_new(saddr, 514));
+#endif
+    }
+  else if (saddr)
+    {
+      log_msg_set_saddr_ref(msg, g_sockaddr_inet_new(saddr, 514));
+    }
+  return msg;
+}
+
+Test(netmask_list, test_source_address_and_values_are_matched)
+{
+  gchar *filename = _create_temp_file(NETWORKS, strlen(NETWORKS));
+  FilterExprNode *saddr_filter = filter_netmask_list_new(filename, NULL);
+  FilterExprNode *value_filter = filter_netmask_list_new(filename, "client_ip");
+  LogMessage *msg;
+
+  cr_assert_not_null(saddr_filter);
+  cr_assert_not_null(value_filter);
+
+  msg = _create_message("10.1.2.3");
+  cr_assert(filter_expr_eval(saddr_filter, msg));
+  cr_assert_not(filter_expr_eval(value_filter, msg));
+  log_msg_set_value_by_name(msg, "client_ip", "192.168.1.1", -1);
+  cr_assert(filter_expr_eval(value_filter, msg));
+  log_msg_set_value_by_name(msg, "client_ip", "2001:db8::1", -1);
+  cr_assert(filter_expr_eval(value_filter, msg));
+  log_msg_set_value_by_name(msg, "client_ip", "192.168.3.1", -1);
+  cr_assert_not(filter_expr_eval(value_filter, msg));
+  log_msg_set_value_by_name(msg, "client_ip", "not an address", -1);
+  cr_assert_not(filter_expr_eval(value_filter, msg));
+  log_msg_unref(msg);
+
+  msg = _create_message("8.8.8.8");
+  cr_assert_not(filter_expr_eval(saddr_filter, msg));
+  saddr_filter->comp = TRUE;
+  cr_assert(filter_expr_eval(saddr_filter, msg));
+  saddr_filter->comp = FALSE;
+  log_msg_unref(msg);
+
+#if SYSLOG_NG_ENABLE_IPV6
+  msg = _create_message("2001:db8::5");
+  cr_assert(filter_expr_eval(saddr_filter, msg));
+  log_msg_unref(msg);
+#endif
+
+  /* local messages come from the loopback address */
+  msg = _create_message(NULL);
+  cr_assert(filter_expr_eval(saddr_filter, msg));
+  log_msg_unref(msg);
+
+  filter_expr_unref(saddr_filter);
+  filter_expr_unref(value_filter);
+  g_unlink(filename);
+  g_free(filename);
+}
+
+Test(netmask_list, test_missing_list_file_fails)
+{
+  cr_assert_null(filter_netmask_list_new("/nonexistent/netmask.list", NULL));
+}
+
+#define PERF_NUM_NETWORKS 20000
+#define PERF_NUM_MESSAGES 1024
+#define PERF_ORCHAIN_ROUNDS 4
+#define PERF_LIST_ROUNDS 2000
+/* fixed, so that every run measures the same networks and addresses */
+#define PERF_RANDOM_SEED 0x5ca1ab1e
+
+static guint32
+_random_network(GRand *rand, gint *prefix)
+{
+  *prefix = g_rand_int_range(rand, 12, 33);
+  return g_rand_int(rand) & ~(guint32) ((G_GUINT64_CONSTANT(1) << (32 - *prefix)) - 1);
+}
+
+/* balanced, so that evaluating it does not recurse once per network */
+static FilterExprNode *
+_construct_or_chain(gchar **cidrs, gint lo, gint hi)
+{
+  if (hi - lo == 1)
+    return filter_netmask_new(cidrs[lo]);
+
+  gint mid = (lo + hi) / 2;
+  return fop_or_new(_construct_or_chain(cidrs, lo, mid), _construct_or_chain(cidrs, mid, hi));
+}
+
+static gint
+_count_matches(FilterExprNode *filter, LogMessage **msgs, gint rounds, gdouble *rate)
+{
+  gint matches;
+
+  *rate = perf_measure_filter_rate(filter, msgs, PERF_NUM_MESSAGES, rounds * PERF_NUM_MESSAGES, &matches);
+  return matches / rounds;
+}
+
+Test(netmask_list, test_performance_compared_to_netmask_or_chain)
+{
+  gchar **cidrs = g_new0(gchar *, PERF_NUM_NETWORKS + 1);
+  GString *lines = g_string_new("");
+  LogMessage *msgs[PERF_NUM_MESSAGES];
+  GRand *rand = g_rand_new_with_seed(PERF_RANDOM_SEED);
+  gdouble orchain_rate, list_rate;
+
+  for (gint i = 0; i < PERF_NUM_NETWORKS; i++)
+    {
+      struct in_addr network;
+      gint prefix;
+
+      network.s_addr = htonl(_random_network(rand, &prefix));
+      cidrs[i] = g_strdup_printf("%s/%d", inet_ntoa(network), prefix);
+      g_string_append_printf(lines, "%s\n", cidrs[i]);
+    }
+
+  for (gint i = 0; i < PERF_NUM_MESSAGES; i++)
+    {
+      struct in_addr address;
+
+      address.s_addr = htonl(g_rand_int(rand));
+      msgs[i] = _create_message(inet_ntoa(address));
+    }
+
+  gchar *filename = _create_temp_file(lines->str, lines->len);
+  FilterExprNode *list_filter = filter_netmask_list_new(filename, NULL);
+  FilterExprNode *orchain_filter = _construct_or_chain(cidrs, 0, PERF_NUM_NETWORKS);
+
+  gint orchain_matches = _count_matches(orchain_filter, msgs, PERF_ORCHAIN_ROUNDS, &orchain_rate);
+  gint list_matches = _count_matches(list_filter, msgs, PERF_LIST_ROUNDS, &list_rate);
+
+  perf_print_rates("20000 networks", "netmask-list()", list_rate, "netmask() or-chain", orchain_rate);
+  cr_assert_eq(list_matches, orchain_matches);
+
+  for (gint i = 0; i < PERF_NUM_MESSAGES; i++)
+    log_msg_unref(msgs[i]);
+  filter_expr_unref(orchain_filter);
+  filter_expr_unref(list_filter);
+  g_unlink(filename);
+  g_free(filename);
+  g_string_free(lines, TRUE);
+  g_strfreev(cidrs);
+  g_rand_free(rand);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+}
+
+static void
+teardown(void)
+{
+  app_shutdown();
+}
+
+TestSuite(netmask_trie, .init = setup, .fini = teardown);
+TestSuite(netmask_list, .init = setup, .fini = teardown);
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "libtest/perf_lib.h"
+
+#include "filter/filter-expr.h"
+#include "logmatcher.h"
+#include "apphook.h"
+
+static gchar *
+_get_required_literal(const gchar *type, const gchar *pattern, gint flags)
+{
+  LogMatcherOptions options;
+
+  log_matcher_options_defaults(&options);
+  cr_assert(log_matcher_options_set_type(&options, type));
+  options.flags = flags;
+
+  LogMatcher *matcher = log_matcher_new(&options);
+  cr_assert(log_matcher_compile(matcher, pattern, NULL));
+
+  gchar *literal = log_matcher_get_required_literal(matcher);
+
+  log_matcher_unref(matcher);
+  log_matcher_options_destroy(&options);
+  return literal;
+}
+
+static void
+_assert_required_literal(const gchar *type, const gchar *pattern, gint flags, const gchar *expected)
+{
+  gchar *literal = _get_required_literal(type, pattern, flags);
+
+  if (expected)
+    cr_assert_str_eq(literal, expected, "pattern: %s", pattern);
+  else
+    cr_assert_null(literal, "pattern: %s, literal: %s", pattern, literal);
+  g_free(literal);
+}
+
+Test(prefilter, required_literal_of_string_and_glob_matchers)
+{
+  _assert_required_literal("string", "disk full", 0, "disk full");
+  _assert_required_literal("string", "disk", LMF_PREFIX | LMF_ICASE, "disk");
+  _assert_required_literal("string", "ab", LMF_SUBSTRING, NULL);
+  _assert_required_literal("glob", "*disk*full?", 0, "disk");
+  _assert_required_literal("glob", "*?*", 0, NULL);
+}
+
+Test(prefilter, required_literal_of_pcre_matcher)
+{
+  _assert_required_literal("pcre", "foobar", 0, "foobar");
+  _assert_required_literal("pcre", "foobar", LMF_ICASE, "foobar");
+  _assert_required_literal("pcre", "user (\\w+) logged in", 0, " logged in");
+  _assert_required_literal("pcre", "abc*def", 0, "def");
+  _assert_required_literal("pcre", "abc+de", 0, "abc");
+  _assert_required_literal("pcre", "hello{2,3}world", 0, "world");
+  _assert_required_literal("pcre", "[]x]yzw", 0, "yzw");
+  _assert_required_literal("pcre", "[[:alpha:]]+ klmno", 0, " klmno");
+  _assert_required_literal("pcre", "a\\.b\\.c\\.d", 0, "a.b.c.d");
+  _assert_required_literal("pcre", "\\d+ connections? from", 0, " connection");
+  _assert_required_literal("pcre", "(foobar)?baz", 0, "baz");
+  _assert_required_literal("pcre", "^sshd\\[\\d+\\]: Accepted", 0, "]: Accepted");
+
+  _assert_required_literal("pcre", "foo|barbaz", 0, NULL);
+  _assert_required_literal("pcre", "(?i)foobar", 0, NULL);
+  _assert_required_literal("pcre", "\\x41BCDEF", 0, NULL);
+  _assert_required_literal("pcre", "foobar", LMF_ICASE | LMF_UTF8, NULL);
+  _assert_required_literal("pcre", "a.b.c", 0, NULL);
+}
+
+static FilterExprNode *
+_compile_filter(GlobalConfig *cfg, const gchar *config_snippet)
+{
+  FilterExprNode *expr = perf_compile_filter(cfg, config_snippet);
+
+  cr_assert(filter_expr_init(expr, cfg));
+  return expr;
+}
+
+static const gchar *filters[] =
+{
+  "message('foobar')",
+  "message('FooBar' flags(ignore-case))",
+  "message('user (\\w+) logged in')",
+  "message('abc*def')",
+  "message('error.*disk full')",
+  "message('disk' type(string) flags(substring))",
+  "message('Disk Full' type(string) flags(substring ignore-case))",
+  "message('prefix-' type(string) flags(prefix))",
+  "message('exact value' type(string))",
+  "message('*disk*' type(glob))",
+  "message('foo|bar')",
+  "message('\\d+ connections? from')",
+  "message('^sshd\\[\\d+\\]: Accepted')",
+  "not message('foobar')",
+  "match('logged' value('MESSAGE'))",
+  "message('foobar') and program('sshd' type(string))",
+  "program('ssh.*')",
+  "program('sshd' type(string))",
+};
+
+static const gchar *messages[] =
+{
+  "", "foo", "bar", "foobar", "FOOBAR baz", "user alice logged in", "user  logged in",
+  "abdef", "abccdef", "error: disk full", "ERROR disk full", "disk", "some Disk FULL here",
+  "prefix-x", "exact value", "exact value2", "connections from", "2 connection from x",
+  "sshd[12]: Accepted", "sshd[]: Accepted",
+};
+
+static const gchar *programs[] = { "sshd", "ssh", "sshd2", "cron" };
+
+Test(prefilter, shared_prefilter_gives_the_same_results_as_standalone_filters)
+{
+  GlobalConfig *shared_cfg = cfg_new_snippet();
+  FilterExprNode *shared[G_N_ELEMENTS(filters)];
+  FilterExprNode *standalone[G_N_ELEMENTS(filters)];
+  GlobalConfig *standalone_cfg[G_N_ELEMENTS(filters)];
+
+  for (gint i = 0; i < G_N_ELEMENTS(filters); i++)
+    {
+      shared[i] = _compile_filter(shared_cfg, filters[i]);
+
+      /* on its own, the filter is below the threshold of the prefilter */
+      standalone_cfg[i] = cfg_new_snippet();
+      standalone[i] = _compile_filter(standalone_cfg[i], filters[i]);
+    }
+
+  for (gint m = 0; m < G_N_ELEMENTS(messages); m++)
+    {
+      for (gint p = 0; p < G_N_ELEMENTS(programs); p++)
+        {
+          LogMessage *msg = log_msg_new_empty();
+
+          log_msg_set_value(msg, LM_V_MESSAGE, messages[m], -1);
+          log_msg_set_value(msg, LM_V_PROGRAM, programs[p], -1);
+          for (gint i = 0; i < G_N_ELEMENTS(filters); i++)
+            {
+              cr_assert_eq(filter_expr_eval(shared[i], msg), filter_expr_eval(standalone[i], msg),
+                           "filter: %s, message: %s, program: %s", filters[i], messages[m], programs[p]);
+            }
+          log_msg_unref(msg);
+        }
+    }
+
+  for (gint i = 0; i < G_N_ELEMENTS(filters); i++)
+    {
+      filter_expr_unref(shared[i]);
+      filter_expr_unref(standalone[i]);
+      cfg_free(standalone_cfg[i]);
+    }
+  cfg_free(shared_cfg);
+}
+
+Test(prefilter, changing_the_value_invalidates_the_cached_scan)
+{
+  GlobalConfig *cfg = cfg_new_snippet();
+  FilterExprNode *exprs[8];
+
+  for (gint i = 0; i < G_N_ELEMENTS(exprs); i++)
+    {
+      gchar *snippet = g_strdup_printf("message('service%d failed')", i);
+      exprs[i] = _compile_filter(cfg, snippet);
+      g_free(snippet);
+    }
+
+  LogMessage *msg = log_msg_new_empty();
+  log_msg_set_value(msg, LM_V_MESSAGE, "service1 failed", -1);
+  cr_assert(filter_expr_eval(exprs[1], msg));
+  cr_assert_not(filter_expr_eval(exprs[2], msg));
+
+  /* same length, changed in place */
+  log_msg_set_value(msg, LM_V_MESSAGE, "service2 failed", -1);
+  cr_assert_not(filter_expr_eval(exprs[1], msg));
+  cr_assert(filter_expr_eval(exprs[2], msg));
+  log_msg_unref(msg);
+
+  for (gint i = 0; i < G_N_ELEMENTS(exprs); i++)
+    filter_expr_unref(exprs[i]);
+  cfg_free(cfg);
+}
+
+#define PERF_FILTERS 200
+
+static gint
+_eval_all_filters(LogMessage *msg, gpointer user_data)
+{
+  FilterExprNode **exprs = (FilterExprNode **) user_data;
+  gint matches = 0;
+
+  for (gint f = 0; f < PERF_FILTERS; f++)
+    matches += filter_expr_eval(exprs[f], msg);
+  return matches;
+}
+
+Test(prefilter, throughput_of_many_regexp_filters_on_the_same_value)
+{
+  GlobalConfig *shared_cfg = cfg_new_snippet();
+  FilterExprNode *shared[PERF_FILTERS];
+  FilterExprNode *standalone[PERF_FILTERS];
+  GlobalConfig *standalone_cfg[PERF_FILTERS];
+  LogMessage *msgs[16];
+
+  for (gint i = 0; i < PERF_FILTERS; i++)
+    {
+      gchar *snippet = g_strdup_printf("message('service-%d\\[\\d+\\]: (\\w+) failed')", i);
+
+      shared[i] = _compile_filter(shared_cfg, snippet);
+      standalone_cfg[i] = cfg_new_snippet();
+      standalone[i] = _compile_filter(standalone_cfg[i], snippet);
+      g_free(snippet);
+    }
+
+  for (gint i = 0; i < G_N_ELEMENTS(msgs); i++)
+    {
+      gchar *value = g_strdup_printf("Oct 17 12:00:00 host service-%d[%d]: unit failed, restarting in %d seconds",
+                                     i * 37, 1000 + i, i);
+      msgs[i] = log_msg_new_empty();
+      log_msg_set_value(msgs[i], LM_V_MESSAGE, value, -1);
+      g_free(value);
+    }
+
+  gint shared_matches, standalone_matches;
+  gdouble shared_rate = perf_measure_rate(_eval_all_filters, shared, msgs, G_N_ELEMENTS(msgs), PERF_MESSAGES,
+                                         &shared_matches);
+  gdouble standalone_rate = perf_measure_rate(_eval_all_filters, standalone, msgs, G_N_ELEMENTS(msgs), PERF_MESSAGES,
+                                             &standalone_matches);
+
+  perf_print_rates("200 regexp filters on $MESSAGE", "prefiltered", shared_rate, "standalone", standalone_rate);
+  cr_assert_eq(shared_matches, standalone_matches);
+
+  for (gint i = 0; i < G_N_ELEMENTS(msgs); i++)
+    log_msg_unref(msgs[i]);
+  for (gint i = 0; i < PERF_FILTERS; i++)
+    {
+      filter_expr_unref(shared[i]);
+      filter_expr_unref(standalone[i]);
+      cfg_free(standalone_cfg[i]);
+    }
+  cfg_free(shared_cfg);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+}
+
+static void
+teardown(void)
+{
+  app_shutdown();
+}
+
+TestSuite(prefilter, .init = setup, .fini = teardown);
@@ -24,15 +24,29 @@
 #include "find-crlf.h"
 
 #include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FIND_CRLF_HAVE_SSE2 1
+#endif
+
+#if defined(FIND_CRLF_HAVE_SSE2) && (defined(__x86_64__) || defined(__i386__)) && ((defined(__GNUC__) && __GNUC__ >= 5) || defined(__clang__))
+#include <immintrin.h>
+#define FIND_CRLF_HAVE_AVX2 1
+#define FIND_CRLF_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
 /**
  * This is an optimized version of finding either a CR or LF or NUL
  * character in a buffer.  It is used to find these line terminators in
  * syslog traffic.
  *
  * It uses an algorithm very similar to what there's in libc memchr/strchr.
+ * This is the fallback used for the parts of the buffer the vectorized
+ * variants below do not cover.
  **/
-gchar *
-find_cr_or_lf(gchar *s, gsize n)
+static gchar *
+_find_cr_or_lf_generic(gchar *s, gsize n)
 {
   gchar *char_ptr;
   gulong *longword_ptr;
@@ -97,3 +111,279 @@ find_cr_or_lf(gchar *s, gsize n)
 
   return NULL;
 }
+
+/* same as above, looking for LF or NUL */
+static const guchar *
+_find_lf_or_nul_generic(const guchar *s, gsize n)
+{
+  const guchar *char_ptr;
+  const gulong *longword_ptr;
+  gulong longword, magic_bits, charmask;
+  gchar c;
+
+  c = '\n';
+
+  /* align input to long boundary */
+  for (char_ptr = s; n > 0 && ((gulong) char_ptr & (sizeof(longword) - 1)) != 0; ++char_ptr, n--)
+    {
+      if (*char_ptr == c || *char_ptr == '\0')
+        return char_ptr;
+    }
+
+  longword_ptr = (gulong *) char_ptr;
+
+#if GLIB_SIZEOF_LONG == 8
+  magic_bits = 0x7efefefefefefeffL;
+#elif GLIB_SIZEOF_LONG == 4
+  magic_bits = 0x7efefeffL;
+#else
+#error "unknown architecture"
+#endif
+  memset(&charmask, c, sizeof(charmask));
+
+  while (n > sizeof(longword))
+    {
+      longword = *longword_ptr++;
+      if ((((longword + magic_bits) ^ ~longword) & ~magic_bits) != 0 ||
+          ((((longword ^ charmask) + magic_bits) ^ ~(longword ^ charmask)) & ~magic_bits) != 0)
+        {
+          gint i;
+
+          char_ptr = (const guchar *) (longword_ptr - 1);
+
+          for (i = 0; i < sizeof(longword); i++)
+            {
+              if (*char_ptr == c || *char_ptr == '\0')
+                return char_ptr;
+              char_ptr++;
+            }
+        }
+      n -= sizeof(longword);
+    }
+
+  char_ptr = (const guchar *) longword_ptr;
+
+  while (n-- > 0)
+    {
+      if (*char_ptr == c || *char_ptr == '\0')
+        return char_ptr;
+      ++char_ptr;
+    }
+
+  return NULL;
+}
+
+static gsize
+_find_lf_or_nul_offsets_generic(const guchar *s, gsize n, gsize start, gsize *offsets, gsize max_offsets)
+{
+  gsize count = 0;
+  const guchar *eol;
+
+  while (count < max_offsets && start < n && (eol = _find_lf_or_nul_generic(s + start, n - start)))
+    {
+      offsets[count++] = eol - s;
+      start = eol - s + 1;
+    }
+  return count;
+}
+
+/*
+ * The vectorized variants compare 16 (SSE2) or 32 (AVX2) bytes at a time
+ * and turn the result into a bitmask, where the lowest set bit is the
+ * first match.  Loads are unaligned and never extend beyond the end of
+ * the buffer, the remainder is processed by the generic code.
+ */
+
+#if defined(FIND_CRLF_HAVE_SSE2)
+
+static inline gchar *
+_first_cr_or_lf_in_mask(gchar *block, guint eol_mask, guint nul_mask)
+{
+  guint first = __builtin_ctz(eol_mask | nul_mask);
+
+  if (eol_mask & (1U << first))
+    return block + first;
+  return NULL;
+}
+
+static gsize
+_collect_offsets_from_mask(guint mask, gsize block_offset, gsize *offsets, gsize count, gsize max_offsets)
+{
+  while (mask && count < max_offsets)
+    {
+      offsets[count++] = block_offset + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  return count;
+}
+
+static gchar *
+_find_cr_or_lf_sse2(gchar *s, gsize n)
+{
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i nul = _mm_setzero_si128();
+  gsize i;
+
+  for (i = 0; i + sizeof(__m128i) <= n; i += sizeof(__m128i))
+    {
+      __m128i block = _mm_loadu_si128((const __m128i *) (s + i));
+      guint eol_mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, cr), _mm_cmpeq_epi8(block, lf)));
+      guint nul_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, nul));
+
+      if (eol_mask | nul_mask)
+        return _first_cr_or_lf_in_mask(s + i, eol_mask, nul_mask);
+    }
+  return _find_cr_or_lf_generic(s + i, n - i);
+}
+
+static const guchar *
+_find_lf_or_nul_sse2(const guchar *s, gsize n)
+{
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i nul = _mm_setzero_si128();
+  gsize i;
+
+  for (i = 0; i + sizeof(__m128i) <= n; i += sizeof(__m128i))
+    {
+      __m128i block = _mm_loadu_si128((const __m128i *) (s + i));
+      guint mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, lf), _mm_cmpeq_epi8(block, nul)));
+
+      if (mask)
+        return s + i + __builtin_ctz(mask);
+    }
+  return _find_lf_or_nul_generic(s + i, n - i);
+}
+
+static gsize
+_find_lf_or_nul_offsets_sse2(const guchar *s, gsize n, gsize start, gsize *offsets, gsize max_offsets)
+{
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i nul = _mm_setzero_si128();
+  gsize count = 0;
+  gsize i;
+
+  for (i = start; i + sizeof(__m128i) <= n; i += sizeof(__m128i))
+    {
+      __m128i block = _mm_loadu_si128((const __m128i *) (s + i));
+      guint mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, lf), _mm_cmpeq_epi8(block, nul)));
+
+      count = _collect_offsets_from_mask(mask, i, offsets, count, max_offsets);
+      if (count == max_offsets)
+        return count;
+    }
+  return count + _find_lf_or_nul_offsets_generic(s, n, i, offsets + count, max_offsets - count);
+}
+
+#endif
+
+#if defined(FIND_CRLF_HAVE_AVX2)
+
+static FIND_CRLF_AVX2_TARGET gchar *
+_find_cr_or_lf_avx2(gchar *s, gsize n)
+{
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const __m256i nul = _mm256_setzero_si256();
+  gsize i;
+
+  for (i = 0; i + sizeof(__m256i) <= n; i += sizeof(__m256i))
+    {
+      __m256i block = _mm256_loadu_si256((const __m256i *) (s + i));
+      guint eol_mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, cr),
+                                                            _mm256_cmpeq_epi8(block, lf)));
+      guint nul_mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, nul));
+
+      if (eol_mask | nul_mask)
+        return _first_cr_or_lf_in_mask(s + i, eol_mask, nul_mask);
+    }
+  return _find_cr_or_lf_sse2(s + i, n - i);
+}
+
+static FIND_CRLF_AVX2_TARGET const guchar *
+_find_lf_or_nul_avx2(const guchar *s, gsize n)
+{
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const __m256i nul = _mm256_setzero_si256();
+  gsize i;
+
+  for (i = 0; i + sizeof(__m256i) <= n; i += sizeof(__m256i))
+    {
+      __m256i block = _mm256_loadu_si256((const __m256i *) (s + i));
+      guint mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, lf), _mm256_cmpeq_epi8(block, nul)));
+
+      if (mask)
+        return s + i + __builtin_ctz(mask);
+    }
+  return _find_lf_or_nul_sse2(s + i, n - i);
+}
+
+static FIND_CRLF_AVX2_TARGET gsize
+_find_lf_or_nul_offsets_avx2(const guchar *s, gsize n, gsize start, gsize *offsets, gsize max_offsets)
+{
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const __m256i nul = _mm256_setzero_si256();
+  gsize count = 0;
+  gsize i;
+
+  for (i = start; i + sizeof(__m256i) <= n; i += sizeof(__m256i))
+    {
+      __m256i block = _mm256_loadu_si256((const __m256i *) (s + i));
+      guint mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, lf), _mm256_cmpeq_epi8(block, nul)));
+
+      count = _collect_offsets_from_mask(mask, i, offsets, count, max_offsets);
+      if (count == max_offsets)
+        return count;
+    }
+  return count + _find_lf_or_nul_offsets_sse2(s, n, i, offsets + count, max_offsets - count);
+}
+
+static inline gboolean
+_cpu_has_avx2(void)
+{
+  return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+gchar *
+find_cr_or_lf(gchar *s, gsize n)
+{
+#if defined(FIND_CRLF_HAVE_AVX2)
+  if (_cpu_has_avx2())
+    return _find_cr_or_lf_avx2(s, n);
+#endif
+#if defined(FIND_CRLF_HAVE_SSE2)
+  return _find_cr_or_lf_sse2(s, n);
+#else
+  return _find_cr_or_lf_generic(s, n);
+#endif
+}
+
+const guchar *
+find_lf_or_nul(const guchar *s, gsize n)
+{
+#if defined(FIND_CRLF_HAVE_AVX2)
+  if (_cpu_has_avx2())
+    return _find_lf_or_nul_avx2(s, n);
+#endif
+#if defined(FIND_CRLF_HAVE_SSE2)
+  return _find_lf_or_nul_sse2(s, n);
+#else
+  return _find_lf_or_nul_generic(s, n);
+#endif
+}
+
+gsize
+find_lf_or_nul_offsets(const guchar *s, gsize n, gsize *offsets, gsize max_offsets)
+{
+#if defined(FIND_CRLF_HAVE_AVX2)
+  if (_cpu_has_avx2())
+    return _find_lf_or_nul_offsets_avx2(s, n, 0, offsets, max_offsets);
+#endif
+#if defined(FIND_CRLF_HAVE_SSE2)
+  return _find_lf_or_nul_offsets_sse2(s, n, 0, offsets, max_offsets);
+#else
+  return _find_lf_or_nul_offsets_generic(s, n, 0, offsets, max_offsets);
+#endif
+}
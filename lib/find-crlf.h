@@ -26,6 +26,22 @@
 
 #include "syslog-ng.h"
 
+/*
+ * These functions use SSE2/AVX2 instructions when the CPU supports them,
+ * the choice is made at runtime.
+ */
+
+/* first CR or LF in the buffer, NULL if there's none or a NUL comes first */
 gchar *find_cr_or_lf(gchar *s, gsize n);
 
+/* first LF or NUL in the buffer, NULL if there's none */
+const guchar *find_lf_or_nul(const guchar *s, gsize n);
+
+/*
+ * Stores the offsets of the LF and NUL characters of the buffer to
+ * @offsets in a single pass, up to @max_offsets of them.  Returns the
+ * number of offsets stored.
+ */
+gsize find_lf_or_nul_offsets(const guchar *s, gsize n, gsize *offsets, gsize max_offsets);
+
 #endif
@@ -23,6 +23,7 @@
 #include "host-resolve.h"
 #include "hostname.h"
 #include "dnscache.h"
+#include "dns-resolver-pool.h"
 #include "messages.h"
 #include "cfg.h"
 #include "tls-support.h"
@@ -52,6 +53,12 @@ TLS_BLOCK_END;
 
 #define hostname_buffer  __tls_deref(hostname_buffer)
 
+/* number of threads performing reverse lookups with use-dns(async) */
+#define HOST_RESOLVE_ASYNC_THREADS 4
+
+static DNSResolverPool *resolver_pool;
+static gboolean reinit_resolver_hook_registered;
+
 static void
 normalize_hostname(gchar *result, gsize result_size, const gchar *hostname)
 {
@@ -323,6 +330,22 @@ resolve_address_using_gethostbyaddr(GSockAddr *saddr, gchar *buf, gsize buf_len)
 
 #endif
 
+static gboolean
+resolve_address_in_resolver_pool(GSockAddr *saddr, gchar *buf, gsize buf_len)
+{
+#ifdef SYSLOG_NG_HAVE_GETNAMEINFO
+  return resolve_address_using_getnameinfo(saddr, buf, buf_len) != NULL;
+#else
+  return resolve_address_using_gethostbyaddr(saddr, buf, buf_len) != NULL;
+#endif
+}
+
+static gboolean
+is_async_dns_enabled(const HostResolveOptions *host_resolve_options)
+{
+  return host_resolve_options->use_dns == HRO_USE_DNS_ASYNC && resolver_pool;
+}
+
 static void *
 sockaddr_to_dnscache_key(GSockAddr *saddr)
 {
@@ -360,7 +383,19 @@ resolve_sockaddr_to_inet_or_inet6_hostname(gsize *result_len, GSockAddr *saddr,
         return hostname_apply_options_fqdn(hname_len, result_len, hname, positive, host_resolve_options);
     }
 
-  if (!hname && host_resolve_options->use_dns && host_resolve_options->use_dns != 2)
+  if (!hname && is_async_dns_enabled(host_resolve_options))
+    {
+      if (!dns_resolver_pool_lookup(resolver_pool, saddr, host_resolve_options->dns_async_timeout,
+                                    hostname_buffer, sizeof(hostname_buffer), &positive))
+        {
+          /* the lookup is still in progress, go on with the address but
+           * don't cache it, the result is picked up by a later message */
+          hname = g_sockaddr_format(saddr, hostname_buffer, sizeof(hostname_buffer), GSA_ADDRESS_ONLY);
+          return hostname_apply_options_fqdn(-1, result_len, hname, FALSE, host_resolve_options);
+        }
+      hname = positive ? hostname_buffer : NULL;
+    }
+  else if (!hname && host_resolve_options->use_dns && host_resolve_options->use_dns != HRO_USE_DNS_PERSIST_ONLY)
     {
 #ifdef SYSLOG_NG_HAVE_GETNAMEINFO
       hname = resolve_address_using_getnameinfo(saddr, hostname_buffer, sizeof(hostname_buffer));
@@ -428,6 +463,7 @@ host_resolve_options_defaults(HostResolveOptions *options)
   options->use_fqdn = -1;
   options->use_dns_cache = -1;
   options->normalize_hostnames = -1;
+  options->dns_async_timeout = -1;
 }
 
 void
@@ -437,11 +473,36 @@ host_resolve_options_global_defaults(HostResolveOptions *options)
   options->use_dns = TRUE;
   options->use_dns_cache = TRUE;
   options->normalize_hostnames = FALSE;
+  options->dns_async_timeout = 0;
+}
+
+static void
+_reinit_resolver(gint type, gpointer user_data)
+{
+  res_init();
+}
+
+/*
+ * Re-reads resolv.conf on reload.  Only registered once use-dns(async)
+ * is configured, other modes keep resolving with the configuration
+ * loaded at startup, as before.
+ */
+static void
+_register_reinit_resolver_hook(void)
+{
+  if (reinit_resolver_hook_registered)
+    return;
+
+  register_application_hook(AH_CONFIG_STOPPED, _reinit_resolver, NULL, AHM_RUN_REPEAT);
+  reinit_resolver_hook_registered = TRUE;
 }
 
 static void
 _init_options(HostResolveOptions *options)
 {
+  if (options->use_dns == HRO_USE_DNS_ASYNC)
+    _register_reinit_resolver_hook();
+
   if (options->use_dns == 0)
     {
       if (options->use_dns_cache != 0)
@@ -469,6 +530,8 @@ host_resolve_options_init(HostResolveOptions *options, HostResolveOptions *globa
     options->use_dns_cache = global_options->use_dns_cache;
   if (options->normalize_hostnames == -1)
     options->normalize_hostnames = global_options->normalize_hostnames;
+  if (options->dns_async_timeout == -1)
+    options->dns_async_timeout = global_options->dns_async_timeout;
   _init_options(options);
 }
 
@@ -477,14 +540,16 @@ host_resolve_options_destroy(HostResolveOptions *options)
 {
 }
 
-static void
-_reinit_resolver(gint type, gpointer user_data)
+void
+host_resolve_global_init(void)
 {
-  res_init();
+  resolver_pool = dns_resolver_pool_new(HOST_RESOLVE_ASYNC_THREADS, resolve_address_in_resolver_pool);
 }
 
 void
-host_resolve_global_init(void)
+host_resolve_global_deinit(void)
 {
-  register_application_hook(AH_CONFIG_STOPPED, _reinit_resolver, NULL, AHM_RUN_REPEAT);
+  dns_resolver_pool_free(resolver_pool);
+  resolver_pool = NULL;
+  reinit_resolver_hook_registered = FALSE;
 }
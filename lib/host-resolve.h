@@ -26,12 +26,22 @@
 #include "syslog-ng.h"
 #include "gsockaddr.h"
 
+/* values of use-dns() */
+typedef enum
+{
+  HRO_USE_DNS_NO = 0,
+  HRO_USE_DNS_YES = 1,
+  HRO_USE_DNS_PERSIST_ONLY = 2,
+  HRO_USE_DNS_ASYNC = 3,
+} HostResolveUseDns;
+
 typedef struct _HostResolveOptions
 {
   gboolean use_dns;
   gboolean use_fqdn;
   gboolean use_dns_cache;
   gboolean normalize_hostnames;
+  gint dns_async_timeout;
 } HostResolveOptions;
 
 /* name resolution */
@@ -46,4 +56,7 @@ void host_resolve_options_init_globals(HostResolveOptions *options);
 void host_resolve_options_init(HostResolveOptions *options, HostResolveOptions *global_options);
 void host_resolve_options_destroy(HostResolveOptions *options);
 
+void host_resolve_global_init(void);
+void host_resolve_global_deinit(void);
+
 #endif
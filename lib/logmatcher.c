@@ -59,6 +59,48 @@ log_matcher_init(LogMatcher *self, const LogMatcherOptions *options)
   self->free_fn = log_matcher_free_method;
 }
 
+/*
+ * Collects the longest run of consecutive literal characters of a
+ * pattern, shorter literals would not narrow down the candidates enough to
+ * be useful.
+ */
+#define LOG_MATCHER_MIN_REQUIRED_LITERAL_LEN 3
+
+typedef struct _RequiredLiteral
+{
+  GString *current;
+  GString *longest;
+} RequiredLiteral;
+
+static void
+_required_literal_init(RequiredLiteral *self)
+{
+  self->current = g_string_new("");
+  self->longest = g_string_new("");
+}
+
+static void
+_required_literal_end_run(RequiredLiteral *self)
+{
+  if (self->current->len > self->longest->len)
+    g_string_assign(self->longest, self->current->str);
+  g_string_truncate(self->current, 0);
+}
+
+static gchar *
+_required_literal_destroy(RequiredLiteral *self, gboolean valid)
+{
+  gchar *result = NULL;
+
+  _required_literal_end_run(self);
+  if (valid && self->longest->len >= LOG_MATCHER_MIN_REQUIRED_LITERAL_LEN)
+    result = g_strdup(self->longest->str);
+
+  g_string_free(self->current, TRUE);
+  g_string_free(self->longest, TRUE);
+  return result;
+}
+
 typedef struct _LogMatcherString
 {
   LogMatcher super;
@@ -201,6 +243,17 @@ log_matcher_string_replace(LogMatcher *s, LogMessage *msg, gint value_handle, co
   return NULL;
 }
 
+/* the pattern is required in all modes: exact, prefix and substring */
+static gchar *
+log_matcher_string_get_required_literal(LogMatcher *s)
+{
+  LogMatcherString *self = (LogMatcherString *) s;
+
+  if (self->pattern_len < LOG_MATCHER_MIN_REQUIRED_LITERAL_LEN)
+    return NULL;
+  return g_strdup(s->pattern);
+}
+
 LogMatcher *
 log_matcher_string_new(const LogMatcherOptions *options)
 {
@@ -210,6 +263,7 @@ log_matcher_string_new(const LogMatcherOptions *options)
   self->super.compile = log_matcher_string_compile;
   self->super.match = log_matcher_string_match;
   self->super.replace = log_matcher_string_replace;
+  self->super.get_required_literal = log_matcher_string_get_required_literal;
 
   return &self->super;
 }
@@ -262,6 +316,22 @@ log_matcher_glob_match(LogMatcher *s, LogMessage *msg, gint value_handle, const
   return FALSE;
 }
 
+static gchar *
+log_matcher_glob_get_required_literal(LogMatcher *s)
+{
+  RequiredLiteral literal;
+
+  _required_literal_init(&literal);
+  for (const gchar *p = s->pattern; *p; p++)
+    {
+      if (*p == '*' || *p == '?')
+        _required_literal_end_run(&literal);
+      else
+        g_string_append_c(literal.current, *p);
+    }
+  return _required_literal_destroy(&literal, TRUE);
+}
+
 static void
 log_matcher_glob_free(LogMatcher *s)
 {
@@ -279,6 +349,7 @@ log_matcher_glob_new(const LogMatcherOptions *options)
   self->super.compile = log_matcher_glob_compile;
   self->super.match = log_matcher_glob_match;
   self->super.replace = NULL;
+  self->super.get_required_literal = log_matcher_glob_get_required_literal;
   self->super.free_fn = log_matcher_glob_free;
 
   return &self->super;
@@ -657,6 +728,138 @@ log_matcher_pcre_re_replace(LogMatcher *s, LogMessage *msg, gint value_handle, c
   return NULL;
 }
 
+/* escapes that stand for a single non-literal atom and take no arguments */
+#define PCRE_SIMPLE_ESCAPES "dDsSwWhHvVRbBAzZGKXCntrefaE"
+
+static const gchar *
+_skip_pcre_character_class(const gchar *p)
+{
+  p++;
+  if (*p == '^')
+    p++;
+  if (*p == ']')
+    p++;
+
+  for (; *p; p++)
+    {
+      if (*p == '\\')
+        {
+          if (!*++p)
+            return NULL;
+        }
+      else if (*p == '[' && p[1] == ':')
+        {
+          p = strstr(p + 2, ":]");
+          if (!p)
+            return NULL;
+          p++;
+        }
+      else if (*p == ']')
+        {
+          return p;
+        }
+    }
+  return NULL;
+}
+
+static const gchar *
+_skip_pcre_counted_quantifier(const gchar *p)
+{
+  p++;
+  if (!g_ascii_isdigit(*p))
+    return NULL;
+
+  while (g_ascii_isdigit(*p) || *p == ',')
+    p++;
+  return *p == '}' ? p : NULL;
+}
+
+/*
+ * Only literals outside of groups are collected and anything not
+ * understood makes the whole pattern ineligible, so the result is
+ * conservative: it may miss literals, but never returns one that a match
+ * can do without.
+ */
+static gchar *
+log_matcher_pcre_re_get_required_literal(LogMatcher *s)
+{
+  const gchar *re = s->pattern;
+  RequiredLiteral literal;
+  gboolean last_atom_in_run = FALSE;
+  gboolean valid = TRUE;
+  gint depth = 0;
+
+  /* caseless matching in UTF-8 mode is not limited to ASCII case folding */
+  if ((s->flags & (LMF_ICASE | LMF_UTF8)) == (LMF_ICASE | LMF_UTF8))
+    return NULL;
+
+  /* alternatives, inline options and verbs are not followed */
+  if (strchr(re, '|') || strstr(re, "(?") || strstr(re, "(*"))
+    return NULL;
+
+  _required_literal_init(&literal);
+  for (const gchar *p = re; *p; p++)
+    {
+      gboolean is_literal = FALSE;
+      gchar c = *p;
+
+      switch (c)
+        {
+        case '\\':
+          c = *++p;
+          if (c && !g_ascii_isalnum(c))
+            is_literal = TRUE;
+          else if (!c || !strchr(PCRE_SIMPLE_ESCAPES, c))
+            valid = FALSE;
+          break;
+        case '[':
+          p = _skip_pcre_character_class(p);
+          valid = (p != NULL);
+          break;
+        case '(':
+          depth++;
+          break;
+        case ')':
+          depth--;
+          break;
+        case '{':
+          p = _skip_pcre_counted_quantifier(p);
+          valid = (p != NULL);
+        /* fallthrough */
+        case '*':
+        case '?':
+          /* the previous atom is optional */
+          if (last_atom_in_run)
+            g_string_truncate(literal.current, literal.current->len - 1);
+          break;
+        case '+':
+          break;
+        case '.':
+        case '^':
+        case '$':
+          break;
+        default:
+          is_literal = ((guchar) c) < 0x80;
+          break;
+        }
+
+      if (!valid)
+        break;
+
+      if (is_literal && depth == 0)
+        {
+          g_string_append_c(literal.current, c);
+          last_atom_in_run = TRUE;
+        }
+      else
+        {
+          _required_literal_end_run(&literal);
+          last_atom_in_run = FALSE;
+        }
+    }
+  return _required_literal_destroy(&literal, valid);
+}
+
 static void
 log_matcher_pcre_re_free(LogMatcher *s)
 {
@@ -677,6 +880,7 @@ log_matcher_pcre_re_new(const LogMatcherOptions *options)
   self->super.compile = log_matcher_pcre_re_compile;
   self->super.match = log_matcher_pcre_re_match;
   self->super.replace = log_matcher_pcre_re_replace;
+  self->super.get_required_literal = log_matcher_pcre_re_get_required_literal;
   self->super.free_fn = log_matcher_pcre_re_free;
 
   return &self->super;
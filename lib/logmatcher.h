@@ -72,6 +72,8 @@ struct _LogMatcher
   /* value_len can be -1 to indicate unknown length, new_length can be returned as -1 to indicate unknown length */
   gchar *(*replace)(LogMatcher *s, LogMessage *msg, gint value_handle, const gchar *value, gssize value_len,
                     LogTemplate *replacement, gssize *new_length);
+  /* returns a string that is present in every value the matcher accepts, or NULL */
+  gchar *(*get_required_literal)(LogMatcher *s);
   void (*free_fn)(LogMatcher *s);
 };
 
@@ -96,6 +98,14 @@ log_matcher_replace(LogMatcher *s, LogMessage *msg, gint value_handle, const gch
   return NULL;
 }
 
+static inline gchar *
+log_matcher_get_required_literal(LogMatcher *s)
+{
+  if (s->get_required_literal && s->pattern)
+    return s->get_required_literal(s);
+  return NULL;
+}
+
 static inline void
 log_matcher_set_flags(LogMatcher *s, gint flags)
 {
@@ -24,7 +24,11 @@
 
 #include "logmpx.h"
 #include "cfg-walker.h"
+#include "filter/filter-pipe.h"
+#include "str-utils.h"
 
+/* below this the dispatch table would not pay off */
+#define LOG_MULTIPLEXER_DISPATCH_MIN_BRANCHES 8
 
 void
 log_multiplexer_add_next_hop(LogMultiplexer *self, LogPipe *next_hop)
@@ -32,6 +36,147 @@ log_multiplexer_add_next_hop(LogMultiplexer *self, LogPipe *next_hop)
   g_ptr_array_add(self->next_hops, next_hop);
 }
 
+/*
+ * Looks for the first filter of the branch, skipping pass-through pipes.
+ * The branch can be skipped as long as the filter fails, unless
+ * drop-unmatched would turn that into a match.
+ */
+static gboolean
+_branch_get_equality_test(LogPipe *branch_head, NVHandle *handle, const gchar **value)
+{
+  LogPipe *p;
+
+  for (p = branch_head; p; p = p->pipe_next)
+    {
+      if (p->flags & PIF_DROP_UNMATCHED)
+        return FALSE;
+
+      if (p->queue)
+        return log_filter_pipe_get_equality_test(p, handle, value);
+    }
+  return FALSE;
+}
+
+static NVHandle
+_find_most_common_handle(NVHandle *handles, gint num_handles, gint *count)
+{
+  GHashTable *counts = g_hash_table_new(NULL, NULL);
+  NVHandle best = LM_V_NONE;
+  gint i;
+
+  *count = 0;
+  for (i = 0; i < num_handles; i++)
+    {
+      if (handles[i] == LM_V_NONE)
+        continue;
+
+      gpointer key = GUINT_TO_POINTER(handles[i]);
+      gint n = GPOINTER_TO_INT(g_hash_table_lookup(counts, key)) + 1;
+
+      g_hash_table_insert(counts, key, GINT_TO_POINTER(n));
+      if (n > *count)
+        {
+          *count = n;
+          best = handles[i];
+        }
+    }
+  g_hash_table_unref(counts);
+  return best;
+}
+
+static void
+_append_index(gpointer key, gpointer value, gpointer user_data)
+{
+  g_array_append_val((GArray *) value, *(gint *) user_data);
+}
+
+static void
+_free_index_array(gpointer a)
+{
+  g_array_free((GArray *) a, TRUE);
+}
+
+static void
+log_multiplexer_free_dispatch_table(LogMultiplexer *self)
+{
+  if (self->dispatch_table)
+    {
+      g_hash_table_unref(self->dispatch_table);
+      self->dispatch_table = NULL;
+    }
+  if (self->dispatch_unindexed)
+    {
+      g_array_free(self->dispatch_unindexed, TRUE);
+      self->dispatch_unindexed = NULL;
+    }
+}
+
+static void
+log_multiplexer_build_dispatch_table(LogMultiplexer *self)
+{
+  gint num_hops = self->next_hops->len;
+  NVHandle *handles = g_new0(NVHandle, num_hops);
+  const gchar **values = g_new0(const gchar *, num_hops);
+  gint num_indexed;
+  gint i;
+
+  for (i = 0; i < num_hops; i++)
+    {
+      if (!_branch_get_equality_test(g_ptr_array_index(self->next_hops, i), &handles[i], &values[i]))
+        handles[i] = LM_V_NONE;
+    }
+
+  self->dispatch_handle = _find_most_common_handle(handles, num_hops, &num_indexed);
+  if (num_indexed < LOG_MULTIPLEXER_DISPATCH_MIN_BRANCHES)
+    goto exit;
+
+  self->dispatch_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, _free_index_array);
+  self->dispatch_unindexed = g_array_new(FALSE, FALSE, sizeof(gint));
+
+  for (i = 0; i < num_hops; i++)
+    {
+      if (handles[i] == self->dispatch_handle && !g_hash_table_contains(self->dispatch_table, values[i]))
+        g_hash_table_insert(self->dispatch_table, g_strdup(values[i]), g_array_new(FALSE, FALSE, sizeof(gint)));
+    }
+
+  /* unindexed branches are added to every list to keep the original order */
+  for (i = 0; i < num_hops; i++)
+    {
+      if (handles[i] == self->dispatch_handle)
+        {
+          g_array_append_val((GArray *) g_hash_table_lookup(self->dispatch_table, values[i]), i);
+        }
+      else
+        {
+          g_array_append_val(self->dispatch_unindexed, i);
+          g_hash_table_foreach(self->dispatch_table, _append_index, &i);
+        }
+    }
+
+  msg_debug("Using dispatch table in multiplexer",
+            evt_tag_str("name", log_msg_get_value_name(self->dispatch_handle, NULL)),
+            evt_tag_int("indexed_branches", num_indexed),
+            evt_tag_int("unindexed_branches", self->dispatch_unindexed->len),
+            log_pipe_location_tag(&self->super));
+
+exit:
+  g_free(handles);
+  g_free(values);
+}
+
+static GArray *
+log_multiplexer_lookup_dispatch_table(LogMultiplexer *self, LogMessage *msg)
+{
+  const gchar *value;
+  gssize value_len;
+
+  value = log_msg_get_value(msg, self->dispatch_handle, &value_len);
+  APPEND_ZERO(value, value, value_len);
+
+  GArray *candidates = g_hash_table_lookup(self->dispatch_table, value);
+  return candidates ? candidates : self->dispatch_unindexed;
+}
+
 static gboolean
 log_multiplexer_init(LogPipe *s)
 {
@@ -53,12 +198,18 @@ log_multiplexer_init(LogPipe *s)
           self->fallback_exists = TRUE;
         }
     }
+
+  log_multiplexer_free_dispatch_table(self);
+  log_multiplexer_build_dispatch_table(self);
   return TRUE;
 }
 
 static gboolean
-log_multiplexer_deinit(LogPipe *self)
+log_multiplexer_deinit(LogPipe *s)
 {
+  LogMultiplexer *self = (LogMultiplexer *) s;
+
+  log_multiplexer_free_dispatch_table(self);
   return TRUE;
 }
 
@@ -78,18 +229,29 @@ log_multiplexer_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_op
   gboolean matched;
   gboolean delivered = FALSE;
   gint fallback;
+  const gint *candidates = NULL;
+  gint num_candidates = self->next_hops->len;
 
   local_options.matched = &matched;
 
+  /* the single step hook wants to see every pipe */
+  if (self->dispatch_table && !pipe_single_step_hook)
+    {
+      GArray *a = log_multiplexer_lookup_dispatch_table(self, msg);
+
+      candidates = (const gint *) a->data;
+      num_candidates = a->len;
+    }
+
   if (_has_multiple_arcs(self))
     {
       log_msg_write_protect(msg);
     }
   for (fallback = 0; (fallback == 0) || (fallback == 1 && self->fallback_exists && !delivered); fallback++)
     {
-      for (i = 0; i < self->next_hops->len; i++)
+      for (i = 0; i < num_candidates; i++)
         {
-          LogPipe *next_hop = g_ptr_array_index(self->next_hops, i);
+          LogPipe *next_hop = g_ptr_array_index(self->next_hops, candidates ? candidates[i] : i);
 
           if (G_UNLIKELY(fallback == 0 && (next_hop->flags & PIF_BRANCH_FALLBACK) != 0))
             {
@@ -139,6 +301,7 @@ log_multiplexer_free(LogPipe *s)
 {
   LogMultiplexer *self = (LogMultiplexer *) s;
 
+  log_multiplexer_free_dispatch_table(self);
   g_ptr_array_free(self->next_hops, TRUE);
   log_pipe_free_method(s);
 }
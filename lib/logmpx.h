@@ -35,12 +35,23 @@
  *
  * This object is used for example for each source to send messages to all
  * log pipelines that refer to the source.
+ *
+ * If enough branches start with an equality test on the same name-value
+ * pair (e.g. program("x" type(string)) or "$HOST" eq "y"), a dispatch
+ * table is built at init time, mapping the value to the list of branches
+ * that may match it.  Messages are then only passed to those branches.
  **/
 typedef struct _LogMultiplexer
 {
   LogPipe super;
   GPtrArray *next_hops;
   gboolean fallback_exists;
+
+  NVHandle dispatch_handle;
+  /* value -> GArray of next_hops indexes, in the original order */
+  GHashTable *dispatch_table;
+  /* next_hops indexes to visit if the value is not in the table */
+  GArray *dispatch_unindexed;
 } LogMultiplexer;
 
 LogMultiplexer *log_multiplexer_new(GlobalConfig *cfg);
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logmsg/logmsg-pool.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
+#include "tls-support.h"
+
+/*
+ * Size classes are powers of two from 512 bytes to 16k, larger blocks are
+ * allocated with g_malloc() directly.
+ *
+ * Each thread owns a pool, blocks remember the pool they were allocated
+ * from.  The owner keeps its free blocks on plain free lists, other
+ * threads push the blocks they free to the return lists of the owner with
+ * a CAS loop, which the owner takes over as a whole once its free list
+ * runs out.  As only the owner removes blocks from a return list, and it
+ * always removes all of them, the usual ABA problem of lock-free stacks
+ * does not apply.
+ *
+ * The pool of an exiting thread is put aside with its cached blocks and
+ * return lists intact and is adopted by the next new thread, so blocks
+ * still in use always have a live pool to return to.
+ *
+ * The free lists are trimmed periodically: blocks that stayed on a free
+ * list for a whole period were not needed, half of them are released, so
+ * the memory cached after a burst is given back gradually.
+ */
+
+#define LOG_MSG_POOL_MIN_CLASS_SHIFT 9
+#define LOG_MSG_POOL_NUM_CLASSES 6
+/* per thread and size class, both for the free list and the return list */
+#define LOG_MSG_POOL_MAX_CACHED_BYTES (64 * 1024)
+/* the free lists are trimmed and the cached bytes are published to the stats counter after this many operations */
+#define LOG_MSG_POOL_TRIM_PERIOD 256
+
+typedef struct _LogMsgPool LogMsgPool;
+typedef struct _LogMsgPoolBlock LogMsgPoolBlock;
+
+struct _LogMsgPoolBlock
+{
+  /* NULL for blocks too large for any size class */
+  LogMsgPool *pool;
+  union
+  {
+    /* while the block is in use */
+    gsize size_class;
+    /* while the block is cached */
+    LogMsgPoolBlock *next;
+  };
+};
+
+struct _LogMsgPool
+{
+  /* used by the owner thread only */
+  LogMsgPoolBlock *free_lists[LOG_MSG_POOL_NUM_CLASSES];
+  gint free_counts[LOG_MSG_POOL_NUM_CLASSES];
+  /* the lowest length of the free lists since the last trim */
+  gint free_low_water[LOG_MSG_POOL_NUM_CLASSES];
+  gssize cached_bytes;
+  gssize cached_bytes_reported;
+  gint ops_since_report;
+
+  /* pushed to by any thread, taken over by the owner */
+  gpointer return_lists[LOG_MSG_POOL_NUM_CLASSES];
+  gint return_counts[LOG_MSG_POOL_NUM_CLASSES];
+
+  LogMsgPool *next_unowned;
+};
+
+TLS_BLOCK_START
+{
+  LogMsgPool *log_msg_pool;
+}
+TLS_BLOCK_END;
+
+#define log_msg_pool  __tls_deref(log_msg_pool)
+
+static void _release_pool(gpointer s);
+
+/* only used to learn about the exit of the owner thread */
+static GPrivate pool_owner = G_PRIVATE_INIT(_release_pool);
+
+static GMutex unowned_pools_lock;
+static LogMsgPool *unowned_pools;
+
+static StatsCounterItem *count_cached_bytes;
+
+static inline gsize
+_class_size(gint size_class)
+{
+  return 1 << (LOG_MSG_POOL_MIN_CLASS_SHIFT + size_class);
+}
+
+static inline gint
+_max_cached_blocks(gint size_class)
+{
+  return LOG_MSG_POOL_MAX_CACHED_BYTES / _class_size(size_class);
+}
+
+static inline gint
+_find_size_class(gsize block_size)
+{
+  for (gint size_class = 0; size_class < LOG_MSG_POOL_NUM_CLASSES; size_class++)
+    {
+      if (block_size <= _class_size(size_class))
+        return size_class;
+    }
+  return -1;
+}
+
+static void
+_report_stats(LogMsgPool *self)
+{
+  stats_counter_add(count_cached_bytes, self->cached_bytes - self->cached_bytes_reported);
+  self->cached_bytes_reported = self->cached_bytes;
+  self->ops_since_report = 0;
+}
+
+static inline LogMsgPoolBlock *
+_pop_free_list(LogMsgPool *self, gint size_class)
+{
+  LogMsgPoolBlock *block = self->free_lists[size_class];
+
+  self->free_lists[size_class] = block->next;
+  self->free_counts[size_class]--;
+  self->cached_bytes -= _class_size(size_class);
+  if (self->free_counts[size_class] < self->free_low_water[size_class])
+    self->free_low_water[size_class] = self->free_counts[size_class];
+  return block;
+}
+
+/* releases half of the blocks that were not taken from the free lists since the last trim */
+static void
+_trim_free_lists(LogMsgPool *self)
+{
+  for (gint size_class = 0; size_class < LOG_MSG_POOL_NUM_CLASSES; size_class++)
+    {
+      gint unused_blocks = (self->free_low_water[size_class] + 1) / 2;
+
+      for (gint i = 0; i < unused_blocks; i++)
+        g_free(_pop_free_list(self, size_class));
+      self->free_low_water[size_class] = self->free_counts[size_class];
+    }
+}
+
+static inline void
+_maybe_trim(LogMsgPool *self)
+{
+  if (++self->ops_since_report >= LOG_MSG_POOL_TRIM_PERIOD)
+    {
+      _trim_free_lists(self);
+      _report_stats(self);
+    }
+}
+
+static LogMsgPool *
+_adopt_pool(void)
+{
+  LogMsgPool *self;
+
+  g_mutex_lock(&unowned_pools_lock);
+  self = unowned_pools;
+  if (self)
+    unowned_pools = self->next_unowned;
+  g_mutex_unlock(&unowned_pools_lock);
+
+  if (!self)
+    self = g_new0(LogMsgPool, 1);
+  self->next_unowned = NULL;
+  return self;
+}
+
+static void
+_release_pool(gpointer s)
+{
+  LogMsgPool *self = (LogMsgPool *) s;
+
+  _report_stats(self);
+  log_msg_pool = NULL;
+
+  g_mutex_lock(&unowned_pools_lock);
+  self->next_unowned = unowned_pools;
+  unowned_pools = self;
+  g_mutex_unlock(&unowned_pools_lock);
+}
+
+static inline LogMsgPool *
+_get_pool(void)
+{
+  if (G_UNLIKELY(!log_msg_pool))
+    {
+      log_msg_pool = _adopt_pool();
+      g_private_set(&pool_owner, log_msg_pool);
+    }
+  return log_msg_pool;
+}
+
+static inline void
+_push_free_list(LogMsgPool *self, gint size_class, LogMsgPoolBlock *block)
+{
+  block->next = self->free_lists[size_class];
+  self->free_lists[size_class] = block;
+  self->free_counts[size_class]++;
+  self->cached_bytes += _class_size(size_class);
+}
+
+/* moves the blocks freed by other threads to the free list, beyond the limit they are released */
+static void
+_take_over_returned_blocks(LogMsgPool *self, gint size_class)
+{
+  LogMsgPoolBlock *block;
+  gint count = 0;
+
+  do
+    block = g_atomic_pointer_get(&self->return_lists[size_class]);
+  while (block && !g_atomic_pointer_compare_and_exchange(&self->return_lists[size_class], block, NULL));
+
+  while (block)
+    {
+      LogMsgPoolBlock *next = block->next;
+
+      if (self->free_counts[size_class] < _max_cached_blocks(size_class))
+        _push_free_list(self, size_class, block);
+      else
+        g_free(block);
+      block = next;
+      count++;
+    }
+  g_atomic_int_add(&self->return_counts[size_class], -count);
+}
+
+static void
+_return_to_owner(LogMsgPool *owner, gint size_class, LogMsgPoolBlock *block)
+{
+  if (g_atomic_int_get(&owner->return_counts[size_class]) >= _max_cached_blocks(size_class))
+    {
+      g_free(block);
+      return;
+    }
+
+  g_atomic_int_inc(&owner->return_counts[size_class]);
+  do
+    block->next = g_atomic_pointer_get(&owner->return_lists[size_class]);
+  while (!g_atomic_pointer_compare_and_exchange(&owner->return_lists[size_class], block->next, block));
+}
+
+gpointer
+log_msg_pool_alloc(gsize size)
+{
+  gint size_class = _find_size_class(size + sizeof(LogMsgPoolBlock));
+  LogMsgPoolBlock *block;
+
+  if (size_class < 0)
+    {
+      block = g_malloc(size + sizeof(LogMsgPoolBlock));
+      block->pool = NULL;
+      return block + 1;
+    }
+
+  LogMsgPool *self = _get_pool();
+
+  if (!self->free_lists[size_class])
+    _take_over_returned_blocks(self, size_class);
+
+  if (self->free_lists[size_class])
+    {
+      block = _pop_free_list(self, size_class);
+    }
+  else
+    {
+      block = g_malloc(_class_size(size_class));
+      block->pool = self;
+    }
+
+  block->size_class = size_class;
+  _maybe_trim(self);
+  return block + 1;
+}
+
+void
+log_msg_pool_free(gpointer p)
+{
+  LogMsgPoolBlock *block = ((LogMsgPoolBlock *) p) - 1;
+  LogMsgPool *owner = block->pool;
+  gint size_class = block->size_class;
+
+  if (!owner)
+    {
+      g_free(block);
+      return;
+    }
+
+  if (owner != log_msg_pool)
+    {
+      _return_to_owner(owner, size_class, block);
+      return;
+    }
+
+  if (owner->free_counts[size_class] < _max_cached_blocks(size_class))
+    _push_free_list(owner, size_class, block);
+  else
+    g_free(block);
+  _maybe_trim(owner);
+}
+
+/* the number of bytes cached by the current thread */
+gsize
+log_msg_pool_get_cached_bytes(void)
+{
+  return log_msg_pool ? log_msg_pool->cached_bytes : 0;
+}
+
+static void
+_free_cached_blocks(LogMsgPool *self)
+{
+  for (gint size_class = 0; size_class < LOG_MSG_POOL_NUM_CLASSES; size_class++)
+    {
+      _take_over_returned_blocks(self, size_class);
+      while (self->free_lists[size_class])
+        {
+          LogMsgPoolBlock *block = self->free_lists[size_class];
+
+          self->free_lists[size_class] = block->next;
+          g_free(block);
+        }
+      self->free_counts[size_class] = 0;
+      self->free_low_water[size_class] = 0;
+    }
+  self->cached_bytes = 0;
+  _report_stats(self);
+}
+
+void
+log_msg_pool_register_stats(void)
+{
+  StatsClusterKey sc_key;
+
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "msg_pool_cached_bytes", NULL);
+  stats_register_counter(1, &sc_key, SC_TYPE_SINGLE_VALUE, &count_cached_bytes);
+}
+
+/*
+ * Releases the blocks cached by the current thread and by the threads
+ * already exited.  The pools themselves are kept, messages still alive
+ * may be freed later.
+ */
+void
+log_msg_pool_global_deinit(void)
+{
+  if (log_msg_pool)
+    _free_cached_blocks(log_msg_pool);
+
+  g_mutex_lock(&unowned_pools_lock);
+  for (LogMsgPool *pool = unowned_pools; pool; pool = pool->next_unowned)
+    _free_cached_blocks(pool);
+  g_mutex_unlock(&unowned_pools_lock);
+}
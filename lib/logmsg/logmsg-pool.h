@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef LOGMSG_POOL_H_INCLUDED
+#define LOGMSG_POOL_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/*
+ * Memory for LogMessage instances.
+ *
+ * Blocks are rounded up to a few size classes and cached per thread, so a
+ * thread allocating messages mostly reuses blocks it freed earlier instead
+ * of calling malloc().  A block freed by another thread (e.g. a destination
+ * dropping the last reference) is handed back to the thread that allocated
+ * it through a lock-free return list.
+ */
+gpointer log_msg_pool_alloc(gsize size);
+void log_msg_pool_free(gpointer p);
+
+gsize log_msg_pool_get_cached_bytes(void);
+
+void log_msg_pool_register_stats(void);
+void log_msg_pool_global_deinit(void);
+
+#endif
@@ -30,6 +30,7 @@
 #include "timeutils/cache.h"
 #include "timeutils/misc.h"
 #include "logmsg/nvtable.h"
+#include "logmsg/logmsg-pool.h"
 #include "stats/stats-registry.h"
 #include "stats/stats-cluster-single.h"
 #include "template/templates.h"
@@ -1255,7 +1256,7 @@ log_msg_alloc(gsize payload_size)
       payload_ofs = alloc_size;
       alloc_size += payload_space;
     }
-  msg = g_malloc(alloc_size);
+  msg = log_msg_pool_alloc(alloc_size);
 
   memset(msg, 0, sizeof(LogMessage));
 
@@ -1474,7 +1475,7 @@ log_msg_free(LogMessage *self)
 
   stats_counter_sub(count_allocated_bytes, self->allocated_bytes);
 
-  g_free(self);
+  log_msg_pool_free(self);
 }
 
 /**
@@ -1917,6 +1918,8 @@ log_msg_register_stats(void)
 
   stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "msg_allocated_bytes", NULL);
   stats_register_counter(1, &sc_key, SC_TYPE_SINGLE_VALUE, &count_allocated_bytes);
+
+  log_msg_pool_register_stats();
   stats_unlock();
 }
 
@@ -1942,6 +1945,7 @@ void
 log_msg_global_deinit(void)
 {
   log_msg_registry_deinit();
+  log_msg_pool_global_deinit();
 }
 
 gint
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "logmsg/logmsg-pool.h"
+#include "logmsg/logmsg.h"
+#include "apphook.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static gpointer
+_free_block(gpointer p)
+{
+  log_msg_pool_free(p);
+  return NULL;
+}
+
+Test(logmsg_pool, test_freed_block_is_reused_by_the_same_thread)
+{
+  gpointer p = log_msg_pool_alloc(100);
+  gsize cached_bytes = log_msg_pool_get_cached_bytes();
+
+  log_msg_pool_free(p);
+  cr_assert_gt(log_msg_pool_get_cached_bytes(), cached_bytes);
+
+  cr_assert_eq(log_msg_pool_alloc(100), p);
+  cr_assert_eq(log_msg_pool_get_cached_bytes(), cached_bytes);
+  log_msg_pool_free(p);
+}
+
+Test(logmsg_pool, test_block_freed_by_another_thread_is_returned_to_its_owner)
+{
+  gpointer p = log_msg_pool_alloc(3000);
+  gsize cached_bytes = log_msg_pool_get_cached_bytes();
+
+  g_thread_join(g_thread_new("free", _free_block, p));
+
+  /* returned blocks are only taken over when the free list runs out */
+  cr_assert_eq(log_msg_pool_get_cached_bytes(), cached_bytes);
+  cr_assert_eq(log_msg_pool_alloc(3000), p);
+  log_msg_pool_free(p);
+}
+
+Test(logmsg_pool, test_large_blocks_are_not_cached)
+{
+  gpointer p = log_msg_pool_alloc(65536);
+  gsize cached_bytes = log_msg_pool_get_cached_bytes();
+
+  memset(p, 0, 65536);
+  log_msg_pool_free(p);
+  cr_assert_eq(log_msg_pool_get_cached_bytes(), cached_bytes);
+}
+
+#define BURST_BLOCKS 200
+
+Test(logmsg_pool, test_blocks_cached_after_a_burst_are_released_gradually)
+{
+  gpointer blocks[BURST_BLOCKS];
+
+  for (gint i = 0; i < BURST_BLOCKS; i++)
+    blocks[i] = log_msg_pool_alloc(100);
+  for (gint i = 0; i < BURST_BLOCKS; i++)
+    log_msg_pool_free(blocks[i]);
+
+  gsize cached_after_burst = log_msg_pool_get_cached_bytes();
+  cr_assert_leq(cached_after_burst, 64 * 1024, "the free list must be capped");
+
+  /* steady traffic in another size class, the blocks left from the burst are not needed */
+  for (gint i = 0; i < 16 * 256; i++)
+    log_msg_pool_free(log_msg_pool_alloc(3000));
+
+  cr_assert_lt(log_msg_pool_get_cached_bytes(), cached_after_burst / 8,
+               "unused blocks must be released, cached: %" G_GSIZE_FORMAT, log_msg_pool_get_cached_bytes());
+}
+
+#define PERF_NUM_MESSAGES 100000
+#define PERF_CLONES_PER_MESSAGE 2
+#define PERF_MESSAGE_SIZE (sizeof(LogMessage) + 256)
+#define PERF_CLONE_SIZE (sizeof(LogMessage))
+
+typedef struct
+{
+  const gchar *name;
+  gpointer (*alloc)(gsize size);
+  void (*free)(gpointer p);
+} Allocator;
+
+typedef struct
+{
+  const Allocator *allocator;
+  GAsyncQueue *queue;
+} FreeBlocksArgs;
+
+static gpointer
+_free_blocks(gpointer a)
+{
+  FreeBlocksArgs *args = (FreeBlocksArgs *) a;
+  gpointer p;
+
+  while ((p = g_async_queue_pop(args->queue)) != GINT_TO_POINTER(1))
+    args->allocator->free(p);
+  return NULL;
+}
+
+/*
+ * The allocation pattern of messages and their clones: blocks are
+ * allocated in this thread, the last references are dropped in another.
+ */
+static void
+_measure_allocator(const Allocator *allocator)
+{
+  FreeBlocksArgs args = { .allocator = allocator, .queue = g_async_queue_new() };
+  GThread *consumer = g_thread_new("free", _free_blocks, &args);
+  GTimer *timer = g_timer_new();
+
+  for (gint i = 0; i < PERF_NUM_MESSAGES; i++)
+    {
+      for (gint clone = 0; clone < PERF_CLONES_PER_MESSAGE; clone++)
+        g_async_queue_push(args.queue, allocator->alloc(PERF_CLONE_SIZE));
+      g_async_queue_push(args.queue, allocator->alloc(PERF_MESSAGE_SIZE));
+    }
+  g_async_queue_push(args.queue, GINT_TO_POINTER(1));
+  g_thread_join(consumer);
+  g_timer_stop(timer);
+
+  printf("      %-8s: %12.3f blocks/sec\n", allocator->name,
+         PERF_NUM_MESSAGES * (PERF_CLONES_PER_MESSAGE + 1) / g_timer_elapsed(timer, NULL));
+
+  g_timer_destroy(timer);
+  g_async_queue_unref(args.queue);
+}
+
+Test(logmsg_pool, test_performance_of_alloc_free_across_threads)
+{
+  static const Allocator pool = { "pool", log_msg_pool_alloc, log_msg_pool_free };
+  static const Allocator malloc_ = { "g_malloc", g_malloc, g_free };
+
+  _measure_allocator(&malloc_);
+  _measure_allocator(&pool);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+}
+
+static void
+teardown(void)
+{
+  app_shutdown();
+}
+
+TestSuite(logmsg_pool, .init = setup, .fini = teardown);
@@ -310,6 +310,7 @@ exit:
   state->pending_raw_stream_pos = state->raw_stream_pos;
   state->pending_raw_buffer_size = state->raw_buffer_size;
   state->__deprecated_buffer_cached_eol = 0;
+  self->buffer_generation++;
 
   state = NULL;
   log_proto_buffered_server_put_state(self);
@@ -621,6 +622,7 @@ log_proto_buffered_server_fetch_from_buffer(LogProtoBufferedServer *self, const
           state->pending_raw_buffer_size = 0;
         }
       state->pending_buffer_pos = state->pending_buffer_end = 0;
+      self->buffer_generation++;
       goto exit;
     }
 
@@ -706,6 +708,7 @@ log_proto_buffered_server_fetch_into_buffer(LogProtoBufferedServer *self)
         {
           msg_error("EOF read on a channel with leftovers from previous character conversion, dropping input");
           state->pending_buffer_pos = state->pending_buffer_end = 0;
+          self->buffer_generation++;
         }
       result = G_IO_STATUS_EOF;
     }
@@ -750,6 +753,7 @@ _buffered_server_update_pos(LogProtoServer *s)
     {
       state->pending_buffer_end = 0;
       state->pending_buffer_pos = 0;
+      self->buffer_generation++;
       if (self->pos_tracking)
         {
           state->pending_raw_stream_pos += state->pending_raw_buffer_size;
@@ -91,6 +91,9 @@ struct _LogProtoBufferedServer
   PersistEntryHandle persist_handle;
   GIConv convert;
   guchar *buffer;
+  /* incremented whenever the data in the buffer is discarded, offsets
+   * into the buffer remembered by subclasses are invalid after that */
+  guint32 buffer_generation;
 
   /* auxiliary data (e.g. GSockAddr, other transport related meta
    * data) associated with the already buffered data */
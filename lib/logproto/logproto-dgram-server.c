@@ -48,6 +48,17 @@ log_proto_dgram_server_fetch_from_buffer(LogProtoBufferedServer *s, const guchar
   return TRUE;
 }
 
+static LogProtoPrepareAction
+log_proto_dgram_server_prepare(LogProtoServer *s, GIOCondition *cond, gint *timeout)
+{
+  /* datagrams already received by the transport (e.g. batched receive)
+   * would not wake up the poll loop */
+  if (log_transport_has_buffered_input(s->transport))
+    return LPPA_FORCE_SCHEDULE_FETCH;
+
+  return log_proto_buffered_server_prepare(s, cond, timeout);
+}
+
 LogProtoServer *
 log_proto_dgram_server_new(LogTransport *transport, const LogProtoServerOptions *options)
 {
@@ -55,6 +66,7 @@ log_proto_dgram_server_new(LogTransport *transport, const LogProtoServerOptions
 
   log_proto_buffered_server_init(&self->super, transport, options);
   self->super.fetch_from_buffer = log_proto_dgram_server_fetch_from_buffer;
+  self->super.super.prepare = log_proto_dgram_server_prepare;
   self->super.stream_based = FALSE;
   return &self->super.super;
 }
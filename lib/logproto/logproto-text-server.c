@@ -23,6 +23,7 @@
  */
 #include "logproto-text-server.h"
 #include "messages.h"
+#include "find-crlf.h"
 
 #include <string.h>
 
@@ -176,6 +177,68 @@ log_proto_text_server_accumulate_line_method(LogProtoTextServer *self, const guc
   return LPT_CONSUME_LINE | LPT_EXTRACTED;
 }
 
+static inline void
+log_proto_text_server_reset_eol_batch(LogProtoTextServer *self)
+{
+  self->eol_batch_pos = 0;
+  self->eol_batch_len = 0;
+  self->eol_batch_scan_start = 0;
+  self->eol_batch_scan_end = 0;
+}
+
+/*
+ * Returns the first EOL character at or after the @from offset of the
+ * buffer, @end being the end of the data.  Instead of looking for the EOL
+ * of each line separately, the buffer is scanned once and the EOLs of the
+ * subsequent lines are remembered, so consecutive lines are located
+ * without touching the data again.  This is only valid as long as the
+ * data is not moved around or discarded, see the callers of
+ * log_proto_text_server_reset_eol_batch() and buffer_generation in
+ * LogProtoBufferedServer.
+ */
+static const guchar *
+log_proto_text_server_find_eol(LogProtoTextServer *self, gsize from, gsize end)
+{
+  gsize scan_from = from;
+
+  /* the data the offsets were taken from was discarded, new data may be at the same place */
+  if (self->eol_batch_generation != self->super.buffer_generation)
+    {
+      log_proto_text_server_reset_eol_batch(self);
+      self->eol_batch_generation = self->super.buffer_generation;
+    }
+
+  /* a rewound line is looked up again */
+  while (self->eol_batch_pos > 0 && self->eol_batch[self->eol_batch_pos - 1] >= from)
+    self->eol_batch_pos--;
+  while (self->eol_batch_pos < self->eol_batch_len && self->eol_batch[self->eol_batch_pos] < from)
+    self->eol_batch_pos++;
+
+  if (self->eol_batch_pos < self->eol_batch_len && self->eol_batch[self->eol_batch_pos] < end)
+    return self->super.buffer + self->eol_batch[self->eol_batch_pos];
+
+  /* the part scanned previously has no more EOLs, only new data needs to be looked at */
+  if (self->eol_batch_pos == self->eol_batch_len &&
+      self->eol_batch_scan_start <= from && from < self->eol_batch_scan_end && self->eol_batch_scan_end <= end)
+    scan_from = self->eol_batch_scan_end;
+
+  self->eol_batch_len = find_lf_or_nul_offsets(self->super.buffer + scan_from, end - scan_from,
+                                               self->eol_batch, LPT_EOL_BATCH_SIZE);
+  self->eol_batch_pos = 0;
+  for (gint i = 0; i < self->eol_batch_len; i++)
+    self->eol_batch[i] += scan_from;
+
+  self->eol_batch_scan_start = from;
+  if (self->eol_batch_len == LPT_EOL_BATCH_SIZE)
+    self->eol_batch_scan_end = self->eol_batch[LPT_EOL_BATCH_SIZE - 1] + 1;
+  else
+    self->eol_batch_scan_end = end;
+
+  if (self->eol_batch_len == 0)
+    return NULL;
+  return self->super.buffer + self->eol_batch[0];
+}
+
 static void
 log_proto_text_server_split_buffer(LogProtoTextServer *self, LogProtoBufferedServerState *state,
                                    const guchar *buffer_start, gsize buffer_bytes)
@@ -189,6 +252,7 @@ log_proto_text_server_split_buffer(LogProtoTextServer *self, LogProtoBufferedSer
   memmove(self->super.buffer, buffer_start, buffer_bytes);
   state->pending_buffer_pos = 0;
   state->pending_buffer_end = buffer_bytes;
+  log_proto_text_server_reset_eol_batch(self);
 
   if (G_UNLIKELY(self->super.pos_tracking))
     {
@@ -231,7 +295,7 @@ log_proto_text_server_try_extract(LogProtoTextServer *self, LogProtoBufferedServ
        * read further data, or the buffer already contains a
        * complete line */
 
-      eom = find_eom(self->super.buffer + next_line_pos, state->pending_buffer_end - next_line_pos);
+      eom = log_proto_text_server_find_eol(self, next_line_pos, state->pending_buffer_end);
       if (eom)
         next_eol_pos = eom - self->super.buffer;
     }
@@ -345,7 +409,9 @@ log_proto_text_server_locate_next_eol(LogProtoTextServer *self, LogProtoBuffered
     }
   else
     {
-      eol = find_eom(buffer_start + self->consumed_len + 1, buffer_bytes - self->consumed_len - 1);
+      gsize from = buffer_start + self->consumed_len + 1 - self->super.buffer;
+
+      eol = log_proto_text_server_find_eol(self, from, from + buffer_bytes - self->consumed_len - 1);
     }
   return eol;
 }
@@ -415,6 +481,7 @@ log_proto_text_server_flush(LogProtoBufferedServer *s)
   LogProtoTextServer *self = (LogProtoTextServer *) s;
   self->consumed_len = -1;
   self->cached_eol_pos = 0;
+  log_proto_text_server_reset_eol_batch(self);
 }
 
 void
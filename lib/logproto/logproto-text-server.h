@@ -38,6 +38,8 @@ enum
 #define LPT_CONSUME_PARTIAL_AMOUNT_MASK      ~0xFF
 #define LPT_CONSUME_PARTIALLY(drop_length) (LPT_CONSUME_LINE | ((drop_length) << LPT_CONSUME_PARTIAL_AMOUNT_SHIFT))
 
+#define LPT_EOL_BATCH_SIZE 32
+
 typedef struct _LogProtoTextServer LogProtoTextServer;
 struct _LogProtoTextServer
 {
@@ -55,6 +57,15 @@ struct _LogProtoTextServer
 
   gint32 consumed_len;
   gint32 cached_eol_pos;
+
+  /* EOL offsets located in advance by a single scan of the buffer */
+  gsize eol_batch[LPT_EOL_BATCH_SIZE];
+  gint eol_batch_pos;
+  gint eol_batch_len;
+  gsize eol_batch_scan_start;
+  gsize eol_batch_scan_end;
+  /* LogProtoBufferedServer.buffer_generation the offsets belong to */
+  guint32 eol_batch_generation;
 };
 
 /* LogProtoTextServer
@@ -290,6 +290,62 @@ Test(log_proto, test_log_proto_text_server_multi_read)
   log_proto_server_free(proto);
 }
 
+static void
+test_log_proto_text_server_many_lines_in_a_single_read(LogTransportMockConstructor log_transport_mock_new)
+{
+  LogProtoServer *proto;
+  GString *input = g_string_new("");
+
+  /* more EOLs than what fits in the EOL batch of the server */
+  for (gint i = 0; i < 3 * LPT_EOL_BATCH_SIZE; i++)
+    g_string_append(input, (i % 3) == 0 ? "x\n" : "\n");
+
+  proto = construct_test_proto(
+            log_transport_mock_new(
+              input->str, input->len,
+              "partial", -1,
+              " line\n", -1,
+              LTM_EOF));
+
+  for (gint i = 0; i < 3 * LPT_EOL_BATCH_SIZE; i++)
+    assert_proto_server_fetch(proto, (i % 3) == 0 ? "x" : "", -1);
+  assert_proto_server_fetch(proto, "partial line", -1);
+  assert_proto_server_fetch_failure(proto, LPS_EOF, NULL);
+  log_proto_server_free(proto);
+  g_string_free(input, TRUE);
+}
+
+Test(log_proto, test_log_proto_text_server_many_lines_in_a_single_read)
+{
+  test_log_proto_text_server_many_lines_in_a_single_read(log_transport_mock_stream_new);
+  test_log_proto_text_server_many_lines_in_a_single_read(log_transport_mock_records_new);
+}
+
+Test(log_proto, test_log_proto_text_server_lines_of_growing_length_in_separate_reads)
+{
+  LogProtoServer *proto;
+
+  /* the buffer is emptied after each line, the next read lands at the
+   * same offset, where the EOLs of the previous data must not be used */
+  proto = construct_test_proto(
+            log_transport_mock_records_new(
+              "a\n", -1,
+              "bbbbb\n", -1,
+              "ccccccccc\n", -1,
+              "d\neeeeeeeeeeeeeeee\n", -1,
+              "ffffffffffffffffffffffffffffffff\n", -1,
+              LTM_EOF));
+
+  assert_proto_server_fetch(proto, "a", -1);
+  assert_proto_server_fetch(proto, "bbbbb", -1);
+  assert_proto_server_fetch(proto, "ccccccccc", -1);
+  assert_proto_server_fetch(proto, "d", -1);
+  assert_proto_server_fetch(proto, "eeeeeeeeeeeeeeee", -1);
+  assert_proto_server_fetch(proto, "ffffffffffffffffffffffffffffffff", -1);
+  assert_proto_server_fetch_failure(proto, LPS_EOF, NULL);
+  log_proto_server_free(proto);
+}
+
 Test(log_proto, test_log_proto_text_server_multi_read_not_allowed, .disabled = true)
 {
   /* FIXME: */
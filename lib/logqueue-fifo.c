@@ -43,27 +43,41 @@ QueueType log_queue_fifo_type = "FIFO";
  *
  *   - has a per-thread, unlocked input queue where threads can put their items
  *
- *   - has a locked wait-queue where items go once the per-thread input
- *     would be overflown or if the input thread goes to sleep (e.g.  one
- *     lock acquisition per a longer period)
+ *   - has a lock-free, multi-producer/single-consumer wait-queue where
+ *     items go in batches once the per-thread input would be overflown or
+ *     if the input thread goes to sleep
  *
  *   - has an unlocked output queue where items from the wait queue go, once
  *     it becomes depleted.
  *
  * This means that items flow in this sequence from one list to the next:
  *
- *    input queue (per-thread) -> wait queue (locked) -> output queue (single-threaded)
+ *    input queue (per-thread) -> wait queue (lock-free) -> output queue (single-threaded)
  *
  * Fastpath is:
  *   - input threads putting elements on their per-thread queue (lockless)
  *   - output threads removing elements from the output queue (lockless)
  *
  * Slowpath:
- *   - input queue is overflown (or the input thread goes to sleep), wait
- *     queue mutex is grabbed, all elements are put to the wait queue.
+ *   - input queue is overflown (or the input thread goes to sleep), the
+ *     contents of the input queue is detached as a single batch and pushed
+ *     to the wait queue using a compare-and-swap
  *
- *   - output queue is depleted, wait queue mutex is grabbed, all elements
- *     on the wait queue is put to the output queue
+ *   - output queue is depleted, all batches on the wait queue are taken
+ *     using a compare-and-swap and are put to the output queue
+ *
+ * The wait queue is a stack of batches (new batches are pushed to its
+ * head), the output thread reverses it when taking it over, so the order
+ * of the batches is retained.  As the output thread always takes over
+ * the complete stack, there's no ABA problem to deal with.
+ *
+ * log_fifo_size is enforced by reserving room in the wait queue counters
+ * with a compare-and-swap before a batch is published, so input threads
+ * racing with each other cannot overfill the queue.
+ *
+ * LogQueue->lock is only grabbed by the input threads if the output
+ * thread registered a parallel push callback, e.g.  it is waiting for
+ * items as the queue was empty.
  *
  * Threading assumptions:
  *   - the head of the queue is only manipulated from the output thread
@@ -77,9 +91,26 @@ typedef struct _InputQueue
   WorkerBatchCallback cb;
   guint16 len;
   guint16 non_flow_controlled_len;
-  guint16 finish_cb_registered;
+  gint finish_cb_registered;
 } InputQueue;
 
+typedef struct _InputQueueBatch InputQueueBatch;
+struct _InputQueueBatch
+{
+  InputQueueBatch *next;
+  struct iv_list_head items;
+  gint len;
+  gint non_flow_controlled_len;
+};
+
+typedef struct _WaitQueue
+{
+  /* stack of InputQueueBatch instances, newest first */
+  InputQueueBatch *batches;
+  gint len;
+  gint non_flow_controlled_len;
+} WaitQueue;
+
 typedef struct _OverflowQueue
 {
   struct iv_list_head items;
@@ -87,14 +118,18 @@ typedef struct _OverflowQueue
   gint non_flow_controlled_len;
 } OverflowQueue;
 
+/* batches taken over by the output thread are kept here for reuse */
+#define SPARE_BATCHES_MAX 8
+
 typedef struct _LogQueueFifo
 {
   LogQueue super;
 
   /* scalable qoverflow implementation */
   OverflowQueue output_queue;
-  OverflowQueue wait_queue;
+  WaitQueue wait_queue;
   OverflowQueue backlog_queue; /* entries that were sent but not acked yet */
+  InputQueueBatch *spare_batches[SPARE_BATCHES_MAX];
 
   gint log_fifo_size;
 
@@ -104,13 +139,16 @@ typedef struct _LogQueueFifo
   InputQueue input_queues[0];
 } LogQueueFifo;
 
-/* NOTE: this is inherently racy. If the LogQueue->lock is taken, then the
- * race is limited to the changes in output_queue queue changes.
+/* NOTE: this is inherently racy. The wait_queue counters are updated
+ * atomically, the output_queue counters can only change in the output thread.
  *
- * In the output thread, this means that this can get race-free. In the
- * input thread, the output_queue can change because of a
- * log_queue_fifo_push_head() or log_queue_fifo_rewind_backlog().
+ * In the output thread, this means that only the wait_queue counters may
+ * change in parallel. In the input thread, the output_queue can change
+ * because of a log_queue_fifo_push_head() or log_queue_fifo_rewind_backlog().
  *
+ * The wait_queue counters are increased before a batch is published and
+ * decreased after the batch was moved to the output queue, so the length
+ * may temporarily be overestimated but never underestimated.
  */
 
 static void
@@ -130,35 +168,25 @@ log_queue_fifo_get_length(LogQueue *s)
 {
   LogQueueFifo *self = (LogQueueFifo *) s;
 
-  return self->wait_queue.len + self->output_queue.len;
-}
-
-static gint64
-log_queue_fifo_get_non_flow_controlled_length(LogQueueFifo *self)
-{
-  return self->wait_queue.non_flow_controlled_len + self->output_queue.non_flow_controlled_len;
+  return g_atomic_int_get(&self->wait_queue.len) + self->output_queue.len;
 }
 
 gboolean
 log_queue_fifo_is_empty_racy(LogQueue *s)
 {
   LogQueueFifo *self = (LogQueueFifo *) s;
-  gboolean has_message_in_queue = FALSE;
-  g_mutex_lock(&self->super.lock);
-  if (log_queue_fifo_get_length(s) > 0)
+  gint i;
+
+  /* the input threads publish their batch before clearing
+   * finish_cb_registered, so we need to check them in the reverse order to
+   * avoid missing a batch in flight */
+  for (i = 0; i < log_queue_max_threads; i++)
     {
-      has_message_in_queue = TRUE;
+      if (g_atomic_int_get(&self->input_queues[i].finish_cb_registered))
+        return FALSE;
     }
-  else
-    {
-      gint i;
-      for (i = 0; i < log_queue_max_threads && !has_message_in_queue; i++)
-        {
-          has_message_in_queue |= self->input_queues[i].finish_cb_registered;
-        }
-    }
-  g_mutex_unlock(&self->super.lock);
-  return !has_message_in_queue;
+
+  return log_queue_fifo_get_length(s) == 0;
 }
 
 /* NOTE: this is inherently racy, can only be called if log processing is suspended (e.g. reload time) */
@@ -210,76 +238,184 @@ log_queue_fifo_drop_messages_from_input_queue(LogQueueFifo *self, InputQueue *in
             evt_tag_str("persist_name", self->super.persist_name));
 }
 
+/* log_fifo_size applies to every message in legacy mode, only to the non-flow-controlled ones otherwise */
 static inline gboolean
-log_queue_fifo_calculate_num_of_messages_to_drop(LogQueueFifo *self, InputQueue *input_queue,
-                                                 gint *num_of_messages_to_drop)
+_is_limited(LogQueueFifo *self, gboolean flow_control_requested)
 {
-  /* since we're in the input thread, queue_len will be racy.
-   * It can increase due to log_queue_fifo_push_head() and can also decrease as
-   * items are removed from the output queue using log_queue_pop_head().
-   *
-   * The only reason we're using it here is to check for qoverflow
-   * overflows, however the only side-effect of the race (if lost) is that
-   * we would lose a couple of message too many or add some more messages to
-   * qoverflow than permitted by the user.  Since if flow-control is used,
-   * the fifo size should be sized larger than the potential window sizes,
-   * otherwise we can lose messages anyway, this is not deemed a cost to
-   * justify proper locking in this case.
-   */
+  return G_UNLIKELY(self->use_legacy_fifo_size) || !flow_control_requested;
+}
 
-  guint16 input_queue_len;
-  gint queue_len;
+/*
+ * Reserves room for at most num_messages limited messages in the wait
+ * queue, returns the number of messages that fit.  The reservation is
+ * made by increasing the limited wait_queue counter with a
+ * compare-and-swap, so it can't be overtaken by another input thread.
+ *
+ * The output_queue counter is read racily, but the output thread can only
+ * decrease it, except for log_queue_fifo_push_head() and the rewinds,
+ * which put back messages that were already accounted for.
+ */
+static gint
+log_queue_fifo_reserve(LogQueueFifo *self, gint num_messages)
+{
+  gint *wait_queue_len;
+  gint *output_queue_len;
+  gint reserved, accepted;
 
   if (G_UNLIKELY(self->use_legacy_fifo_size))
     {
-      queue_len = log_queue_fifo_get_length(&self->super);
-      input_queue_len = input_queue->len;
+      wait_queue_len = &self->wait_queue.len;
+      output_queue_len = &self->output_queue.len;
     }
   else
     {
-      queue_len = log_queue_fifo_get_non_flow_controlled_length(self);
-      input_queue_len = input_queue->non_flow_controlled_len;
+      wait_queue_len = &self->wait_queue.non_flow_controlled_len;
+      output_queue_len = &self->output_queue.non_flow_controlled_len;
     }
 
-  gboolean drop_messages = queue_len + input_queue_len > self->log_fifo_size;
-  if (!drop_messages)
-    return FALSE;
+  do
+    {
+      reserved = g_atomic_int_get(wait_queue_len);
+      accepted = CLAMP(self->log_fifo_size - reserved - *output_queue_len, 0, num_messages);
+
+      if (accepted == 0)
+        return 0;
+    }
+  while (!g_atomic_int_compare_and_exchange(wait_queue_len, reserved, reserved + accepted));
+
+  return accepted;
+}
+
+/*
+ * The spare batches are taken and given back by exchanging a single slot
+ * with a compare-and-swap. A slot holds no link to other batches, so it is
+ * not exposed to the ABA problem a free-list would be.
+ */
+static InputQueueBatch *
+_input_queue_batch_new(LogQueueFifo *self)
+{
+  InputQueueBatch *batch;
+
+  for (gint i = 0; i < SPARE_BATCHES_MAX; i++)
+    {
+      batch = g_atomic_pointer_get(&self->spare_batches[i]);
+      if (batch && g_atomic_pointer_compare_and_exchange(&self->spare_batches[i], batch, NULL))
+        {
+          batch->next = NULL;
+          batch->len = 0;
+          batch->non_flow_controlled_len = 0;
+          INIT_IV_LIST_HEAD(&batch->items);
+          return batch;
+        }
+    }
 
-  /* NOTE: MAX is needed here to ensure that the lost race on queue_len
-   * doesn't result in n < 0 */
-  *num_of_messages_to_drop = input_queue_len - MAX(0, (self->log_fifo_size - queue_len));
+  batch = g_new0(InputQueueBatch, 1);
+  INIT_IV_LIST_HEAD(&batch->items);
+  return batch;
+}
 
-  return TRUE;
+static void
+_input_queue_batch_free(LogQueueFifo *self, InputQueueBatch *batch)
+{
+  for (gint i = 0; i < SPARE_BATCHES_MAX; i++)
+    {
+      if (g_atomic_pointer_compare_and_exchange(&self->spare_batches[i], NULL, batch))
+        return;
+    }
+  g_free(batch);
 }
 
-/* move items from the per-thread input queue to the lock-protected "wait" queue */
+/* can be called from any of the input threads in parallel, the limited
+ * counter of the batch has already been reserved with log_queue_fifo_reserve() */
+static void
+log_queue_fifo_publish_batch(LogQueueFifo *self, InputQueueBatch *batch)
+{
+  InputQueueBatch *head;
+
+  if (G_UNLIKELY(self->use_legacy_fifo_size))
+    g_atomic_int_add(&self->wait_queue.non_flow_controlled_len, batch->non_flow_controlled_len);
+  else
+    g_atomic_int_add(&self->wait_queue.len, batch->len);
+
+  do
+    {
+      head = g_atomic_pointer_get(&self->wait_queue.batches);
+      batch->next = head;
+    }
+  while (!g_atomic_pointer_compare_and_exchange(&self->wait_queue.batches, head, batch));
+}
+
+/* can only be called from the output thread (or when no input threads are running) */
+static void
+log_queue_fifo_move_wait_queue_to_output_queue(LogQueueFifo *self)
+{
+  InputQueueBatch *batches, *reversed = NULL, *next;
+
+  do
+    {
+      batches = g_atomic_pointer_get(&self->wait_queue.batches);
+      if (!batches)
+        return;
+    }
+  while (!g_atomic_pointer_compare_and_exchange(&self->wait_queue.batches, batches, NULL));
+
+  /* the stack contains the newest batch first */
+  while (batches)
+    {
+      next = batches->next;
+      batches->next = reversed;
+      reversed = batches;
+      batches = next;
+    }
+
+  for (InputQueueBatch *batch = reversed; batch; batch = next)
+    {
+      next = batch->next;
+
+      iv_list_splice_tail(&batch->items, &self->output_queue.items);
+      self->output_queue.len += batch->len;
+      self->output_queue.non_flow_controlled_len += batch->non_flow_controlled_len;
+
+      g_atomic_int_add(&self->wait_queue.len, -batch->len);
+      g_atomic_int_add(&self->wait_queue.non_flow_controlled_len, -batch->non_flow_controlled_len);
+      _input_queue_batch_free(self, batch);
+    }
+}
+
+/* move items from the per-thread input queue to the lock-free "wait" queue */
 static void
 log_queue_fifo_move_input_unlocked(LogQueueFifo *self, gint thread_id)
 {
-  gint num_of_messages_to_drop;
-  gboolean drop_messages = log_queue_fifo_calculate_num_of_messages_to_drop(self, &self->input_queues[thread_id],
-                           &num_of_messages_to_drop);
+  InputQueue *input_queue = &self->input_queues[thread_id];
+  gint limited_len = G_UNLIKELY(self->use_legacy_fifo_size) ? input_queue->len : input_queue->non_flow_controlled_len;
+  gint accepted = log_queue_fifo_reserve(self, limited_len);
 
-  if (drop_messages)
+  if (accepted < limited_len)
     {
       /* slow path, the input thread's queue would overflow the queue, let's drop some messages */
-      log_queue_fifo_drop_messages_from_input_queue(self, &self->input_queues[thread_id], num_of_messages_to_drop);
+      log_queue_fifo_drop_messages_from_input_queue(self, input_queue, limited_len - accepted);
     }
 
-  log_queue_queued_messages_add(&self->super, self->input_queues[thread_id].len);
-  iv_list_update_msg_size(self, &self->input_queues[thread_id].items);
+  if (input_queue->len == 0)
+    return;
+
+  log_queue_queued_messages_add(&self->super, input_queue->len);
+  iv_list_update_msg_size(self, &input_queue->items);
 
-  iv_list_splice_tail_init(&self->input_queues[thread_id].items, &self->wait_queue.items);
-  self->wait_queue.len += self->input_queues[thread_id].len;
-  self->wait_queue.non_flow_controlled_len += self->input_queues[thread_id].non_flow_controlled_len;
-  self->input_queues[thread_id].len = 0;
-  self->input_queues[thread_id].non_flow_controlled_len = 0;
+  InputQueueBatch *batch = _input_queue_batch_new(self);
+  iv_list_splice_tail_init(&input_queue->items, &batch->items);
+  batch->len = input_queue->len;
+  batch->non_flow_controlled_len = input_queue->non_flow_controlled_len;
+  input_queue->len = 0;
+  input_queue->non_flow_controlled_len = 0;
+
+  log_queue_fifo_publish_batch(self, batch);
 }
 
-/* move items from the per-thread input queue to the lock-protected
- * "wait" queue, but grabbing locks first. This is registered as a
- * callback to be called when the input worker thread finishes its
- * job.
+/* move items from the per-thread input queue to the lock-free "wait"
+ * queue and wake up the output thread if it's waiting for items. This is
+ * registered as a callback to be called when the input worker thread
+ * finishes its job.
  */
 static gpointer
 log_queue_fifo_move_input(gpointer user_data)
@@ -291,24 +427,20 @@ log_queue_fifo_move_input(gpointer user_data)
 
   g_assert(thread_id >= 0);
 
-  g_mutex_lock(&self->super.lock);
   log_queue_fifo_move_input_unlocked(self, thread_id);
-  log_queue_push_notify(&self->super);
-  g_mutex_unlock(&self->super.lock);
-  self->input_queues[thread_id].finish_cb_registered = FALSE;
+  log_queue_push_notify_lockless(&self->super);
+  g_atomic_int_set(&self->input_queues[thread_id].finish_cb_registered, FALSE);
   log_queue_unref(&self->super);
   return NULL;
 }
 
-/* lock must be held */
 static inline gboolean
 _message_has_to_be_dropped(LogQueueFifo *self, const LogPathOptions *path_options)
 {
-  if (G_UNLIKELY(self->use_legacy_fifo_size))
-    return log_queue_fifo_get_length(&self->super) >= self->log_fifo_size;
+  if (!_is_limited(self, path_options->flow_control_requested))
+    return FALSE;
 
-  return !path_options->flow_control_requested
-         && log_queue_fifo_get_non_flow_controlled_length(self) >= self->log_fifo_size;
+  return log_queue_fifo_reserve(self, 1) == 0;
 }
 
 static inline void
@@ -369,7 +501,7 @@ log_queue_fifo_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *pat
            */
 
           main_loop_worker_register_batch_callback(&self->input_queues[thread_id].cb);
-          self->input_queues[thread_id].finish_cb_registered = TRUE;
+          g_atomic_int_set(&self->input_queues[thread_id].finish_cb_registered, TRUE);
           log_queue_ref(&self->super);
         }
 
@@ -384,14 +516,11 @@ log_queue_fifo_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *pat
       return;
     }
 
-  /* slow path, put the pending item and the whole input queue to the wait_queue */
-
-  g_mutex_lock(&self->super.lock);
+  /* slow path, put the pending item to the wait_queue as a single element batch */
 
   if (_message_has_to_be_dropped(self, path_options))
     {
       stats_counter_inc(self->super.dropped_messages);
-      g_mutex_unlock(&self->super.lock);
 
       _drop_message(msg, path_options);
 
@@ -402,21 +531,21 @@ log_queue_fifo_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *pat
       return;
     }
 
-  node = log_msg_alloc_queue_node(msg, path_options);
+  InputQueueBatch *batch = _input_queue_batch_new(self);
 
-  iv_list_add_tail(&node->list, &self->wait_queue.items);
-  self->wait_queue.len++;
+  node = log_msg_alloc_queue_node(msg, path_options);
+  iv_list_add_tail(&node->list, &batch->items);
+  batch->len = 1;
 
   if (!path_options->flow_control_requested)
-    self->wait_queue.non_flow_controlled_len++;
+    batch->non_flow_controlled_len = 1;
 
-  log_queue_push_notify(&self->super);
   log_queue_queued_messages_inc(&self->super);
-
   log_queue_memory_usage_add(&self->super, log_msg_get_size(msg));
-  g_mutex_unlock(&self->super.lock);
-
   log_msg_unref(msg);
+
+  log_queue_fifo_publish_batch(self, batch);
+  log_queue_push_notify_lockless(&self->super);
 }
 
 /*
@@ -464,13 +593,7 @@ log_queue_fifo_pop_head(LogQueue *s, LogPathOptions *path_options)
   if (self->output_queue.len == 0)
     {
       /* slow path, output queue is empty, get some elements from the wait queue */
-      g_mutex_lock(&self->super.lock);
-      iv_list_splice_tail_init(&self->wait_queue.items, &self->output_queue.items);
-      self->output_queue.len = self->wait_queue.len;
-      self->output_queue.non_flow_controlled_len = self->wait_queue.non_flow_controlled_len;
-      self->wait_queue.len = 0;
-      self->wait_queue.non_flow_controlled_len = 0;
-      g_mutex_unlock(&self->super.lock);
+      log_queue_fifo_move_wait_queue_to_output_queue(self);
     }
 
   if (self->output_queue.len > 0)
@@ -644,9 +767,13 @@ log_queue_fifo_free(LogQueue *s)
       log_queue_fifo_free_queue(&self->input_queues[i].items);
     }
 
-  log_queue_fifo_free_queue(&self->wait_queue.items);
+  log_queue_fifo_move_wait_queue_to_output_queue(self);
   log_queue_fifo_free_queue(&self->output_queue.items);
   log_queue_fifo_free_queue(&self->backlog_queue.items);
+
+  for (i = 0; i < SPARE_BATCHES_MAX; i++)
+    g_free(self->spare_batches[i]);
+
   log_queue_free_method(s);
 }
 
@@ -680,7 +807,6 @@ log_queue_fifo_new(gint log_fifo_size, const gchar *persist_name)
       self->input_queues[i].cb.func = log_queue_fifo_move_input;
       self->input_queues[i].cb.user_data = self;
     }
-  INIT_IV_LIST_HEAD(&self->wait_queue.items);
   INIT_IV_LIST_HEAD(&self->output_queue.items);
   INIT_IV_LIST_HEAD(&self->backlog_queue.items);
 
@@ -114,6 +114,31 @@ log_queue_push_notify(LogQueue *self)
     }
 }
 
+/*
+ * Same as log_queue_push_notify(), but it is to be called by producers
+ * that publish their items without holding self->lock.  The lock is only
+ * acquired if a parallel push callback is registered, e.g.  the consumer
+ * is waiting for items.
+ *
+ * log_queue_check_items() registers the callback before checking the
+ * length of the queue, while producers publish their items before
+ * checking the callback, thus either the consumer sees the new items or
+ * the producer sees the callback.  Both sides need to use sequentially
+ * consistent atomic operations for this to work.
+ *
+ * NOTE: self->lock must not be held when calling this function.
+ */
+void
+log_queue_push_notify_lockless(LogQueue *self)
+{
+  if (!g_atomic_pointer_get((gpointer *) &self->parallel_push_notify))
+    return;
+
+  g_mutex_lock(&self->lock);
+  log_queue_push_notify(self);
+  g_mutex_unlock(&self->lock);
+}
+
 void
 log_queue_reset_parallel_push(LogQueue *self)
 {
@@ -152,12 +177,15 @@ log_queue_check_items(LogQueue *self, gint *timeout, LogQueuePushNotifyFunc para
   if (self->parallel_push_data && self->parallel_push_data_destroy)
     self->parallel_push_data_destroy(self->parallel_push_data);
 
+  /* the callback is registered before checking the length, see
+   * log_queue_push_notify_lockless() for the reasons */
+  self->parallel_push_data = user_data;
+  self->parallel_push_data_destroy = user_data_destroy;
+  g_atomic_pointer_set((gpointer *) &self->parallel_push_notify, (gpointer) parallel_push_notify);
+
   num_elements = log_queue_get_length(self);
   if (num_elements == 0)
     {
-      self->parallel_push_notify = parallel_push_notify;
-      self->parallel_push_data = user_data;
-      self->parallel_push_data_destroy = user_data_destroy;
       g_mutex_unlock(&self->lock);
       return FALSE;
     }
@@ -168,6 +196,7 @@ log_queue_check_items(LogQueue *self, gint *timeout, LogQueuePushNotifyFunc para
 
   self->parallel_push_notify = NULL;
   self->parallel_push_data = NULL;
+  self->parallel_push_data_destroy = NULL;
 
   g_mutex_unlock(&self->lock);
 
@@ -222,8 +251,8 @@ log_queue_check_items(LogQueue *self, gint *timeout, LogQueuePushNotifyFunc para
 static void
 _register_common_counters(LogQueue *self, gint stats_level, const StatsClusterKey *sc_key)
 {
-  stats_register_counter(stats_level, sc_key, SC_TYPE_QUEUED, &self->queued_messages);
-  stats_register_counter(stats_level, sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
+  stats_register_sharded_counter(stats_level, sc_key, SC_TYPE_QUEUED, &self->queued_messages);
+  stats_register_sharded_counter(stats_level, sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
   stats_register_counter_and_index(STATS_LEVEL1, sc_key, SC_TYPE_MEMORY_USAGE, &self->memory_usage);
   atomic_gssize_set(&self->stats_cache.queued_messages, log_queue_get_length(self));
   stats_counter_add(self->queued_messages, atomic_gssize_get_unsigned(&self->stats_cache.queued_messages));
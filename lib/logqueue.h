@@ -216,6 +216,7 @@ void log_queue_queued_messages_dec(LogQueue *self);
 void log_queue_queued_messages_reset(LogQueue *self);
 
 void log_queue_push_notify(LogQueue *self);
+void log_queue_push_notify_lockless(LogQueue *self);
 void log_queue_reset_parallel_push(LogQueue *self);
 void log_queue_set_parallel_push(LogQueue *self, LogQueuePushNotifyFunc parallel_push_notify, gpointer user_data,
                                  GDestroyNotify user_data_destroy);
@@ -31,6 +31,7 @@
 static void log_reader_io_handle_in(gpointer s);
 static gboolean log_reader_fetch_log(LogReader *self);
 static void log_reader_update_watches(LogReader *self);
+static void log_reader_disable_watches(LogReader *self);
 
 /*****************************************************************************
  * LogReader setters
@@ -88,6 +89,20 @@ log_reader_set_options(LogReader *s, LogPipe *control, LogReaderOptions *options
   log_proto_server_set_options(self->proto, &self->options->proto_options.super);
 }
 
+/*
+ * The reader is assigned to one of the I/O reactors when it is first
+ * initialized, if they are enabled and the reader is threaded.  Readers
+ * with a dynamic window are left in the main thread, as the window pool is
+ * rebalanced there.
+ */
+void
+log_reader_use_io_reactor(LogReader *s)
+{
+  LogReader *self = (LogReader *) s;
+
+  self->use_io_reactor = TRUE;
+}
+
 void
 log_reader_set_name(LogReader *self, const gchar *name)
 {
@@ -104,6 +119,52 @@ log_reader_disable_bookmark_saving(LogReader *s)
  * Watches: the poll_events instance and the idle timer
  ***************************************************************************/
 
+static inline void
+log_reader_assert_watches_thread(LogReader *self)
+{
+  if (self->reactor)
+    g_assert(main_loop_io_reactor_is_current(self->reactor));
+  else
+    main_loop_assert_main_thread();
+}
+
+static gpointer
+log_reader_unref_deferred(gpointer s)
+{
+  log_pipe_unref((LogPipe *) s);
+  return NULL;
+}
+
+static gpointer
+log_reader_notify_control_deferred(gpointer s)
+{
+  LogReader *self = (LogReader *) s;
+
+  /* if the reader was deinitialized in the meantime, it notices the same
+   * condition again once it is initialized */
+  if (self->super.super.flags & PIF_INITIALIZED)
+    log_pipe_notify(self->control, self->pending_notify_code, self);
+  log_pipe_unref(&self->super.super);
+  return NULL;
+}
+
+/* the control may deinit or free the reader, so it is always notified in the main thread */
+static void
+log_reader_notify_control(LogReader *self, gint notify_code)
+{
+  if (!self->reactor)
+    {
+      log_pipe_notify(self->control, notify_code, self);
+      return;
+    }
+
+  /* the watches stay disabled until the control has acted upon the notification */
+  log_reader_disable_watches(self);
+  self->pending_notify_code = notify_code;
+  log_pipe_ref(&self->super.super);
+  main_loop_io_reactor_call_main(log_reader_notify_control_deferred, self);
+}
+
 static void
 log_reader_idle_timeout(void *cookie)
 {
@@ -113,7 +174,7 @@ log_reader_idle_timeout(void *cookie)
   msg_notice("Source timeout has elapsed, closing connection",
              evt_tag_int("fd", log_proto_server_get_fd(self->proto)));
 
-  log_pipe_notify(self->control, NC_CLOSE, self);
+  log_reader_notify_control(self, NC_CLOSE);
 }
 
 static void
@@ -178,11 +239,31 @@ log_reader_force_check_in_next_poll(LogReader *self)
     }
 }
 
+static gpointer
+log_reader_wakeup_in_reactor(gpointer s)
+{
+  LogReader *self = (LogReader *) s;
+
+  /* the watches may have been stopped since the wakeup was triggered */
+  if (self->watches_running && self->suspended)
+    log_reader_update_watches(self);
+
+  main_loop_io_reactor_call_main(log_reader_unref_deferred, self);
+  return NULL;
+}
+
 static void
 log_reader_wakeup_triggered(gpointer s)
 {
   LogReader *self = (LogReader *) s;
 
+  if (self->reactor)
+    {
+      log_pipe_ref(&self->super.super);
+      main_loop_io_reactor_call(self->reactor, log_reader_wakeup_in_reactor, self);
+      return;
+    }
+
   if (!self->io_job.working && self->suspended)
     {
       /* NOTE: by the time working is set to FALSE we're over an
@@ -257,9 +338,27 @@ log_reader_close_proto_deferred(gpointer s)
   log_reader_start_watches(self);
 }
 
+static gpointer
+log_reader_close_proto_in_reactor(gpointer s)
+{
+  LogReader *self = (LogReader *) s;
+
+  log_reader_close_proto_deferred(self);
+  main_loop_io_reactor_call_main(log_reader_unref_deferred, self);
+  return NULL;
+}
+
 void
 log_reader_close_proto(LogReader *self)
 {
+  if (self->reactor)
+    {
+      /* the watches are owned by the reactor thread, the LogProto is closed there asynchronously */
+      log_pipe_ref(&self->super.super);
+      main_loop_io_reactor_call(self->reactor, log_reader_close_proto_in_reactor, self);
+      return;
+    }
+
   g_assert(self->watches_running);
   main_loop_call((MainLoopTaskFunc) log_reader_close_proto_deferred, self, TRUE);
 
@@ -299,7 +398,7 @@ log_reader_update_watches(LogReader *self)
   GIOCondition cond;
   gint idle_timeout = -1;
 
-  main_loop_assert_main_thread();
+  log_reader_assert_watches_thread(self);
   g_assert(self->watches_running);
 
   log_reader_disable_watches(self);
@@ -387,7 +486,9 @@ log_reader_work_finished(void *s)
       gint notify_code = self->notify_code;
 
       self->notify_code = 0;
-      log_pipe_notify(self->control, notify_code, self);
+      log_reader_notify_control(self, notify_code);
+      if (self->reactor)
+        return;
     }
   if (self->super.super.flags & PIF_INITIALIZED)
     {
@@ -556,7 +657,12 @@ log_reader_io_handle_in(gpointer s)
   LogReader *self = (LogReader *) s;
 
   log_reader_disable_watches(self);
-  if ((self->options->flags & LR_THREADED))
+  if (self->reactor)
+    {
+      /* if the reactor is parked, the watches are restarted when the reader is initialized again */
+      main_loop_io_reactor_run_job(self->reactor, &self->io_job, G_IO_IN);
+    }
+  else if ((self->options->flags & LR_THREADED))
     {
       main_loop_io_worker_job_submit(&self->io_job, G_IO_IN);
     }
@@ -620,6 +726,30 @@ _unregister_aggregated_stats(LogReader *self)
  * LogReader->LogPipe interface implementation
  *****************************************************************************/
 
+/* the reader is referenced while these calls are pending, released in the main thread */
+static gpointer
+log_reader_start_watches_in_reactor(gpointer s)
+{
+  LogReader *self = (LogReader *) s;
+
+  log_reader_start_watches(self);
+  main_loop_io_reactor_call_main(log_reader_unref_deferred, self);
+  return NULL;
+}
+
+static gpointer
+log_reader_stop_watches_in_reactor(gpointer s)
+{
+  LogReader *self = (LogReader *) s;
+
+  if (iv_task_registered(&self->restart_task))
+    iv_task_unregister(&self->restart_task);
+
+  log_reader_stop_watches(self);
+  main_loop_io_reactor_call_main(log_reader_unref_deferred, self);
+  return NULL;
+}
+
 static gboolean
 log_reader_init(LogPipe *s)
 {
@@ -643,7 +773,20 @@ log_reader_init(LogPipe *s)
 
   iv_event_register(&self->schedule_wakeup);
 
-  log_reader_start_watches(self);
+  if (!self->reactor && self->use_io_reactor && (self->options->flags & LR_THREADED)
+      && !log_source_is_dynamic_window_enabled(&self->super))
+    self->reactor = main_loop_io_reactor_assign();
+
+  if (self->reactor)
+    {
+      main_loop_io_reactor_engage(self->reactor);
+      log_pipe_ref(s);
+      main_loop_io_reactor_call(self->reactor, log_reader_start_watches_in_reactor, self);
+    }
+  else
+    {
+      log_reader_start_watches(self);
+    }
 
   _register_aggregated_stats(self);
 
@@ -658,10 +801,18 @@ log_reader_deinit(LogPipe *s)
   main_loop_assert_main_thread();
 
   iv_event_unregister(&self->schedule_wakeup);
-  if (iv_task_registered(&self->restart_task))
-    iv_task_unregister(&self->restart_task);
+  if (self->reactor)
+    {
+      log_pipe_ref(s);
+      main_loop_io_reactor_call(self->reactor, log_reader_stop_watches_in_reactor, self);
+    }
+  else
+    {
+      if (iv_task_registered(&self->restart_task))
+        iv_task_unregister(&self->restart_task);
 
-  log_reader_stop_watches(self);
+      log_reader_stop_watches(self);
+    }
 
   _unregister_aggregated_stats(self);
   if (!log_source_deinit(s))
@@ -707,6 +858,7 @@ log_reader_free(LogPipe *s)
   if (self->poll_events)
     poll_events_free(self->poll_events);
 
+  main_loop_io_reactor_release(self->reactor);
   log_pipe_unref(self->control);
   g_sockaddr_unref(self->peer_addr);
   g_sockaddr_unref(self->local_addr);
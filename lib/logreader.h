@@ -31,6 +31,7 @@
 #include "logproto/logproto-server.h"
 #include "poll-events.h"
 #include "mainloop-io-worker.h"
+#include "mainloop-io-reactor.h"
 #include <iv_event.h>
 
 /* flags */
@@ -75,9 +76,14 @@ struct _LogReader
   struct iv_task restart_task;
   struct iv_event schedule_wakeup;
   MainLoopIOWorkerJob io_job;
-  gboolean watches_running:1, suspended:1, realloc_window_after_fetch:1;
+  gboolean watches_running:1, suspended:1, realloc_window_after_fetch:1, use_io_reactor:1;
   gint notify_code;
 
+  /* if set, the watches are registered in the reactor thread and input is
+   * processed there, see log_reader_use_io_reactor() */
+  MainLoopIOReactor *reactor;
+  gint pending_notify_code;
+
 
   /* proto & poll_events pending to be applied. As long as the previous
    * processing is being done, we can't replace these in self->proto and
@@ -97,6 +103,7 @@ void log_reader_set_name(LogReader *s, const gchar *name);
 void log_reader_set_peer_addr(LogReader *s, GSockAddr *peer_addr);
 void log_reader_set_local_addr(LogReader *s, GSockAddr *local_addr);
 void log_reader_set_immediate_check(LogReader *s);
+void log_reader_use_io_reactor(LogReader *s);
 void log_reader_disable_bookmark_saving(LogReader *s);
 void log_reader_open(LogReader *s, LogProtoServer *proto, PollEvents *poll_events);
 void log_reader_close_proto(LogReader *s);
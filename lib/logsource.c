@@ -474,8 +474,8 @@ log_source_init(LogPipe *s)
   stats_lock();
   StatsClusterKey sc_key;
   stats_cluster_logpipe_key_set(&sc_key, self->options->stats_source | SCS_SOURCE, self->stats_id, self->stats_instance);
-  stats_register_counter(self->options->stats_level, &sc_key,
-                         SC_TYPE_PROCESSED, &self->recvd_messages);
+  stats_register_sharded_counter(self->options->stats_level, &sc_key,
+                                 SC_TYPE_PROCESSED, &self->recvd_messages);
   stats_register_counter(self->options->stats_level, &sc_key, SC_TYPE_STAMP, &self->last_message_seen);
 
   _register_window_stats(self);
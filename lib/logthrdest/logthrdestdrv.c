@@ -79,10 +79,32 @@ log_threaded_dest_driver_set_time_reopen(LogDriver *s, time_t time_reopen)
   self->time_reopen = time_reopen;
 }
 
+static void
+_track_latency(LogThreadedDestWorker *self, LogMessage *msg)
+{
+  if (self->owner->e2e_latency)
+    g_array_append_val(self->batch_recvd_timestamps, msg->timestamps[LM_TS_RECVD]);
+}
+
+/* messages leave the batch in the order they were inserted, the delivered ones are accounted for */
+static void
+_untrack_latency(LogThreadedDestWorker *self, gint batch_size, gboolean delivered)
+{
+  guint len = MIN(self->batch_recvd_timestamps->len, batch_size);
+
+  for (guint i = 0; delivered && i < len; i++)
+    {
+      UnixTime *recvd = &g_array_index(self->batch_recvd_timestamps, UnixTime, i);
+      stats_aggregator_insert_data(self->owner->e2e_latency, unix_time_get_elapsed_usec(recvd));
+    }
+  g_array_remove_range(self->batch_recvd_timestamps, 0, len);
+}
+
 /* this should be used in combination with LTR_EXPLICIT_ACK_MGMT to actually confirm message delivery. */
 void
 log_threaded_dest_worker_ack_messages(LogThreadedDestWorker *self, gint batch_size)
 {
+  _untrack_latency(self, batch_size, TRUE);
   log_queue_ack_backlog(self->queue, batch_size);
   stats_counter_add(self->owner->written_messages, batch_size);
   self->retries_on_error_counter = 0;
@@ -92,6 +114,7 @@ log_threaded_dest_worker_ack_messages(LogThreadedDestWorker *self, gint batch_si
 void
 log_threaded_dest_worker_drop_messages(LogThreadedDestWorker *self, gint batch_size)
 {
+  _untrack_latency(self, batch_size, FALSE);
   log_queue_ack_backlog(self->queue, batch_size);
   stats_counter_add(self->owner->dropped_messages, batch_size);
   self->retries_on_error_counter = 0;
@@ -101,6 +124,9 @@ log_threaded_dest_worker_drop_messages(LogThreadedDestWorker *self, gint batch_s
 void
 log_threaded_dest_worker_rewind_messages(LogThreadedDestWorker *self, gint batch_size)
 {
+  /* the rewound messages are the last ones of the batch, they are tracked again when inserted again */
+  guint len = self->batch_recvd_timestamps->len;
+  g_array_set_size(self->batch_recvd_timestamps, len - MIN(len, batch_size));
   log_queue_rewind_backlog(self->queue, batch_size);
   self->rewound_batch_size = self->batch_size;
   self->batch_size -= batch_size;
@@ -424,6 +450,7 @@ _perform_inserts(LogThreadedDestWorker *self)
       ScratchBuffersMarker mark;
       scratch_buffers_mark(&mark);
 
+      _track_latency(self, msg);
       result = log_threaded_dest_worker_insert(self, msg);
       scratch_buffers_reclaim_marked(mark);
 
@@ -806,6 +833,7 @@ log_threaded_dest_worker_deinit_method(LogThreadedDestWorker *self)
 void
 log_threaded_dest_worker_free_method(LogThreadedDestWorker *self)
 {
+  g_array_free(self->batch_recvd_timestamps, TRUE);
   g_cond_clear(&self->started_up);
 }
 
@@ -818,6 +846,7 @@ log_threaded_dest_worker_init_instance(LogThreadedDestWorker *self, LogThreadedD
   self->free_fn = log_threaded_dest_worker_free_method;
   self->owner = owner;
   self->time_reopen = -1;
+  self->batch_recvd_timestamps = g_array_new(FALSE, FALSE, sizeof(UnixTime));
   g_cond_init(&self->started_up);
   _init_watches(self);
 }
@@ -840,6 +869,15 @@ log_threaded_dest_driver_set_num_workers(LogDriver *s, gint num_workers)
   self->num_workers = num_workers;
 }
 
+void
+log_threaded_dest_driver_set_partition_key(LogDriver *s, LogTemplate *partition_key)
+{
+  LogThreadedDestDriver *self = (LogThreadedDestDriver *) s;
+
+  log_template_unref(self->partition_key);
+  self->partition_key = partition_key;
+}
+
 /* compatibility bridge between LogThreadedDestWorker */
 
 static gboolean
@@ -960,13 +998,60 @@ log_threaded_dest_driver_set_max_retries_on_error(LogDriver *s, gint max_retries
   self->retries_on_error_max = max_retries;
 }
 
+/* FNV-1a, we need a length aware hash as the formatted key is not
+ * necessarily NUL terminated (e.g.  trivial templates) */
+static guint32
+_hash_partition_key(const gchar *key, gssize key_len)
+{
+  guint32 hash = 2166136261U;
+
+  for (gssize i = 0; i < key_len; i++)
+    {
+      hash ^= (guchar) key[i];
+      hash *= 16777619U;
+    }
+  return hash;
+}
+
+static guint32
+_calculate_partition_hash(LogThreadedDestDriver *self, LogMessage *msg)
+{
+  const gchar *key;
+  gssize key_len = -1;
+  guint32 hash;
+
+  if (log_template_is_trivial(self->partition_key))
+    {
+      key = log_template_get_trivial_value(self->partition_key, msg, &key_len);
+      if (key_len < 0)
+        key_len = strlen(key);
+      return _hash_partition_key(key, key_len);
+    }
+
+  ScratchBuffersMarker marker;
+  GString *formatted_key = scratch_buffers_alloc_and_mark(&marker);
+
+  log_template_format(self->partition_key, msg, &DEFAULT_TEMPLATE_EVAL_OPTIONS, formatted_key);
+  hash = _hash_partition_key(formatted_key->str, formatted_key->len);
+
+  scratch_buffers_reclaim_marked(marker);
+  return hash;
+}
+
 LogThreadedDestWorker *
 _lookup_worker(LogThreadedDestDriver *self, LogMessage *msg)
 {
-  gint worker_index = self->last_worker % self->num_workers;
+  gint worker_index;
+
+  if (self->partition_key && self->num_workers > 1)
+    {
+      worker_index = _calculate_partition_hash(self, msg) % self->num_workers;
+      return self->workers[worker_index];
+    }
+
+  worker_index = self->last_worker % self->num_workers;
   self->last_worker++;
 
-  /* here would come the lookup mechanism that maps msg -> worker that doesn't exist yet. */
   return self->workers[worker_index];
 }
 
@@ -1042,6 +1127,10 @@ log_threaded_dest_driver_register_aggregated_stats(LogThreadedDestDriver *self)
                                          self->format_stats_instance(self), "eps");
   stats_register_aggregator_cps(0, &sc_key, &sc_key_eps_input, SC_TYPE_WRITTEN, &self->CPS);
 
+  stats_cluster_single_key_set_with_name(&sc_key, self->stats_source | SCS_DESTINATION, self->super.super.id,
+                                         self->format_stats_instance(self), "e2e_latency");
+  stats_register_aggregator_histogram(0, &sc_key, &self->e2e_latency);
+
   stats_aggregator_unlock();
 }
 
@@ -1055,6 +1144,7 @@ log_threaded_dest_driver_unregister_aggregated_stats(LogThreadedDestDriver *self
   stats_unregister_aggregator_maximum(&self->max_batch_size);
   stats_unregister_aggregator_average(&self->average_batch_size);
   stats_unregister_aggregator_cps(&self->CPS);
+  stats_unregister_aggregator_histogram(&self->e2e_latency);
 
   stats_aggregator_unlock();
 }
@@ -1067,9 +1157,9 @@ _register_stats(LogThreadedDestDriver *self)
     StatsClusterKey sc_key;
 
     _init_stats_key(self, &sc_key);
-    stats_register_counter(0, &sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
-    stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED, &self->processed_messages);
-    stats_register_counter(0, &sc_key, SC_TYPE_WRITTEN, &self->written_messages);
+    stats_register_sharded_counter(0, &sc_key, SC_TYPE_DROPPED, &self->dropped_messages);
+    stats_register_sharded_counter(0, &sc_key, SC_TYPE_PROCESSED, &self->processed_messages);
+    stats_register_sharded_counter(0, &sc_key, SC_TYPE_WRITTEN, &self->written_messages);
 
   }
   stats_unlock();
@@ -1195,6 +1285,7 @@ log_threaded_dest_driver_free(LogPipe *s)
   LogThreadedDestDriver *self = (LogThreadedDestDriver *)s;
 
   log_threaded_dest_worker_free_method(&self->worker.instance);
+  log_template_unref(self->partition_key);
   g_mutex_clear(&self->lock);
   g_free(self->workers);
   log_dest_driver_free((LogPipe *)self);
@@ -32,6 +32,7 @@
 #include "logqueue.h"
 #include "mainloop-worker.h"
 #include "seqnum.h"
+#include "template/templates.h"
 
 #include <iv.h>
 #include <iv_event.h>
@@ -79,6 +80,8 @@ struct _LogThreadedDestWorker
   gboolean connected;
   gint batch_size;
   gint rewound_batch_size;
+  /* LM_TS_RECVD of the messages in the batch, while latency is measured */
+  GArray *batch_recvd_timestamps;
   gint retries_on_error_counter;
   guint retries_counter;
   gint32 seq_num;
@@ -114,6 +117,7 @@ struct _LogThreadedDestDriver
   StatsAggregator *max_batch_size;
   StatsAggregator *average_batch_size;
   StatsAggregator *CPS;
+  StatsAggregator *e2e_latency;
 
   gint batch_lines;
   gint batch_timeout;
@@ -144,6 +148,10 @@ struct _LogThreadedDestDriver
   gint created_workers;
   guint last_worker;
 
+  /* if set, messages with the same formatted partition key are always
+   * delivered by the same worker, preserving their relative order */
+  LogTemplate *partition_key;
+
   gint stats_source;
 
   /* this counter is not thread safe if there are multiple worker threads,
@@ -246,6 +254,7 @@ void log_threaded_dest_driver_free(LogPipe *s);
 
 void log_threaded_dest_driver_set_max_retries_on_error(LogDriver *s, gint max_retries);
 void log_threaded_dest_driver_set_num_workers(LogDriver *s, gint num_workers);
+void log_threaded_dest_driver_set_partition_key(LogDriver *s, LogTemplate *partition_key);
 void log_threaded_dest_driver_set_batch_lines(LogDriver *s, gint batch_lines);
 void log_threaded_dest_driver_set_batch_timeout(LogDriver *s, gint batch_timeout);
 void log_threaded_dest_driver_set_time_reopen(LogDriver *s, time_t time_reopen);
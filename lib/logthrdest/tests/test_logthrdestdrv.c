@@ -27,6 +27,8 @@
 #include "libtest/cr_template.h"
 
 #include "logthrdest/logthrdestdrv.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
 #include "apphook.h"
 
 
@@ -772,8 +774,271 @@ Test(logthrdestdrv, test_explicit_ack_accept)
   cr_assert(dd->super.shared_seq_num == 11, "%d", dd->super.shared_seq_num);
 }
 
+typedef struct _PartitionTracker
+{
+  GMutex lock;
+  GHashTable *key_to_worker;
+  gint misrouted_messages;
+} PartitionTracker;
+
+static PartitionTracker partition_tracker;
+
+static LogThreadedResult
+_insert_and_track_partition(LogThreadedDestWorker *s, LogMessage *msg)
+{
+  const gchar *key = log_msg_get_value(msg, LM_V_PID, NULL);
+  gpointer worker_index;
+
+  g_mutex_lock(&partition_tracker.lock);
+  if (g_hash_table_lookup_extended(partition_tracker.key_to_worker, key, NULL, &worker_index))
+    {
+      if (GPOINTER_TO_INT(worker_index) != s->worker_index)
+        partition_tracker.misrouted_messages++;
+    }
+  else
+    {
+      g_hash_table_insert(partition_tracker.key_to_worker, g_strdup(key), GINT_TO_POINTER(s->worker_index));
+    }
+  g_mutex_unlock(&partition_tracker.lock);
+  return LTR_SUCCESS;
+}
+
+static LogThreadedDestWorker *
+_construct_partitioned_worker(LogThreadedDestDriver *o, gint worker_index)
+{
+  LogThreadedDestWorker *self = g_new0(LogThreadedDestWorker, 1);
+
+  log_threaded_dest_worker_init_instance(self, o, worker_index);
+  self->thread_init = log_threaded_dest_worker_init_method;
+  self->thread_deinit = log_threaded_dest_worker_deinit_method;
+  self->insert = _insert_and_track_partition;
+  self->free_fn = log_threaded_dest_worker_free_method;
+  return self;
+}
+
+static void
+_generate_messages_with_keys(TestThreadedDestDriver *driver, gint n, gint num_keys)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT_NOACK;
+  gchar buf[32];
+
+  for (gint i = 0; i < n; i++)
+    {
+      LogMessage *msg = create_sample_message();
+
+      g_snprintf(buf, sizeof(buf), "key%d", i % num_keys);
+      log_msg_set_value(msg, LM_V_PID, buf, -1);
+
+      log_pipe_queue(&driver->super.super.super.super, msg, &path_options);
+    }
+}
+
+static void
+_setup_partitioned_dd(const gchar *partition_key)
+{
+  GlobalConfig *cfg = main_loop_get_current_config(main_loop);
+
+  dd = test_threaded_dd_new(cfg);
+  dd->super.worker.construct = _construct_partitioned_worker;
+  log_threaded_dest_driver_set_num_workers(&dd->super.super.super, 4);
+
+  LogTemplate *template = log_template_new(cfg, NULL);
+  cr_assert(log_template_compile(template, partition_key, NULL));
+  log_threaded_dest_driver_set_partition_key(&dd->super.super.super, template);
+
+  cr_assert(log_pipe_init(&dd->super.super.super.super));
+  cr_assert(log_pipe_on_config_inited(&dd->super.super.super.super));
+}
+
+static void
+_assert_messages_are_partitioned_by_key(const gchar *partition_key)
+{
+  _setup_partitioned_dd(partition_key);
+
+  _generate_messages_with_keys(dd, 100, 7);
+  _spin_for_counter_value(dd->super.written_messages, 100);
+
+  cr_assert(g_hash_table_size(partition_tracker.key_to_worker) == 7);
+  cr_assert(partition_tracker.misrouted_messages == 0,
+            "messages with the same partition key were delivered by different workers, misrouted=%d",
+            partition_tracker.misrouted_messages);
+}
+
 MainLoopOptions main_loop_options = {0};
 
+static void
+setup_partition(void)
+{
+  app_startup();
+
+  main_loop = main_loop_get_instance();
+  main_loop_init(main_loop, &main_loop_options);
+
+  g_mutex_init(&partition_tracker.lock);
+  partition_tracker.key_to_worker = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  partition_tracker.misrouted_messages = 0;
+}
+
+static void
+teardown_partition(void)
+{
+  _teardown_dd();
+  g_hash_table_unref(partition_tracker.key_to_worker);
+  g_mutex_clear(&partition_tracker.lock);
+  main_loop_deinit(main_loop);
+  app_shutdown();
+}
+
+Test(logthrdestdrv_partition, messages_with_the_same_trivial_key_are_delivered_by_the_same_worker,
+     .init = setup_partition, .fini = teardown_partition)
+{
+  _assert_messages_are_partitioned_by_key("$PID");
+}
+
+Test(logthrdestdrv_partition, messages_with_the_same_formatted_key_are_delivered_by_the_same_worker,
+     .init = setup_partition, .fini = teardown_partition)
+{
+  _assert_messages_are_partitioned_by_key("tenant-${PID}");
+}
+
+static void
+setup_latency(void)
+{
+  GlobalConfig *cfg;
+
+  app_startup();
+
+  main_loop = main_loop_get_instance();
+  main_loop_init(main_loop, &main_loop_options);
+
+  /* the latency histogram is only registered from stats level 1 */
+  cfg = main_loop_get_current_config(main_loop);
+  cfg->stats_options.level = STATS_LEVEL1;
+  stats_reinit(&cfg->stats_options);
+  _setup_dd();
+}
+
+static void
+teardown_latency(void)
+{
+  _teardown_dd();
+  main_loop_deinit(main_loop);
+  app_shutdown();
+}
+
+static gssize
+_get_latency_count(void)
+{
+  StatsClusterKey sc_key;
+  StatsCounterItem *counter;
+
+  stats_cluster_single_key_set_with_name(&sc_key, dd->super.stats_source | SCS_DESTINATION, dd->super.super.super.id,
+                                         "stats-name", "e2e_latency_count");
+  stats_lock();
+  counter = stats_get_counter(&sc_key, SC_TYPE_SINGLE_VALUE);
+  stats_unlock();
+
+  cr_assert(counter, "e2e_latency histogram is not registered");
+  return stats_counter_get(counter);
+}
+
+static void
+_assert_latency_tracked(gssize expected_count)
+{
+  gssize count = _get_latency_count();
+
+  cr_assert(count == expected_count, "unexpected number of latency samples, expected=%" G_GSSIZE_FORMAT
+            ", count=%" G_GSSIZE_FORMAT, expected_count, count);
+  cr_assert(dd->super.worker.instance.batch_recvd_timestamps->len == 0,
+            "timestamps left behind after the batches were finished, len=%d",
+            dd->super.worker.instance.batch_recvd_timestamps->len);
+}
+
+Test(logthrdestdrv_latency, latency_is_measured_for_acked_messages,
+     .init = setup_latency, .fini = teardown_latency)
+{
+  dd->super.worker.insert = _insert_batched_message_success;
+  dd->super.worker.flush = _flush_batched_message_success;
+  dd->super.batch_lines = 5;
+
+  _generate_messages_and_wait_for_processing(dd, 10, dd->super.written_messages);
+  _assert_latency_tracked(10);
+}
+
+Test(logthrdestdrv_latency, latency_is_not_measured_for_dropped_messages,
+     .init = setup_latency, .fini = teardown_latency)
+{
+  dd->super.worker.insert = _insert_batched_message_drop;
+  dd->super.worker.flush = _flush_batched_message_drop;
+  dd->super.worker.instance.time_reopen = 0;
+
+  start_grabbing_messages();
+  _generate_messages_and_wait_for_processing(dd, 10, dd->super.dropped_messages);
+  _assert_latency_tracked(0);
+}
+
+Test(logthrdestdrv_latency, rewound_messages_are_measured_once_when_delivered_after_retries,
+     .init = setup_latency, .fini = teardown_latency)
+{
+  dd->super.worker.insert = _insert_batched_message_error_success;
+  dd->super.worker.flush = _flush_batched_message_error_success;
+  dd->super.worker.instance.time_reopen = 0;
+  dd->super.retries_on_error_max = 5;
+
+  start_grabbing_messages();
+  _generate_messages_and_wait_for_processing(dd, 10, dd->super.written_messages);
+  _assert_latency_tracked(10);
+}
+
+/* the first batch is partially acked and the rest of it rewound, the ones after it are acked as a whole */
+static LogThreadedResult
+_finish_batch_with_partial_rewind(TestThreadedDestDriver *self)
+{
+  LogThreadedDestWorker *worker = &self->super.worker.instance;
+  gint batch_size = worker->batch_size;
+
+  if (batch_size > 0 && self->failure_counter++ == 0)
+    {
+      log_threaded_dest_worker_ack_messages(worker, batch_size / 2);
+      log_threaded_dest_worker_rewind_messages(worker, batch_size - batch_size / 2);
+      return LTR_EXPLICIT_ACK_MGMT;
+    }
+
+  log_threaded_dest_worker_ack_messages(worker, batch_size);
+  return LTR_EXPLICIT_ACK_MGMT;
+}
+
+static LogThreadedResult
+_insert_explicit_acks_partial_rewind(LogThreadedDestDriver *s, LogMessage *msg)
+{
+  TestThreadedDestDriver *self = (TestThreadedDestDriver *) s;
+
+  self->insert_counter++;
+  if (self->super.worker.instance.batch_size < s->batch_lines)
+    return LTR_QUEUED;
+
+  return _finish_batch_with_partial_rewind(self);
+}
+
+static LogThreadedResult
+_flush_explicit_acks_partial_rewind(LogThreadedDestDriver *s)
+{
+  return _finish_batch_with_partial_rewind((TestThreadedDestDriver *) s);
+}
+
+Test(logthrdestdrv_latency, partially_rewound_batch_is_measured_once_per_message,
+     .init = setup_latency, .fini = teardown_latency)
+{
+  dd->super.worker.insert = _insert_explicit_acks_partial_rewind;
+  dd->super.worker.flush = _flush_explicit_acks_partial_rewind;
+  dd->super.batch_lines = 5;
+
+  _generate_messages_and_wait_for_processing(dd, 10, dd->super.written_messages);
+  cr_assert(dd->insert_counter > 10, "rewound messages expected to be inserted again, insert_counter=%d",
+            dd->insert_counter);
+  _assert_latency_tracked(10);
+}
+
 static void
 setup(void)
 {
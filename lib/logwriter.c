@@ -75,6 +75,7 @@ struct _LogWriter
   StatsAggregator *max_message_size;
   StatsAggregator *average_messages_size;
   StatsAggregator *CPS;
+  StatsAggregator *e2e_latency;
   struct
   {
     StatsCounterItem *count;
@@ -1162,6 +1163,14 @@ _log_writer_insert_msg_length_stats(LogWriter *self, gsize msg_len)
   stats_aggregator_insert_data(self->average_messages_size, msg_len);
 }
 
+/* the time from receiving the message to handing it over to the transport */
+static void
+_log_writer_insert_latency_stats(LogWriter *self, LogMessage *msg)
+{
+  if (self->e2e_latency)
+    stats_aggregator_insert_data(self->e2e_latency, unix_time_get_elapsed_usec(&msg->timestamps[LM_TS_RECVD]));
+}
+
 static gboolean
 log_writer_write_message(LogWriter *self, LogMessage *msg, LogPathOptions *path_options, gboolean *write_error)
 {
@@ -1222,6 +1231,7 @@ log_writer_write_message(LogWriter *self, LogMessage *msg, LogPathOptions *path_
       if (msg->flags & LF_LOCAL)
         step_sequence_number(&self->seq_num);
 
+      _log_writer_insert_latency_stats(self, msg);
       log_msg_unref(msg);
       msg_set_context(NULL);
       log_msg_refcache_stop();
@@ -1422,6 +1432,10 @@ _register_aggregated_stats(LogWriter *self, StatsClusterKey *sc_key_input, gint
                                          self->stats_instance, "eps");
   stats_register_aggregator_cps(self->options->stats_level, &sc_key, sc_key_input, stats_type, &self->CPS);
 
+  stats_cluster_single_key_set_with_name(&sc_key, self->options->stats_source | SCS_DESTINATION, self->stats_id,
+                                         self->stats_instance, "e2e_latency");
+  stats_register_aggregator_histogram(self->options->stats_level, &sc_key, &self->e2e_latency);
+
   stats_aggregator_unlock();
 }
 
@@ -1433,6 +1447,7 @@ _unregister_aggregated_stats(LogWriter *self)
   stats_unregister_aggregator_maximum(&self->max_message_size);
   stats_unregister_aggregator_average(&self->average_messages_size);
   stats_unregister_aggregator_cps(&self->CPS);
+  stats_unregister_aggregator_histogram(&self->e2e_latency);
 
   stats_aggregator_unlock();
 }
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "mainloop-io-reactor.h"
+#include "mainloop-worker.h"
+#include "tls-support.h"
+#include "messages.h"
+
+#include <iv.h>
+#include <iv_event.h>
+
+/************************************************************************************
+ * Asynchronous call queues, one for each reactor and one for the main thread
+ ************************************************************************************/
+
+typedef struct _CallQueue
+{
+  GMutex lock;
+  GQueue calls;
+  struct iv_event posted;
+} CallQueue;
+
+typedef struct _Call
+{
+  MainLoopTaskFunc func;
+  gpointer user_data;
+} Call;
+
+static void
+_call_queue_push(CallQueue *self, MainLoopTaskFunc func, gpointer user_data)
+{
+  Call *call = g_new(Call, 1);
+  gboolean was_empty;
+
+  call->func = func;
+  call->user_data = user_data;
+
+  g_mutex_lock(&self->lock);
+  was_empty = g_queue_is_empty(&self->calls);
+  g_queue_push_tail(&self->calls, call);
+  g_mutex_unlock(&self->lock);
+
+  if (was_empty)
+    iv_event_post(&self->posted);
+}
+
+static void
+_call_queue_run(gpointer s)
+{
+  CallQueue *self = (CallQueue *) s;
+  Call *call;
+
+  g_mutex_lock(&self->lock);
+  while ((call = g_queue_pop_head(&self->calls)))
+    {
+      g_mutex_unlock(&self->lock);
+      call->func(call->user_data);
+      g_free(call);
+      g_mutex_lock(&self->lock);
+    }
+  g_mutex_unlock(&self->lock);
+}
+
+/* must be called in the thread running the queue */
+static void
+_call_queue_init(CallQueue *self)
+{
+  g_mutex_init(&self->lock);
+  g_queue_init(&self->calls);
+  IV_EVENT_INIT(&self->posted);
+  self->posted.cookie = self;
+  self->posted.handler = _call_queue_run;
+  iv_event_register(&self->posted);
+}
+
+static void
+_call_queue_deinit(CallQueue *self)
+{
+  _call_queue_run(self);
+  iv_event_unregister(&self->posted);
+  g_mutex_clear(&self->lock);
+}
+
+/************************************************************************************
+ * Reactor threads
+ ************************************************************************************/
+
+struct _MainLoopIOReactor
+{
+  GThread *thread;
+  CallQueue calls;
+  GMutex startup_lock;
+  GCond startup_cond;
+  gboolean started;
+
+  /* used in the reactor thread only: no I/O jobs are run while parked */
+  gboolean parked;
+
+  /* used in the main thread only */
+  gboolean holding_job;
+  gint num_assigned;
+};
+
+TLS_BLOCK_START
+{
+  MainLoopIOReactor *current_reactor;
+}
+TLS_BLOCK_END;
+
+#define current_reactor  __tls_deref(current_reactor)
+
+static gint main_loop_io_reactors_count;
+static MainLoopIOReactor *main_loop_io_reactors;
+static CallQueue main_thread_calls;
+
+static gpointer
+_reactor_thread(gpointer s)
+{
+  MainLoopIOReactor *self = (MainLoopIOReactor *) s;
+
+  main_loop_worker_thread_start(NULL);
+  iv_init();
+  current_reactor = self;
+  _call_queue_init(&self->calls);
+
+  g_mutex_lock(&self->startup_lock);
+  self->started = TRUE;
+  g_cond_signal(&self->startup_cond);
+  g_mutex_unlock(&self->startup_lock);
+
+  iv_main();
+
+  _call_queue_deinit(&self->calls);
+  current_reactor = NULL;
+  iv_deinit();
+  main_loop_worker_thread_stop();
+  return NULL;
+}
+
+static gpointer
+_quit(gpointer s)
+{
+  iv_quit();
+  return NULL;
+}
+
+/*
+ * A reactor with readers assigned counts as a running worker job, so
+ * reloads and shutdown wait for it the same way as for the I/O worker
+ * pool: when workers are requested to exit, the reactor stops running I/O
+ * jobs and completes its job.  It takes a new one once a reader is
+ * initialized again.
+ */
+static gpointer
+_complete_job(gpointer s)
+{
+  main_loop_worker_job_complete();
+  return NULL;
+}
+
+static gpointer
+_park(gpointer s)
+{
+  MainLoopIOReactor *self = (MainLoopIOReactor *) s;
+
+  self->parked = TRUE;
+  main_loop_io_reactor_call_main(_complete_job, NULL);
+  return NULL;
+}
+
+static gpointer
+_unpark(gpointer s)
+{
+  MainLoopIOReactor *self = (MainLoopIOReactor *) s;
+
+  self->parked = FALSE;
+  return NULL;
+}
+
+/* NOTE: runs in the main thread, when workers are requested to exit */
+static void
+_request_park(gpointer s)
+{
+  MainLoopIOReactor *self = (MainLoopIOReactor *) s;
+
+  self->holding_job = FALSE;
+  main_loop_io_reactor_call(self, _park, self);
+}
+
+/* NOTE: runs in the main thread */
+void
+main_loop_io_reactor_engage(MainLoopIOReactor *self)
+{
+  main_loop_assert_main_thread();
+
+  /* readers initialized while a reload is waiting for the workers to exit
+   * are initialized again by the reload itself */
+  if (self->holding_job || main_loop_worker_is_exit_pending())
+    return;
+
+  self->holding_job = TRUE;
+  main_loop_worker_job_start();
+  main_loop_worker_register_exit_notification_callback(_request_park, self);
+  main_loop_io_reactor_call(self, _unpark, self);
+}
+
+/* NOTE: runs in the main thread, returns the reactor with the least readers assigned */
+MainLoopIOReactor *
+main_loop_io_reactor_assign(void)
+{
+  MainLoopIOReactor *selected = NULL;
+
+  main_loop_assert_main_thread();
+
+  for (gint i = 0; i < main_loop_io_reactors_count; i++)
+    {
+      MainLoopIOReactor *reactor = &main_loop_io_reactors[i];
+
+      if (!selected || reactor->num_assigned < selected->num_assigned)
+        selected = reactor;
+    }
+
+  if (selected)
+    selected->num_assigned++;
+  return selected;
+}
+
+/*
+ * Returns the same reactor for the same index every time, for work that
+ * has to be ordered across reloads, like unregistering and registering the
+ * same fd again.  Returns NULL if no reactors are running.
+ */
+MainLoopIOReactor *
+main_loop_io_reactor_get(gint index)
+{
+  if (main_loop_io_reactors_count == 0)
+    return NULL;
+
+  return &main_loop_io_reactors[index % main_loop_io_reactors_count];
+}
+
+/* NOTE: runs in the main thread */
+void
+main_loop_io_reactor_release(MainLoopIOReactor *self)
+{
+  if (!self)
+    return;
+
+  main_loop_assert_main_thread();
+  self->num_assigned--;
+}
+
+void
+main_loop_io_reactor_call(MainLoopIOReactor *self, MainLoopTaskFunc func, gpointer user_data)
+{
+  _call_queue_push(&self->calls, func, user_data);
+}
+
+void
+main_loop_io_reactor_call_main(MainLoopTaskFunc func, gpointer user_data)
+{
+  _call_queue_push(&main_thread_calls, func, user_data);
+}
+
+/*
+ * Runs an I/O job right in the reactor thread, the counterpart of
+ * main_loop_io_worker_job_submit().  The caller must keep the job alive,
+ * engage/release are not called.  Returns FALSE if the reactor is parked
+ * and the job was not run.
+ */
+gboolean
+main_loop_io_reactor_run_job(MainLoopIOReactor *self, MainLoopIOWorkerJob *job, GIOCondition cond)
+{
+  g_assert(current_reactor == self);
+  g_assert(job->working == FALSE);
+
+  if (self->parked)
+    return FALSE;
+
+  job->working = TRUE;
+  job->cond = cond;
+  job->work(job->user_data, cond);
+  main_loop_worker_invoke_batch_callbacks();
+  main_loop_worker_run_gc();
+  job->working = FALSE;
+  job->completion(job->user_data);
+  return TRUE;
+}
+
+gboolean
+main_loop_io_reactor_is_current(MainLoopIOReactor *self)
+{
+  return current_reactor == self;
+}
+
+gint
+main_loop_io_reactor_get_count(void)
+{
+  return MIN(MAX(main_loop_io_reactors_count, 0), MAIN_LOOP_MAX_WORKER_THREADS);
+}
+
+static void
+_start_reactor(MainLoopIOReactor *self)
+{
+  g_mutex_init(&self->startup_lock);
+  g_cond_init(&self->startup_cond);
+  self->parked = TRUE;
+  self->thread = g_thread_new("io-reactor", _reactor_thread, self);
+
+  g_mutex_lock(&self->startup_lock);
+  while (!self->started)
+    g_cond_wait(&self->startup_cond, &self->startup_lock);
+  g_mutex_unlock(&self->startup_lock);
+}
+
+static void
+_stop_reactor(MainLoopIOReactor *self)
+{
+  main_loop_io_reactor_call(self, _quit, NULL);
+  g_thread_join(self->thread);
+  g_mutex_clear(&self->startup_lock);
+  g_cond_clear(&self->startup_cond);
+}
+
+void
+main_loop_io_reactor_init(void)
+{
+  main_loop_io_reactors_count = main_loop_io_reactor_get_count();
+  if (main_loop_io_reactors_count == 0)
+    return;
+
+  _call_queue_init(&main_thread_calls);
+  main_loop_io_reactors = g_new0(MainLoopIOReactor, main_loop_io_reactors_count);
+  for (gint i = 0; i < main_loop_io_reactors_count; i++)
+    _start_reactor(&main_loop_io_reactors[i]);
+
+  msg_debug("I/O reactors started",
+            evt_tag_int("count", main_loop_io_reactors_count));
+}
+
+/*
+ * Stops the reactor threads and runs the calls they posted to the main
+ * thread before exiting.  The reactors themselves are kept around until
+ * main_loop_io_reactor_deinit(), as readers freed afterwards (e.g. with
+ * the configuration) still release the reactor they were assigned to.
+ */
+void
+main_loop_io_reactor_stop(void)
+{
+  if (main_loop_io_reactors_count == 0)
+    return;
+
+  for (gint i = 0; i < main_loop_io_reactors_count; i++)
+    _stop_reactor(&main_loop_io_reactors[i]);
+
+  _call_queue_deinit(&main_thread_calls);
+}
+
+void
+main_loop_io_reactor_deinit(void)
+{
+  if (main_loop_io_reactors_count == 0)
+    return;
+
+  g_free(main_loop_io_reactors);
+  main_loop_io_reactors = NULL;
+}
+
+static GOptionEntry main_loop_io_reactor_options[] =
+{
+  { "io-reactors",      0,         0, G_OPTION_ARG_INT, &main_loop_io_reactors_count, "Process socket connections in <count> threads running their own event loop", "<count>" },
+  { NULL },
+};
+
+void
+main_loop_io_reactor_add_options(GOptionContext *ctx)
+{
+  g_option_context_add_main_entries(ctx, main_loop_io_reactor_options, NULL);
+}
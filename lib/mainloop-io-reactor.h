@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#ifndef MAINLOOP_IO_REACTOR_H_INCLUDED
+#define MAINLOOP_IO_REACTOR_H_INCLUDED 1
+
+#include "mainloop-io-worker.h"
+
+/*
+ * I/O reactors are worker threads running their own ivykis loop.  A
+ * LogReader assigned to a reactor registers its watches in the reactor
+ * thread and processes its input right there, instead of having each
+ * readiness event detected by the main thread and dispatched to the I/O
+ * worker pool.
+ *
+ * Reactors are only started if requested with --io-reactors.  Calls
+ * between the main thread and the reactors are never waited for, as both
+ * sides may be blocked on the other otherwise (e.g. a destination opening
+ * a file with main_loop_call() in the reactor thread).
+ */
+typedef struct _MainLoopIOReactor MainLoopIOReactor;
+
+MainLoopIOReactor *main_loop_io_reactor_assign(void);
+MainLoopIOReactor *main_loop_io_reactor_get(gint index);
+void main_loop_io_reactor_release(MainLoopIOReactor *self);
+void main_loop_io_reactor_engage(MainLoopIOReactor *self);
+
+void main_loop_io_reactor_call(MainLoopIOReactor *self, MainLoopTaskFunc func, gpointer user_data);
+void main_loop_io_reactor_call_main(MainLoopTaskFunc func, gpointer user_data);
+
+gboolean main_loop_io_reactor_run_job(MainLoopIOReactor *self, MainLoopIOWorkerJob *job, GIOCondition cond);
+gboolean main_loop_io_reactor_is_current(MainLoopIOReactor *self);
+gint main_loop_io_reactor_get_count(void);
+
+void main_loop_io_reactor_add_options(GOptionContext *ctx);
+
+void main_loop_io_reactor_init(void);
+void main_loop_io_reactor_stop(void);
+void main_loop_io_reactor_deinit(void);
+
+#endif
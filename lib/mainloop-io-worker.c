@@ -22,6 +22,7 @@
  *
  */
 #include "mainloop-io-worker.h"
+#include "mainloop-io-reactor.h"
 #include "mainloop-worker.h"
 #include "mainloop-call.h"
 #include "logqueue.h"
@@ -113,7 +114,9 @@ main_loop_io_worker_init(void)
   main_loop_io_workers.thread_stop = (void (*)(void *)) main_loop_worker_thread_stop;
   iv_work_pool_create(&main_loop_io_workers);
 
-  log_queue_set_max_threads(MIN(main_loop_io_workers.max_threads, MAIN_LOOP_MAX_WORKER_THREADS));
+  /* reactor threads post to log queues the same way as the I/O workers */
+  log_queue_set_max_threads(MIN(main_loop_io_workers.max_threads + main_loop_io_reactor_get_count(),
+                                MAIN_LOOP_MAX_WORKER_THREADS));
 }
 
 void
@@ -132,8 +132,9 @@ typedef struct _WorkerExitNotification
 
 static GList *exit_notification_list = NULL;
 
-static void
-_register_exit_notification_callback(WorkerExitNotificationFunc func, gpointer user_data)
+/* the callback is invoked once, when workers are requested to exit */
+void
+main_loop_worker_register_exit_notification_callback(WorkerExitNotificationFunc func, gpointer user_data)
 {
   WorkerExitNotification *cfunc = g_new(WorkerExitNotification, 1);
 
@@ -371,7 +372,7 @@ main_loop_create_worker_thread(WorkerThreadFunc func, WorkerExitNotificationFunc
 
   main_loop_worker_job_start();
   if (terminate_func)
-    _register_exit_notification_callback(terminate_func, data);
+    main_loop_worker_register_exit_notification_callback(terminate_func, data);
   g_thread_new(NULL, _worker_thread_func, p);
 }
 
@@ -384,6 +385,18 @@ _reenable_worker_jobs(void *s)
   is_reloading_scheduled = FALSE;
 }
 
+/*
+ * TRUE if workers were requested to exit and the pending sync call is
+ * still waiting for them.  It is FALSE while the sync call itself runs.
+ */
+gboolean
+main_loop_worker_is_exit_pending(void)
+{
+  main_loop_assert_main_thread();
+
+  return main_loop_workers_quit && main_loop_jobs_running > 0;
+}
+
 void
 main_loop_worker_sync_call(void (*func)(gpointer user_data), gpointer user_data)
 {
@@ -76,6 +76,9 @@ void main_loop_worker_thread_start(void *cookie);
 void main_loop_worker_thread_stop(void);
 void main_loop_worker_run_gc(void);
 
+void main_loop_worker_register_exit_notification_callback(WorkerExitNotificationFunc func, gpointer user_data);
+gboolean main_loop_worker_is_exit_pending(void);
+
 void main_loop_create_worker_thread(WorkerThreadFunc func, WorkerExitNotificationFunc terminate_func, gpointer data,
                                     WorkerOptions *worker_options);
 
@@ -24,6 +24,7 @@
 #include "mainloop.h"
 #include "mainloop-worker.h"
 #include "mainloop-io-worker.h"
+#include "mainloop-io-reactor.h"
 #include "mainloop-call.h"
 #include "mainloop-control.h"
 #include "apphook.h"
@@ -590,6 +591,7 @@ main_loop_init(MainLoop *self, MainLoopOptions *options)
   scratch_buffers_automatic_gc_init();
   main_loop_worker_init();
   main_loop_io_worker_init();
+  main_loop_io_reactor_init();
   main_loop_call_init();
 
   main_loop_init_events(self);
@@ -637,7 +639,11 @@ main_loop_free_config(MainLoop *self)
 void
 main_loop_deinit(MainLoop *self)
 {
+  /* reactors may still hold references to the readers of the configuration,
+   * while the readers point to their reactor until they are freed */
+  main_loop_io_reactor_stop();
   main_loop_free_config(self);
+  main_loop_io_reactor_deinit();
 
   control_deinit(self->control_server);
 
@@ -673,6 +679,7 @@ void
 main_loop_add_options(GOptionContext *ctx)
 {
   main_loop_io_worker_add_options(ctx);
+  main_loop_io_reactor_add_options(ctx);
 }
 
 void
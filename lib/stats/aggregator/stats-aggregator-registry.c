@@ -267,6 +267,41 @@ stats_unregister_aggregator_average(StatsAggregator **s)
   *s = NULL;
 }
 
+void
+stats_register_aggregator_histogram(gint level, StatsClusterKey *sc_key, StatsAggregator **s)
+{
+  g_assert(stats_aggregator_locked);
+
+  /* measuring latencies costs a clock read per value, it is not done at the default stats level */
+  level = MAX(level, STATS_LEVEL1);
+
+  if (!stats_check_level(level))
+    {
+      *s = NULL;
+      return;
+    }
+
+  if (!_is_in_table(sc_key))
+    {
+      *s = stats_aggregator_histogram_new(level, sc_key);
+      _insert_to_table(*s);
+    }
+  else
+    {
+      *s = _get_from_table(sc_key);
+    }
+
+  stats_aggregator_track_counter(*s);
+}
+
+void
+stats_unregister_aggregator_histogram(StatsAggregator **s)
+{
+  g_assert(stats_aggregator_locked);
+  stats_aggregator_untrack_counter(*s);
+  *s = NULL;
+}
+
 void
 stats_register_aggregator_cps(gint level, StatsClusterKey *sc_key, StatsClusterKey *sc_key_input, gint stats_type,
                               StatsAggregator **s)
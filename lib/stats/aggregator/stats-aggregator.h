@@ -63,6 +63,17 @@ StatsAggregator *stats_aggregator_maximum_new(gint level, StatsClusterKey *sc_ke
 
 StatsAggregator *stats_aggregator_average_new(gint level, StatsClusterKey *sc_key);
 
+typedef enum
+{
+  STATS_HISTOGRAM_BUCKET,
+  STATS_HISTOGRAM_COUNT,
+  STATS_HISTOGRAM_SUM,
+} StatsHistogramCounterKind;
+
+StatsAggregator *stats_aggregator_histogram_new(gint level, StatsClusterKey *sc_key);
+gboolean stats_aggregator_histogram_parse_counter_name(const gchar *name, gsize *base_len,
+                                                       StatsHistogramCounterKind *kind, gsize *upper_bound);
+
 StatsAggregator *stats_aggregator_cps_new(gint level, StatsClusterKey *sc_key, StatsClusterKey *sc_key_input,
                                           gint stats_type);
 
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "stats/aggregator/stats-aggregator.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
+
+#include <string.h>
+
+/*
+ * Values are sorted into fixed buckets with upper bounds following a
+ * 1-2-5 series, so the relative error is the same across the whole range,
+ * from 100us to 100s.  The last bucket catches everything above.
+ *
+ * The buckets are not cumulative, each counter holds the number of values
+ * between the bounds of its own bucket and the one below it.  The values
+ * are expected in microseconds.
+ */
+static const gsize bucket_bounds[] =
+{
+  100, 200, 500,
+  1000, 2000, 5000,
+  10000, 20000, 50000,
+  100000, 200000, 500000,
+  1000000, 2000000, 5000000,
+  10000000, 20000000, 50000000,
+  100000000,
+};
+
+#define NUM_BUCKETS (G_N_ELEMENTS(bucket_bounds) + 1)
+
+typedef struct
+{
+  StatsCounterItem *counter;
+  gchar *name;
+} HistogramCounter;
+
+typedef struct
+{
+  StatsAggregator super;
+  HistogramCounter buckets[NUM_BUCKETS];
+  HistogramCounter count;
+  HistogramCounter sum;
+} StatsAggregatorHistogram;
+
+static gint
+_find_bucket(gsize value)
+{
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS(bucket_bounds); i++)
+    {
+      if (value <= bucket_bounds[i])
+        break;
+    }
+  return i;
+}
+
+static void
+_insert_data(StatsAggregator *s, gsize value)
+{
+  StatsAggregatorHistogram *self = (StatsAggregatorHistogram *)s;
+
+  stats_counter_inc(self->buckets[_find_bucket(value)].counter);
+  stats_counter_inc(self->count.counter);
+  stats_counter_add(self->sum.counter, value);
+}
+
+static void
+_reset(StatsAggregator *s)
+{
+  StatsAggregatorHistogram *self = (StatsAggregatorHistogram *)s;
+
+  for (gint i = 0; i < NUM_BUCKETS; i++)
+    stats_counter_set(self->buckets[i].counter, 0);
+  stats_counter_set(self->count.counter, 0);
+  stats_counter_set(self->sum.counter, 0);
+}
+
+static gchar *
+_format_bucket_name(const gchar *name, gint bucket)
+{
+  if (bucket == G_N_ELEMENTS(bucket_bounds))
+    return g_strconcat(name, "_le_inf", NULL);
+
+  gsize bound = bucket_bounds[bucket];
+
+  if (bound < 1000)
+    return g_strdup_printf("%s_le_%" G_GSIZE_FORMAT "us", name, bound);
+  if (bound < 1000000)
+    return g_strdup_printf("%s_le_%" G_GSIZE_FORMAT "ms", name, bound / 1000);
+  return g_strdup_printf("%s_le_%" G_GSIZE_FORMAT "s", name, bound / 1000000);
+}
+
+static void
+_register_counter(StatsAggregatorHistogram *self, HistogramCounter *counter, gchar *name)
+{
+  StatsClusterKey sc_key;
+
+  counter->name = name;
+  stats_cluster_single_key_set_with_name(&sc_key, self->super.key.component, self->super.key.id,
+                                         self->super.key.instance, counter->name);
+  stats_register_counter(self->super.stats_level, &sc_key, SC_TYPE_SINGLE_VALUE, &counter->counter);
+}
+
+static void
+_unregister_counter(StatsAggregatorHistogram *self, HistogramCounter *counter)
+{
+  StatsClusterKey sc_key;
+
+  stats_cluster_single_key_set_with_name(&sc_key, self->super.key.component, self->super.key.id,
+                                         self->super.key.instance, counter->name);
+  stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &counter->counter);
+  counter->counter = NULL;
+  g_free(counter->name);
+  counter->name = NULL;
+}
+
+static void
+_register(StatsAggregator *s)
+{
+  StatsAggregatorHistogram *self = (StatsAggregatorHistogram *)s;
+  const gchar *name = self->super.key.counter_group_init.counter.name;
+
+  stats_lock();
+  for (gint i = 0; i < NUM_BUCKETS; i++)
+    _register_counter(self, &self->buckets[i], _format_bucket_name(name, i));
+  _register_counter(self, &self->count, g_strconcat(name, "_count", NULL));
+  _register_counter(self, &self->sum, g_strconcat(name, "_sum_us", NULL));
+  stats_unlock();
+}
+
+static void
+_unregister(StatsAggregator *s)
+{
+  StatsAggregatorHistogram *self = (StatsAggregatorHistogram *)s;
+
+  if (!self->count.name)
+    return;
+
+  stats_lock();
+  for (gint i = 0; i < NUM_BUCKETS; i++)
+    _unregister_counter(self, &self->buckets[i]);
+  _unregister_counter(self, &self->count);
+  _unregister_counter(self, &self->sum);
+  stats_unlock();
+}
+
+static gboolean
+_parse_bucket_bound(const gchar *bound_str, gsize *upper_bound)
+{
+  gchar *unit;
+  guint64 bound;
+
+  if (strcmp(bound_str, "inf") == 0)
+    {
+      *upper_bound = G_MAXSIZE;
+      return TRUE;
+    }
+
+  if (!g_ascii_isdigit(bound_str[0]))
+    return FALSE;
+
+  bound = g_ascii_strtoull(bound_str, &unit, 10);
+  if (strcmp(unit, "us") == 0)
+    *upper_bound = bound;
+  else if (strcmp(unit, "ms") == 0)
+    *upper_bound = bound * 1000;
+  else if (strcmp(unit, "s") == 0)
+    *upper_bound = bound * 1000000;
+  else
+    return FALSE;
+  return TRUE;
+}
+
+/*
+ * Recognizes the names of the counters registered by histograms, for
+ * exporters that present them as a single metric.  @base_len is the length
+ * of the histogram name, @upper_bound is in microseconds and is only set
+ * for buckets, G_MAXSIZE for the last one.
+ *
+ * NOTE: a counter named like a count or sum may belong to something else,
+ * it is only part of a histogram if there are buckets with the same name.
+ */
+gboolean
+stats_aggregator_histogram_parse_counter_name(const gchar *name, gsize *base_len,
+                                              StatsHistogramCounterKind *kind, gsize *upper_bound)
+{
+  const gchar *suffix;
+
+  if (g_str_has_suffix(name, "_count"))
+    {
+      *kind = STATS_HISTOGRAM_COUNT;
+      *base_len = strlen(name) - strlen("_count");
+      return TRUE;
+    }
+
+  if (g_str_has_suffix(name, "_sum_us"))
+    {
+      *kind = STATS_HISTOGRAM_SUM;
+      *base_len = strlen(name) - strlen("_sum_us");
+      return TRUE;
+    }
+
+  suffix = g_strrstr(name, "_le_");
+  if (!suffix || !_parse_bucket_bound(suffix + strlen("_le_"), upper_bound))
+    return FALSE;
+
+  *kind = STATS_HISTOGRAM_BUCKET;
+  *base_len = suffix - name;
+  return TRUE;
+}
+
+static void
+_set_virtual_function(StatsAggregatorHistogram *self)
+{
+  self->super.insert_data = _insert_data;
+  self->super.reset = _reset;
+  self->super.register_aggr = _register;
+  self->super.unregister_aggr = _unregister;
+}
+
+StatsAggregator *
+stats_aggregator_histogram_new(gint level, StatsClusterKey *sc_key)
+{
+  StatsAggregatorHistogram *self = g_new0(StatsAggregatorHistogram, 1);
+  stats_aggregator_init_instance(&self->super, sc_key, level);
+  _set_virtual_function(self);
+
+  return &self->super;
+}
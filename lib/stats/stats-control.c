@@ -24,6 +24,7 @@
 
 #include "stats/stats-control.h"
 #include "stats/stats-csv.h"
+#include "stats/stats-openmetrics.h"
 #include "stats/stats-counter.h"
 #include "stats/stats-registry.h"
 #include "stats/stats-cluster.h"
@@ -65,10 +66,21 @@ _reset_counters(void)
   stats_aggregator_unlock();
 }
 
+/* STATS [OPENMETRICS] */
+static gchar *
+_generate_stats(GString *command)
+{
+  gchar **args = g_strsplit(command->str, " ", 2);
+  gboolean openmetrics = args[0] && args[1] && g_str_equal(g_strstrip(args[1]), "OPENMETRICS");
+
+  g_strfreev(args);
+  return openmetrics ? stats_generate_openmetrics() : stats_generate_csv();
+}
+
 static GString *
 _send_stats_get_result(ControlConnection *cc, GString *command, gpointer user_data)
 {
-  gchar *stats = stats_generate_csv();
+  gchar *stats = _generate_stats(command);
   GString *response = g_string_new(stats);
   g_free(stats);
 
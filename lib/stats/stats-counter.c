@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "stats/stats-counter.h"
+#include "tls-support.h"
+
+TLS_BLOCK_START
+{
+  /* the shard of the current thread plus one, zero if not assigned yet */
+  gint stats_counter_shard;
+}
+TLS_BLOCK_END;
+
+#define stats_counter_shard  __tls_deref(stats_counter_shard)
+
+static gint stats_counter_next_shard;
+
+gint
+stats_counter_get_shard(void)
+{
+  if (G_UNLIKELY(stats_counter_shard == 0))
+    {
+      guint shard = (guint) g_atomic_int_add(&stats_counter_next_shard, 1);
+      stats_counter_shard = (shard % STATS_COUNTER_SHARDS) + 1;
+    }
+  return stats_counter_shard - 1;
+}
+
+/*
+ * The value of the counter so far stays in counter->value, and updates
+ * racing with the conversion that still see no shards go there as well, as
+ * it is part of the sum.  Must be called with the stats lock held.
+ */
+void
+stats_counter_make_sharded(StatsCounterItem *counter)
+{
+  g_assert(!counter->external);
+
+  if (counter->shards)
+    return;
+
+  g_atomic_pointer_set(&counter->shards, g_new0(atomic_gssize, STATS_COUNTER_SHARDS * STATS_COUNTER_SHARD_STRIDE));
+}
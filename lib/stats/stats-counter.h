@@ -27,6 +27,16 @@
 #include "syslog-ng.h"
 #include "atomic-gssize.h"
 
+/*
+ * Sharded counters spread their updates over per-thread cells, each on its
+ * own cache line, so that threads updating the same counter do not contend
+ * for it.  The cells are summed when the counter is read.  Threads are
+ * assigned to the cells round-robin, so more threads than shards still
+ * share cells.
+ */
+#define STATS_COUNTER_SHARDS 16
+#define STATS_COUNTER_SHARD_STRIDE (64 / sizeof(atomic_gssize))
+
 typedef struct _StatsCounterItem
 {
   union
@@ -34,11 +44,16 @@ typedef struct _StatsCounterItem
     atomic_gssize value;
     atomic_gssize *value_ref;
   };
+  /* NULL unless the counter is sharded */
+  atomic_gssize *shards;
   gchar *name;
   gint type;
   gboolean external;
 } StatsCounterItem;
 
+gint stats_counter_get_shard(void);
+void stats_counter_make_sharded(StatsCounterItem *counter);
+
 
 static gboolean
 stats_counter_read_only(StatsCounterItem *counter)
@@ -46,13 +61,21 @@ stats_counter_read_only(StatsCounterItem *counter)
   return counter->external;
 }
 
+static inline atomic_gssize *
+stats_counter_get_cell(StatsCounterItem *counter)
+{
+  if (counter->shards)
+    return &counter->shards[stats_counter_get_shard() * STATS_COUNTER_SHARD_STRIDE];
+  return &counter->value;
+}
+
 static inline void
 stats_counter_add(StatsCounterItem *counter, gssize add)
 {
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_add(&counter->value, add);
+      atomic_gssize_add(stats_counter_get_cell(counter), add);
     }
 }
 
@@ -62,7 +85,7 @@ stats_counter_sub(StatsCounterItem *counter, gssize sub)
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_sub(&counter->value, sub);
+      atomic_gssize_sub(stats_counter_get_cell(counter), sub);
     }
 }
 
@@ -72,7 +95,7 @@ stats_counter_inc(StatsCounterItem *counter)
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_inc(&counter->value);
+      atomic_gssize_inc(stats_counter_get_cell(counter));
     }
 }
 
@@ -82,7 +105,7 @@ stats_counter_dec(StatsCounterItem *counter)
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_dec(&counter->value);
+      atomic_gssize_dec(stats_counter_get_cell(counter));
     }
 }
 
@@ -93,9 +116,24 @@ stats_counter_set(StatsCounterItem *counter, gsize value)
   if (counter && !stats_counter_read_only(counter))
     {
       atomic_gssize_racy_set(&counter->value, value);
+      if (counter->shards)
+        {
+          for (gint i = 0; i < STATS_COUNTER_SHARDS; i++)
+            atomic_gssize_racy_set(&counter->shards[i * STATS_COUNTER_SHARD_STRIDE], 0);
+        }
     }
 }
 
+static inline gsize
+stats_counter_sum_shards(StatsCounterItem *counter)
+{
+  gssize sum = atomic_gssize_get(&counter->value);
+
+  for (gint i = 0; i < STATS_COUNTER_SHARDS; i++)
+    sum += atomic_gssize_get(&counter->shards[i * STATS_COUNTER_SHARD_STRIDE]);
+  return (gsize) sum;
+}
+
 /* NOTE: this is _not_ atomic and doesn't have to be as sets would race anyway */
 static inline gsize
 stats_counter_get(StatsCounterItem *counter)
@@ -104,7 +142,9 @@ stats_counter_get(StatsCounterItem *counter)
 
   if (counter)
     {
-      if (!counter->external)
+      if (counter->shards)
+        result = stats_counter_sum_shards(counter);
+      else if (!counter->external)
         result = atomic_gssize_get_unsigned(&counter->value);
       else
         result = atomic_gssize_get_unsigned(counter->value_ref);
@@ -124,6 +164,8 @@ static inline void
 stats_counter_free(StatsCounterItem *counter)
 {
   g_free(counter->name);
+  g_free(counter->shards);
+  counter->shards = NULL;
 }
 
 #endif
@@ -22,8 +22,7 @@
  *
  */
 #include "stats/stats-csv.h"
-#include "stats/stats-registry.h"
-#include "stats/stats-cluster.h"
+#include "stats/stats-snapshot.h"
 #include "utf8utils.h"
 
 #include <string.h>
@@ -59,27 +58,15 @@ stats_format_csv_escapevar(const gchar *var)
 }
 
 static void
-stats_format_csv(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointer user_data)
+stats_format_csv(StatsSnapshotCounter *counter, GString *csv)
 {
-  GString *csv = (GString *) user_data;
   gchar *s_id, *s_instance, *tag_name;
-  gchar buf[32];
-  gchar state;
 
-  s_id = stats_format_csv_escapevar(sc->key.id);
-  s_instance = stats_format_csv_escapevar(sc->key.instance);
-
-  if (sc->dynamic)
-    state = 'd';
-  else if (stats_cluster_is_orphaned(sc))
-    state = 'o';
-  else
-    state = 'a';
-
-  tag_name = stats_format_csv_escapevar(stats_cluster_get_type_name(sc, type));
+  s_id = stats_format_csv_escapevar(counter->id);
+  s_instance = stats_format_csv_escapevar(counter->instance);
+  tag_name = stats_format_csv_escapevar(counter->name);
   g_string_append_printf(csv, "%s;%s;%s;%c;%s;%"G_GSIZE_FORMAT"\n",
-                         stats_cluster_get_component_name(sc, buf, sizeof(buf)),
-                         s_id, s_instance, state, tag_name, stats_counter_get(&sc->counter_group.counters[type]));
+                         counter->component, s_id, s_instance, counter->state, tag_name, counter->value);
   g_free(tag_name);
   g_free(s_id);
   g_free(s_instance);
@@ -93,8 +80,9 @@ stats_generate_csv(void)
 
   g_string_append_printf(csv, "%s;%s;%s;%s;%s;%s\n", "SourceName", "SourceId", "SourceInstance", "State", "Type",
                          "Number");
-  stats_lock();
-  stats_foreach_counter(stats_format_csv, csv);
-  stats_unlock();
+  StatsSnapshot *snapshot = stats_snapshot_take();
+  for (guint i = 0; i < snapshot->counters->len; i++)
+    stats_format_csv(&g_array_index(snapshot->counters, StatsSnapshotCounter, i), csv);
+  stats_snapshot_free(snapshot);
   return g_string_free(csv, FALSE);
 }
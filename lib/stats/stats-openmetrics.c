@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "stats/stats-openmetrics.h"
+#include "stats/stats-snapshot.h"
+#include "stats/aggregator/stats-aggregator.h"
+
+#include <string.h>
+
+/*
+ * Formats the counters in the OpenMetrics text format.  Every counter is
+ * a sample of the metric family syslogng_<counter name>, labelled with the
+ * component, id and instance of its cluster.  The counters of histogram
+ * aggregators are merged into a single histogram family, with cumulative
+ * buckets and the bounds converted to seconds.
+ *
+ * The formatting works on a snapshot, the stats lock is only held while it
+ * is taken.
+ */
+
+#define METRIC_PREFIX "syslogng_"
+
+typedef struct _Sample
+{
+  const StatsSnapshotCounter *counter;
+  gchar *family;
+  gboolean histogram;
+  StatsHistogramCounterKind kind;
+  gsize upper_bound;
+} Sample;
+
+static void
+_append_sanitized_name(GString *result, const gchar *name, gsize len)
+{
+  for (gsize i = 0; i < len && name[i]; i++)
+    {
+      gchar c = name[i];
+
+      g_string_append_c(result, (g_ascii_isalnum(c) || c == '_' || c == ':') ? c : '_');
+    }
+}
+
+static gchar *
+_format_family_name(const gchar *name, gsize len, const gchar *suffix)
+{
+  GString *family = g_string_new(METRIC_PREFIX);
+
+  _append_sanitized_name(family, name, len);
+  g_string_append(family, suffix);
+  return g_string_free(family, FALSE);
+}
+
+static gchar *
+_format_histogram_key(const StatsSnapshotCounter *counter, gsize base_len)
+{
+  return g_strdup_printf("%.*s\n%s\n%s\n%s", (gint) base_len, counter->name,
+                         counter->component, counter->id, counter->instance);
+}
+
+/* histograms are recognized by their buckets, counts and sums are only merged if there are buckets */
+static GHashTable *
+_collect_histograms(StatsSnapshot *snapshot)
+{
+  GHashTable *histograms = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+  for (guint i = 0; i < snapshot->counters->len; i++)
+    {
+      const StatsSnapshotCounter *counter = &g_array_index(snapshot->counters, StatsSnapshotCounter, i);
+      StatsHistogramCounterKind kind;
+      gsize base_len, upper_bound;
+
+      if (stats_aggregator_histogram_parse_counter_name(counter->name, &base_len, &kind, &upper_bound)
+          && kind == STATS_HISTOGRAM_BUCKET)
+        g_hash_table_add(histograms, _format_histogram_key(counter, base_len));
+    }
+  return histograms;
+}
+
+static gboolean
+_is_histogram_part(GHashTable *histograms, const StatsSnapshotCounter *counter, gsize base_len,
+                   StatsHistogramCounterKind kind)
+{
+  if (kind == STATS_HISTOGRAM_BUCKET)
+    return TRUE;
+
+  gchar *key = _format_histogram_key(counter, base_len);
+  gboolean found = g_hash_table_contains(histograms, key);
+
+  g_free(key);
+  return found;
+}
+
+static void
+_init_sample(Sample *self, GHashTable *histograms, const StatsSnapshotCounter *counter)
+{
+  gsize base_len;
+
+  self->counter = counter;
+  self->upper_bound = 0;
+  if (stats_aggregator_histogram_parse_counter_name(counter->name, &base_len, &self->kind, &self->upper_bound)
+      && _is_histogram_part(histograms, counter, base_len, self->kind))
+    {
+      self->histogram = TRUE;
+      self->family = _format_family_name(counter->name, base_len, "_seconds");
+    }
+  else
+    {
+      self->histogram = FALSE;
+      self->family = _format_family_name(counter->name, strlen(counter->name), "");
+    }
+}
+
+static gint
+_compare_labels(const Sample *a, const Sample *b)
+{
+  gint result;
+
+  if ((result = strcmp(a->counter->component, b->counter->component)) != 0)
+    return result;
+  if ((result = strcmp(a->counter->id, b->counter->id)) != 0)
+    return result;
+  return strcmp(a->counter->instance, b->counter->instance);
+}
+
+static gint
+_compare_samples(gconstpointer pa, gconstpointer pb)
+{
+  const Sample *a = (const Sample *) pa;
+  const Sample *b = (const Sample *) pb;
+  gint result;
+
+  if ((result = strcmp(a->family, b->family)) != 0)
+    return result;
+  if (a->histogram != b->histogram)
+    return a->histogram - b->histogram;
+  if ((result = _compare_labels(a, b)) != 0)
+    return result;
+  if (!a->histogram)
+    return 0;
+  if (a->kind != b->kind)
+    return a->kind - b->kind;
+  if (a->upper_bound != b->upper_bound)
+    return a->upper_bound < b->upper_bound ? -1 : 1;
+  return 0;
+}
+
+static void
+_append_label(GString *result, const gchar *name, const gchar *value, gboolean *first)
+{
+  if (!value[0])
+    return;
+
+  g_string_append(result, *first ? "{" : ",");
+  g_string_append_printf(result, "%s=\"", name);
+  for (const gchar *c = value; *c; c++)
+    {
+      if (*c == '\\' || *c == '"')
+        g_string_append_c(result, '\\');
+      if (*c == '\n')
+        g_string_append(result, "\\n");
+      else
+        g_string_append_c(result, *c);
+    }
+  g_string_append_c(result, '"');
+  *first = FALSE;
+}
+
+/* @le is only appended for buckets */
+static void
+_append_labels(GString *result, const StatsSnapshotCounter *counter, const gchar *le)
+{
+  gboolean first = TRUE;
+
+  _append_label(result, "component", counter->component, &first);
+  _append_label(result, "id", counter->id, &first);
+  _append_label(result, "instance", counter->instance, &first);
+  if (le)
+    _append_label(result, "le", le, &first);
+  if (!first)
+    g_string_append_c(result, '}');
+}
+
+static void
+_format_seconds(gchar *buf, gsize buf_len, gsize usec)
+{
+  g_ascii_formatd(buf, buf_len, "%g", usec / 1e6);
+}
+
+static void
+_format_plain_sample(GString *result, const Sample *sample)
+{
+  g_string_append(result, sample->family);
+  _append_labels(result, sample->counter, NULL);
+  g_string_append_printf(result, " %" G_GSIZE_FORMAT "\n", sample->counter->value);
+}
+
+/* formats the samples of one histogram, returns the number of samples consumed */
+static guint
+_format_histogram(GString *result, const Sample *samples, guint len)
+{
+  gsize cumulative = 0;
+  gboolean has_inf = FALSE;
+  const Sample *sum = NULL;
+  gchar le[G_ASCII_DTOSTR_BUF_SIZE];
+  guint i;
+
+  for (i = 0; i < len && _compare_labels(&samples[0], &samples[i]) == 0; i++)
+    {
+      const Sample *sample = &samples[i];
+
+      if (sample->kind == STATS_HISTOGRAM_SUM)
+        sum = sample;
+      if (sample->kind != STATS_HISTOGRAM_BUCKET)
+        continue;
+
+      cumulative += sample->counter->value;
+      has_inf = (sample->upper_bound == G_MAXSIZE);
+      if (has_inf)
+        g_strlcpy(le, "+Inf", sizeof(le));
+      else
+        _format_seconds(le, sizeof(le), sample->upper_bound);
+
+      g_string_append_printf(result, "%s_bucket", sample->family);
+      _append_labels(result, sample->counter, le);
+      g_string_append_printf(result, " %" G_GSIZE_FORMAT "\n", cumulative);
+    }
+
+  if (!has_inf)
+    {
+      g_string_append_printf(result, "%s_bucket", samples[0].family);
+      _append_labels(result, samples[0].counter, "+Inf");
+      g_string_append_printf(result, " %" G_GSIZE_FORMAT "\n", cumulative);
+    }
+
+  /* the count is derived from the buckets, so that it is consistent with them */
+  g_string_append_printf(result, "%s_count", samples[0].family);
+  _append_labels(result, samples[0].counter, NULL);
+  g_string_append_printf(result, " %" G_GSIZE_FORMAT "\n", cumulative);
+
+  if (sum)
+    {
+      g_string_append_printf(result, "%s_sum", samples[0].family);
+      _append_labels(result, samples[0].counter, NULL);
+      g_ascii_dtostr(le, sizeof(le), sum->counter->value / 1e6);
+      g_string_append_printf(result, " %s\n", le);
+    }
+  return i;
+}
+
+gchar *
+stats_generate_openmetrics(void)
+{
+  StatsSnapshot *snapshot = stats_snapshot_take();
+  GHashTable *histograms = _collect_histograms(snapshot);
+  GArray *samples = g_array_sized_new(FALSE, FALSE, sizeof(Sample), snapshot->counters->len);
+  GString *result = g_string_sized_new(1024);
+  const gchar *family = NULL;
+
+  for (guint i = 0; i < snapshot->counters->len; i++)
+    {
+      Sample sample;
+
+      _init_sample(&sample, histograms, &g_array_index(snapshot->counters, StatsSnapshotCounter, i));
+      g_array_append_val(samples, sample);
+    }
+  g_array_sort(samples, _compare_samples);
+
+  for (guint i = 0; i < samples->len;)
+    {
+      Sample *sample = &g_array_index(samples, Sample, i);
+      guint len = samples->len - i;
+
+      if (!family || strcmp(family, sample->family) != 0)
+        {
+          family = sample->family;
+          g_string_append_printf(result, "# TYPE %s %s\n", family, sample->histogram ? "histogram" : "unknown");
+        }
+
+      /* a family is either a histogram or not, see _compare_samples() */
+      if (sample->histogram)
+        {
+          guint family_len;
+
+          for (family_len = 1; family_len < len; family_len++)
+            {
+              Sample *next = &g_array_index(samples, Sample, i + family_len);
+              if (!next->histogram || strcmp(next->family, family) != 0)
+                break;
+            }
+          i += _format_histogram(result, sample, family_len);
+        }
+      else
+        {
+          _format_plain_sample(result, sample);
+          i++;
+        }
+    }
+  g_string_append(result, "# EOF\n");
+
+  for (guint i = 0; i < samples->len; i++)
+    g_free(g_array_index(samples, Sample, i).family);
+  g_array_free(samples, TRUE);
+  g_hash_table_destroy(histograms);
+  stats_snapshot_free(snapshot);
+  return g_string_free(result, FALSE);
+}
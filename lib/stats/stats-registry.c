@@ -210,6 +210,24 @@ stats_register_counter(gint stats_level, const StatsClusterKey *sc_key, gint typ
   return _register_counter(stats_level, sc_key, type, FALSE, counter);
 }
 
+/*
+ * Registers a counter updated by many threads concurrently, like the
+ * processed counter of a destination with multiple workers.  It is the
+ * same as stats_register_counter(), except that the counter is sharded if
+ * enabled with stats-sharded-counters(yes).
+ */
+StatsCluster *
+stats_register_sharded_counter(gint stats_level, const StatsClusterKey *sc_key, gint type,
+                               StatsCounterItem **counter)
+{
+  StatsCluster *sc = _register_counter(stats_level, sc_key, type, FALSE, counter);
+
+  if (*counter && !(*counter)->external && stats_check_sharded_counters())
+    stats_counter_make_sharded(*counter);
+
+  return sc;
+}
+
 StatsCluster *
 stats_register_external_counter(gint stats_level, const StatsClusterKey *sc_key, gint type,
                                 atomic_gssize *external_counter)
@@ -220,6 +238,8 @@ stats_register_external_counter(gint stats_level, const StatsClusterKey *sc_key,
 StatsCluster *
 stats_register_alias_counter(gint level, const StatsClusterKey *sc_key, gint type, StatsCounterItem *aliased_counter)
 {
+  /* an alias only refers to the unsharded part of the value */
+  g_assert(!aliased_counter->shards);
   return stats_register_external_counter(level, sc_key, type, &aliased_counter->value);
 }
 
@@ -33,7 +33,10 @@ typedef gboolean (*StatsForeachClusterRemoveFunc)(StatsCluster *sc, gpointer use
 void stats_lock(void);
 void stats_unlock(void);
 gboolean stats_check_level(gint level);
+gboolean stats_check_sharded_counters(void);
 StatsCluster *stats_register_counter(gint level, const StatsClusterKey *sc_key, gint type, StatsCounterItem **counter);
+StatsCluster *stats_register_sharded_counter(gint level, const StatsClusterKey *sc_key, gint type,
+                                             StatsCounterItem **counter);
 
 StatsCluster *stats_register_external_counter(gint level, const StatsClusterKey *sc_key, gint type,
                                               atomic_gssize *external_counter);
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "stats/stats-snapshot.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster.h"
+
+static const gchar *
+_insert_string(StatsSnapshot *self, const gchar *str)
+{
+  return g_string_chunk_insert_const(self->strings, str ? str : "");
+}
+
+static gchar
+_get_state(StatsCluster *sc)
+{
+  if (sc->dynamic)
+    return 'd';
+  if (stats_cluster_is_orphaned(sc))
+    return 'o';
+  return 'a';
+}
+
+static void
+_copy_counter(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointer user_data)
+{
+  StatsSnapshot *self = (StatsSnapshot *) user_data;
+  StatsSnapshotCounter copy;
+  gchar buf[32];
+
+  copy.component = _insert_string(self, stats_cluster_get_component_name(sc, buf, sizeof(buf)));
+  copy.id = _insert_string(self, sc->key.id);
+  copy.instance = _insert_string(self, sc->key.instance);
+  copy.name = _insert_string(self, stats_cluster_get_type_name(sc, type));
+  copy.state = _get_state(sc);
+  copy.value = stats_counter_get(counter);
+  g_array_append_val(self->counters, copy);
+}
+
+StatsSnapshot *
+stats_snapshot_take(void)
+{
+  StatsSnapshot *self = g_new0(StatsSnapshot, 1);
+
+  self->counters = g_array_new(FALSE, FALSE, sizeof(StatsSnapshotCounter));
+  self->strings = g_string_chunk_new(4096);
+
+  stats_lock();
+  stats_foreach_counter(_copy_counter, self);
+  stats_unlock();
+  return self;
+}
+
+void
+stats_snapshot_free(StatsSnapshot *self)
+{
+  g_array_free(self->counters, TRUE);
+  g_string_chunk_free(self->strings);
+  g_free(self);
+}
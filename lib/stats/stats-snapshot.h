@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#ifndef STATS_SNAPSHOT_H_INCLUDED
+#define STATS_SNAPSHOT_H_INCLUDED 1
+
+#include "syslog-ng.h"
+
+/*
+ * A copy of the names and current values of the live counters, taken with
+ * the stats lock held only for the copy.  The strings are owned by the
+ * snapshot, so it can be formatted and sent without the lock, while
+ * counters are registered and unregistered.
+ */
+typedef struct _StatsSnapshotCounter
+{
+  const gchar *component;
+  const gchar *id;
+  const gchar *instance;
+  const gchar *name;
+  /* 'a' for active, 'o' for orphaned, 'd' for dynamic, like in the CSV output */
+  gchar state;
+  gsize value;
+} StatsSnapshotCounter;
+
+typedef struct _StatsSnapshot
+{
+  GArray *counters;
+  GStringChunk *strings;
+} StatsSnapshot;
+
+StatsSnapshot *stats_snapshot_take(void);
+void stats_snapshot_free(StatsSnapshot *self);
+
+#endif
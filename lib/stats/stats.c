@@ -259,6 +259,7 @@ stats_options_defaults(StatsOptions *options)
   options->log_freq = 600;
   options->lifetime = 600;
   options->max_dynamic = -1;
+  options->sharded_counters = FALSE;
 }
 
 gboolean
@@ -270,6 +271,14 @@ stats_check_level(gint level)
     return level == 0;
 }
 
+gboolean
+stats_check_sharded_counters(void)
+{
+  if (!stats_options)
+    return FALSE;
+  return stats_options->sharded_counters;
+}
+
 gboolean
 stats_check_dynamic_clusters_limit(guint number_of_clusters)
 {
@@ -34,6 +34,7 @@ typedef struct _StatsOptions
   gint level;
   gint lifetime;
   gint max_dynamic;
+  gboolean sharded_counters;
 } StatsOptions;
 
 enum
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "apphook.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-logpipe.h"
+
+#include <stdio.h>
+
+#define NUM_THREADS 4
+#define NUM_INCREMENTS 1000000
+
+static StatsOptions stats_options;
+
+static void
+_enable_sharded_counters(gboolean enable)
+{
+  stats_options_defaults(&stats_options);
+  stats_options.sharded_counters = enable;
+  stats_reinit(&stats_options);
+}
+
+static StatsCounterItem *
+_register_counter(const gchar *id)
+{
+  StatsCounterItem *counter = NULL;
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_logpipe_key_set(&sc_key, SCS_DESTINATION | SCS_CENTER, id, NULL);
+  stats_register_sharded_counter(0, &sc_key, SC_TYPE_PROCESSED, &counter);
+  stats_unlock();
+  return counter;
+}
+
+static void
+_unregister_counter(const gchar *id, StatsCounterItem **counter)
+{
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_logpipe_key_set(&sc_key, SCS_DESTINATION | SCS_CENTER, id, NULL);
+  stats_unregister_counter(&sc_key, SC_TYPE_PROCESSED, counter);
+  stats_unlock();
+}
+
+static gpointer
+_increment_counter(gpointer s)
+{
+  StatsCounterItem *counter = (StatsCounterItem *) s;
+
+  for (gint i = 0; i < NUM_INCREMENTS; i++)
+    stats_counter_inc(counter);
+  return NULL;
+}
+
+/* returns the number of increments per second */
+static gdouble
+_increment_counter_in_threads(StatsCounterItem *counter)
+{
+  GThread *threads[NUM_THREADS];
+  GTimeVal start, end;
+
+  g_get_current_time(&start);
+  for (gint i = 0; i < NUM_THREADS; i++)
+    threads[i] = g_thread_new("increment", _increment_counter, counter);
+  for (gint i = 0; i < NUM_THREADS; i++)
+    g_thread_join(threads[i]);
+  g_get_current_time(&end);
+
+  return NUM_THREADS * NUM_INCREMENTS * 1e6 / g_time_val_diff(&end, &start);
+}
+
+Test(stats_sharded_counter, test_counters_are_not_sharded_by_default)
+{
+  _enable_sharded_counters(FALSE);
+
+  StatsCounterItem *counter = _register_counter("d_default");
+  cr_assert_null(counter->shards);
+  _unregister_counter("d_default", &counter);
+}
+
+Test(stats_sharded_counter, test_updates_from_multiple_threads_are_summed)
+{
+  _enable_sharded_counters(TRUE);
+
+  StatsCounterItem *counter = _register_counter("d_sharded");
+  cr_assert_not_null(counter->shards);
+
+  stats_counter_add(counter, 10);
+  _increment_counter_in_threads(counter);
+  stats_counter_sub(counter, 5);
+  cr_assert_eq(stats_counter_get(counter), NUM_THREADS * NUM_INCREMENTS + 5);
+
+  stats_counter_set(counter, 3);
+  cr_assert_eq(stats_counter_get(counter), 3);
+  _unregister_counter("d_sharded", &counter);
+}
+
+Test(stats_sharded_counter, test_counter_keeps_its_value_when_sharded_by_a_later_registration)
+{
+  StatsCounterItem *counter = NULL, *sharded = NULL;
+  StatsClusterKey sc_key;
+
+  _enable_sharded_counters(TRUE);
+
+  stats_lock();
+  stats_cluster_logpipe_key_set(&sc_key, SCS_DESTINATION | SCS_CENTER, "d_shared", NULL);
+  stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED, &counter);
+  stats_unlock();
+  cr_assert_null(counter->shards);
+
+  stats_counter_add(counter, 7);
+  sharded = _register_counter("d_shared");
+  cr_assert_eq(sharded, counter);
+  stats_counter_inc(sharded);
+  cr_assert_eq(stats_counter_get(counter), 8);
+
+  _unregister_counter("d_shared", &sharded);
+  _unregister_counter("d_shared", &counter);
+}
+
+Test(stats_sharded_counter, test_performance_of_contended_increments)
+{
+  _enable_sharded_counters(FALSE);
+  StatsCounterItem *counter = _register_counter("d_shared_word");
+  printf("      shared word: %12.3f increments/sec\n", _increment_counter_in_threads(counter));
+  _unregister_counter("d_shared_word", &counter);
+
+  _enable_sharded_counters(TRUE);
+  counter = _register_counter("d_sharded_cells");
+  printf("      sharded    : %12.3f increments/sec\n", _increment_counter_in_threads(counter));
+  _unregister_counter("d_sharded_cells", &counter);
+}
+
+TestSuite(stats_sharded_counter, .init = app_startup, .fini = app_shutdown);
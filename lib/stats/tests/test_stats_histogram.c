@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "stats/aggregator/stats-histogram.c"
+
+Test(stats_histogram, test_values_are_sorted_into_buckets_by_their_upper_bound)
+{
+  cr_assert_eq(_find_bucket(0), 0);
+  cr_assert_eq(_find_bucket(100), 0);
+  cr_assert_eq(_find_bucket(101), 1);
+  cr_assert_eq(_find_bucket(200), 1);
+  cr_assert_eq(_find_bucket(201), 2);
+  cr_assert_eq(_find_bucket(1000), 3);
+  cr_assert_eq(_find_bucket(1001), 4);
+  cr_assert_eq(_find_bucket(1000000), 12);
+  cr_assert_eq(_find_bucket(100000000), G_N_ELEMENTS(bucket_bounds) - 1);
+}
+
+Test(stats_histogram, test_values_above_the_last_bound_go_to_the_last_bucket)
+{
+  cr_assert_eq(_find_bucket(100000001), NUM_BUCKETS - 1);
+  cr_assert_eq(_find_bucket(G_MAXSIZE), NUM_BUCKETS - 1);
+}
+
+static void
+_assert_bucket_name(gint bucket, const gchar *expected)
+{
+  gchar *name = _format_bucket_name("latency", bucket);
+
+  cr_assert_str_eq(name, expected);
+  g_free(name);
+}
+
+Test(stats_histogram, test_bucket_names_use_the_largest_whole_unit)
+{
+  _assert_bucket_name(0, "latency_le_100us");
+  _assert_bucket_name(2, "latency_le_500us");
+  _assert_bucket_name(3, "latency_le_1ms");
+  _assert_bucket_name(11, "latency_le_500ms");
+  _assert_bucket_name(12, "latency_le_1s");
+  _assert_bucket_name(G_N_ELEMENTS(bucket_bounds) - 1, "latency_le_100s");
+  _assert_bucket_name(NUM_BUCKETS - 1, "latency_le_inf");
+}
+
+static void
+_assert_counter_name_parsed(const gchar *name, StatsHistogramCounterKind expected_kind, gsize expected_base_len)
+{
+  StatsHistogramCounterKind kind;
+  gsize base_len;
+  gsize upper_bound;
+
+  cr_assert(stats_aggregator_histogram_parse_counter_name(name, &base_len, &kind, &upper_bound),
+            "Failed to parse counter name: %s", name);
+  cr_assert_eq(kind, expected_kind, "Unexpected kind for counter name: %s", name);
+  cr_assert_eq(base_len, expected_base_len, "Unexpected base length for counter name: %s", name);
+}
+
+static void
+_assert_bucket_name_parsed(const gchar *name, gsize expected_base_len, gsize expected_upper_bound)
+{
+  StatsHistogramCounterKind kind;
+  gsize base_len;
+  gsize upper_bound;
+
+  cr_assert(stats_aggregator_histogram_parse_counter_name(name, &base_len, &kind, &upper_bound),
+            "Failed to parse counter name: %s", name);
+  cr_assert_eq(kind, STATS_HISTOGRAM_BUCKET, "Unexpected kind for counter name: %s", name);
+  cr_assert_eq(base_len, expected_base_len, "Unexpected base length for counter name: %s", name);
+  cr_assert_eq(upper_bound, expected_upper_bound, "Unexpected upper bound for counter name: %s", name);
+}
+
+static void
+_assert_counter_name_not_parsed(const gchar *name)
+{
+  StatsHistogramCounterKind kind;
+  gsize base_len;
+  gsize upper_bound;
+
+  cr_assert_not(stats_aggregator_histogram_parse_counter_name(name, &base_len, &kind, &upper_bound),
+                "Counter name should not be recognized: %s", name);
+}
+
+Test(stats_histogram, test_parse_counter_name)
+{
+  _assert_counter_name_parsed("latency_count", STATS_HISTOGRAM_COUNT, strlen("latency"));
+  _assert_counter_name_parsed("latency_sum_us", STATS_HISTOGRAM_SUM, strlen("latency"));
+
+  _assert_bucket_name_parsed("latency_le_100us", strlen("latency"), 100);
+  _assert_bucket_name_parsed("latency_le_5ms", strlen("latency"), 5000);
+  _assert_bucket_name_parsed("latency_le_100s", strlen("latency"), 100000000);
+  _assert_bucket_name_parsed("latency_le_inf", strlen("latency"), G_MAXSIZE);
+  _assert_bucket_name_parsed("queue_le_disk_latency_le_1ms", strlen("queue_le_disk_latency"), 1000);
+
+  _assert_counter_name_not_parsed("latency");
+  _assert_counter_name_not_parsed("latency_le_");
+  _assert_counter_name_not_parsed("latency_le_ms");
+  _assert_counter_name_not_parsed("latency_le_5m");
+  _assert_counter_name_not_parsed("latency_le_5msec");
+}
+
+Test(stats_histogram, test_formatted_bucket_names_are_parsed_back)
+{
+  for (gint i = 0; i < NUM_BUCKETS; i++)
+    {
+      gchar *name = _format_bucket_name("latency", i);
+      gsize expected_upper_bound = i < G_N_ELEMENTS(bucket_bounds) ? bucket_bounds[i] : G_MAXSIZE;
+
+      _assert_bucket_name_parsed(name, strlen("latency"), expected_upper_bound);
+      g_free(name);
+    }
+}
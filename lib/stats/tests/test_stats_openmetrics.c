@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "apphook.h"
+#include "stats/stats-openmetrics.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-logpipe.h"
+#include "stats/stats-cluster-single.h"
+#include "stats/aggregator/stats-aggregator-registry.h"
+
+#include <string.h>
+
+static void
+_assert_output_contains(const gchar *output, const gchar *expected)
+{
+  cr_assert(strstr(output, expected) != NULL, "Expected line not found: %s\nOutput:\n%s", expected, output);
+}
+
+Test(stats_openmetrics, test_counters_are_labelled_with_their_cluster_key)
+{
+  StatsCounterItem *processed = NULL, *value = NULL;
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_logpipe_key_set(&sc_key, SCS_SOURCE | SCS_CENTER, "s_net#0", "afsocket_sd.(stream,AF_INET(0.0.0.0:514))");
+  stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED, &processed);
+  stats_cluster_single_key_set_with_name(&sc_key, SCS_DESTINATION | SCS_GLOBAL, "d_file", "\"quoted\"", "msg_size.max");
+  stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &value);
+  stats_unlock();
+
+  stats_counter_set(processed, 42);
+  stats_counter_set(value, 1024);
+
+  gchar *output = stats_generate_openmetrics();
+
+  _assert_output_contains(output, "# TYPE syslogng_processed unknown\n");
+  _assert_output_contains(output,
+                          "syslogng_processed{component=\"src.center\",id=\"s_net#0\","
+                          "instance=\"afsocket_sd.(stream,AF_INET(0.0.0.0:514))\"} 42\n");
+  _assert_output_contains(output,
+                          "syslogng_msg_size_max{component=\"dst.global\",id=\"d_file\",instance=\"\\\"quoted\\\"\"} 1024\n");
+  cr_assert(g_str_has_suffix(output, "# EOF\n"));
+  g_free(output);
+}
+
+Test(stats_openmetrics, test_histograms_are_exported_with_cumulative_buckets_in_seconds)
+{
+  StatsAggregator *histogram = NULL;
+  StatsClusterKey sc_key;
+
+  stats_aggregator_lock();
+  stats_cluster_single_key_set_with_name(&sc_key, SCS_DESTINATION | SCS_GLOBAL, "d_file", NULL, "e2e_latency");
+  stats_register_aggregator_histogram(0, &sc_key, &histogram);
+  stats_aggregator_unlock();
+
+  stats_aggregator_insert_data(histogram, 50);
+  stats_aggregator_insert_data(histogram, 150);
+  stats_aggregator_insert_data(histogram, 150);
+  stats_aggregator_insert_data(histogram, 1000000000);
+
+  gchar *output = stats_generate_openmetrics();
+
+  _assert_output_contains(output, "# TYPE syslogng_e2e_latency_seconds histogram\n");
+  _assert_output_contains(output,
+                          "syslogng_e2e_latency_seconds_bucket{component=\"dst.global\",id=\"d_file\",le=\"0.0001\"} 1\n");
+  _assert_output_contains(output,
+                          "syslogng_e2e_latency_seconds_bucket{component=\"dst.global\",id=\"d_file\",le=\"0.0002\"} 3\n");
+  _assert_output_contains(output,
+                          "syslogng_e2e_latency_seconds_bucket{component=\"dst.global\",id=\"d_file\",le=\"100\"} 3\n");
+  _assert_output_contains(output,
+                          "syslogng_e2e_latency_seconds_bucket{component=\"dst.global\",id=\"d_file\",le=\"+Inf\"} 4\n");
+  _assert_output_contains(output, "syslogng_e2e_latency_seconds_count{component=\"dst.global\",id=\"d_file\"} 4\n");
+  _assert_output_contains(output, "syslogng_e2e_latency_seconds_sum{component=\"dst.global\",id=\"d_file\"} 1000.00035\n");
+  cr_assert(strstr(output, "_le_") == NULL);
+  g_free(output);
+
+  stats_aggregator_lock();
+  stats_unregister_aggregator_histogram(&histogram);
+  stats_aggregator_unlock();
+}
+
+Test(stats_openmetrics, test_count_suffix_without_histogram_buckets_is_a_plain_counter)
+{
+  StatsCounterItem *counter = NULL;
+  StatsClusterKey sc_key;
+
+  stats_lock();
+  stats_cluster_single_key_set_with_name(&sc_key, SCS_DESTINATION | SCS_GLOBAL, "d_file", NULL, "truncated_count");
+  stats_register_counter(0, &sc_key, SC_TYPE_SINGLE_VALUE, &counter);
+  stats_unlock();
+
+  stats_counter_set(counter, 3);
+
+  gchar *output = stats_generate_openmetrics();
+  _assert_output_contains(output, "# TYPE syslogng_truncated_count unknown\n");
+  _assert_output_contains(output, "syslogng_truncated_count{component=\"dst.global\",id=\"d_file\"} 3\n");
+  g_free(output);
+}
+
+TestSuite(stats_openmetrics, .init = app_startup, .fini = app_shutdown);
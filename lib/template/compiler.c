@@ -432,6 +432,49 @@ error:
   return result;
 }
 
+static void
+log_template_compiler_flatten_elem(LogTemplateFlatElem *flat, const LogTemplateElem *e)
+{
+  flat->text = e->text_len ? e->text : NULL;
+  flat->text_len = e->text_len;
+  flat->default_value = e->default_value;
+  flat->default_value_len = e->default_value ? strlen(e->default_value) : 0;
+  flat->msg_ref = e->msg_ref;
+  flat->type = e->type;
+
+  switch (e->type)
+    {
+    case LTE_MACRO:
+      flat->macro = e->macro;
+      break;
+    case LTE_VALUE:
+      flat->value_handle = e->value_handle;
+      break;
+    case LTE_FUNC:
+      flat->func.ops = e->func.ops;
+      flat->func.state = e->func.state;
+      break;
+    default:
+      g_assert_not_reached();
+    }
+}
+
+/* generate the array based representation of compiled_template, which is
+ * used during evaluation, the result must be freed using g_free() */
+LogTemplateFlatElem *
+log_template_compiler_flatten(GList *compiled_template, gint *flat_template_len)
+{
+  gint len = g_list_length(compiled_template);
+  LogTemplateFlatElem *flat_template = g_new0(LogTemplateFlatElem, MAX(len, 1));
+  gint i = 0;
+
+  for (GList *l = compiled_template; l; l = l->next)
+    log_template_compiler_flatten_elem(&flat_template[i++], (LogTemplateElem *) l->data);
+
+  *flat_template_len = len;
+  return flat_template;
+}
+
 void
 log_template_compiler_init(LogTemplateCompiler *self, LogTemplate *template)
 {
@@ -27,6 +27,7 @@
 
 #include "syslog-ng.h"
 #include "templates.h"
+#include "repr.h"
 
 typedef struct
 {
@@ -38,6 +39,7 @@ typedef struct
 } LogTemplateCompiler;
 
 gboolean log_template_compiler_compile(LogTemplateCompiler *self, GList **compiled_template, GError **error);
+LogTemplateFlatElem *log_template_compiler_flatten(GList *compiled_template, gint *flat_template_len);
 void log_template_compiler_init(LogTemplateCompiler *self, LogTemplate *template);
 void log_template_compiler_clear(LogTemplateCompiler *self);
 
@@ -32,17 +32,14 @@ void
 log_template_append_format_with_context(LogTemplate *self, LogMessage **messages, gint num_messages,
                                         LogTemplateEvalOptions *options, GString *result)
 {
-  GList *p;
-  LogTemplateElem *e;
-
   if (!options->opts)
     options->opts = &self->cfg->template_options;
 
-  for (p = self->compiled_template; p; p = g_list_next(p))
+  for (gint i = 0; i < self->flat_template_len; i++)
     {
+      const LogTemplateFlatElem *e = &self->flat_template[i];
       gint msg_ndx;
 
-      e = (LogTemplateElem *) p->data;
       if (e->text)
         {
           g_string_append_len(result, e->text, e->text_len);
@@ -73,7 +70,7 @@ log_template_append_format_with_context(LogTemplate *self, LogMessage **messages
           if (value && value[0])
             result_append(result, value, value_len, self->escape);
           else if (e->default_value)
-            result_append(result, e->default_value, -1, self->escape);
+            result_append(result, e->default_value, e->default_value_len, self->escape);
           break;
         }
         case LTE_MACRO:
@@ -84,7 +81,7 @@ log_template_append_format_with_context(LogTemplate *self, LogMessage **messages
             {
               log_macro_expand(result, e->macro, self->escape, options, messages[msg_ndx]);
               if (len == result->len && e->default_value)
-                g_string_append(result, e->default_value);
+                g_string_append_len(result, e->default_value, e->default_value_len);
             }
           break;
         }
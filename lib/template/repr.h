@@ -55,6 +55,31 @@ typedef struct _LogTemplateElem
   };
 } LogTemplateElem;
 
+/* Flattened representation of the compiled template, generated from the
+ * list of LogTemplateElem instances once compilation is finished.  It is
+ * a contiguous array, so the evaluator does not need to chase list
+ * pointers, and lengths are precomputed.  Strings and function states are
+ * borrowed from the LogTemplateElem list, which owns them. */
+typedef struct _LogTemplateFlatElem
+{
+  const gchar *text;
+  const gchar *default_value;
+  gsize text_len;
+  gsize default_value_len;
+  guint16 msg_ref;
+  guint8 type;
+  union
+  {
+    guint macro;
+    NVHandle value_handle;
+    struct
+    {
+      LogTemplateFunction *ops;
+      gpointer state;
+    } func;
+  };
+} LogTemplateFlatElem;
+
 
 LogTemplateElem *log_template_elem_new_macro(const gchar *text, guint macro, gchar *default_value, gint msg_ref);
 LogTemplateElem *log_template_elem_new_value(const gchar *text, gchar *value_name, gchar *default_value, gint msg_ref);
@@ -94,6 +94,34 @@ log_template_get_trivial_value(LogTemplate *self, LogMessage *msg, gssize *value
     }
 }
 
+/* returns LM_V_NONE if the trivial template is a literal */
+NVHandle
+log_template_get_trivial_value_handle(LogTemplate *self)
+{
+  g_assert(self->trivial);
+
+  if (!self->compiled_template)
+    return LM_V_NONE;
+
+  LogTemplateElem *e = (LogTemplateElem *) self->compiled_template->data;
+
+  switch (e->type)
+    {
+    case LTE_MACRO:
+      if (e->text_len > 0)
+        return LM_V_NONE;
+      else if (e->macro == M_MESSAGE)
+        return LM_V_MESSAGE;
+      else if (e->macro == M_HOST)
+        return LM_V_HOST;
+      g_assert_not_reached();
+    case LTE_VALUE:
+      return e->value_handle;
+    default:
+      g_assert_not_reached();
+    }
+}
+
 static gboolean
 _calculate_triviality(LogTemplate *self)
 {
@@ -146,6 +174,9 @@ log_template_reset_compiled(LogTemplate *self)
 {
   log_template_elem_free_list(self->compiled_template);
   self->compiled_template = NULL;
+  g_free(self->flat_template);
+  self->flat_template = NULL;
+  self->flat_template_len = 0;
   self->trivial = FALSE;
 }
 
@@ -166,6 +197,8 @@ log_template_compile(LogTemplate *self, const gchar *template, GError **error)
   result = log_template_compiler_compile(&compiler, &self->compiled_template, error);
   log_template_compiler_clear(&compiler);
 
+  self->flat_template = log_template_compiler_flatten(self->compiled_template, &self->flat_template_len);
+
   self->trivial = _calculate_triviality(self);
   return result;
 }
@@ -178,6 +211,7 @@ log_template_compile_literal_string(LogTemplate *self, const gchar *literal)
   self->template = g_strdup(literal);
   self->compiled_template = g_list_append(self->compiled_template,
                                           log_template_elem_new_macro(literal, M_NONE, NULL, 0));
+  self->flat_template = log_template_compiler_flatten(self->compiled_template, &self->flat_template_len);
 
   self->trivial = _calculate_triviality(self);
 }
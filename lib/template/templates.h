@@ -58,6 +58,8 @@ struct _LogTemplate
   gchar *name;
   gchar *template;
   GList *compiled_template;
+  struct _LogTemplateFlatElem *flat_template;
+  gint flat_template_len;
   GlobalConfig *cfg;
   guint escape:1, def_inline:1, trivial:1;
   TypeHint type_hint;
@@ -73,6 +75,7 @@ gboolean log_template_is_literal_string(const LogTemplate *self);
 const gchar *log_template_get_literal_value(const LogTemplate *self, gssize *value_len);
 gboolean log_template_is_trivial(LogTemplate *self);
 const gchar *log_template_get_trivial_value(LogTemplate *self, LogMessage *msg, gssize *value_len);
+NVHandle log_template_get_trivial_value_handle(LogTemplate *self);
 void log_template_set_name(LogTemplate *self, const gchar *name);
 
 LogTemplate *log_template_new(GlobalConfig *cfg, const gchar *name);
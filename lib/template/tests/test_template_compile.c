@@ -376,6 +376,48 @@ Test(template_compile, test_unknown_function)
                            type = LTE_MACRO, msg_ref = 0);
 }
 
+Test(template_compile, test_flat_template_mirrors_the_compiled_list)
+{
+  assert_template_compile("foo$MSG ${APP.VALUE:-default} @$(hello) bar");
+
+  cr_assert_eq(template->flat_template_len, g_list_length(template->compiled_template));
+
+  gint i = 0;
+  for (GList *l = template->compiled_template; l; l = l->next, i++)
+    {
+      LogTemplateElem *e = (LogTemplateElem *) l->data;
+      LogTemplateFlatElem *flat = &template->flat_template[i];
+
+      cr_assert_eq(flat->type, e->type);
+      cr_assert_eq(flat->msg_ref, e->msg_ref);
+      cr_assert_eq(flat->text_len, e->text_len);
+      if (e->text_len)
+        cr_assert_eq(flat->text, e->text);
+      else
+        cr_assert_null(flat->text);
+      cr_assert_eq(flat->default_value, e->default_value);
+      if (e->default_value)
+        cr_assert_eq(flat->default_value_len, strlen(e->default_value));
+
+      if (e->type == LTE_MACRO)
+        cr_assert_eq(flat->macro, e->macro);
+      else if (e->type == LTE_VALUE)
+        cr_assert_eq(flat->value_handle, e->value_handle);
+      else if (e->type == LTE_FUNC)
+        cr_assert_eq(flat->func.state, e->func.state);
+    }
+}
+
+Test(template_compile, test_flat_template_of_literal_string)
+{
+  log_template_compile_literal_string(template, "literal");
+
+  cr_assert_eq(template->flat_template_len, 1);
+  cr_assert_eq(template->flat_template[0].type, LTE_MACRO);
+  cr_assert_eq(template->flat_template[0].macro, M_NONE);
+  cr_assert_eq(template->flat_template[0].text_len, strlen("literal"));
+}
+
 static void
 setup(void)
 {
@@ -55,6 +55,8 @@ Test(template_speed, test_template_speed)
   perftest_template("$DATE $FACILITY.$PRIORITY $HOST $MSGHDR$MSG $SEQNO\n");
   perftest_template("${APP.VALUE} ${APP.VALUE2}\n");
   perftest_template("$DATE ${HOST:--} ${PROGRAM:--} ${PID:--} ${MSGID:--} ${SDATA:--} $MSG\n");
+  perftest_template("$ISODATE $HOST $MSGHDR$MSG\n");
+  perftest_template("$ISODATE $HOST ${PROGRAM:--}[${PID:--}]: ${APP.VALUE} ${APP.VALUE2} $MSG\n");
 
   app_shutdown();
 }
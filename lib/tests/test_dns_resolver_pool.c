@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "dns-resolver-pool.h"
+#include "apphook.h"
+
+#include <string.h>
+
+/*
+ * The stub resolver below stands in for a DNS server:
+ *   - 10.0.0.1 resolves to "host1.example.com" immediately,
+ *   - 10.0.0.2 does not resolve,
+ *   - 10.0.0.3 blocks until the test releases it, like a slow server.
+ */
+
+#define FAST_ADDRESS "10.0.0.1"
+#define FAILING_ADDRESS "10.0.0.2"
+#define SLOW_ADDRESS "10.0.0.3"
+
+static DNSResolverPool *pool;
+static gint resolve_calls;
+
+static GMutex slow_lock;
+static GCond slow_cond;
+static gboolean slow_released;
+
+static void
+_release_slow_lookups(void)
+{
+  g_mutex_lock(&slow_lock);
+  slow_released = TRUE;
+  g_cond_broadcast(&slow_cond);
+  g_mutex_unlock(&slow_lock);
+}
+
+static gboolean
+_stub_resolve(GSockAddr *saddr, gchar *buf, gsize buflen)
+{
+  gchar address[64];
+
+  g_atomic_int_inc(&resolve_calls);
+  g_sockaddr_format(saddr, address, sizeof(address), GSA_ADDRESS_ONLY);
+
+  if (strcmp(address, SLOW_ADDRESS) == 0)
+    {
+      g_mutex_lock(&slow_lock);
+      while (!slow_released)
+        g_cond_wait(&slow_cond, &slow_lock);
+      g_mutex_unlock(&slow_lock);
+      g_strlcpy(buf, "slow.example.com", buflen);
+      return TRUE;
+    }
+  if (strcmp(address, FAST_ADDRESS) == 0)
+    {
+      g_strlcpy(buf, "host1.example.com", buflen);
+      return TRUE;
+    }
+  return FALSE;
+}
+
+static gboolean
+_lookup(const gchar *address, gint timeout_msec, gchar *buf, gsize buflen, gboolean *positive)
+{
+  GSockAddr *saddr = g_sockaddr_inet_new(address, 514);
+  gboolean result = dns_resolver_pool_lookup(pool, saddr, timeout_msec, buf, buflen, positive);
+
+  g_sockaddr_unref(saddr);
+  return result;
+}
+
+Test(dns_resolver_pool, test_parked_lookup_returns_the_resolved_name)
+{
+  gchar hostname[256] = "";
+  gboolean positive = FALSE;
+
+  cr_assert(_lookup(FAST_ADDRESS, 10000, hostname, sizeof(hostname), &positive));
+  cr_assert(positive);
+  cr_assert_str_eq(hostname, "host1.example.com");
+}
+
+Test(dns_resolver_pool, test_failed_lookup_is_reported_as_negative)
+{
+  gchar hostname[256] = "";
+  gboolean positive = TRUE;
+
+  cr_assert(_lookup(FAILING_ADDRESS, 10000, hostname, sizeof(hostname), &positive));
+  cr_assert_not(positive);
+  cr_assert_str_eq(hostname, "");
+}
+
+Test(dns_resolver_pool, test_slow_lookup_does_not_block_the_caller)
+{
+  gchar hostname[256] = "";
+  gboolean positive;
+
+  cr_assert_not(_lookup(SLOW_ADDRESS, 0, hostname, sizeof(hostname), &positive));
+
+  _release_slow_lookups();
+  cr_assert(_lookup(SLOW_ADDRESS, 10000, hostname, sizeof(hostname), &positive));
+  cr_assert(positive);
+  cr_assert_str_eq(hostname, "slow.example.com");
+}
+
+Test(dns_resolver_pool, test_parking_is_bounded_by_the_deadline)
+{
+  gchar hostname[256];
+  gboolean positive;
+  gint64 start = g_get_monotonic_time();
+
+  cr_assert_not(_lookup(SLOW_ADDRESS, 100, hostname, sizeof(hostname), &positive));
+  cr_assert_geq(g_get_monotonic_time() - start, 100 * G_TIME_SPAN_MILLISECOND);
+}
+
+Test(dns_resolver_pool, test_concurrent_lookups_of_the_same_address_are_merged)
+{
+  gchar hostname[256];
+  gboolean positive;
+
+  for (gint i = 0; i < 10; i++)
+    cr_assert_not(_lookup(SLOW_ADDRESS, 0, hostname, sizeof(hostname), &positive));
+
+  _release_slow_lookups();
+  cr_assert(_lookup(SLOW_ADDRESS, 10000, hostname, sizeof(hostname), &positive));
+  cr_assert(_lookup(SLOW_ADDRESS, 0, hostname, sizeof(hostname), &positive));
+  cr_assert_eq(g_atomic_int_get(&resolve_calls), 1);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  resolve_calls = 0;
+  slow_released = FALSE;
+  pool = dns_resolver_pool_new(2, _stub_resolve);
+}
+
+static void
+teardown(void)
+{
+  _release_slow_lookups();
+  dns_resolver_pool_free(pool);
+  app_shutdown();
+}
+
+TestSuite(dns_resolver_pool, .init = setup, .fini = teardown);
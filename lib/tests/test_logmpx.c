@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "libtest/perf_lib.h"
+
+#include "logmpx.h"
+#include "filter/filter-pipe.h"
+#include "apphook.h"
+
+#include <string.h>
+
+#define MAX_BRANCHES 500
+
+typedef struct _CountingPipe
+{
+  LogPipe super;
+  gint hits;
+} CountingPipe;
+
+static GlobalConfig *cfg;
+static GPtrArray *pipes;
+static CountingPipe *counters[MAX_BRANCHES];
+
+static void
+_counting_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  CountingPipe *self = (CountingPipe *) s;
+
+  self->hits++;
+  log_pipe_forward_msg(s, msg, path_options);
+}
+
+static LogPipe *
+_track_pipe(LogPipe *p)
+{
+  g_ptr_array_add(pipes, p);
+  return p;
+}
+
+/* mimics the branch cfg-tree creates for a log path: attach pipe -> filter -> rest */
+static void
+_add_branch(LogMultiplexer *mpx, gint index_, const gchar *filter, guint32 flags)
+{
+  LogPipe *head = _track_pipe(log_pipe_new(cfg));
+  LogFilterPipe *filter_pipe = (LogFilterPipe *) _track_pipe(log_filter_pipe_new(perf_compile_filter(cfg, filter), cfg));
+  CountingPipe *counter = g_new0(CountingPipe, 1);
+
+  log_pipe_init_instance(&counter->super, cfg);
+  counter->super.queue = _counting_pipe_queue;
+  _track_pipe(&counter->super);
+  counters[index_] = counter;
+
+  filter_pipe->name = g_strdup_printf("f_%d", index_);
+  head->flags |= flags;
+  log_pipe_append(head, &filter_pipe->super);
+  log_pipe_append(&filter_pipe->super, &counter->super);
+  log_multiplexer_add_next_hop(mpx, head);
+}
+
+static void
+_add_program_branches(LogMultiplexer *mpx, gint first, gint num)
+{
+  for (gint i = first; i < first + num; i++)
+    {
+      gchar *filter = g_strdup_printf("program('p%d' type(string))", i);
+      _add_branch(mpx, i, filter, 0);
+      g_free(filter);
+    }
+}
+
+static LogMultiplexer *
+_new_mpx(void)
+{
+  return (LogMultiplexer *) _track_pipe(&log_multiplexer_new(cfg)->super);
+}
+
+static void
+_init_pipes(void)
+{
+  /* the multiplexers come first, but branches are fully built by now */
+  for (gint i = 0; i < pipes->len; i++)
+    cr_assert(log_pipe_init(g_ptr_array_index(pipes, i)));
+}
+
+static LogMessage *
+_new_msg(const gchar *name, const gchar *value)
+{
+  LogMessage *msg = log_msg_new_empty();
+
+  log_msg_set_value_by_name(msg, name, value, -1);
+  return msg;
+}
+
+static void
+_queue_msg(LogMultiplexer *mpx, LogMessage *msg)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT_NOACK;
+
+  log_pipe_queue(&mpx->super, log_msg_ref(msg), &path_options);
+}
+
+static void
+_queue(LogMultiplexer *mpx, const gchar *name, const gchar *value)
+{
+  LogMessage *msg = _new_msg(name, value);
+
+  _queue_msg(mpx, msg);
+  log_msg_unref(msg);
+}
+
+static void
+_assert_hits(gint first, gint num, gint expected)
+{
+  for (gint i = first; i < first + num; i++)
+    cr_assert_eq(counters[i]->hits, expected, "branch %d: expected %d hits, got %d", i, expected, counters[i]->hits);
+}
+
+Test(logmpx, dispatch_table_visits_only_matching_branches)
+{
+  LogMultiplexer *mpx = _new_mpx();
+
+  _add_program_branches(mpx, 0, 10);
+  _init_pipes();
+
+  cr_assert(mpx->dispatch_table);
+  cr_assert_eq(mpx->dispatch_handle, LM_V_PROGRAM);
+  cr_assert_eq(mpx->dispatch_unindexed->len, 0);
+
+  _queue(mpx, "PROGRAM", "p3");
+  _assert_hits(0, 3, 0);
+  _assert_hits(3, 1, 1);
+  _assert_hits(4, 6, 0);
+
+  _queue(mpx, "PROGRAM", "p");
+  _queue(mpx, "PROGRAM", "p30");
+  _assert_hits(3, 1, 1);
+}
+
+Test(logmpx, unindexed_branches_keep_their_order)
+{
+  LogMultiplexer *mpx = _new_mpx();
+
+  _add_branch(mpx, 0, "message('foo')", 0);
+  _add_program_branches(mpx, 1, 4);
+  _add_branch(mpx, 5, "program('p6' type(string)) or program('p7' type(string))", 0);
+  _add_branch(mpx, 6, "program('p6' type(string))", PIF_BRANCH_FINAL);
+  _add_program_branches(mpx, 7, 4);
+  _add_branch(mpx, 11, "not program('p8' type(string))", 0);
+  _init_pipes();
+
+  cr_assert(mpx->dispatch_table);
+  cr_assert_eq(mpx->dispatch_unindexed->len, 3);
+
+  /* the final flag of branch 6 stops the unindexed branch 11 */
+  _queue(mpx, "PROGRAM", "p6");
+  _assert_hits(0, 5, 0);
+  _assert_hits(5, 2, 1);
+  _assert_hits(7, 5, 0);
+
+  _queue(mpx, "PROGRAM", "p8");
+  _assert_hits(8, 1, 1);
+  _assert_hits(11, 1, 0);
+
+  _queue(mpx, "PROGRAM", "unknown");
+  _assert_hits(11, 1, 1);
+}
+
+Test(logmpx, equality_comparisons_and_conjunctions_are_indexed)
+{
+  LogMultiplexer *mpx = _new_mpx();
+
+  for (gint i = 0; i < 10; i++)
+    {
+      gchar *filter = (i % 2)
+                      ? g_strdup_printf("'$HOST' eq 'h%d'", i)
+                      : g_strdup_printf("'$HOST' ne 'x' and host('h%d' type(string))", i);
+      _add_branch(mpx, i, filter, 0);
+      g_free(filter);
+    }
+  _init_pipes();
+
+  cr_assert(mpx->dispatch_table);
+  cr_assert_eq(mpx->dispatch_handle, LM_V_HOST);
+  cr_assert_eq(mpx->dispatch_unindexed->len, 0);
+
+  _queue(mpx, "HOST", "h1");
+  _queue(mpx, "HOST", "h2");
+  _assert_hits(0, 1, 0);
+  _assert_hits(1, 2, 1);
+  _assert_hits(3, 7, 0);
+}
+
+Test(logmpx, fallback_branches_are_visited_when_nothing_matched)
+{
+  LogMultiplexer *mpx = _new_mpx();
+
+  _add_program_branches(mpx, 0, 10);
+  _add_branch(mpx, 10, "'$PROGRAM' ne ''", PIF_BRANCH_FALLBACK);
+  _init_pipes();
+
+  cr_assert(mpx->dispatch_table);
+
+  _queue(mpx, "PROGRAM", "p1");
+  _assert_hits(10, 1, 0);
+
+  _queue(mpx, "PROGRAM", "unknown");
+  _assert_hits(10, 1, 1);
+}
+
+Test(logmpx, no_dispatch_table_for_few_or_non_indexable_branches)
+{
+  LogMultiplexer *few = _new_mpx();
+  LogMultiplexer *pcre = _new_mpx();
+  LogMultiplexer *drop_unmatched = _new_mpx();
+
+  _add_program_branches(few, 0, 3);
+  for (gint i = 10; i < 20; i++)
+    {
+      gchar *pcre_filter = g_strdup_printf("program('p%d')", i);
+      gchar *string_filter = g_strdup_printf("program('p%d' type(string))", i);
+
+      _add_branch(pcre, i, pcre_filter, 0);
+      _add_branch(drop_unmatched, i + 10, string_filter, PIF_DROP_UNMATCHED);
+      g_free(pcre_filter);
+      g_free(string_filter);
+    }
+  _init_pipes();
+
+  cr_assert_null(few->dispatch_table);
+  cr_assert_null(pcre->dispatch_table);
+  cr_assert_null(drop_unmatched->dispatch_table);
+
+  _queue(few, "PROGRAM", "p1");
+  _assert_hits(0, 1, 0);
+  _assert_hits(1, 1, 1);
+  _assert_hits(2, 1, 0);
+}
+
+static gint
+_queue_perf_msg(LogMessage *msg, gpointer user_data)
+{
+  _queue_msg((LogMultiplexer *) user_data, msg);
+  return 0;
+}
+
+Test(logmpx, dispatch_performance_with_500_log_paths)
+{
+  LogMultiplexer *mpx = _new_mpx();
+  LogMessage *msgs[MAX_BRANCHES];
+
+  _add_program_branches(mpx, 0, MAX_BRANCHES);
+  _init_pipes();
+  cr_assert(mpx->dispatch_table);
+
+  for (gint i = 0; i < MAX_BRANCHES; i++)
+    {
+      gchar *program = g_strdup_printf("p%d", i);
+      msgs[i] = _new_msg("PROGRAM", program);
+      g_free(program);
+    }
+
+  gdouble indexed_rate = perf_measure_rate(_queue_perf_msg, mpx, msgs, MAX_BRANCHES, PERF_MESSAGES, NULL);
+
+  /* hide the table to measure the filter-by-filter path */
+  GHashTable *dispatch_table = mpx->dispatch_table;
+  mpx->dispatch_table = NULL;
+  gdouble linear_rate = perf_measure_rate(_queue_perf_msg, mpx, msgs, MAX_BRANCHES, PERF_MESSAGES, NULL);
+  mpx->dispatch_table = dispatch_table;
+
+  perf_print_rates("logmpx dispatch with 500 log paths", "indexed", indexed_rate, "linear", linear_rate);
+
+  _assert_hits(0, MAX_BRANCHES, 2 * PERF_MESSAGES / MAX_BRANCHES);
+
+  for (gint i = 0; i < MAX_BRANCHES; i++)
+    log_msg_unref(msgs[i]);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  cfg = cfg_new_snippet();
+  pipes = g_ptr_array_new_with_free_func((GDestroyNotify) log_pipe_unref);
+  memset(counters, 0, sizeof(counters));
+}
+
+static void
+teardown(void)
+{
+  for (gint i = 0; i < pipes->len; i++)
+    log_pipe_deinit(g_ptr_array_index(pipes, i));
+  g_ptr_array_free(pipes, TRUE);
+  cfg_free(cfg);
+  app_shutdown();
+}
+
+TestSuite(logmpx, .init = setup, .fini = teardown);
@@ -424,3 +424,77 @@ Test(logqueue, log_queue_fifo_should_drop_only_non_flow_controlled_messages_thre
   _unregister_stats_counters(q);
   log_queue_unref(q);
 }
+
+#define RACING_FEEDERS 8
+#define RACING_MESSAGES_PER_FEEDER 1000
+#define RACING_FIFO_SIZE 100
+
+typedef struct _RacingFeeder
+{
+  LogQueue *queue;
+  gboolean use_input_queue;
+  GThread *thread;
+} RacingFeeder;
+
+static gpointer
+_racing_feed_thread(gpointer args)
+{
+  RacingFeeder *feeder = (RacingFeeder *) args;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  iv_init();
+  if (feeder->use_input_queue)
+    main_loop_worker_thread_start(NULL);
+
+  for (gint i = 0; i < RACING_MESSAGES_PER_FEEDER; i++)
+    {
+      log_queue_push_tail(feeder->queue, log_msg_new_empty(), &path_options);
+
+      if (feeder->use_input_queue && (i % 10) == 9)
+        main_loop_worker_invoke_batch_callbacks();
+    }
+
+  if (feeder->use_input_queue)
+    {
+      main_loop_worker_invoke_batch_callbacks();
+      main_loop_worker_thread_stop();
+    }
+  iv_deinit();
+  return NULL;
+}
+
+static void
+_assert_racing_feeders_do_not_exceed_log_fifo_size(gboolean use_input_queue)
+{
+  RacingFeeder feeders[RACING_FEEDERS];
+
+  log_queue_set_max_threads(RACING_FEEDERS);
+  LogQueue *q = log_queue_fifo_new(RACING_FIFO_SIZE, NULL);
+  _register_stats_counters(q);
+
+  for (gint i = 0; i < RACING_FEEDERS; i++)
+    {
+      feeders[i].queue = q;
+      feeders[i].use_input_queue = use_input_queue;
+      feeders[i].thread = g_thread_new(NULL, _racing_feed_thread, &feeders[i]);
+    }
+  for (gint i = 0; i < RACING_FEEDERS; i++)
+    g_thread_join(feeders[i].thread);
+
+  cr_assert_eq(log_queue_get_length(q), RACING_FIFO_SIZE);
+  cr_assert_eq(stats_counter_get(q->dropped_messages),
+               RACING_FEEDERS * RACING_MESSAGES_PER_FEEDER - RACING_FIFO_SIZE);
+
+  _unregister_stats_counters(q);
+  log_queue_unref(q);
+}
+
+Test(logqueue, log_queue_fifo_input_threads_racing_for_the_last_slots_do_not_exceed_log_fifo_size)
+{
+  _assert_racing_feeders_do_not_exceed_log_fifo_size(TRUE);
+}
+
+Test(logqueue, log_queue_fifo_slow_path_feeders_racing_for_the_last_slots_do_not_exceed_log_fifo_size)
+{
+  _assert_racing_feeders_do_not_exceed_log_fifo_size(FALSE);
+}
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "libtest/queue_utils_lib.h"
+
+#include "logqueue.h"
+#include "logqueue-fifo.h"
+#include "logpipe.h"
+#include "apphook.h"
+#include "mainloop-worker.h"
+#include "cfg.h"
+
+#include <iv.h>
+
+/*
+ * Measures the throughput of LogQueueFifo with multiple input threads
+ * feeding a single output thread, the hand-off between the per-thread
+ * input queues and the output queue being the contended part.
+ *
+ * The same workload is also run against MutexFifo below, which mirrors
+ * the mutex protected wait queue LogQueueFifo used before the lock-free
+ * hand-off, so the two can be compared on the same machine.
+ */
+
+#define MAX_FEEDERS 16
+#define MESSAGES_PER_FEEDER 200000
+#define FEED_BATCH_SIZE 100
+
+/*
+ * Reference implementation: every input thread collects messages in a
+ * private queue and splices it into a shared wait queue under a mutex at
+ * the end of the batch, the output thread takes over the whole wait queue
+ * under the same mutex once its own output queue is drained.
+ */
+typedef struct _MutexFifo
+{
+  GMutex lock;
+  GQueue wait_queue;
+  GQueue output_queue;
+} MutexFifo;
+
+static void
+mutex_fifo_init(MutexFifo *self)
+{
+  g_mutex_init(&self->lock);
+  g_queue_init(&self->wait_queue);
+  g_queue_init(&self->output_queue);
+}
+
+static void
+mutex_fifo_deinit(MutexFifo *self)
+{
+  g_assert(g_queue_is_empty(&self->wait_queue));
+  g_assert(g_queue_is_empty(&self->output_queue));
+  g_mutex_clear(&self->lock);
+}
+
+static void
+mutex_fifo_move_input(MutexFifo *self, GQueue *input_queue)
+{
+  g_mutex_lock(&self->lock);
+  while (!g_queue_is_empty(input_queue))
+    g_queue_push_tail_link(&self->wait_queue, g_queue_pop_head_link(input_queue));
+  g_mutex_unlock(&self->lock);
+}
+
+static LogMessage *
+mutex_fifo_pop_head(MutexFifo *self)
+{
+  if (g_queue_is_empty(&self->output_queue))
+    {
+      g_mutex_lock(&self->lock);
+      self->output_queue = self->wait_queue;
+      g_queue_init(&self->wait_queue);
+      g_mutex_unlock(&self->lock);
+    }
+  return g_queue_pop_head(&self->output_queue);
+}
+
+typedef struct _FeedState
+{
+  LogQueue *queue;
+  MutexFifo *mutex_fifo;
+  gint num_messages;
+} FeedState;
+
+static gpointer
+_feed_thread(gpointer user_data)
+{
+  FeedState *state = (FeedState *) user_data;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *tmpl;
+
+  iv_init();
+  main_loop_worker_thread_start(NULL);
+
+  tmpl = log_msg_new_empty();
+  for (gint i = 0; i < state->num_messages; i++)
+    {
+      LogMessage *msg = log_msg_clone_cow(tmpl, &path_options);
+      log_msg_add_ack(msg, &path_options);
+      msg->ack_func = test_ack;
+
+      log_queue_push_tail(state->queue, msg, &path_options);
+
+      if ((i % FEED_BATCH_SIZE) == FEED_BATCH_SIZE - 1)
+        main_loop_worker_invoke_batch_callbacks();
+    }
+  main_loop_worker_invoke_batch_callbacks();
+
+  log_msg_unref(tmpl);
+  main_loop_worker_thread_stop();
+  iv_deinit();
+  return NULL;
+}
+
+static gpointer
+_feed_mutex_fifo_thread(gpointer user_data)
+{
+  FeedState *state = (FeedState *) user_data;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  GQueue input_queue = G_QUEUE_INIT;
+  LogMessage *tmpl;
+
+  tmpl = log_msg_new_empty();
+  for (gint i = 0; i < state->num_messages; i++)
+    {
+      LogMessage *msg = log_msg_clone_cow(tmpl, &path_options);
+      log_msg_add_ack(msg, &path_options);
+      msg->ack_func = test_ack;
+
+      g_queue_push_tail(&input_queue, msg);
+
+      if ((i % FEED_BATCH_SIZE) == FEED_BATCH_SIZE - 1)
+        mutex_fifo_move_input(state->mutex_fifo, &input_queue);
+    }
+  mutex_fifo_move_input(state->mutex_fifo, &input_queue);
+
+  log_msg_unref(tmpl);
+  return NULL;
+}
+
+static void
+_consume_messages(LogQueue *q, gint num_messages)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gint consumed = 0;
+
+  while (consumed < num_messages)
+    {
+      LogMessage *msg = log_queue_pop_head(q, &path_options);
+
+      if (!msg)
+        {
+          g_thread_yield();
+          continue;
+        }
+
+      log_msg_ack(msg, &path_options, AT_PROCESSED);
+      log_msg_unref(msg);
+      consumed++;
+    }
+}
+
+static void
+_consume_mutex_fifo_messages(MutexFifo *mutex_fifo, gint num_messages)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gint consumed = 0;
+
+  while (consumed < num_messages)
+    {
+      LogMessage *msg = mutex_fifo_pop_head(mutex_fifo);
+
+      if (!msg)
+        {
+          g_thread_yield();
+          continue;
+        }
+
+      log_msg_ack(msg, &path_options, AT_PROCESSED);
+      log_msg_unref(msg);
+      consumed++;
+    }
+}
+
+static void
+_perftest_feeders(gint num_feeders)
+{
+  GThread *feeders[MAX_FEEDERS];
+  FeedState state;
+  GTimeVal start, end;
+  gint num_messages = num_feeders * MESSAGES_PER_FEEDER;
+
+  LogQueue *q = log_queue_fifo_new(num_messages, NULL);
+
+  state.queue = q;
+  state.mutex_fifo = NULL;
+  state.num_messages = MESSAGES_PER_FEEDER;
+
+  acked_messages = 0;
+  g_get_current_time(&start);
+  for (gint i = 0; i < num_feeders; i++)
+    feeders[i] = g_thread_new(NULL, _feed_thread, &state);
+
+  _consume_messages(q, num_messages);
+
+  for (gint i = 0; i < num_feeders; i++)
+    g_thread_join(feeders[i]);
+  g_get_current_time(&end);
+
+  cr_assert_eq(acked_messages, num_messages);
+  cr_assert_eq(log_queue_get_length(q), 0);
+
+  printf("      lock-free fifo, feeders: %2d, speed: %12.3f msg/sec\n", num_feeders,
+         num_messages * 1e6 / g_time_val_diff(&end, &start));
+  log_queue_unref(q);
+}
+
+static void
+_perftest_mutex_fifo_feeders(gint num_feeders)
+{
+  GThread *feeders[MAX_FEEDERS];
+  FeedState state;
+  MutexFifo mutex_fifo;
+  GTimeVal start, end;
+  gint num_messages = num_feeders * MESSAGES_PER_FEEDER;
+
+  mutex_fifo_init(&mutex_fifo);
+
+  state.queue = NULL;
+  state.mutex_fifo = &mutex_fifo;
+  state.num_messages = MESSAGES_PER_FEEDER;
+
+  acked_messages = 0;
+  g_get_current_time(&start);
+  for (gint i = 0; i < num_feeders; i++)
+    feeders[i] = g_thread_new(NULL, _feed_mutex_fifo_thread, &state);
+
+  _consume_mutex_fifo_messages(&mutex_fifo, num_messages);
+
+  for (gint i = 0; i < num_feeders; i++)
+    g_thread_join(feeders[i]);
+  g_get_current_time(&end);
+
+  cr_assert_eq(acked_messages, num_messages);
+
+  printf("         mutex fifo, feeders: %2d, speed: %12.3f msg/sec\n", num_feeders,
+         num_messages * 1e6 / g_time_val_diff(&end, &start));
+  mutex_fifo_deinit(&mutex_fifo);
+}
+
+Test(logqueue_perf, test_fifo_multiple_feeders_performance)
+{
+  gint feeder_counts[] = { 1, 4, MAX_FEEDERS };
+
+  log_queue_set_max_threads(MAX_FEEDERS);
+
+  for (gint i = 0; i < G_N_ELEMENTS(feeder_counts); i++)
+    {
+      _perftest_mutex_fifo_feeders(feeder_counts[i]);
+      _perftest_feeders(feeder_counts[i]);
+    }
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  configuration = cfg_new_snippet();
+  cr_assert(cfg_init(configuration), "cfg_init failed!");
+}
+
+static void
+teardown(void)
+{
+  cfg_free(configuration);
+  app_shutdown();
+}
+
+TestSuite(logqueue_perf, .init = setup, .fini = teardown);
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "mainloop-io-reactor.h"
+#include "mainloop.h"
+#include "apphook.h"
+
+#include <iv.h>
+
+static void
+_start_reactors(gint count)
+{
+  gchar *count_option = g_strdup_printf("--io-reactors=%d", count);
+  gchar *argv[] = { "test_mainloop_io_reactor", count_option, NULL };
+  gchar **args = argv;
+  gint argc = 2;
+  GOptionContext *ctx = g_option_context_new(NULL);
+
+  main_loop_io_reactor_add_options(ctx);
+  cr_assert(g_option_context_parse(ctx, &argc, &args, NULL));
+  g_option_context_free(ctx);
+  g_free(count_option);
+
+  main_loop_io_reactor_init();
+  cr_assert_eq(main_loop_io_reactor_get_count(), count);
+}
+
+static void
+_stop_reactors(void)
+{
+  main_loop_io_reactor_stop();
+  main_loop_io_reactor_deinit();
+}
+
+Test(mainloop_io_reactor, test_assign_selects_the_least_loaded_reactor)
+{
+  _start_reactors(2);
+
+  MainLoopIOReactor *first = main_loop_io_reactor_assign();
+  MainLoopIOReactor *second = main_loop_io_reactor_assign();
+  cr_assert_not_null(first);
+  cr_assert_not_null(second);
+  cr_assert_neq(first, second);
+
+  MainLoopIOReactor *third = main_loop_io_reactor_assign();
+  cr_assert(third == first || third == second);
+
+  /* the one not selected a second time has a single reader assigned */
+  MainLoopIOReactor *least_loaded = (third == first) ? second : first;
+  cr_assert_eq(main_loop_io_reactor_assign(), least_loaded);
+
+  main_loop_io_reactor_release(first);
+  main_loop_io_reactor_release(first);
+  cr_assert_eq(main_loop_io_reactor_assign(), first);
+
+  main_loop_io_reactor_release(first);
+  main_loop_io_reactor_release(second);
+  main_loop_io_reactor_release(second);
+  _stop_reactors();
+}
+
+Test(mainloop_io_reactor, test_assign_returns_null_without_reactors)
+{
+  cr_assert_null(main_loop_io_reactor_assign());
+  cr_assert_null(main_loop_io_reactor_get(0));
+
+  /* releasing the reactor of a reader that was never assigned one */
+  main_loop_io_reactor_release(NULL);
+}
+
+Test(mainloop_io_reactor, test_get_returns_the_same_reactor_for_the_same_index)
+{
+  _start_reactors(3);
+
+  cr_assert_eq(main_loop_io_reactor_get(1), main_loop_io_reactor_get(1));
+  cr_assert_eq(main_loop_io_reactor_get(0), main_loop_io_reactor_get(3));
+  cr_assert_neq(main_loop_io_reactor_get(0), main_loop_io_reactor_get(1));
+
+  _stop_reactors();
+}
+
+typedef struct _CallRecord
+{
+  MainLoopIOReactor *reactor;
+  gboolean quit_main_loop;
+  gboolean ran_in_reactor;
+  gboolean ran_in_main_thread;
+  gint main_calls;
+} CallRecord;
+
+static gpointer
+_record_main_call(gpointer s)
+{
+  CallRecord *record = (CallRecord *) s;
+
+  record->ran_in_main_thread = main_loop_is_main_thread();
+  record->main_calls++;
+  if (record->quit_main_loop)
+    iv_quit();
+  return NULL;
+}
+
+static gpointer
+_record_reactor_call(gpointer s)
+{
+  CallRecord *record = (CallRecord *) s;
+
+  record->ran_in_reactor = main_loop_io_reactor_is_current(record->reactor);
+  main_loop_io_reactor_call_main(_record_main_call, record);
+  return NULL;
+}
+
+Test(mainloop_io_reactor, test_calls_run_in_the_target_thread)
+{
+  CallRecord record = { 0 };
+
+  _start_reactors(2);
+  record.reactor = main_loop_io_reactor_get(1);
+  record.quit_main_loop = TRUE;
+  cr_assert_not(main_loop_io_reactor_is_current(record.reactor));
+
+  main_loop_io_reactor_call(record.reactor, _record_reactor_call, &record);
+  iv_main();
+
+  cr_assert(record.ran_in_reactor);
+  cr_assert(record.ran_in_main_thread);
+  cr_assert_eq(record.main_calls, 1);
+
+  _stop_reactors();
+}
+
+Test(mainloop_io_reactor, test_stop_runs_the_calls_posted_by_the_reactors)
+{
+  CallRecord record = { 0 };
+
+  _start_reactors(1);
+  record.reactor = main_loop_io_reactor_get(0);
+
+  /* the reactor runs the call before its exit request, the main thread
+   * does not run its event loop before stopping the reactors */
+  main_loop_io_reactor_call(record.reactor, _record_reactor_call, &record);
+  main_loop_io_reactor_stop();
+
+  cr_assert(record.ran_in_reactor);
+  cr_assert(record.ran_in_main_thread);
+  cr_assert_eq(record.main_calls, 1);
+
+  main_loop_io_reactor_deinit();
+}
+
+Test(mainloop_io_reactor, test_readers_can_release_their_reactor_after_stop)
+{
+  _start_reactors(2);
+
+  MainLoopIOReactor *reactor = main_loop_io_reactor_assign();
+
+  /* readers are freed with the configuration, after the reactor threads have exited */
+  main_loop_io_reactor_stop();
+  main_loop_io_reactor_release(reactor);
+  main_loop_io_reactor_deinit();
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  main_thread_handle = get_thread_id();
+}
+
+static void
+teardown(void)
+{
+  app_shutdown();
+}
+
+TestSuite(mainloop_io_reactor, .init = setup, .fini = teardown);
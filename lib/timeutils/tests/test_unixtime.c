@@ -474,6 +474,21 @@ Test(unixtime, unix_time_guess_timezone_for_quarter_hour_differences)
             number_of_even_timezones);
 }
 
+Test(unixtime, unix_time_get_elapsed_usec_measures_the_time_since_the_timestamp)
+{
+  UnixTime ut = UNIX_TIME_INIT;
+  gint64 now = g_get_real_time();
+
+  ut.ut_sec = (now - 1500000) / G_USEC_PER_SEC;
+  ut.ut_usec = (now - 1500000) % G_USEC_PER_SEC;
+  cr_assert_geq(unix_time_get_elapsed_usec(&ut), 1500000);
+  cr_assert_lt(unix_time_get_elapsed_usec(&ut), 1500000 + 60 * G_USEC_PER_SEC);
+
+  /* timestamps in the future */
+  ut.ut_sec = now / G_USEC_PER_SEC + 3600;
+  cr_assert_eq(unix_time_get_elapsed_usec(&ut), 0);
+}
+
 static void
 setup(void)
 {
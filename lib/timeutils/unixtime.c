@@ -308,3 +308,13 @@ unix_time_eq(const UnixTime *a, const UnixTime *b)
          a->ut_usec == b->ut_usec &&
          a->ut_gmtoff == b->ut_gmtoff;
 }
+
+/* the time elapsed since the timestamp in microseconds, measured with the
+ * real time and not the cached one, 0 for timestamps in the future */
+gint64
+unix_time_get_elapsed_usec(const UnixTime *self)
+{
+  gint64 elapsed = g_get_real_time() - ((gint64) self->ut_sec * G_USEC_PER_SEC + self->ut_usec);
+
+  return MAX(elapsed, 0);
+}
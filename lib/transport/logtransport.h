@@ -38,6 +38,9 @@ struct _LogTransport
   gssize (*read)(LogTransport *self, gpointer buf, gsize count, LogTransportAuxData *aux);
   gssize (*write)(LogTransport *self, const gpointer buf, gsize count);
   gssize (*writev)(LogTransport *self, struct iovec *iov, gint iov_count);
+  /* optional, TRUE if data was already read from the fd but not yet
+   * returned by read(), so polling the fd is not enough to wake up */
+  gboolean (*has_buffered_input)(LogTransport *self);
   void (*free_fn)(LogTransport *self);
 };
 
@@ -53,6 +56,12 @@ log_transport_writev(LogTransport *self, struct iovec *iov, gint iov_count)
   return self->writev(self, iov, iov_count);
 }
 
+static inline gboolean
+log_transport_has_buffered_input(LogTransport *self)
+{
+  return self->has_buffered_input && self->has_buffered_input(self);
+}
+
 static inline gssize
 log_transport_read(LogTransport *self, gpointer buf, gsize count, LogTransportAuxData *aux)
 {
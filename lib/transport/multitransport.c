@@ -122,6 +122,14 @@ _multitransport_read(LogTransport *s, gpointer buf, gsize count, LogTransportAux
   return r;
 }
 
+static gboolean
+_multitransport_has_buffered_input(LogTransport *s)
+{
+  MultiTransport *self = (MultiTransport *)s;
+
+  return log_transport_has_buffered_input(self->active_transport);
+}
+
 static void
 _multitransport_free(LogTransport *s)
 {
@@ -142,6 +150,7 @@ multitransport_new(TransportFactory *default_transport_factory, gint fd)
   log_transport_init_instance(&self->super, fd);
   self->super.read = _multitransport_read;
   self->super.write = _multitransport_write;
+  self->super.has_buffered_input = _multitransport_has_buffered_input;
   self->super.free_fn = _multitransport_free;
   self->active_transport = transport_factory_construct_transport(default_transport_factory, fd);
   self->active_transport_factory = default_transport_factory;
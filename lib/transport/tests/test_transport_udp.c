@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "transport/transport-udp-socket.h"
+#include "gsockaddr.h"
+#include "gsocket.h"
+#include "fdhelpers.h"
+#include "apphook.h"
+
+#include <sys/socket.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* more than what a single batched receive returns */
+#define NUM_DATAGRAMS 40
+
+static LogTransport *transport;
+static gint sender_fd;
+static guint16 sender_port;
+
+static gint
+_create_bound_socket(void)
+{
+  GSockAddr *addr = g_sockaddr_inet_new("127.0.0.1", 0);
+  gint fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  cr_assert(fd >= 0);
+  cr_assert(g_bind(fd, addr) == G_IO_STATUS_NORMAL);
+  g_sockaddr_unref(addr);
+  return fd;
+}
+
+static void
+_send_datagram(const gchar *payload)
+{
+  cr_assert_eq(send(sender_fd, payload, strlen(payload), 0), strlen(payload));
+}
+
+static gssize
+_read_datagram(gchar *buf, gsize buflen, LogTransportAuxData *aux)
+{
+  log_transport_aux_data_reinit(aux);
+  return log_transport_read(transport, buf, buflen, aux);
+}
+
+Test(transport_udp, test_datagrams_are_returned_one_by_one_with_their_peer_address)
+{
+  LogTransportAuxData aux;
+  gchar payload[32];
+  gchar buf[1024];
+
+  for (gint i = 0; i < NUM_DATAGRAMS; i++)
+    {
+      g_snprintf(payload, sizeof(payload), "message %d", i);
+      _send_datagram(payload);
+    }
+
+  log_transport_aux_data_init(&aux);
+  for (gint i = 0; i < NUM_DATAGRAMS; i++)
+    {
+      gssize rc = _read_datagram(buf, sizeof(buf), &aux);
+
+      g_snprintf(payload, sizeof(payload), "message %d", i);
+      cr_assert_eq(rc, strlen(payload), "Unexpected datagram length, index=%d, rc=%d", i, (gint) rc);
+      cr_assert(memcmp(buf, payload, rc) == 0, "Unexpected datagram content, index=%d", i);
+      cr_assert_not_null(aux.peer_addr);
+      cr_assert_eq(g_sockaddr_get_port(aux.peer_addr), sender_port);
+    }
+
+  cr_assert_eq(_read_datagram(buf, sizeof(buf), &aux), -1);
+  cr_assert_eq(errno, EAGAIN);
+  cr_assert_not(log_transport_has_buffered_input(transport));
+  log_transport_aux_data_destroy(&aux);
+}
+
+Test(transport_udp, test_datagram_longer_than_the_buffer_is_truncated)
+{
+  LogTransportAuxData aux;
+  gchar buf[16];
+
+  _send_datagram("this datagram does not fit in the buffer");
+  _send_datagram("short");
+
+  log_transport_aux_data_init(&aux);
+  cr_assert_eq(_read_datagram(buf, sizeof(buf), &aux), sizeof(buf));
+  cr_assert(memcmp(buf, "this datagram do", sizeof(buf)) == 0);
+  cr_assert_eq(_read_datagram(buf, sizeof(buf), &aux), 5);
+  cr_assert(memcmp(buf, "short", 5) == 0);
+  log_transport_aux_data_destroy(&aux);
+}
+
+#if defined(SYSLOG_NG_HAVE_RECVMMSG)
+
+Test(transport_udp, test_batched_datagrams_are_reported_as_buffered_input)
+{
+  LogTransportAuxData aux;
+  gchar buf[1024];
+
+  _send_datagram("first");
+  _send_datagram("second");
+
+  cr_assert_not(log_transport_has_buffered_input(transport));
+
+  log_transport_aux_data_init(&aux);
+  cr_assert_eq(_read_datagram(buf, sizeof(buf), &aux), 5);
+  cr_assert(log_transport_has_buffered_input(transport));
+  cr_assert_eq(_read_datagram(buf, sizeof(buf), &aux), 6);
+  cr_assert_not(log_transport_has_buffered_input(transport));
+  log_transport_aux_data_destroy(&aux);
+}
+
+#endif
+
+static void
+setup(void)
+{
+  app_startup();
+
+  gint receiver_fd = _create_bound_socket();
+  g_fd_set_nonblock(receiver_fd, TRUE);
+  GSockAddr *receiver_addr = g_socket_get_local_name(receiver_fd);
+
+  sender_fd = _create_bound_socket();
+  GSockAddr *sender_addr = g_socket_get_local_name(sender_fd);
+  sender_port = g_sockaddr_get_port(sender_addr);
+  cr_assert(connect(sender_fd, &receiver_addr->sa, receiver_addr->salen) == 0);
+
+  g_sockaddr_unref(sender_addr);
+  g_sockaddr_unref(receiver_addr);
+
+  transport = log_transport_udp_socket_new(receiver_fd);
+}
+
+static void
+teardown(void)
+{
+  log_transport_free(transport);
+  close(sender_fd);
+  app_shutdown();
+}
+
+TestSuite(transport_udp, .init = setup, .fini = teardown);
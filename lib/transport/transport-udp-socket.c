@@ -30,12 +30,41 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <errno.h>
+#include <string.h>
+
+#define UDP_CTLBUF_SIZE 64
+
+#if defined(SYSLOG_NG_HAVE_RECVMMSG)
+
+/* number of datagrams fetched by a single recvmmsg() call */
+#define UDP_RECV_BATCH_SIZE 16
+
+/* datagrams received by the last recvmmsg() call, returned one-by-one by
+ * subsequent read() calls */
+typedef struct _UDPRecvBatch
+{
+  gchar *buffer;
+  gsize datagram_size;
+  gint count;
+  gint next;
+  struct mmsghdr msgs[UDP_RECV_BATCH_SIZE];
+  struct iovec iovs[UDP_RECV_BATCH_SIZE];
+  struct sockaddr_storage addrs[UDP_RECV_BATCH_SIZE];
+#if defined(SYSLOG_NG_HAVE_CTRLBUF_IN_MSGHDR)
+  gchar ctlbufs[UDP_RECV_BATCH_SIZE][UDP_CTLBUF_SIZE];
+#endif
+} UDPRecvBatch;
+
+#endif
 
 typedef struct _LogTransportUDP LogTransportUDP;
 struct _LogTransportUDP
 {
   LogTransportSocket super;
   GSockAddr *bind_addr;
+#if defined(SYSLOG_NG_HAVE_RECVMMSG)
+  UDPRecvBatch batch;
+#endif
 };
 
 #if defined(SYSLOG_NG_HAVE_CTRLBUF_IN_MSGHDR)
@@ -135,6 +164,112 @@ _feed_aux_from_cmsg(LogTransportUDP *self, LogTransportAuxData *aux, struct msgh
 #define _feed_aux_from_cmsg(self, aux, msg)
 #endif
 
+static void
+_feed_aux_from_msghdr(LogTransportUDP *self, LogTransportAuxData *aux, struct msghdr *msg)
+{
+  if (msg->msg_namelen && aux)
+    log_transport_aux_data_set_peer_addr_ref(aux, g_sockaddr_new((struct sockaddr *) msg->msg_name, msg->msg_namelen));
+  if (aux)
+    aux->proto = self->super.proto;
+  _feed_aux_from_cmsg(self, aux, msg);
+}
+
+#if defined(SYSLOG_NG_HAVE_RECVMMSG)
+
+static void
+_recv_batch_setup(LogTransportUDP *self, gsize datagram_size)
+{
+  UDPRecvBatch *batch = &self->batch;
+
+  if (batch->buffer && batch->datagram_size == datagram_size)
+    return;
+
+  g_free(batch->buffer);
+  batch->buffer = g_malloc(UDP_RECV_BATCH_SIZE * datagram_size);
+  batch->datagram_size = datagram_size;
+
+  for (gint i = 0; i < UDP_RECV_BATCH_SIZE; i++)
+    {
+      batch->iovs[i].iov_base = batch->buffer + i * datagram_size;
+      batch->iovs[i].iov_len = datagram_size;
+      batch->msgs[i].msg_hdr.msg_iov = &batch->iovs[i];
+      batch->msgs[i].msg_hdr.msg_iovlen = 1;
+      batch->msgs[i].msg_hdr.msg_name = &batch->addrs[i];
+    }
+}
+
+static gint
+_recv_batch_fill(LogTransportUDP *self, gsize datagram_size)
+{
+  UDPRecvBatch *batch = &self->batch;
+  gint rc;
+
+  _recv_batch_setup(self, datagram_size);
+
+  /* recvmmsg() updates the length fields in place, reset them */
+  for (gint i = 0; i < UDP_RECV_BATCH_SIZE; i++)
+    {
+      batch->msgs[i].msg_hdr.msg_namelen = sizeof(batch->addrs[i]);
+#if defined(SYSLOG_NG_HAVE_CTRLBUF_IN_MSGHDR)
+      batch->msgs[i].msg_hdr.msg_control = batch->ctlbufs[i];
+      batch->msgs[i].msg_hdr.msg_controllen = sizeof(batch->ctlbufs[i]);
+#endif
+    }
+
+  do
+    {
+      rc = recvmmsg(self->super.super.fd, batch->msgs, UDP_RECV_BATCH_SIZE, 0, NULL);
+    }
+  while (rc == -1 && errno == EINTR);
+
+  batch->next = 0;
+  batch->count = MAX(rc, 0);
+  return rc;
+}
+
+static gssize
+log_transport_udp_socket_read_method(LogTransport *s, gpointer buf, gsize buflen, LogTransportAuxData *aux)
+{
+  LogTransportUDP *self = (LogTransportUDP *) s;
+  UDPRecvBatch *batch = &self->batch;
+
+  while (TRUE)
+    {
+      if (batch->next >= batch->count)
+        {
+          /* datagrams longer than the caller's buffer are truncated, just
+           * as recvmsg() would do */
+          if (_recv_batch_fill(self, buflen) < 0)
+            return -1;
+          if (batch->count == 0)
+            break;
+        }
+
+      struct mmsghdr *mmsg = &batch->msgs[batch->next++];
+
+      /* DGRAM sockets should never return EOF, skip empty datagrams */
+      if (mmsg->msg_len == 0)
+        continue;
+
+      gsize len = MIN(mmsg->msg_len, buflen);
+      memcpy(buf, mmsg->msg_hdr.msg_iov[0].iov_base, len);
+      _feed_aux_from_msghdr(self, aux, &mmsg->msg_hdr);
+      return len;
+    }
+
+  errno = EAGAIN;
+  return -1;
+}
+
+static gboolean
+log_transport_udp_socket_has_buffered_input(LogTransport *s)
+{
+  LogTransportUDP *self = (LogTransportUDP *) s;
+
+  return self->batch.next < self->batch.count;
+}
+
+#else
 
 static gssize
 log_transport_udp_socket_read_method(LogTransport *s, gpointer buf, gsize buflen, LogTransportAuxData *aux)
@@ -145,7 +280,7 @@ log_transport_udp_socket_read_method(LogTransport *s, gpointer buf, gsize buflen
   struct iovec iov[1];
   struct sockaddr_storage ss;
 #if defined(SYSLOG_NG_HAVE_CTRLBUF_IN_MSGHDR)
-  gchar ctlbuf[64];
+  gchar ctlbuf[UDP_CTLBUF_SIZE];
   msg.msg_control = ctlbuf;
   msg.msg_controllen = sizeof(ctlbuf);
 #endif
@@ -171,16 +306,14 @@ log_transport_udp_socket_read_method(LogTransport *s, gpointer buf, gsize buflen
     }
   else if (rc > 0)
     {
-      if (msg.msg_namelen && aux)
-        log_transport_aux_data_set_peer_addr_ref(aux, g_sockaddr_new((struct sockaddr *) &ss, msg.msg_namelen));
-      if (aux)
-        aux->proto = self->super.proto;
-      _feed_aux_from_cmsg(self, aux, &msg);
+      _feed_aux_from_msghdr(self, aux, &msg);
     }
   return rc;
 
 }
 
+#endif
+
 static void
 log_transport_udp_setup_fd(LogTransportUDP *self, gint fd)
 {
@@ -210,6 +343,9 @@ log_transport_udp_socket_free(LogTransport *s)
 {
   LogTransportUDP *self = (LogTransportUDP *)s;
   g_sockaddr_unref(self->bind_addr);
+#if defined(SYSLOG_NG_HAVE_RECVMMSG)
+  g_free(self->batch.buffer);
+#endif
   log_transport_free_method(s);
 }
 
@@ -221,6 +357,9 @@ log_transport_udp_socket_new(gint fd)
   log_transport_dgram_socket_init_instance(&self->super, fd);
   self->super.super.read = log_transport_udp_socket_read_method;
   self->super.super.free_fn = log_transport_udp_socket_free;
+#if defined(SYSLOG_NG_HAVE_RECVMMSG)
+  self->super.super.has_buffered_input = log_transport_udp_socket_has_buffered_input;
+#endif
 
   log_transport_udp_setup_fd(self, fd);
   return &self->super.super;
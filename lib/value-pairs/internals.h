@@ -28,6 +28,13 @@
 #include "syslog-ng.h"
 #include "atomic.h"
 
+typedef struct _VPNVPairCache
+{
+  guint len;
+  /* indexed by NVHandle */
+  guint8 decisions[];
+} VPNVPairCache;
+
 struct _ValuePairs
 {
   GAtomicCounter ref_cnt;
@@ -40,6 +47,10 @@ struct _ValuePairs
 
   /* guint32 as CfgFlagHandler only supports 32 bit integers */
   guint32 scopes;
+
+  VPNVPairCache *nvpair_cache;
+  GPtrArray *retired_nvpair_caches;
+  GMutex nvpair_cache_lock;
 };
 
 
@@ -284,6 +284,46 @@ Test(value_pairs, test_transformer_shift_levels)
   g_ptr_array_free(transformers, TRUE);
 }
 
+static gboolean
+vp_cat_pairs_foreach(const gchar *name, TypeHint type, const gchar *value,
+                     gsize value_len, gpointer user_data)
+{
+  GString *res = (GString *) user_data;
+
+  g_string_append_printf(res, "%s=%.*s;", name, (gint) value_len, value);
+  return FALSE;
+}
+
+Test(value_pairs, test_explicit_pairs_override_nvpairs_and_names_registered_later_are_selected)
+{
+  ValuePairs *vp = value_pairs_new();
+  LogTemplate *template = create_template("string", "overridden");
+  LogTemplateEvalOptions options = {&template_options, LTZ_LOCAL, 11, NULL};
+  LogMessage *msg = log_msg_new_empty();
+  GString *res = g_string_new("");
+
+  value_pairs_add_scope(vp, "nv-pairs");
+  value_pairs_add_glob_pattern(vp, "excluded.*", FALSE);
+  value_pairs_add_pair(vp, "HOST", template);
+  log_template_unref(template);
+
+  log_msg_set_value(msg, LM_V_HOST, "bzorp", -1);
+  log_msg_set_value_by_name(msg, "PROGRAM", "prog", -1);
+  value_pairs_foreach(vp, vp_cat_pairs_foreach, msg, &options, res);
+  cr_assert_str_eq(res->str, "HOST=overridden;PROGRAM=prog;");
+
+  /* handles registered after the first lookup */
+  log_msg_set_value_by_name(msg, "value_pairs_late_name", "late", -1);
+  log_msg_set_value_by_name(msg, "excluded.value_pairs_late_name", "excluded", -1);
+  g_string_truncate(res, 0);
+  value_pairs_foreach(vp, vp_cat_pairs_foreach, msg, &options, res);
+  cr_assert_str_eq(res->str, "HOST=overridden;PROGRAM=prog;value_pairs_late_name=late;");
+
+  g_string_free(res, TRUE);
+  log_msg_unref(msg);
+  value_pairs_unref(vp);
+}
+
 GlobalConfig *cfg;
 
 void
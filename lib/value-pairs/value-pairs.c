@@ -55,16 +55,34 @@ typedef struct
   GString *name;
   GString *value;
   TypeHint type_hint;
+  /* the order of insertion, the last one inserted wins among equal names */
+  guint seq;
 } VPResultValue;
 
+/*
+ * Results are collected into a per-thread array, which is reused across
+ * calls, and are sorted by name once all of them are inserted.  Nested
+ * calls (e.g. a template of a pair using format-json itself) append
+ * their results after those of the outer call and truncate the array
+ * back when done.
+ */
 typedef struct
 {
-  GTree *result_tree;
-
-  /* array of VPResultValue instances */
+  GCompareFunc compare_func;
   GArray *values;
+  /* the first element of the array owned by this call */
+  guint start;
 } VPResults;
 
+enum
+{
+  VP_NVPAIR_UNKNOWN = 0,
+  VP_NVPAIR_EXCLUDED,
+  VP_NVPAIR_INCLUDED,
+};
+
+#define VP_NVPAIR_CACHE_INITIAL_SIZE 256
+
 
 typedef enum
 {
@@ -188,19 +206,31 @@ vp_result_value_init(VPResultValue *rv, GString *name, TypeHint type_hint, GStri
   rv->value = value;
 }
 
+static void
+vp_results_free_values(gpointer values)
+{
+  g_array_free((GArray *) values, TRUE);
+}
+
+static GPrivate vp_results_values = G_PRIVATE_INIT(vp_results_free_values);
+
 static void
 vp_results_init(VPResults *results, GCompareFunc compare_func)
 {
-  results->values = g_array_sized_new(FALSE, FALSE, sizeof(VPResultValue), 16);
-  results->result_tree = g_tree_new_full((GCompareDataFunc) compare_func, NULL,
-                                         NULL, NULL);
+  results->values = g_private_get(&vp_results_values);
+  if (!results->values)
+    {
+      results->values = g_array_sized_new(FALSE, FALSE, sizeof(VPResultValue), 64);
+      g_private_set(&vp_results_values, results->values);
+    }
+  results->compare_func = compare_func;
+  results->start = results->values->len;
 }
 
 static void
 vp_results_deinit(VPResults *results)
 {
-  g_tree_destroy(results->result_tree);
-  g_array_free(results->values, TRUE);
+  g_array_set_size(results->values, results->start);
 }
 
 static void
@@ -212,8 +242,84 @@ vp_results_insert(VPResults *results, GString *name, TypeHint type_hint, GString
   g_array_set_size(results->values, ndx + 1);
   rv = &g_array_index(results->values, VPResultValue, ndx);
   vp_result_value_init(rv, name, type_hint, value);
-  /* GTree takes over ownership of name */
-  g_tree_insert(results->result_tree, name->str, GINT_TO_POINTER(ndx));
+  rv->seq = ndx - results->start;
+}
+
+static gint
+vp_results_compare(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const VPResultValue *rv1 = (const VPResultValue *) a;
+  const VPResultValue *rv2 = (const VPResultValue *) b;
+  GCompareFunc compare_func = (GCompareFunc) user_data;
+  gint result = compare_func(rv1->name->str, rv2->name->str);
+
+  if (result != 0)
+    return result;
+  return rv1->seq < rv2->seq ? -1 : 1;
+}
+
+static void
+vp_results_sort(VPResults *results)
+{
+  guint count = results->values->len - results->start;
+
+  if (count > 1)
+    g_qsort_with_data(&g_array_index(results->values, VPResultValue, results->start), count,
+                      sizeof(VPResultValue), vp_results_compare, results->compare_func);
+}
+
+/* returns the index of the last one of the results with the same name, starting at ndx */
+static guint
+vp_results_skip_overridden(VPResults *results, guint ndx)
+{
+  while (ndx + 1 < results->values->len &&
+         results->compare_func(g_array_index(results->values, VPResultValue, ndx).name->str,
+                               g_array_index(results->values, VPResultValue, ndx + 1).name->str) == 0)
+    ndx++;
+  return ndx;
+}
+
+/*
+ * The include/exclude decision of an nv-pair only depends on its name and
+ * the configuration, so it is cached for each NVHandle.  The cache is
+ * shared by all threads using the same ValuePairs instance: decisions are
+ * stored without locking, as racing threads store the same value.  As the
+ * registry grows, the cache is replaced by a larger copy under a lock and
+ * the old ones are kept until the instance is freed, as other threads may
+ * still be using them, similarly to NVHandleDescArray.
+ */
+static VPNVPairCache *
+vp_nvpair_cache_grow(ValuePairs *vp, NVHandle handle)
+{
+  VPNVPairCache *cache;
+
+  g_mutex_lock(&vp->nvpair_cache_lock);
+  cache = vp->nvpair_cache;
+  if (!cache || handle >= cache->len)
+    {
+      guint len = MAX(cache ? cache->len * 2 : VP_NVPAIR_CACHE_INITIAL_SIZE, handle + 1);
+      VPNVPairCache *new_cache = g_malloc0(sizeof(VPNVPairCache) + len);
+
+      new_cache->len = len;
+      if (cache)
+        {
+          memcpy(new_cache->decisions, cache->decisions, cache->len);
+          g_ptr_array_add(vp->retired_nvpair_caches, cache);
+        }
+      g_atomic_pointer_set(&vp->nvpair_cache, new_cache);
+      cache = new_cache;
+    }
+  g_mutex_unlock(&vp->nvpair_cache_lock);
+  return cache;
+}
+
+/* NOTE: only called while the configuration of the instance is changed, no threads use the cache */
+static void
+vp_nvpair_cache_reset(ValuePairs *vp)
+{
+  g_ptr_array_set_size(vp->retired_nvpair_caches, 0);
+  g_free(vp->nvpair_cache);
+  vp->nvpair_cache = NULL;
 }
 
 static GString *
@@ -255,20 +361,11 @@ vp_pairs_foreach(gpointer data, gpointer user_data)
   vp_results_insert(results, vp_transform_apply(vp, vpc->name), vpc->template->type_hint, sb);
 }
 
-/* runs over the LogMessage nv-pairs, and inserts them unless excluded */
 static gboolean
-vp_msg_nvpairs_foreach(NVHandle handle, const gchar *name,
-                       const gchar *value, gssize value_len,
-                       NVType type, gpointer user_data)
+vp_is_nvpair_selected(ValuePairs *vp, NVHandle handle, const gchar *name)
 {
-  ValuePairs *vp = ((gpointer *)user_data)[0];
-  VPResults *results = ((gpointer *)user_data)[5];
   guint j;
   gboolean inc;
-  GString *sb;
-
-  if (vp->omit_empty_values && value_len == 0)
-    return FALSE;
 
   inc = (name[0] == '.' && (vp->scopes & VPS_DOT_NV_PAIRS)) ||
         (name[0] != '.' && (vp->scopes & VPS_NV_PAIRS)) ||
@@ -280,8 +377,44 @@ vp_msg_nvpairs_foreach(NVHandle handle, const gchar *name,
       if (vp_pattern_spec_eval(vps, name))
         inc = vps->include;
     }
+  return inc;
+}
+
+static gboolean
+vp_is_nvpair_included(ValuePairs *vp, NVHandle handle, const gchar *name)
+{
+  VPNVPairCache *cache = g_atomic_pointer_get(&vp->nvpair_cache);
+  gboolean inc;
+
+  if (G_LIKELY(cache && handle < cache->len))
+    {
+      if (cache->decisions[handle] != VP_NVPAIR_UNKNOWN)
+        return cache->decisions[handle] == VP_NVPAIR_INCLUDED;
+    }
+  else
+    {
+      cache = vp_nvpair_cache_grow(vp, handle);
+    }
 
-  if (!inc)
+  inc = vp_is_nvpair_selected(vp, handle, name);
+  cache->decisions[handle] = inc ? VP_NVPAIR_INCLUDED : VP_NVPAIR_EXCLUDED;
+  return inc;
+}
+
+/* runs over the LogMessage nv-pairs, and inserts them unless excluded */
+static gboolean
+vp_msg_nvpairs_foreach(NVHandle handle, const gchar *name,
+                       const gchar *value, gssize value_len,
+                       NVType type, gpointer user_data)
+{
+  ValuePairs *vp = ((gpointer *)user_data)[0];
+  VPResults *results = ((gpointer *)user_data)[5];
+  GString *sb;
+
+  if (vp->omit_empty_values && value_len == 0)
+    return FALSE;
+
+  if (!vp_is_nvpair_included(vp, handle, name))
     return FALSE;
 
   sb = scratch_buffers_alloc();
@@ -341,6 +474,7 @@ vp_merge_set(ValuePairs *vp, ValuePairSpec *set)
 static void
 vp_update_builtin_list_of_values(ValuePairs *vp)
 {
+  vp_nvpair_cache_reset(vp);
   g_ptr_array_set_size(vp->builtins, 0);
 
   if (vp->patterns->len > 0)
@@ -399,19 +533,18 @@ vp_merge_builtins(ValuePairs *vp, VPResults *results, LogMessage *msg, LogTempla
 }
 
 static gboolean
-vp_foreach_helper(const gchar *name, gpointer ndx_as_pointer, gpointer data)
+vp_results_foreach(VPResults *results, VPForeachFunc func, gpointer user_data)
 {
-  VPResults *results = ((gpointer *)data)[0];
-  gint ndx = GPOINTER_TO_INT(ndx_as_pointer);
-  VPResultValue *rv = &g_array_index(results->values, VPResultValue, ndx);
-  VPForeachFunc func = ((gpointer *)data)[1];
-  gpointer user_data = ((gpointer *)data)[2];
-  gboolean *r = ((gpointer *)data)[3];
+  /* the callback may call us recursively, which may reallocate the array */
+  for (guint ndx = results->start; ndx < results->values->len; ndx++)
+    {
+      ndx = vp_results_skip_overridden(results, ndx);
 
-  *r &= !func(name, rv->type_hint,
-              rv->value->str,
-              rv->value->len, user_data);
-  return !*r;
+      VPResultValue *rv = &g_array_index(results->values, VPResultValue, ndx);
+      if (func(rv->name->str, rv->type_hint, rv->value->str, rv->value->len, user_data))
+        return FALSE;
+    }
+  return TRUE;
 }
 
 
@@ -422,9 +555,8 @@ value_pairs_foreach_sorted (ValuePairs *vp, VPForeachFunc func,
                             gpointer user_data)
 {
   gpointer args[] = { vp, func, msg, options, user_data, NULL};
-  gboolean result = TRUE;
+  gboolean result;
   VPResults results;
-  gpointer helper_args[] = { &results, func, user_data, &result };
   ScratchBuffersMarker mark;
 
   scratch_buffers_mark(&mark);
@@ -445,7 +577,8 @@ value_pairs_foreach_sorted (ValuePairs *vp, VPForeachFunc func,
   g_ptr_array_foreach(vp->vpairs, (GFunc)vp_pairs_foreach, args);
 
   /* Aaand we run it through the callback! */
-  g_tree_foreach(results.result_tree, (GTraverseFunc)vp_foreach_helper, helper_args);
+  vp_results_sort(&results);
+  result = vp_results_foreach(&results, func, user_data);
   vp_results_deinit(&results);
   scratch_buffers_reclaim_marked(mark);
 
@@ -866,6 +999,8 @@ value_pairs_new(void)
   vp->vpairs = g_ptr_array_new();
   vp->patterns = g_ptr_array_new();
   vp->transforms = g_ptr_array_new();
+  vp->retired_nvpair_caches = g_ptr_array_new_with_free_func(g_free);
+  g_mutex_init(&vp->nvpair_cache_lock);
 
   return vp;
 }
@@ -905,6 +1040,9 @@ value_pairs_free (ValuePairs *vp)
     }
   g_ptr_array_free(vp->transforms, TRUE);
   g_ptr_array_free(vp->builtins, TRUE);
+  vp_nvpair_cache_reset(vp);
+  g_ptr_array_free(vp->retired_nvpair_caches, TRUE);
+  g_mutex_clear(&vp->nvpair_cache_lock);
   g_free(vp);
 }
 
@@ -278,9 +278,17 @@ assert_template_failure(const gchar *template, const gchar *expected_error)
 
 void
 perftest_template(gchar *template)
+{
+  LogMessage *msg = create_sample_message();
+
+  perftest_template_msg(template, msg);
+  log_msg_unref(msg);
+}
+
+void
+perftest_template_msg(gchar *template, LogMessage *msg)
 {
   LogTemplate *templ;
-  LogMessage *msg;
   GString *res = g_string_sized_new(1024);
   gint i;
   GError *error = NULL;
@@ -293,7 +301,6 @@ perftest_template(gchar *template)
                 template, error ? error->message : "(none)");
       return;
     }
-  msg = create_sample_message();
 
   start_stopwatch();
   for (i = 0; i < BENCHMARK_COUNT; i++)
@@ -307,5 +314,4 @@ perftest_template(gchar *template)
 
   log_template_unref(templ);
   g_string_free(res, TRUE);
-  log_msg_unref(msg);
 }
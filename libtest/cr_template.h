@@ -45,6 +45,7 @@ void assert_template_format_with_escaping_and_context_msgs(const gchar *template
                                                            LogMessage **msgs, gint num_messages);
 void assert_template_failure(const gchar *template, const gchar *expected_failure);
 void perftest_template(gchar *template);
+void perftest_template_msg(gchar *template, LogMessage *msg);
 
 LogMessage *create_empty_message(void);
 LogMessage *create_sample_message(void);
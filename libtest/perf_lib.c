@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "perf_lib.h"
+#include "cfg-lexer.h"
+#include "filter/filter-expr-parser.h"
+
+#include <criterion/criterion.h>
+#include <stdio.h>
+#include <string.h>
+
+FilterExprNode *
+perf_compile_filter(GlobalConfig *cfg, const gchar *config_snippet)
+{
+  FilterExprNode *expr;
+
+  CfgLexer *lexer = cfg_lexer_new_buffer(cfg, config_snippet, strlen(config_snippet));
+  cr_assert(lexer, "Couldn't initialize a buffer for CfgLexer");
+  cr_assert(cfg_run_parser(cfg, lexer, &filter_expr_parser, (gpointer *) &expr, NULL), "%s", config_snippet);
+  return expr;
+}
+
+/*
+ * Calls @func @iterations times, cycling through @msgs, and returns the
+ * number of messages processed per second.
+ */
+gdouble
+perf_measure_rate(PerfMessageFunc func, gpointer user_data,
+                  LogMessage **msgs, gint num_msgs, gint iterations, gint *matches)
+{
+  gint local_matches = 0;
+  gint64 start = g_get_monotonic_time();
+
+  for (gint i = 0; i < iterations; i++)
+    local_matches += func(msgs[i % num_msgs], user_data);
+
+  gint64 elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+  if (matches)
+    *matches = local_matches;
+  return iterations * (gdouble) G_USEC_PER_SEC / elapsed;
+}
+
+static gint
+_eval_filter(LogMessage *msg, gpointer user_data)
+{
+  return filter_expr_eval((FilterExprNode *) user_data, msg);
+}
+
+gdouble
+perf_measure_filter_rate(FilterExprNode *filter, LogMessage **msgs, gint num_msgs, gint iterations, gint *matches)
+{
+  return perf_measure_rate(_eval_filter, filter, msgs, num_msgs, iterations, matches);
+}
+
+void
+perf_print_rates(const gchar *benchmark, const gchar *name, gdouble rate, const gchar *other_name, gdouble other_rate)
+{
+  printf("%s: %s=%.0f msg/sec, %s=%.0f msg/sec\n", benchmark, name, rate, other_name, other_rate);
+}
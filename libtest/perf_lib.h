@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef PERF_LIB_H_INCLUDED
+#define PERF_LIB_H_INCLUDED 1
+
+#include "syslog-ng.h"
+#include "cfg.h"
+#include "logmsg/logmsg.h"
+#include "filter/filter-expr.h"
+
+/* number of messages a throughput test feeds, unless it needs a different amount */
+#define PERF_MESSAGES 20000
+
+/* processes @msg, returns the number of matches it produced */
+typedef gint (*PerfMessageFunc)(LogMessage *msg, gpointer user_data);
+
+FilterExprNode *perf_compile_filter(GlobalConfig *cfg, const gchar *config_snippet);
+
+gdouble perf_measure_rate(PerfMessageFunc func, gpointer user_data,
+                          LogMessage **msgs, gint num_msgs, gint iterations, gint *matches);
+gdouble perf_measure_filter_rate(FilterExprNode *filter,
+                                 LogMessage **msgs, gint num_msgs, gint iterations, gint *matches);
+void perf_print_rates(const gchar *benchmark, const gchar *name, gdouble rate,
+                      const gchar *other_name, gdouble other_rate);
+
+#endif
@@ -28,12 +28,20 @@
 #include "value-pairs/evttag.h"
 #include "value-pairs/value-pairs.h"
 
+#include <string.h>
+
 static void
 _worker_disconnect(LogThreadedDestWorker *s)
 {
   MongoDBDestWorker *self = (MongoDBDestWorker *)s;
   MongoDBDestDriver *owner = (MongoDBDestDriver *) self->super.owner;
 
+  /* the documents not sent yet are rewound with the rest of the batch */
+  if (self->bulk_op)
+    mongoc_bulk_operation_destroy(self->bulk_op);
+  self->bulk_op = NULL;
+  self->bulk_op_documents = 0;
+
   if (self->coll_obj)
     mongoc_collection_destroy(self->coll_obj);
   self->coll_obj = NULL;
@@ -317,9 +325,8 @@ _vp_process_value(const gchar *name, const gchar *prefix, TypeHint type,
 }
 
 static LogThreadedResult
-_worker_insert(LogThreadedDestWorker *s, LogMessage *msg)
+_format_document(MongoDBDestWorker *self, LogMessage *msg)
 {
-  MongoDBDestWorker *self = (MongoDBDestWorker *) s;
   MongoDBDestDriver *owner = (MongoDBDestDriver *) self->super.owner;
 
   gboolean success;
@@ -350,6 +357,39 @@ _worker_insert(LogThreadedDestWorker *s, LogMessage *msg)
             evt_tag_value_pairs("message", owner->vp, msg, &options),
             evt_tag_str("driver", owner->super.super.super.id));
 
+  return LTR_SUCCESS;
+}
+
+static LogThreadedResult
+_map_insert_error(MongoDBDestWorker *self, const bson_error_t *error)
+{
+  MongoDBDestDriver *owner = (MongoDBDestDriver *) self->super.owner;
+
+  if (error->domain == MONGOC_ERROR_STREAM)
+    {
+      msg_error("Network error while inserting into MongoDB",
+                evt_tag_int("time_reopen", self->super.time_reopen),
+                evt_tag_str("reason", error->message),
+                evt_tag_str("driver", owner->super.super.super.id));
+      return LTR_NOT_CONNECTED;
+    }
+
+  msg_error("Failed to insert into MongoDB",
+            evt_tag_int("time_reopen", self->super.time_reopen),
+            evt_tag_str("reason", error->message),
+            evt_tag_str("driver", owner->super.super.super.id));
+  return LTR_ERROR;
+}
+
+static LogThreadedResult
+_worker_insert(LogThreadedDestWorker *s, LogMessage *msg)
+{
+  MongoDBDestWorker *self = (MongoDBDestWorker *) s;
+  MongoDBDestDriver *owner = (MongoDBDestDriver *) self->super.owner;
+
+  LogThreadedResult result = _format_document(self, msg);
+  if (result != LTR_SUCCESS)
+    return result;
 
   if (!owner->collection_is_literal_string)
     {
@@ -359,29 +399,137 @@ _worker_insert(LogThreadedDestWorker *s, LogMessage *msg)
     }
 
   bson_error_t error;
-  success = mongoc_collection_insert(self->coll_obj, MONGOC_INSERT_NONE,
-                                     (const bson_t *)self->bson, NULL, &error);
+  gboolean success = mongoc_collection_insert(self->coll_obj, MONGOC_INSERT_NONE,
+                                              (const bson_t *)self->bson, NULL, &error);
   if (!success)
+    return _map_insert_error(self, &error);
+
+  return LTR_SUCCESS;
+}
+
+static gint32
+_get_inserted_count_from_reply(const bson_t *reply)
+{
+  bson_iter_t iter;
+
+  if (bson_iter_init_find(&iter, reply, "nInserted") && BSON_ITER_HOLDS_INT32(&iter))
+    return bson_iter_int32(&iter);
+  return 0;
+}
+
+/*
+ * The bulk operation is ordered, MongoDB stops at the first document it
+ * fails to insert.  The documents stored before that one are acked right
+ * away, only the rest of the batch is rewound and sent again.
+ *
+ * The documents of the bulk operation are the oldest ones of the batch,
+ * the current message is not among them when a bulk operation is executed
+ * from insert().
+ */
+LogThreadedResult
+afmongodb_dw_process_bulk_result(MongoDBDestWorker *self, gboolean success,
+                                 const bson_t *reply, const bson_error_t *error)
+{
+  MongoDBDestDriver *owner = (MongoDBDestDriver *) self->super.owner;
+  gint inserted = success ? self->bulk_op_documents : _get_inserted_count_from_reply(reply);
+
+  /* acking resets the retry counter of the batch, only do it if we made progress */
+  inserted = CLAMP(inserted, 0, self->bulk_op_documents);
+  if (inserted > 0)
+    log_threaded_dest_worker_ack_messages(&self->super, inserted);
+  self->bulk_op_documents = 0;
+
+  if (success)
+    return LTR_SUCCESS;
+
+  msg_debug("MongoDB bulk insert failed",
+            evt_tag_int("inserted", inserted),
+            evt_tag_int("remaining", self->super.batch_size),
+            evt_tag_str("driver", owner->super.super.super.id));
+  return _map_insert_error(self, error);
+}
+
+static LogThreadedResult
+_execute_bulk_operation(MongoDBDestWorker *self)
+{
+  bson_t reply;
+  bson_error_t error;
+
+  if (!self->bulk_op)
+    return LTR_SUCCESS;
+
+  gboolean success = mongoc_bulk_operation_execute(self->bulk_op, &reply, &error) != 0;
+  LogThreadedResult result = afmongodb_dw_process_bulk_result(self, success, &reply, &error);
+
+  bson_destroy(&reply);
+  mongoc_bulk_operation_destroy(self->bulk_op);
+  self->bulk_op = NULL;
+  return result;
+}
+
+static LogThreadedResult
+_switch_collection_of_batch(MongoDBDestWorker *self, LogMessage *msg)
+{
+  const gchar *new_collection = _format_collection_template(self, msg);
+
+  if (self->coll_obj && strcmp(mongoc_collection_get_name(self->coll_obj), new_collection) == 0)
+    return LTR_SUCCESS;
+
+  /* a bulk operation is bound to a single collection, send what we have
+   * collected so far */
+  LogThreadedResult result = _execute_bulk_operation(self);
+  if (result != LTR_SUCCESS)
+    return result;
+
+  if (!_switch_collection(self, new_collection))
+    return LTR_ERROR;
+
+  return LTR_SUCCESS;
+}
+
+static LogThreadedResult
+_worker_insert_batch(LogThreadedDestWorker *s, LogMessage *msg)
+{
+  MongoDBDestWorker *self = (MongoDBDestWorker *) s;
+  MongoDBDestDriver *owner = (MongoDBDestDriver *) self->super.owner;
+
+  LogThreadedResult result = _format_document(self, msg);
+  if (result != LTR_SUCCESS)
     {
-      if (error.domain == MONGOC_ERROR_STREAM)
-        {
-          msg_error("Network error while inserting into MongoDB",
-                    evt_tag_int("time_reopen", self->super.time_reopen),
-                    evt_tag_str("reason", error.message),
-                    evt_tag_str("driver", owner->super.super.super.id));
-          return LTR_NOT_CONNECTED;
-        }
-      else
-        {
-          msg_error("Failed to insert into MongoDB",
-                    evt_tag_int("time_reopen", self->super.time_reopen),
-                    evt_tag_str("reason", error.message),
-                    evt_tag_str("driver", owner->super.super.super.id));
-          return LTR_ERROR;
-        }
+      /* a drop applies to the whole batch, send the documents collected so far first */
+      LogThreadedResult bulk_result = _execute_bulk_operation(self);
+      return bulk_result != LTR_SUCCESS ? bulk_result : result;
     }
 
-  return LTR_SUCCESS;
+  if (!owner->collection_is_literal_string)
+    {
+      result = _switch_collection_of_batch(self, msg);
+      if (result != LTR_SUCCESS)
+        return result;
+    }
+
+  if (!self->bulk_op)
+    self->bulk_op = mongoc_collection_create_bulk_operation(self->coll_obj, TRUE, NULL);
+
+  mongoc_bulk_operation_insert(self->bulk_op, (const bson_t *)self->bson);
+  self->bulk_op_documents++;
+  return LTR_QUEUED;
+}
+
+static LogThreadedResult
+_worker_flush(LogThreadedDestWorker *s, LogThreadedFlushMode mode)
+{
+  MongoDBDestWorker *self = (MongoDBDestWorker *) s;
+
+  if (!self->bulk_op)
+    return LTR_SUCCESS;
+
+  /* the stored documents are acked by _execute_bulk_operation() */
+  LogThreadedResult result = _execute_bulk_operation(self);
+  if (result != LTR_SUCCESS)
+    return result;
+
+  return LTR_EXPLICIT_ACK_MGMT;
 }
 
 static gboolean
@@ -400,6 +548,10 @@ _worker_thread_deinit(LogThreadedDestWorker *s)
 {
   MongoDBDestWorker *self = (MongoDBDestWorker *) s;
 
+  if (self->bulk_op)
+    mongoc_bulk_operation_destroy(self->bulk_op);
+  self->bulk_op = NULL;
+
   if (self->bson)
     bson_destroy(self->bson);
   self->bson = NULL;
@@ -421,7 +573,15 @@ afmongodb_dw_new(LogThreadedDestDriver *owner, gint worker_index)
   self->super.thread_deinit = _worker_thread_deinit;
   self->super.connect = _worker_connect;
   self->super.disconnect = _worker_disconnect;
-  self->super.insert = _worker_insert;
+  if (owner->batch_lines > 0)
+    {
+      self->super.insert = _worker_insert_batch;
+      self->super.flush = _worker_flush;
+    }
+  else
+    {
+      self->super.insert = _worker_insert;
+    }
 
   return &self->super;
 }
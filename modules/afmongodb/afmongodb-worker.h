@@ -39,8 +39,14 @@ typedef struct MongoDBDestWorker
   mongoc_collection_t *coll_obj;
 
   bson_t *bson;
+
+  /* documents of the current batch, if batch-lines() is set */
+  mongoc_bulk_operation_t *bulk_op;
+  gint bulk_op_documents;
 } MongoDBDestWorker;
 
+LogThreadedResult afmongodb_dw_process_bulk_result(MongoDBDestWorker *self, gboolean success,
+                                                   const bson_t *reply, const bson_error_t *error);
 LogThreadedDestWorker *afmongodb_dw_new(LogThreadedDestDriver *owner, gint worker_index);
 
 #endif
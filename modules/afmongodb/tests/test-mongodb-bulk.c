@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include <criterion/criterion.h>
+
+#include "apphook.h"
+#include "logqueue-fifo.h"
+#include "libtest/queue_utils_lib.h"
+#include "../afmongodb.h"
+#include "../afmongodb-worker.h"
+
+static LogDriver *mongodb;
+static MongoDBDestWorker *worker;
+static LogQueue *queue;
+
+/* puts n messages into the backlog, as if the worker had inserted them into its bulk operation */
+static void
+_fill_bulk_operation(gint n)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  feed_some_messages(queue, n);
+  for (gint i = 0; i < n; i++)
+    {
+      LogMessage *msg = log_queue_pop_head(queue, &path_options);
+
+      cr_assert_not_null(msg);
+      log_msg_unref(msg);
+      worker->super.batch_size++;
+      worker->bulk_op_documents++;
+    }
+}
+
+static LogThreadedResult
+_process_bulk_reply(gboolean success, gint32 inserted, const bson_error_t *error)
+{
+  bson_t *reply = BCON_NEW("nInserted", BCON_INT32(inserted));
+  LogThreadedResult result = afmongodb_dw_process_bulk_result(worker, success, reply, error);
+
+  bson_destroy(reply);
+  return result;
+}
+
+Test(mongodb_bulk, test_successful_bulk_insert_acks_every_document)
+{
+  bson_error_t error = { 0 };
+
+  _fill_bulk_operation(5);
+  cr_assert_eq(_process_bulk_reply(TRUE, 5, &error), LTR_SUCCESS);
+
+  cr_assert_eq(acked_messages, 5);
+  cr_assert_eq(worker->super.batch_size, 0);
+  cr_assert_eq(worker->bulk_op_documents, 0);
+}
+
+Test(mongodb_bulk, test_partial_failure_acks_the_stored_documents_and_keeps_the_rest)
+{
+  bson_error_t error;
+
+  bson_set_error(&error, MONGOC_ERROR_SERVER, 11000, "E11000 duplicate key error");
+
+  _fill_bulk_operation(5);
+  cr_assert_eq(_process_bulk_reply(FALSE, 3, &error), LTR_ERROR);
+
+  cr_assert_eq(acked_messages, 3);
+  cr_assert_eq(worker->super.batch_size, 2);
+  cr_assert_eq(worker->bulk_op_documents, 0);
+
+  /* only the documents not stored are sent again */
+  log_queue_rewind_backlog_all(queue);
+  cr_assert_eq(log_queue_get_length(queue), 2);
+}
+
+Test(mongodb_bulk, test_network_error_keeps_the_whole_batch)
+{
+  bson_error_t error;
+
+  bson_set_error(&error, MONGOC_ERROR_STREAM, MONGOC_ERROR_STREAM_SOCKET, "connection reset");
+
+  _fill_bulk_operation(5);
+  cr_assert_eq(_process_bulk_reply(FALSE, 0, &error), LTR_NOT_CONNECTED);
+
+  cr_assert_eq(acked_messages, 0);
+  cr_assert_eq(worker->super.batch_size, 5);
+
+  log_queue_rewind_backlog_all(queue);
+  cr_assert_eq(log_queue_get_length(queue), 5);
+}
+
+Test(mongodb_bulk, test_only_the_documents_of_the_bulk_operation_are_acked)
+{
+  bson_error_t error;
+
+  bson_set_error(&error, MONGOC_ERROR_SERVER, 11000, "E11000 duplicate key error");
+
+  /* the message being inserted while the collection is switched is part
+   * of the batch, but not of the bulk operation */
+  _fill_bulk_operation(4);
+  feed_some_messages(queue, 1);
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  log_msg_unref(log_queue_pop_head(queue, &path_options));
+  worker->super.batch_size++;
+
+  cr_assert_eq(_process_bulk_reply(FALSE, 10, &error), LTR_ERROR);
+  cr_assert_eq(acked_messages, 4);
+  cr_assert_eq(worker->super.batch_size, 1);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  configuration = cfg_new_snippet();
+  mongodb = afmongodb_dd_new(configuration);
+  worker = (MongoDBDestWorker *) afmongodb_dw_new((LogThreadedDestDriver *) mongodb, 0);
+
+  queue = log_queue_fifo_new(1000, NULL);
+  log_queue_set_use_backlog(queue, TRUE);
+  worker->super.queue = queue;
+
+  acked_messages = 0;
+  fed_messages = 0;
+}
+
+static void
+teardown(void)
+{
+  log_queue_unref(queue);
+  log_threaded_dest_worker_free(&worker->super);
+  log_pipe_unref(&mongodb->super);
+  cfg_free(configuration);
+  app_shutdown();
+}
+
+TestSuite(mongodb_bulk, .init = setup, .fini = teardown);
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include "afsocket-accept-queue.h"
+#include "atomic.h"
+
+#include <unistd.h>
+
+struct _AFSocketAcceptQueue
+{
+  GAtomicCounter ref_cnt;
+  GMutex lock;
+  GQueue connections;
+  gpointer owner;
+  /* the owner was already asked to take the queued connections */
+  gboolean take_scheduled;
+};
+
+AFSocketAcceptedConnection *
+afsocket_accepted_connection_new(GSockAddr *peer_addr, GSockAddr *local_addr, gint fd)
+{
+  AFSocketAcceptedConnection *self = g_new0(AFSocketAcceptedConnection, 1);
+
+  self->peer_addr = g_sockaddr_ref(peer_addr);
+  self->local_addr = g_sockaddr_ref(local_addr);
+  self->fd = fd;
+  return self;
+}
+
+void
+afsocket_accepted_connection_free(AFSocketAcceptedConnection *self, gboolean close_fd)
+{
+  if (close_fd)
+    close(self->fd);
+  g_sockaddr_unref(self->peer_addr);
+  g_sockaddr_unref(self->local_addr);
+  g_free(self);
+}
+
+/*
+ * The slot reserved for the connection is only kept if it was reserved in
+ * the counter of the current owner.  Returns TRUE if the owner has to be
+ * asked to take the connections, i.e. it was not asked already.
+ */
+gboolean
+afsocket_accept_queue_push(AFSocketAcceptQueue *self, gpointer reserved_by, AFSocketAcceptedConnection *connection)
+{
+  gboolean schedule_take;
+
+  g_mutex_lock(&self->lock);
+  connection->reserved = reserved_by && reserved_by == self->owner;
+  g_queue_push_tail(&self->connections, connection);
+  schedule_take = self->owner && !self->take_scheduled;
+  if (schedule_take)
+    self->take_scheduled = TRUE;
+  g_mutex_unlock(&self->lock);
+
+  return schedule_take;
+}
+
+/* returns the queued connections, unless there is no owner to set them up */
+GList *
+afsocket_accept_queue_take_all(AFSocketAcceptQueue *self, gpointer *owner)
+{
+  GList *connections = NULL;
+
+  g_mutex_lock(&self->lock);
+  *owner = self->owner;
+  if (self->owner)
+    {
+      connections = self->connections.head;
+      g_queue_init(&self->connections);
+    }
+  self->take_scheduled = FALSE;
+  g_mutex_unlock(&self->lock);
+
+  return connections;
+}
+
+/* NOTE: the owner has to take the connections queued so far */
+void
+afsocket_accept_queue_attach(AFSocketAcceptQueue *self, gpointer owner)
+{
+  g_mutex_lock(&self->lock);
+  self->owner = owner;
+  g_mutex_unlock(&self->lock);
+}
+
+/* the slots reserved in the counter of the previous owner are not valid for the next one */
+void
+afsocket_accept_queue_detach(AFSocketAcceptQueue *self)
+{
+  g_mutex_lock(&self->lock);
+  self->owner = NULL;
+  for (GList *l = self->connections.head; l; l = l->next)
+    ((AFSocketAcceptedConnection *) l->data)->reserved = FALSE;
+  g_mutex_unlock(&self->lock);
+}
+
+AFSocketAcceptQueue *
+afsocket_accept_queue_new(void)
+{
+  AFSocketAcceptQueue *self = g_new0(AFSocketAcceptQueue, 1);
+
+  g_atomic_counter_set(&self->ref_cnt, 1);
+  g_mutex_init(&self->lock);
+  g_queue_init(&self->connections);
+  return self;
+}
+
+AFSocketAcceptQueue *
+afsocket_accept_queue_ref(AFSocketAcceptQueue *self)
+{
+  g_assert(!self || g_atomic_counter_get(&self->ref_cnt) > 0);
+
+  if (self)
+    g_atomic_counter_inc(&self->ref_cnt);
+  return self;
+}
+
+void
+afsocket_accept_queue_unref(AFSocketAcceptQueue *self)
+{
+  g_assert(!self || g_atomic_counter_get(&self->ref_cnt));
+
+  if (self && g_atomic_counter_dec_and_test(&self->ref_cnt))
+    {
+      AFSocketAcceptedConnection *connection;
+
+      while ((connection = g_queue_pop_head(&self->connections)))
+        afsocket_accepted_connection_free(connection, TRUE);
+      g_mutex_clear(&self->lock);
+      g_free(self);
+    }
+}
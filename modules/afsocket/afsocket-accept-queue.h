@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#ifndef AFSOCKET_ACCEPT_QUEUE_H_INCLUDED
+#define AFSOCKET_ACCEPT_QUEUE_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "gsockaddr.h"
+
+/*
+ * Connections accepted by the additional listeners of listen-sockets() in
+ * the I/O reactors, waiting for the main thread to set them up.
+ *
+ * The queue has an owner, the source driver setting the connections up.
+ * While a configuration is reloaded, there is none: the queue is kept in
+ * the persistent config and the connections accepted in the meantime wait
+ * for the driver of the new configuration.  The connections still queued
+ * when the queue is freed are closed.
+ */
+typedef struct _AFSocketAcceptedConnection
+{
+  GSockAddr *peer_addr;
+  GSockAddr *local_addr;
+  gint fd;
+  /* the slot of the connection is reserved in the counter of the owner */
+  gboolean reserved;
+} AFSocketAcceptedConnection;
+
+typedef struct _AFSocketAcceptQueue AFSocketAcceptQueue;
+
+AFSocketAcceptedConnection *afsocket_accepted_connection_new(GSockAddr *peer_addr, GSockAddr *local_addr, gint fd);
+void afsocket_accepted_connection_free(AFSocketAcceptedConnection *self, gboolean close_fd);
+
+gboolean afsocket_accept_queue_push(AFSocketAcceptQueue *self, gpointer reserved_by,
+                                    AFSocketAcceptedConnection *connection);
+GList *afsocket_accept_queue_take_all(AFSocketAcceptQueue *self, gpointer *owner);
+
+void afsocket_accept_queue_attach(AFSocketAcceptQueue *self, gpointer owner);
+void afsocket_accept_queue_detach(AFSocketAcceptQueue *self);
+
+AFSocketAcceptQueue *afsocket_accept_queue_new(void);
+AFSocketAcceptQueue *afsocket_accept_queue_ref(AFSocketAcceptQueue *self);
+void afsocket_accept_queue_unref(AFSocketAcceptQueue *self);
+
+#endif
@@ -28,6 +28,7 @@
 #include "stats/stats-registry.h"
 #include "stats/stats-cluster-single.h"
 #include "mainloop.h"
+#include "mainloop-io-reactor.h"
 #include "poll-fd-events.h"
 #include "timeutils/misc.h"
 
@@ -54,6 +55,23 @@ typedef struct _AFSocketSourceConnection
   GSockAddr *local_addr;
 } AFSocketSourceConnection;
 
+/*
+ * Additional SO_REUSEPORT listeners of the same address, each registered
+ * in an I/O reactor, so that accept() is sharded across threads by the
+ * kernel.  The reactor reserves the connection slot and sets up the peer
+ * socket, the main thread only creates the LogReader of the connection,
+ * which registers its stats and joins the pipeline there.
+ */
+typedef struct _AFSocketListener
+{
+  AFSocketSourceDriver *owner;
+  AFSocketAcceptQueue *accept_queue;
+  MainLoopIOReactor *reactor;
+  struct iv_fd listen_fd;
+  gint fd;
+  gboolean close_on_stop;
+} AFSocketListener;
+
 static void afsocket_sd_close_connection(AFSocketSourceDriver *self, AFSocketSourceConnection *sc);
 
 static void
@@ -80,6 +98,18 @@ _connections_count_dec(AFSocketSourceDriver *self)
   atomic_gssize_dec(&self->num_connections);
 }
 
+/* the limit is checked and the slot is taken in one step, as connections are accepted in several threads */
+static gboolean
+_connections_count_reserve(AFSocketSourceDriver *self)
+{
+  if (atomic_gssize_inc(&self->num_connections) >= self->max_connections)
+    {
+      _connections_count_dec(self);
+      return FALSE;
+    }
+  return TRUE;
+}
+
 static gchar *
 _format_sc_name(AFSocketSourceConnection *self, gint format_type)
 {
@@ -148,6 +178,8 @@ afsocket_sc_init(LogPipe *s)
       log_reader_open(self->reader, proto, poll_fd_events_new(self->sock));
       log_reader_set_peer_addr(self->reader, self->peer_addr);
       log_reader_set_local_addr(self->reader, self->local_addr);
+      if (self->owner->transport_mapper->sock_type == SOCK_STREAM)
+        log_reader_use_io_reactor(self->reader);
     }
 
   log_reader_set_options(self->reader, &self->super,
@@ -319,6 +351,14 @@ afsocket_sd_set_listen_backlog(LogDriver *s, gint listen_backlog)
   self->listen_backlog = listen_backlog;
 }
 
+void
+afsocket_sd_set_listen_sockets(LogDriver *s, gint listen_sockets)
+{
+  AFSocketSourceDriver *self = (AFSocketSourceDriver *) s;
+
+  self->listen_sockets = listen_sockets;
+}
+
 void
 afsocket_sd_set_dynamic_window_size(LogDriver *s, gint dynamic_window_size)
 {
@@ -377,6 +417,28 @@ afsocket_sd_format_listener_name(const AFSocketSourceDriver *self)
   return persist_name;
 }
 
+static const gchar *
+afsocket_sd_format_extra_listeners_name(const AFSocketSourceDriver *self)
+{
+  static gchar persist_name[1024];
+
+  g_snprintf(persist_name, sizeof(persist_name), "%s.extra_listen_fds",
+             afsocket_sd_format_name((const LogPipe *)self));
+
+  return persist_name;
+}
+
+static const gchar *
+afsocket_sd_format_accept_queue_name(const AFSocketSourceDriver *self)
+{
+  static gchar persist_name[1024];
+
+  g_snprintf(persist_name, sizeof(persist_name), "%s.accept_queue",
+             afsocket_sd_format_name((const LogPipe *)self));
+
+  return persist_name;
+}
+
 static const gchar *
 afsocket_sd_format_connections_name(const AFSocketSourceDriver *self)
 {
@@ -400,10 +462,12 @@ afsocket_sd_format_dynamic_window_pool_name(const AFSocketSourceDriver *self)
 }
 
 static gboolean
-afsocket_sd_process_connection(AFSocketSourceDriver *self, GSockAddr *client_addr, GSockAddr *local_addr, gint fd)
+_is_connection_allowed_by_tcp_wrapper(AFSocketSourceDriver *self, GSockAddr *client_addr, GSockAddr *local_addr,
+                                      gint fd)
 {
-  gchar buf[MAX_SOCKADDR_STRING], buf2[MAX_SOCKADDR_STRING];
 #if SYSLOG_NG_ENABLE_TCP_WRAPPER
+  gchar buf[MAX_SOCKADDR_STRING], buf2[MAX_SOCKADDR_STRING];
+
   if (client_addr && (client_addr->sa.sa_family == AF_INET
 #if SYSLOG_NG_ENABLE_IPV6
                       || client_addr->sa.sa_family == AF_INET6
@@ -425,49 +489,117 @@ afsocket_sd_process_connection(AFSocketSourceDriver *self, GSockAddr *client_add
     }
 
 #endif
+  return TRUE;
+}
+
+static void
+_log_connection_limit_reached(AFSocketSourceDriver *self, GSockAddr *client_addr, GSockAddr *local_addr)
+{
+  gchar buf[MAX_SOCKADDR_STRING], buf2[MAX_SOCKADDR_STRING];
+
+  msg_error("Number of allowed concurrent connections reached, rejecting connection",
+            evt_tag_str("client", g_sockaddr_format(client_addr, buf, sizeof(buf), GSA_FULL)),
+            evt_tag_str("local", g_sockaddr_format(local_addr, buf2, sizeof(buf2), GSA_FULL)),
+            evt_tag_str("group_name", self->super.super.group),
+            log_pipe_location_tag(&self->super.super.super),
+            evt_tag_int("max", self->max_connections));
+}
 
-  if (_connections_count_get(self) >= self->max_connections)
+/* the connection slot is already reserved, it is released if the connection cannot be set up */
+static gboolean
+_setup_connection(AFSocketSourceDriver *self, GSockAddr *client_addr, GSockAddr *local_addr, gint fd)
+{
+  AFSocketSourceConnection *conn;
+
+  conn = afsocket_sc_new(client_addr, local_addr, fd, self->super.super.super.cfg);
+  afsocket_sc_set_owner(conn, self);
+  if (!log_pipe_init(&conn->super))
     {
-      msg_error("Number of allowed concurrent connections reached, rejecting connection",
-                evt_tag_str("client", g_sockaddr_format(client_addr, buf, sizeof(buf), GSA_FULL)),
-                evt_tag_str("local", g_sockaddr_format(local_addr, buf2, sizeof(buf2), GSA_FULL)),
-                evt_tag_str("group_name", self->super.super.group),
-                log_pipe_location_tag(&self->super.super.super),
-                evt_tag_int("max", self->max_connections));
+      log_pipe_unref(&conn->super);
+      _connections_count_dec(self);
       return FALSE;
     }
-  else
+
+  afsocket_sd_add_connection(self, conn);
+  log_pipe_append(&conn->super, &self->super.super.super);
+  return TRUE;
+}
+
+static gboolean
+afsocket_sd_process_connection(AFSocketSourceDriver *self, GSockAddr *client_addr, GSockAddr *local_addr, gint fd)
+{
+  if (!_is_connection_allowed_by_tcp_wrapper(self, client_addr, local_addr, fd))
+    return FALSE;
+
+  if (!_connections_count_reserve(self))
     {
-      AFSocketSourceConnection *conn;
+      _log_connection_limit_reached(self, client_addr, local_addr);
+      return FALSE;
+    }
 
-      conn = afsocket_sc_new(client_addr, local_addr, fd, self->super.super.super.cfg);
-      afsocket_sc_set_owner(conn, self);
-      if (log_pipe_init(&conn->super))
-        {
-          afsocket_sd_add_connection(self, conn);
-          _connections_count_inc(self);
-          log_pipe_append(&conn->super, &self->super.super.super);
-        }
-      else
-        {
-          log_pipe_unref(&conn->super);
-          return FALSE;
-        }
+  return _setup_connection(self, client_addr, local_addr, fd);
+}
+
+/* connections accepted on an extra listener, with their slot reserved in the reactor */
+static gboolean
+afsocket_sd_process_reserved_connection(AFSocketSourceDriver *self, GSockAddr *client_addr, GSockAddr *local_addr,
+                                        gint fd)
+{
+  if (!_is_connection_allowed_by_tcp_wrapper(self, client_addr, local_addr, fd))
+    {
+      _connections_count_dec(self);
+      return FALSE;
     }
-  return TRUE;
+
+  return _setup_connection(self, client_addr, local_addr, fd);
 }
 
 #define MAX_ACCEPTS_AT_A_TIME 30
 
+static void
+_log_connection_accepted(AFSocketSourceDriver *self, gint fd, GSockAddr *peer_addr)
+{
+  gchar buf1[256], buf2[256];
+
+  if (peer_addr->sa.sa_family != AF_UNIX)
+    msg_notice("Syslog connection accepted",
+               evt_tag_int("fd", fd),
+               evt_tag_str("client", g_sockaddr_format(peer_addr, buf1, sizeof(buf1), GSA_FULL)),
+               evt_tag_str("local", g_sockaddr_format(self->bind_addr, buf2, sizeof(buf2), GSA_FULL)));
+  else
+    msg_verbose("Syslog connection accepted",
+                evt_tag_int("fd", fd),
+                evt_tag_str("client", g_sockaddr_format(peer_addr, buf1, sizeof(buf1), GSA_FULL)),
+                evt_tag_str("local", g_sockaddr_format(self->bind_addr, buf2, sizeof(buf2), GSA_FULL)));
+}
+
+static void
+afsocket_sd_handle_accepted_fd(AFSocketSourceDriver *self, gint new_fd, GSockAddr *peer_addr)
+{
+  GSockAddr *local_addr;
+  gboolean res;
+
+  local_addr = g_socket_get_local_name(new_fd);
+  res = afsocket_sd_process_connection(self, peer_addr, local_addr, new_fd);
+  g_sockaddr_unref(local_addr);
+
+  if (res)
+    {
+      socket_options_setup_peer_socket(self->socket_options, new_fd, peer_addr);
+      _log_connection_accepted(self, new_fd, peer_addr);
+    }
+  else
+    {
+      close(new_fd);
+    }
+}
+
 static void
 afsocket_sd_accept(gpointer s)
 {
   AFSocketSourceDriver *self = (AFSocketSourceDriver *) s;
   GSockAddr *peer_addr;
-  GSockAddr *local_addr;
-  gchar buf1[256], buf2[256];
   gint new_fd;
-  gboolean res;
   int accepts = 0;
 
   while (accepts < MAX_ACCEPTS_AT_A_TIME)
@@ -490,34 +622,333 @@ afsocket_sd_accept(gpointer s)
       g_fd_set_nonblock(new_fd, TRUE);
       g_fd_set_cloexec(new_fd, TRUE);
 
-      local_addr = g_socket_get_local_name(new_fd);
-      res = afsocket_sd_process_connection(self, peer_addr, local_addr, new_fd);
-      g_sockaddr_unref(local_addr);
+      afsocket_sd_handle_accepted_fd(self, new_fd, peer_addr);
+
+      g_sockaddr_unref(peer_addr);
+      accepts++;
+    }
+  return;
+}
+
+/************************************************************************************
+ * Extra listeners, running in the I/O reactors
+ ************************************************************************************/
+
+/* NOTE: runs in the main thread, the peer sockets were already set up in the reactor */
+static void
+afsocket_sd_setup_accepted_connections(AFSocketSourceDriver *self, GList *connections)
+{
+  for (GList *l = connections; l; l = l->next)
+    {
+      AFSocketAcceptedConnection *accepted = (AFSocketAcceptedConnection *) l->data;
+      gboolean res;
+
+      if (accepted->reserved)
+        res = afsocket_sd_process_reserved_connection(self, accepted->peer_addr, accepted->local_addr, accepted->fd);
+      else
+        res = afsocket_sd_process_connection(self, accepted->peer_addr, accepted->local_addr, accepted->fd);
 
       if (res)
-        {
-          socket_options_setup_peer_socket(self->socket_options, new_fd, peer_addr);
+        _log_connection_accepted(self, accepted->fd, accepted->peer_addr);
+      afsocket_accepted_connection_free(accepted, !res);
+    }
+  g_list_free(connections);
+}
 
-          if (peer_addr->sa.sa_family != AF_UNIX)
-            msg_notice("Syslog connection accepted",
-                       evt_tag_int("fd", new_fd),
-                       evt_tag_str("client", g_sockaddr_format(peer_addr, buf1, sizeof(buf1), GSA_FULL)),
-                       evt_tag_str("local", g_sockaddr_format(self->bind_addr, buf2, sizeof(buf2), GSA_FULL)));
-          else
-            msg_verbose("Syslog connection accepted",
-                        evt_tag_int("fd", new_fd),
-                        evt_tag_str("client", g_sockaddr_format(peer_addr, buf1, sizeof(buf1), GSA_FULL)),
-                        evt_tag_str("local", g_sockaddr_format(self->bind_addr, buf2, sizeof(buf2), GSA_FULL)));
+static void
+afsocket_sd_take_accepted_connections(AFSocketSourceDriver *self)
+{
+  gpointer owner;
+  GList *connections = afsocket_accept_queue_take_all(self->accept_queue, &owner);
+
+  g_assert(!connections || owner == self);
+  afsocket_sd_setup_accepted_connections(self, connections);
+}
+
+/*
+ * NOTE: runs in the main thread.  The owner of the queue may have changed
+ * since this was scheduled: connections accepted while the configuration
+ * was reloaded are set up by the driver of the new configuration.
+ */
+static gpointer
+_take_accepted_connections(gpointer s)
+{
+  AFSocketAcceptQueue *accept_queue = (AFSocketAcceptQueue *) s;
+  gpointer owner;
+  GList *connections = afsocket_accept_queue_take_all(accept_queue, &owner);
+
+  if (connections)
+    afsocket_sd_setup_accepted_connections((AFSocketSourceDriver *) owner, connections);
+  afsocket_accept_queue_unref(accept_queue);
+  return NULL;
+}
+
+/*
+ * NOTE: runs in the reactor thread, the connection limit is enforced right
+ * here so that the listeners together cannot go over max-connections.
+ */
+static void
+afsocket_listener_accept(gpointer s)
+{
+  AFSocketListener *self = (AFSocketListener *) s;
+  AFSocketSourceDriver *owner = self->owner;
+  GSockAddr *peer_addr;
+  gint new_fd;
+  int accepts = 0;
+
+  while (accepts < MAX_ACCEPTS_AT_A_TIME)
+    {
+      GIOStatus status;
+
+      status = g_accept(self->fd, &new_fd, &peer_addr);
+      if (status == G_IO_STATUS_AGAIN)
+        break;
+      else if (status != G_IO_STATUS_NORMAL)
+        {
+          msg_error("Error accepting new connection",
+                    evt_tag_error(EVT_TAG_OSERROR));
+          return;
         }
-      else
+
+      g_fd_set_nonblock(new_fd, TRUE);
+      g_fd_set_cloexec(new_fd, TRUE);
+      accepts++;
+
+      if (!_connections_count_reserve(owner))
         {
+          _log_connection_limit_reached(owner, peer_addr, owner->bind_addr);
           close(new_fd);
+          g_sockaddr_unref(peer_addr);
+          continue;
         }
 
+      socket_options_setup_peer_socket(owner->socket_options, new_fd, peer_addr);
+
+      GSockAddr *local_addr = g_socket_get_local_name(new_fd);
+      AFSocketAcceptedConnection *accepted = afsocket_accepted_connection_new(peer_addr, local_addr, new_fd);
+      g_sockaddr_unref(local_addr);
       g_sockaddr_unref(peer_addr);
-      accepts++;
+
+      /* a single call to the main thread takes all the connections queued until it runs */
+      if (afsocket_accept_queue_push(self->accept_queue, owner, accepted))
+        main_loop_io_reactor_call_main(_take_accepted_connections, afsocket_accept_queue_ref(self->accept_queue));
+    }
+}
+
+static AFSocketListener *
+afsocket_listener_new(AFSocketSourceDriver *owner, gint index, gint fd)
+{
+  AFSocketListener *self = g_new0(AFSocketListener, 1);
+
+  self->owner = (AFSocketSourceDriver *) log_pipe_ref(&owner->super.super.super);
+  self->accept_queue = afsocket_accept_queue_ref(owner->accept_queue);
+  self->reactor = main_loop_io_reactor_get(index);
+  self->fd = fd;
+  IV_FD_INIT(&self->listen_fd);
+  self->listen_fd.fd = fd;
+  self->listen_fd.cookie = self;
+  self->listen_fd.handler_in = afsocket_listener_accept;
+  return self;
+}
+
+static gpointer
+_listener_unref_owner(gpointer s)
+{
+  log_pipe_unref((LogPipe *) s);
+  return NULL;
+}
+
+/* NOTE: runs in the reactor thread */
+static gpointer
+_listener_start(gpointer s)
+{
+  AFSocketListener *self = (AFSocketListener *) s;
+
+  iv_fd_register(&self->listen_fd);
+  return NULL;
+}
+
+/* NOTE: runs in the reactor thread, the listener is freed */
+static gpointer
+_listener_stop(gpointer s)
+{
+  AFSocketListener *self = (AFSocketListener *) s;
+
+  if (iv_fd_registered(&self->listen_fd))
+    iv_fd_unregister(&self->listen_fd);
+  if (self->close_on_stop)
+    close(self->fd);
+
+  afsocket_accept_queue_unref(self->accept_queue);
+  main_loop_io_reactor_call_main(_listener_unref_owner, self->owner);
+  g_free(self);
+  return NULL;
+}
+
+static void
+afsocket_listener_start(AFSocketListener *self)
+{
+  main_loop_io_reactor_call(self->reactor, _listener_start, self);
+}
+
+static void
+afsocket_listener_stop(AFSocketListener *self, gboolean close_fd)
+{
+  self->close_on_stop = close_fd;
+  main_loop_io_reactor_call(self->reactor, _listener_stop, self);
+}
+
+static gpointer
+_close_fd_in_reactor(gpointer s)
+{
+  close(GPOINTER_TO_INT(s));
+  return NULL;
+}
+
+/*
+ * The fds of the extra listeners are kept across reloads like the primary
+ * one.  They are closed in the reactor that had them registered, after
+ * they were unregistered there.
+ */
+static void
+_close_saved_listeners_from(GArray *fds, gint first)
+{
+  for (gint i = first; i < fds->len; i++)
+    {
+      MainLoopIOReactor *reactor = main_loop_io_reactor_get(i);
+      gint fd = g_array_index(fds, gint, i);
+
+      if (reactor)
+        main_loop_io_reactor_call(reactor, _close_fd_in_reactor, GINT_TO_POINTER(fd));
+      else
+        close(fd);
+    }
+  g_array_free(fds, TRUE);
+}
+
+static void
+afsocket_sd_close_saved_listeners(gpointer value)
+{
+  _close_saved_listeners_from((GArray *) value, 0);
+}
+
+static gboolean
+_open_extra_listener(AFSocketSourceDriver *self, gint *fd)
+{
+  gint sock;
+
+  if (!transport_mapper_open_socket(self->transport_mapper, self->socket_options, self->bind_addr,
+                                    self->bind_addr, AFSOCKET_DIR_RECV, &sock))
+    return FALSE;
+
+  if (listen(sock, self->listen_backlog) < 0)
+    {
+      msg_error("Error during listen()",
+                evt_tag_error(EVT_TAG_OSERROR));
+      close(sock);
+      return FALSE;
+    }
+  *fd = sock;
+  return TRUE;
+}
+
+static gint
+_get_num_extra_listeners(AFSocketSourceDriver *self)
+{
+  if (self->listen_sockets <= 1 || self->transport_mapper->sock_type != SOCK_STREAM)
+    return 0;
+
+  if (self->bind_addr->sa.sa_family == AF_UNIX)
+    {
+      msg_warning("WARNING: listen-sockets() is only supported for network sockets, using a single listener",
+                  log_pipe_location_tag(&self->super.super.super));
+      return 0;
+    }
+
+  /* all the listeners of the address must set SO_REUSEPORT, including the primary one */
+  if (!self->socket_options->so_reuseport)
+    {
+      msg_warning("WARNING: listen-sockets() requires so-reuseport(yes), using a single listener",
+                  log_pipe_location_tag(&self->super.super.super));
+      return 0;
+    }
+
+  if (main_loop_io_reactor_get_count() == 0)
+    {
+      msg_warning("WARNING: listen-sockets() requires I/O reactors to be started with --io-reactors, "
+                  "using a single listener",
+                  log_pipe_location_tag(&self->super.super.super));
+      return 0;
+    }
+
+  return self->listen_sockets - 1;
+}
+
+/* listening sockets kept from the previous configuration are reused, the rest are opened */
+static void
+afsocket_sd_open_extra_listeners(AFSocketSourceDriver *self)
+{
+  GlobalConfig *cfg = log_pipe_get_config(&self->super.super.super);
+  gint num_listeners = _get_num_extra_listeners(self);
+  GArray *saved = NULL;
+
+  if (self->connections_kept_alive_across_reloads)
+    {
+      saved = cfg_persist_config_fetch(cfg, afsocket_sd_format_extra_listeners_name(self));
+      self->accept_queue = cfg_persist_config_fetch(cfg, afsocket_sd_format_accept_queue_name(self));
+    }
+
+  if (!self->accept_queue && num_listeners > 0)
+    self->accept_queue = afsocket_accept_queue_new();
+
+  self->extra_listeners = g_ptr_array_new();
+  for (gint i = 0; i < num_listeners; i++)
+    {
+      gint fd;
+
+      if (saved && i < saved->len)
+        fd = g_array_index(saved, gint, i);
+      else if (!_open_extra_listener(self, &fd))
+        {
+          msg_error("Error opening additional listening socket, check that so-reuseport() is not disabled on "
+                    "a listener kept from the previous configuration",
+                    evt_tag_int("listen_sockets", i + 1),
+                    log_pipe_location_tag(&self->super.super.super));
+          break;
+        }
+
+      g_ptr_array_add(self->extra_listeners, afsocket_listener_new(self, i, fd));
+    }
+
+  /* the rest is not needed anymore, in case listen-sockets() was decreased */
+  if (saved)
+    _close_saved_listeners_from(saved, self->extra_listeners->len);
+
+  /* connections accepted while the configuration was reloaded are set up once the initialization is finished */
+  if (self->accept_queue)
+    {
+      afsocket_accept_queue_attach(self->accept_queue, self);
+      main_loop_io_reactor_call_main(_take_accepted_connections, afsocket_accept_queue_ref(self->accept_queue));
     }
-  return;
+}
+
+/*
+ * The listeners may still accept connections until they are stopped in
+ * their reactors.  Those are kept in the queue for the driver of the next
+ * configuration, or closed when it is freed.
+ */
+static void
+afsocket_sd_save_accept_queue(AFSocketSourceDriver *self)
+{
+  GlobalConfig *cfg = log_pipe_get_config(&self->super.super.super);
+
+  afsocket_accept_queue_detach(self->accept_queue);
+  if (self->connections_kept_alive_across_reloads)
+    cfg_persist_config_add(cfg, afsocket_sd_format_accept_queue_name(self), self->accept_queue,
+                           (GDestroyNotify) afsocket_accept_queue_unref, FALSE);
+  else
+    afsocket_accept_queue_unref(self->accept_queue);
+  self->accept_queue = NULL;
 }
 
 static void
@@ -676,6 +1107,9 @@ afsocket_sd_start_watches(AFSocketSourceDriver *self)
 {
   _listen_fd_start(self);
 
+  for (gint i = 0; self->extra_listeners && i < self->extra_listeners->len; i++)
+    afsocket_listener_start(g_ptr_array_index(self->extra_listeners, i));
+
   if (self->dynamic_window_pool != NULL)
     _dynamic_window_timer_start(self);
 }
@@ -831,6 +1265,7 @@ _finalize_init(gpointer arg)
     }
 
   _listen_fd_init(self);
+  afsocket_sd_open_extra_listeners(self);
   afsocket_sd_start_watches(self);
   char buf[256];
   msg_info("Accepting connections",
@@ -932,6 +1367,32 @@ afsocket_sd_save_connections(AFSocketSourceDriver *self)
   self->connections = NULL;
 }
 
+/* the listeners are freed in their reactors */
+static void
+afsocket_sd_save_extra_listeners(AFSocketSourceDriver *self)
+{
+  GlobalConfig *cfg = log_pipe_get_config(&self->super.super.super);
+  gboolean keep_fds = self->connections_kept_alive_across_reloads && self->extra_listeners->len > 0;
+  GArray *fds = g_array_new(FALSE, FALSE, sizeof(gint));
+
+  for (gint i = 0; i < self->extra_listeners->len; i++)
+    {
+      AFSocketListener *listener = g_ptr_array_index(self->extra_listeners, i);
+
+      g_array_append_val(fds, listener->fd);
+      afsocket_listener_stop(listener, !keep_fds);
+    }
+
+  if (keep_fds)
+    cfg_persist_config_add(cfg, afsocket_sd_format_extra_listeners_name(self),
+                           fds, afsocket_sd_close_saved_listeners, FALSE);
+  else
+    g_array_free(fds, TRUE);
+
+  g_ptr_array_free(self->extra_listeners, TRUE);
+  self->extra_listeners = NULL;
+}
+
 static void
 afsocket_sd_save_listener(AFSocketSourceDriver *self)
 {
@@ -940,6 +1401,8 @@ afsocket_sd_save_listener(AFSocketSourceDriver *self)
   if (self->transport_mapper->sock_type == SOCK_STREAM)
     {
       afsocket_sd_stop_watches(self);
+      if (self->extra_listeners)
+        afsocket_sd_save_extra_listeners(self);
       if (!self->connections_kept_alive_across_reloads)
         {
           msg_verbose("Closing listener fd",
@@ -1069,8 +1532,14 @@ afsocket_sd_deinit_method(LogPipe *s)
 {
   AFSocketSourceDriver *self = (AFSocketSourceDriver *) s;
 
+  /* the connections queued so far are kept alive along with the rest */
+  if (self->accept_queue)
+    afsocket_sd_take_accepted_connections(self);
+
   afsocket_sd_save_connections(self);
   afsocket_sd_save_listener(self);
+  if (self->accept_queue)
+    afsocket_sd_save_accept_queue(self);
 
   _stop_connection_counter_stats_queryable(self);
 
@@ -1127,6 +1596,7 @@ afsocket_sd_init_instance(AFSocketSourceDriver *self,
   self->transport_mapper = transport_mapper;
   self->max_connections = 10;
   self->listen_backlog = 255;
+  self->listen_sockets = 1;
   self->dynamic_window_stats_freq = DYNAMIC_WINDOW_TIMER_MSECS;
   self->dynamic_window_realloc_ticks = DYNAMIC_WINDOW_REALLOC_TICKS;
   self->connections_kept_alive_across_reloads = TRUE;
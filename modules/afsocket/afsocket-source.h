@@ -27,6 +27,7 @@
 #include "afsocket.h"
 #include "socket-options.h"
 #include "transport-mapper.h"
+#include "afsocket-accept-queue.h"
 #include "driver.h"
 #include "logreader.h"
 #include "dynamic-window-pool.h"
@@ -55,6 +56,9 @@ struct _AFSocketSourceDriver
   gint max_connections;
   atomic_gssize num_connections;
   gint listen_backlog;
+  gint listen_sockets;
+  GPtrArray *extra_listeners;
+  AFSocketAcceptQueue *accept_queue;
   GList *connections;
   SocketOptions *socket_options;
   TransportMapper *transport_mapper;
@@ -78,6 +82,7 @@ struct _AFSocketSourceDriver
 void afsocket_sd_set_keep_alive(LogDriver *self, gint enable);
 void afsocket_sd_set_max_connections(LogDriver *self, gint max_connections);
 void afsocket_sd_set_listen_backlog(LogDriver *self, gint listen_backlog);
+void afsocket_sd_set_listen_sockets(LogDriver *self, gint listen_sockets);
 void afsocket_sd_set_dynamic_window_size(LogDriver *self, gint dynamic_window_size);
 void afsocket_sd_set_dynamic_window_stats_freq(LogDriver *self, gdouble stats_freq);
 void afsocket_sd_set_dynamic_window_realloc_ticks(LogDriver *self, gint realloc_ticks);
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include <criterion/criterion.h>
+
+#include "afsocket-accept-queue.h"
+#include "apphook.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+static gint owner_a, owner_b;
+static GSockAddr *peer_addr;
+static GSockAddr *local_addr;
+
+static AFSocketAcceptedConnection *
+_new_connection(void)
+{
+  gint fds[2];
+
+  cr_assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  close(fds[1]);
+  return afsocket_accepted_connection_new(peer_addr, local_addr, fds[0]);
+}
+
+static gboolean
+_is_fd_open(gint fd)
+{
+  return fcntl(fd, F_GETFD) >= 0 || errno != EBADF;
+}
+
+static void
+_free_connections(GList *connections)
+{
+  for (GList *l = connections; l; l = l->next)
+    afsocket_accepted_connection_free((AFSocketAcceptedConnection *) l->data, TRUE);
+  g_list_free(connections);
+}
+
+Test(afsocket_accept_queue, test_the_owner_is_asked_once_to_take_the_connections)
+{
+  AFSocketAcceptQueue *queue = afsocket_accept_queue_new();
+  gpointer owner;
+
+  afsocket_accept_queue_attach(queue, &owner_a);
+  cr_assert(afsocket_accept_queue_push(queue, &owner_a, _new_connection()));
+  cr_assert_not(afsocket_accept_queue_push(queue, &owner_a, _new_connection()));
+
+  GList *connections = afsocket_accept_queue_take_all(queue, &owner);
+  cr_assert_eq(owner, &owner_a);
+  cr_assert_eq(g_list_length(connections), 2);
+  for (GList *l = connections; l; l = l->next)
+    cr_assert(((AFSocketAcceptedConnection *) l->data)->reserved);
+  _free_connections(connections);
+
+  cr_assert_null(afsocket_accept_queue_take_all(queue, &owner));
+  cr_assert(afsocket_accept_queue_push(queue, &owner_a, _new_connection()));
+
+  afsocket_accept_queue_unref(queue);
+}
+
+Test(afsocket_accept_queue, test_connections_accepted_during_a_reload_wait_for_the_next_owner)
+{
+  AFSocketAcceptQueue *queue = afsocket_accept_queue_new();
+  gpointer owner;
+
+  afsocket_accept_queue_attach(queue, &owner_a);
+  cr_assert(afsocket_accept_queue_push(queue, &owner_a, _new_connection()));
+  afsocket_accept_queue_detach(queue);
+
+  /* accepted by a listener of the old configuration, not stopped yet */
+  cr_assert_not(afsocket_accept_queue_push(queue, &owner_a, _new_connection()));
+  cr_assert_null(afsocket_accept_queue_take_all(queue, &owner));
+  cr_assert_null(owner);
+
+  afsocket_accept_queue_attach(queue, &owner_b);
+  GList *connections = afsocket_accept_queue_take_all(queue, &owner);
+  cr_assert_eq(owner, &owner_b);
+  cr_assert_eq(g_list_length(connections), 2);
+
+  /* the slots were reserved in the counter of the previous owner */
+  for (GList *l = connections; l; l = l->next)
+    cr_assert_not(((AFSocketAcceptedConnection *) l->data)->reserved);
+  _free_connections(connections);
+
+  afsocket_accept_queue_unref(queue);
+}
+
+Test(afsocket_accept_queue, test_slot_reserved_by_another_driver_is_not_kept)
+{
+  AFSocketAcceptQueue *queue = afsocket_accept_queue_new();
+  gpointer owner;
+
+  afsocket_accept_queue_attach(queue, &owner_b);
+  afsocket_accept_queue_push(queue, &owner_a, _new_connection());
+
+  GList *connections = afsocket_accept_queue_take_all(queue, &owner);
+  cr_assert_eq(g_list_length(connections), 1);
+  cr_assert_not(((AFSocketAcceptedConnection *) connections->data)->reserved);
+  _free_connections(connections);
+
+  afsocket_accept_queue_unref(queue);
+}
+
+Test(afsocket_accept_queue, test_connections_left_in_the_queue_are_closed)
+{
+  AFSocketAcceptQueue *queue = afsocket_accept_queue_new();
+  AFSocketAcceptedConnection *connection = _new_connection();
+  gint fd = connection->fd;
+
+  afsocket_accept_queue_push(queue, &owner_a, connection);
+  cr_assert(_is_fd_open(fd));
+
+  afsocket_accept_queue_unref(queue);
+  cr_assert_not(_is_fd_open(fd));
+}
+
+#define PUSHING_THREADS 4
+#define CONNECTIONS_PER_THREAD 100
+
+static gpointer
+_push_connections(gpointer s)
+{
+  AFSocketAcceptQueue *queue = (AFSocketAcceptQueue *) s;
+
+  for (gint i = 0; i < CONNECTIONS_PER_THREAD; i++)
+    afsocket_accept_queue_push(queue, &owner_a, _new_connection());
+  return NULL;
+}
+
+Test(afsocket_accept_queue, test_connections_pushed_by_several_reactors_are_all_taken)
+{
+  AFSocketAcceptQueue *queue = afsocket_accept_queue_new();
+  GThread *threads[PUSHING_THREADS];
+  gint taken = 0;
+  gpointer owner;
+
+  afsocket_accept_queue_attach(queue, &owner_a);
+  for (gint i = 0; i < PUSHING_THREADS; i++)
+    threads[i] = g_thread_new("push", _push_connections, queue);
+
+  while (taken < PUSHING_THREADS * CONNECTIONS_PER_THREAD)
+    {
+      GList *connections = afsocket_accept_queue_take_all(queue, &owner);
+
+      taken += g_list_length(connections);
+      _free_connections(connections);
+    }
+
+  for (gint i = 0; i < PUSHING_THREADS; i++)
+    g_thread_join(threads[i]);
+
+  cr_assert_null(afsocket_accept_queue_take_all(queue, &owner));
+  afsocket_accept_queue_unref(queue);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  peer_addr = g_sockaddr_inet_new("127.0.0.1", 5140);
+  local_addr = g_sockaddr_inet_new("127.0.0.1", 514);
+}
+
+static void
+teardown(void)
+{
+  g_sockaddr_unref(peer_addr);
+  g_sockaddr_unref(local_addr);
+  app_shutdown();
+}
+
+TestSuite(afsocket_accept_queue, .init = setup, .fini = teardown);
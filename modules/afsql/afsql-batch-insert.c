@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include "afsql-batch-insert.h"
+
+#include <string.h>
+
+#define ROW_SEPARATOR ", "
+
+void
+afsql_batch_insert_init(AFSqlBatchInsert *self)
+{
+  self->command = g_string_sized_new(1024);
+  self->table = g_string_sized_new(32);
+  self->rows = 0;
+  self->max_rows = 0;
+  self->max_bytes = 0;
+}
+
+void
+afsql_batch_insert_clear(AFSqlBatchInsert *self)
+{
+  g_string_free(self->command, TRUE);
+  g_string_free(self->table, TRUE);
+}
+
+void
+afsql_batch_insert_reset(AFSqlBatchInsert *self)
+{
+  g_string_truncate(self->command, 0);
+  g_string_truncate(self->table, 0);
+  self->rows = 0;
+}
+
+void
+afsql_batch_insert_set_limits(AFSqlBatchInsert *self, gint max_rows, gsize max_bytes)
+{
+  self->max_rows = max_rows;
+  self->max_bytes = max_bytes;
+}
+
+/*
+ * Returns FALSE if the statement has to be sent before a row of row_len
+ * bytes can be added for table: a single INSERT can only target one
+ * table and has to stay within the limits.
+ */
+gboolean
+afsql_batch_insert_has_room(AFSqlBatchInsert *self, const gchar *table, gsize row_len)
+{
+  if (self->rows == 0)
+    return TRUE;
+
+  if (strcmp(self->table->str, table) != 0)
+    return FALSE;
+
+  if (self->max_rows > 0 && self->rows >= self->max_rows)
+    return FALSE;
+
+  if (self->max_bytes > 0 && self->command->len + strlen(ROW_SEPARATOR) + row_len > self->max_bytes)
+    return FALSE;
+
+  return TRUE;
+}
+
+void
+afsql_batch_insert_start(AFSqlBatchInsert *self, const gchar *table, const gchar *header)
+{
+  g_assert(self->rows == 0);
+
+  g_string_assign(self->table, table);
+  g_string_assign(self->command, header);
+}
+
+void
+afsql_batch_insert_add_row(AFSqlBatchInsert *self, const gchar *row, gsize row_len)
+{
+  if (self->rows > 0)
+    g_string_append(self->command, ROW_SEPARATOR);
+
+  g_string_append_len(self->command, row, row_len);
+  self->rows++;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#ifndef AFSQL_BATCH_INSERT_H_INCLUDED
+#define AFSQL_BATCH_INSERT_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/*
+ * Collects the rows of a batch into a single multi-row INSERT statement.
+ *
+ * Databases limit the size of a statement (MSSQL accepts at most 1000
+ * rows in a VALUES list, MySQL rejects packets above max_allowed_packet,
+ * SQLite statements above SQLITE_MAX_SQL_LENGTH), so a statement is
+ * considered full once it reaches max_rows rows or appending the next row
+ * would make it longer than max_bytes.  A limit of 0 means unlimited.  A
+ * single row longer than max_bytes is still accepted into an empty
+ * statement.
+ */
+typedef struct _AFSqlBatchInsert
+{
+  GString *command;
+  GString *table;
+  gint rows;
+
+  gint max_rows;
+  gsize max_bytes;
+} AFSqlBatchInsert;
+
+void afsql_batch_insert_init(AFSqlBatchInsert *self);
+void afsql_batch_insert_clear(AFSqlBatchInsert *self);
+void afsql_batch_insert_reset(AFSqlBatchInsert *self);
+void afsql_batch_insert_set_limits(AFSqlBatchInsert *self, gint max_rows, gsize max_bytes);
+
+gboolean afsql_batch_insert_has_room(AFSqlBatchInsert *self, const gchar *table, gsize row_len);
+void afsql_batch_insert_start(AFSqlBatchInsert *self, const gchar *table, const gchar *header);
+void afsql_batch_insert_add_row(AFSqlBatchInsert *self, const gchar *row, gsize row_len);
+
+static inline gboolean
+afsql_batch_insert_is_empty(AFSqlBatchInsert *self)
+{
+  return self->rows == 0;
+}
+
+#endif
@@ -54,6 +54,8 @@ static CfgLexerKeyword afsql_keywords[] =
   { "flags",              KW_FLAGS },
   { "create_statement_append", KW_CREATE_STATEMENT_APPEND },
   { "ignore_tns_config",  KW_IGNORE_TNS_CONFIG },
+  { "multi_row_insert_max_rows", KW_MULTI_ROW_INSERT_MAX_ROWS },
+  { "multi_row_insert_max_bytes", KW_MULTI_ROW_INSERT_MAX_BYTES },
 
   { "dbd_option",         KW_DBD_OPTION },
   { NULL }
@@ -183,6 +183,22 @@ afsql_dd_set_ignore_tns_config(LogDriver *s, const gboolean ignore_tns_config)
   self->ignore_tns_config = ignore_tns_config;
 }
 
+void
+afsql_dd_set_multi_row_insert_max_rows(LogDriver *s, gint max_rows)
+{
+  AFSqlDestDriver *self = (AFSqlDestDriver *) s;
+
+  self->multi_row_insert_max_rows = max_rows;
+}
+
+void
+afsql_dd_set_multi_row_insert_max_bytes(LogDriver *s, gint max_bytes)
+{
+  AFSqlDestDriver *self = (AFSqlDestDriver *) s;
+
+  self->multi_row_insert_max_bytes = max_bytes;
+}
+
 void
 afsql_dd_set_session_statements(LogDriver *s, GList *session_statements)
 {
@@ -283,11 +299,19 @@ afsql_dd_commit_transaction(AFSqlDestDriver *self)
  *
  * NOTE: This function can only be called from the database thread.
  **/
+static void
+afsql_dd_reset_batch_insert(AFSqlDestDriver *self)
+{
+  afsql_batch_insert_reset(&self->batch_insert);
+}
+
 static gboolean
 afsql_dd_begin_transaction(AFSqlDestDriver *self)
 {
   gboolean success = TRUE;
   const char *s_begin = "BEGIN";
+
+  afsql_dd_reset_batch_insert(self);
   if (!strcmp(self->type, s_freetds))
     {
       /* the mssql requires this command */
@@ -744,6 +768,7 @@ afsql_dd_disconnect(LogThreadedDestDriver *s)
 
   dbi_conn_close(self->dbi_ctx);
   self->dbi_ctx = NULL;
+  afsql_dd_reset_batch_insert(self);
 }
 
 static GString *
@@ -766,14 +791,12 @@ afsql_dd_ensure_accessible_database_table(AFSqlDestDriver *self, LogMessage *msg
   return table;
 }
 
-static GString *
-afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+static void
+afsql_dd_append_insert_command_header(AFSqlDestDriver *self, GString *insert_command, GString *table)
 {
-  GString *insert_command = g_string_sized_new(256);
-  GString *value = g_string_sized_new(512);
   gint i, j;
 
-  g_string_printf(insert_command, "INSERT INTO %s (", table->str);
+  g_string_append_printf(insert_command, "INSERT INTO %s (", table->str);
 
   for (i = 0; i < self->fields_len; i++)
     {
@@ -790,8 +813,16 @@ afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *t
         }
     }
 
-  g_string_append(insert_command, ") VALUES (");
+  g_string_append(insert_command, ") VALUES ");
+}
+
+static void
+afsql_dd_append_insert_command_row(AFSqlDestDriver *self, GString *insert_command, LogMessage *msg)
+{
+  GString *value = g_string_sized_new(512);
+  gint i, j;
 
+  g_string_append_c(insert_command, '(');
   for (i = 0; i < self->fields_len; i++)
     {
       gchar *quoted;
@@ -826,9 +857,18 @@ afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *t
         }
     }
 
-  g_string_append(insert_command, ")");
+  g_string_append_c(insert_command, ')');
 
   g_string_free(value, TRUE);
+}
+
+static GString *
+afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+{
+  GString *insert_command = g_string_sized_new(256);
+
+  afsql_dd_append_insert_command_header(self, insert_command, table);
+  afsql_dd_append_insert_command_row(self, insert_command, msg);
 
   return insert_command;
 }
@@ -839,6 +879,12 @@ afsql_dd_is_transaction_handling_enabled(const AFSqlDestDriver *self)
   return !!(self->flags & AFSQL_DDF_EXPLICIT_COMMITS);
 }
 
+static inline gboolean
+afsql_dd_is_multi_row_insert_enabled(const AFSqlDestDriver *self)
+{
+  return !!(self->flags & AFSQL_DDF_MULTI_ROW_INSERTS);
+}
+
 static inline gboolean
 afsql_dd_should_begin_new_transaction(const AFSqlDestDriver *self)
 {
@@ -886,6 +932,60 @@ afsql_dd_handle_insert_row_error_depending_on_connection_availability(AFSqlDestD
   return LTR_ERROR;
 }
 
+/**
+ * afsql_dd_run_batch_insert:
+ *
+ * Send the rows collected in batch_insert to the database as a
+ * single INSERT statement.
+ *
+ * NOTE: This function can only be called from the database thread.
+ **/
+static gboolean
+afsql_dd_run_batch_insert(AFSqlDestDriver *self)
+{
+  if (afsql_batch_insert_is_empty(&self->batch_insert))
+    return TRUE;
+
+  msg_debug("Inserting rows collected in the current batch",
+            evt_tag_str("table", self->batch_insert.table->str),
+            evt_tag_int("rows", self->batch_insert.rows),
+            evt_tag_int("length", self->batch_insert.command->len));
+
+  gboolean success = afsql_dd_run_query(self, self->batch_insert.command->str, FALSE, NULL);
+  afsql_dd_reset_batch_insert(self);
+  return success;
+}
+
+static gboolean
+afsql_dd_add_row_to_batch_insert(AFSqlDestDriver *self, GString *table, LogMessage *msg)
+{
+  GString *row = g_string_sized_new(256);
+  gboolean success = TRUE;
+
+  afsql_dd_append_insert_command_row(self, row, msg);
+
+  /* send what we have if the row targets a different table or would not
+   * fit into the statement */
+  if (!afsql_batch_insert_has_room(&self->batch_insert, table->str, row->len))
+    success = afsql_dd_run_batch_insert(self);
+
+  if (success)
+    {
+      if (afsql_batch_insert_is_empty(&self->batch_insert))
+        {
+          GString *header = g_string_sized_new(256);
+
+          afsql_dd_append_insert_command_header(self, header, table);
+          afsql_batch_insert_start(&self->batch_insert, table->str, header->str);
+          g_string_free(header, TRUE);
+        }
+      afsql_batch_insert_add_row(&self->batch_insert, row->str, row->len);
+    }
+
+  g_string_free(row, TRUE);
+  return success;
+}
+
 static LogThreadedResult
 afsql_dd_flush(LogThreadedDestDriver *s)
 {
@@ -894,6 +994,13 @@ afsql_dd_flush(LogThreadedDestDriver *s)
   if (!afsql_dd_is_transaction_handling_enabled(self))
     return LTR_SUCCESS;
 
+  if (!afsql_dd_run_batch_insert(self))
+    {
+      LogThreadedResult retval = afsql_dd_handle_insert_row_error_depending_on_connection_availability(self);
+      afsql_dd_rollback_transaction(self);
+      return retval;
+    }
+
   if (!afsql_dd_commit_transaction(self))
     {
       /* Assuming that in case of error, the queue is rewound by afsql_dd_commit_transaction() */
@@ -908,6 +1015,9 @@ afsql_dd_run_insert_query(AFSqlDestDriver *self, GString *table, LogMessage *msg
 {
   GString *insert_command;
 
+  if (afsql_dd_is_multi_row_insert_enabled(self))
+    return afsql_dd_add_row_to_batch_insert(self, table, msg);
+
   insert_command = afsql_dd_build_insert_command(self, msg, table);
   gboolean success = afsql_dd_run_query(self, insert_command->str, FALSE, NULL);
   g_string_free(insert_command, TRUE);
@@ -1109,6 +1219,46 @@ _initialize_dbi(void)
   return TRUE;
 }
 
+/*
+ * The defaults stay below the limits of the database servers:
+ *   - MSSQL accepts at most 1000 rows in a VALUES list,
+ *   - SQLite statements are limited to SQLITE_MAX_SQL_LENGTH (1000000
+ *     bytes), and older versions handle at most 500 rows
+ *     (SQLITE_MAX_COMPOUND_SELECT),
+ *   - MySQL rejects packets above max_allowed_packet (4MB by default in
+ *     5.7, 64MB in 8.0).
+ */
+static void
+afsql_dd_get_default_multi_row_insert_limits(AFSqlDestDriver *self, gint *max_rows, gint *max_bytes)
+{
+  *max_rows = 0;
+  *max_bytes = 1024 * 1024;
+
+  if (strcmp(self->type, s_freetds) == 0)
+    {
+      *max_rows = 1000;
+    }
+  else if (strcmp(self->type, "sqlite") == 0 || strcmp(self->type, "sqlite3") == 0)
+    {
+      *max_rows = 500;
+      *max_bytes = 1000000;
+    }
+}
+
+static void
+afsql_dd_init_multi_row_insert_limits(AFSqlDestDriver *self)
+{
+  gint max_rows, max_bytes;
+
+  afsql_dd_get_default_multi_row_insert_limits(self, &max_rows, &max_bytes);
+  if (self->multi_row_insert_max_rows >= 0)
+    max_rows = self->multi_row_insert_max_rows;
+  if (self->multi_row_insert_max_bytes >= 0)
+    max_bytes = self->multi_row_insert_max_bytes;
+
+  afsql_batch_insert_set_limits(&self->batch_insert, max_rows, max_bytes);
+}
+
 static gboolean
 afsql_dd_init(LogPipe *s)
 {
@@ -1141,6 +1291,24 @@ afsql_dd_init(LogPipe *s)
 
   log_template_options_init(&self->template_options, cfg);
 
+  if (afsql_dd_is_multi_row_insert_enabled(self) && !afsql_dd_is_transaction_handling_enabled(self))
+    {
+      msg_warning("WARNING: flags(multi-row-inserts) requires flags(explicit-commits), "
+                  "inserting rows one-by-one",
+                  evt_tag_str("type", self->type));
+      self->flags &= ~AFSQL_DDF_MULTI_ROW_INSERTS;
+    }
+
+  if (afsql_dd_is_multi_row_insert_enabled(self) && strcmp(self->type, s_oracle) == 0)
+    {
+      msg_warning("WARNING: flags(multi-row-inserts) is not supported by Oracle, inserting rows one-by-one",
+                  evt_tag_str("type", self->type));
+      self->flags &= ~AFSQL_DDF_MULTI_ROW_INSERTS;
+    }
+
+  if (afsql_dd_is_multi_row_insert_enabled(self))
+    afsql_dd_init_multi_row_insert_limits(self);
+
   if (afsql_dd_is_transaction_handling_enabled(self))
     log_threaded_dest_driver_set_batch_lines((LogDriver *)self, _batch_lines(self));
 
@@ -1181,6 +1349,7 @@ afsql_dd_free(LogPipe *s)
   g_hash_table_destroy(self->dbd_options_numeric);
   if (self->session_statements)
     string_list_free(self->session_statements);
+  afsql_batch_insert_clear(&self->batch_insert);
   log_threaded_dest_driver_free(s);
 }
 
@@ -1216,6 +1385,10 @@ afsql_dd_new(GlobalConfig *cfg)
 
   self->session_statements = NULL;
 
+  self->multi_row_insert_max_rows = -1;
+  self->multi_row_insert_max_bytes = -1;
+  afsql_batch_insert_init(&self->batch_insert);
+
   self->syslogng_conform_tables = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
   self->dbd_options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
   self->dbd_options_numeric = g_hash_table_new_full(g_str_hash, g_int_equal, g_free, NULL);
@@ -1233,6 +1406,8 @@ afsql_dd_lookup_flag(const gchar *flag)
     return AFSQL_DDF_EXPLICIT_COMMITS;
   else if (strcmp(flag, "dont-create-tables") == 0)
     return AFSQL_DDF_DONT_CREATE_TABLES;
+  else if (strcmp(flag, "multi-row-inserts") == 0)
+    return AFSQL_DDF_MULTI_ROW_INSERTS;
   else
     msg_warning("Unknown SQL flag",
                 evt_tag_str("flag", flag));
@@ -27,6 +27,7 @@
 #include "logthrdest/logthrdestdrv.h"
 #include "mainloop-worker.h"
 #include "string-list.h"
+#include "afsql-batch-insert.h"
 
 #include <dbi.h>
 
@@ -46,6 +47,7 @@ enum
 {
   AFSQL_DDF_EXPLICIT_COMMITS = 0x0001,
   AFSQL_DDF_DONT_CREATE_TABLES = 0x0002,
+  AFSQL_DDF_MULTI_ROW_INSERTS = 0x0004,
 };
 
 typedef struct _AFSqlField
@@ -89,6 +91,9 @@ typedef struct _AFSqlDestDriver
   gint flags;
   gboolean ignore_tns_config;
   GList *session_statements;
+  /* -1 selects the default of the database type */
+  gint multi_row_insert_max_rows;
+  gint multi_row_insert_max_bytes;
 
   LogTemplateOptions template_options;
 
@@ -100,6 +105,9 @@ typedef struct _AFSqlDestDriver
   GHashTable *syslogng_conform_tables;
   guint32 failed_message_counter;
   gboolean transaction_active;
+
+  /* multi-row INSERT statement collecting the rows of the current batch */
+  AFSqlBatchInsert batch_insert;
 } AFSqlDestDriver;
 
 
@@ -123,5 +131,7 @@ gint afsql_dd_lookup_flag(const gchar *flag);
 void afsql_dd_add_dbd_option(LogDriver *s, const gchar *name, const gchar *value);
 void afsql_dd_add_dbd_option_numeric(LogDriver *s, const gchar *name, gint value);
 void afsql_dd_set_ignore_tns_config(LogDriver *s, const gboolean ignore_tns_config);
+void afsql_dd_set_multi_row_insert_max_rows(LogDriver *s, gint max_rows);
+void afsql_dd_set_multi_row_insert_max_bytes(LogDriver *s, gint max_bytes);
 
 #endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include <criterion/criterion.h>
+
+#include "afsql-batch-insert.h"
+
+#include <string.h>
+
+#define HEADER "INSERT INTO messages (host, msg) VALUES "
+#define ROW "('host', 'message')"
+
+static AFSqlBatchInsert batch;
+
+/* adds a row the way afsql does: the statement is sent (returned and reset) if it is full */
+static gboolean
+_add_row(const gchar *table, const gchar *row, GString *sent)
+{
+  gboolean flushed = FALSE;
+
+  if (!afsql_batch_insert_has_room(&batch, table, strlen(row)))
+    {
+      g_string_assign(sent, batch.command->str);
+      afsql_batch_insert_reset(&batch);
+      flushed = TRUE;
+    }
+
+  if (afsql_batch_insert_is_empty(&batch))
+    afsql_batch_insert_start(&batch, table, HEADER);
+  afsql_batch_insert_add_row(&batch, row, strlen(row));
+  return flushed;
+}
+
+Test(afsql_batch_insert, test_rows_are_collected_into_a_single_statement)
+{
+  GString *sent = g_string_new("");
+
+  cr_assert(afsql_batch_insert_is_empty(&batch));
+  for (gint i = 0; i < 3; i++)
+    cr_assert_not(_add_row("messages", ROW, sent));
+
+  cr_assert_eq(batch.rows, 3);
+  cr_assert_str_eq(batch.command->str, HEADER ROW ", " ROW ", " ROW);
+  g_string_free(sent, TRUE);
+}
+
+Test(afsql_batch_insert, test_statement_is_split_at_max_rows)
+{
+  GString *sent = g_string_new("");
+
+  afsql_batch_insert_set_limits(&batch, 2, 0);
+
+  cr_assert_not(_add_row("messages", ROW, sent));
+  cr_assert_not(_add_row("messages", ROW, sent));
+  cr_assert(_add_row("messages", ROW, sent));
+
+  cr_assert_str_eq(sent->str, HEADER ROW ", " ROW);
+  cr_assert_str_eq(batch.command->str, HEADER ROW);
+  cr_assert_eq(batch.rows, 1);
+  g_string_free(sent, TRUE);
+}
+
+Test(afsql_batch_insert, test_statement_is_split_before_exceeding_max_bytes)
+{
+  GString *sent = g_string_new("");
+  gsize two_rows_len = strlen(HEADER ROW ", " ROW);
+
+  afsql_batch_insert_set_limits(&batch, 0, two_rows_len);
+
+  cr_assert_not(_add_row("messages", ROW, sent));
+  cr_assert_not(_add_row("messages", ROW, sent));
+  cr_assert_eq(batch.command->len, two_rows_len);
+
+  cr_assert(_add_row("messages", ROW, sent));
+  cr_assert_str_eq(sent->str, HEADER ROW ", " ROW);
+  cr_assert_eq(batch.rows, 1);
+  g_string_free(sent, TRUE);
+}
+
+Test(afsql_batch_insert, test_row_longer_than_max_bytes_is_sent_on_its_own)
+{
+  GString *sent = g_string_new("");
+
+  afsql_batch_insert_set_limits(&batch, 0, 10);
+
+  cr_assert_not(_add_row("messages", ROW, sent));
+  cr_assert_eq(batch.rows, 1);
+
+  cr_assert(_add_row("messages", ROW, sent));
+  cr_assert_str_eq(sent->str, HEADER ROW);
+  cr_assert_eq(batch.rows, 1);
+  g_string_free(sent, TRUE);
+}
+
+Test(afsql_batch_insert, test_statement_is_split_when_the_table_changes)
+{
+  GString *sent = g_string_new("");
+
+  cr_assert_not(_add_row("messages", ROW, sent));
+  cr_assert(_add_row("messages_2021", ROW, sent));
+
+  cr_assert_str_eq(sent->str, HEADER ROW);
+  cr_assert_str_eq(batch.table->str, "messages_2021");
+  g_string_free(sent, TRUE);
+}
+
+Test(afsql_batch_insert, test_reset_empties_the_statement)
+{
+  GString *sent = g_string_new("");
+
+  _add_row("messages", ROW, sent);
+  afsql_batch_insert_reset(&batch);
+
+  cr_assert(afsql_batch_insert_is_empty(&batch));
+  cr_assert_str_eq(batch.command->str, "");
+  cr_assert(afsql_batch_insert_has_room(&batch, "other", 1000000));
+  g_string_free(sent, TRUE);
+}
+
+static void
+setup(void)
+{
+  afsql_batch_insert_init(&batch);
+}
+
+static void
+teardown(void)
+{
+  afsql_batch_insert_clear(&batch);
+}
+
+TestSuite(afsql_batch_insert, .init = setup, .fini = teardown);
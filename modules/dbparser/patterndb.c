@@ -38,6 +38,7 @@
 #include "logpipe.h"
 #include "timeutils/cache.h"
 #include "timeutils/misc.h"
+#include "atomic-gssize.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -48,6 +49,9 @@ static NVHandle context_id_handle = 0;
 
 #define EXPECTED_NUMBER_OF_MESSAGES_EMITTED 32
 
+/* number of independently locked partitions of the correlation state */
+#define PDB_CORRELATION_SHARDS 32
+
 typedef struct _PDBProcessParams
 {
   PDBRule *rule;
@@ -57,22 +61,82 @@ typedef struct _PDBProcessParams
   gpointer emitted_messages[EXPECTED_NUMBER_OF_MESSAGES_EMITTED];
   GPtrArray *emitted_messages_overflow;
   gint num_emitted_messages;
+
+  /* contexts created by create-context actions, to be added to their
+   * shards once the lock of the current shard is released */
+  GList *pending_contexts;
 } PDBProcessParams;
 
+/* A partition of the correlation state, a CorrelationKey is always mapped
+ * to the same shard. Each shard has its own timer wheel, all of them are
+ * kept at the same time (PatternDB->now) */
+typedef struct _PDBCorrelationShard
+{
+  GMutex lock;
+  PatternDB *pdb;
+  CorrelationState correlation;
+  TimerWheel *timer_wheel;
+} PDBCorrelationShard;
+
+/*
+ * Locking
+ * =======
+ *
+ *   - lock: protects the ruleset, it is only write-locked during reload
+ *
+ *   - shards[].lock: protects the correlation contexts and the timer wheel
+ *     of the given shard, messages with different correlation keys are
+ *     processed in parallel as long as they map to different shards
+ *
+ *   - time_lock: serializes advancing the time, which updates the timer
+ *     wheels of all shards one-by-one
+ *
+ *   - rate_limits_lock: protects rate_limits
+ *
+ * lock is never held together with the others.  The rest are acquired in
+ * this order:
+ *
+ *   time_lock -> shards[].lock -> rate_limits_lock
+ *
+ * Rate limits are checked while the actions of a rule are executed, with
+ * the lock of the shard holding the context (and time_lock, when the
+ * actions are triggered by a timeout) already held.  No other lock is
+ * taken with rate_limits_lock held, nor is time_lock taken with a shard
+ * lock held.  Only one shard lock is held at a time, except in
+ * _lock_state(), which takes all of them in index order.
+ */
 struct _PatternDB
 {
   GRWLock lock;
   PDBRuleSet *ruleset;
-  CorrelationState correlation;
+  PDBCorrelationShard shards[PDB_CORRELATION_SHARDS];
   LogTemplate *program_template;
+  GMutex rate_limits_lock;
   GHashTable *rate_limits;
-  TimerWheel *timer_wheel;
+
+  GMutex time_lock;
+  /* the current time of the correlation engine */
+  atomic_gssize now;
+  /* the system time (in seconds) when the last message was processed */
+  atomic_gssize last_message_time;
   GTimeVal last_tick;
 
   PatternDBEmitFunc emit;
   gpointer emit_data;
 };
 
+static inline guint64
+_get_time(PatternDB *self)
+{
+  return (guint64) atomic_gssize_get(&self->now);
+}
+
+static inline PDBCorrelationShard *
+_lookup_shard(PatternDB *self, const CorrelationKey *key)
+{
+  return &self->shards[correlation_key_hash(key) % PDB_CORRELATION_SHARDS];
+}
+
 static inline gpointer
 _piggy_back_log_message_pointer_with_synthetic_value(LogMessage *msg, gboolean synthetic)
 {
@@ -194,6 +258,7 @@ _flush_emitted_messages(PatternDB *self, PDBProcessParams *process_params)
  * Rule evaluation
  *********************************************/
 
+/* NOTE: called with the lock of the current shard held, see the lock order above */
 static gboolean
 _is_action_within_rate_limit(PatternDB *db, PDBProcessParams *process_params)
 {
@@ -212,6 +277,7 @@ _is_action_within_rate_limit(PatternDB *db, PDBProcessParams *process_params)
   g_string_printf(buffer, "%s:%d", rule->rule_id, action->id);
   correlation_key_init(&key, rule->context.scope, msg, buffer->str);
 
+  g_mutex_lock(&db->rate_limits_lock);
   rl = g_hash_table_lookup(db->rate_limits, &key);
   if (!rl)
     {
@@ -224,7 +290,7 @@ _is_action_within_rate_limit(PatternDB *db, PDBProcessParams *process_params)
       g_string_free(buffer, TRUE);
     }
 
-  now = timer_wheel_get_time(db->timer_wheel);
+  now = _get_time(db);
   if (rl->last_check == 0)
     {
       rl->last_check = now;
@@ -245,12 +311,15 @@ _is_action_within_rate_limit(PatternDB *db, PDBProcessParams *process_params)
           rl->last_check = now;
         }
     }
+
+  gboolean within_rate_limit = FALSE;
   if (rl->buckets)
     {
       rl->buckets--;
-      return TRUE;
+      within_rate_limit = TRUE;
     }
-  return FALSE;
+  g_mutex_unlock(&db->rate_limits_lock);
+  return within_rate_limit;
 }
 
 static gboolean
@@ -302,8 +371,6 @@ _execute_action_message(PatternDB *db, PDBProcessParams *process_params)
   log_msg_unref(genmsg);
 }
 
-static void pattern_db_expire_entry(TimerWheel *wheel, guint64 now, gpointer user_data, gpointer caller_context);
-
 static void
 _execute_action_create_context(PatternDB *db, PDBProcessParams *process_params)
 {
@@ -339,19 +406,18 @@ _execute_action_create_context(PatternDB *db, PDBProcessParams *process_params)
             evt_tag_str("rule", rule->rule_id),
             evt_tag_str("context", buffer->str),
             evt_tag_int("context_timeout", syn_context->timeout),
-            evt_tag_int("context_expiration", timer_wheel_get_time(db->timer_wheel) + syn_context->timeout));
+            evt_tag_int("context_expiration", _get_time(db) + syn_context->timeout));
 
   correlation_key_init(&key, syn_context->scope, context_msg, buffer->str);
   new_context = pdb_context_new(&key);
-  g_hash_table_insert(db->correlation.state, &new_context->super.key, new_context);
   g_string_free(buffer, FALSE);
 
   g_ptr_array_add(new_context->super.messages, context_msg);
-
-  new_context->super.timer = timer_wheel_add_timer(db->timer_wheel, rule->context.timeout, pattern_db_expire_entry,
-                                                   correlation_context_ref(&new_context->super),
-                                                   (GDestroyNotify) correlation_context_unref);
   new_context->rule = pdb_rule_ref(rule);
+
+  /* the new context may belong to a different shard than the one we are
+   * holding the lock for, it is registered in _flush_process_params() */
+  process_params->pending_contexts = g_list_prepend(process_params->pending_contexts, new_context);
 }
 
 static void
@@ -403,8 +469,8 @@ _execute_rule_actions(PatternDB *db, PDBProcessParams *process_params, PDBAction
  * PatternDB
  *********************************************************/
 
-/* NOTE: this function requires PatternDB reader/writer lock to be
- * write-locked.
+/* NOTE: this function requires the lock of the shard owning the timer
+ * wheel to be held.
  *
  * Currently, it is, as timer_wheel_set_time() is only called with that
  * precondition, and timer-wheel callbacks are only called from within
@@ -415,25 +481,129 @@ static void
 pattern_db_expire_entry(TimerWheel *wheel, guint64 now, gpointer user_data, gpointer caller_context)
 {
   PDBContext *context = user_data;
-  PatternDB *pdb = (PatternDB *) timer_wheel_get_associated_data(wheel);
+  PDBCorrelationShard *shard = (PDBCorrelationShard *) timer_wheel_get_associated_data(wheel);
   LogMessage *msg = correlation_context_get_last_message(&context->super);
   PDBProcessParams *process_params = caller_context;
 
   msg_debug("Expiring patterndb correlation context",
             evt_tag_str("last_rule", context->rule->rule_id),
-            evt_tag_long("utc", timer_wheel_get_time(pdb->timer_wheel)));
+            evt_tag_long("utc", timer_wheel_get_time(wheel)));
   process_params->context = context;
   process_params->rule = context->rule;
   process_params->msg = msg;
 
-  _execute_rule_actions(pdb, process_params, RAT_TIMEOUT);
-  g_hash_table_remove(pdb->correlation.state, &context->super.key);
+  _execute_rule_actions(shard->pdb, process_params, RAT_TIMEOUT);
+  g_hash_table_remove(shard->correlation.state, &context->super.key);
 
   /* pdb_context_free is automatically called when returning from
      this function by the timerwheel code as a destroy notify
      callback. */
 }
 
+/* another thread may have created a context with the same key since the
+ * pending one was created, in that case the pending context is merged
+ * into the existing one instead of replacing it */
+static void
+_merge_pending_context(PDBCorrelationShard *shard, PDBContext *context, PDBContext *pending_context)
+{
+  msg_debug("Correlation context created concurrently, merging the new context into it",
+            evt_tag_str("rule", pending_context->rule->rule_id),
+            evt_tag_str("context", pending_context->super.key.session_id),
+            evt_tag_int("num_messages", context->super.messages->len));
+
+  for (gint i = 0; i < pending_context->super.messages->len; i++)
+    g_ptr_array_add(context->super.messages,
+                    log_msg_ref((LogMessage *) g_ptr_array_index(pending_context->super.messages, i)));
+
+  if (context->super.timer)
+    timer_wheel_mod_timer(shard->timer_wheel, context->super.timer, pending_context->rule->context.timeout);
+  else
+    context->super.timer = timer_wheel_add_timer(shard->timer_wheel, pending_context->rule->context.timeout,
+                                                 pattern_db_expire_entry,
+                                                 correlation_context_ref(&context->super),
+                                                 (GDestroyNotify) correlation_context_unref);
+  if (context->rule != pending_context->rule)
+    {
+      if (context->rule)
+        pdb_rule_unref(context->rule);
+      context->rule = pdb_rule_ref(pending_context->rule);
+    }
+  correlation_context_unref(&pending_context->super);
+}
+
+static void
+_register_pending_context(PatternDB *self, PDBContext *pending_context)
+{
+  PDBCorrelationShard *shard = _lookup_shard(self, &pending_context->super.key);
+  PDBContext *context;
+
+  g_mutex_lock(&shard->lock);
+  context = g_hash_table_lookup(shard->correlation.state, &pending_context->super.key);
+  if (context)
+    {
+      _merge_pending_context(shard, context, pending_context);
+    }
+  else
+    {
+      g_hash_table_insert(shard->correlation.state, &pending_context->super.key, pending_context);
+      pending_context->super.timer = timer_wheel_add_timer(shard->timer_wheel, pending_context->rule->context.timeout,
+                                                           pattern_db_expire_entry,
+                                                           correlation_context_ref(&pending_context->super),
+                                                           (GDestroyNotify) correlation_context_unref);
+    }
+  g_mutex_unlock(&shard->lock);
+}
+
+/* Called at the end of each operation, without holding any of the locks
+ * within PatternDB. */
+static void
+_flush_process_params(PatternDB *self, PDBProcessParams *process_params)
+{
+  /* contexts were prepended, register them in the order of creation */
+  process_params->pending_contexts = g_list_reverse(process_params->pending_contexts);
+  for (GList *l = process_params->pending_contexts; l; l = l->next)
+    _register_pending_context(self, (PDBContext *) l->data);
+  g_list_free(process_params->pending_contexts);
+  process_params->pending_contexts = NULL;
+
+  _flush_emitted_messages(self, process_params);
+}
+
+/* NOTE: time_lock must be held */
+static void
+_set_time(PatternDB *self, guint64 new_time, PDBProcessParams *process_params)
+{
+  /* time is not allowed to go backwards */
+  if (_get_time(self) >= new_time)
+    return;
+
+  atomic_gssize_set(&self->now, (gssize) new_time);
+  for (gint i = 0; i < PDB_CORRELATION_SHARDS; i++)
+    {
+      PDBCorrelationShard *shard = &self->shards[i];
+
+      g_mutex_lock(&shard->lock);
+      timer_wheel_set_time(shard->timer_wheel, new_time, process_params);
+      g_mutex_unlock(&shard->lock);
+    }
+}
+
+/* The system time of the last message is only stored with a second
+ * resolution, to avoid contention, so we round it upwards.  This way
+ * idleness is detected with a delay of at most one second. */
+static void
+_get_last_activity(PatternDB *self, GTimeVal *last_activity)
+{
+  glong last_message_time = (glong) atomic_gssize_get(&self->last_message_time) + 1;
+
+  *last_activity = self->last_tick;
+  if (last_activity->tv_sec < last_message_time)
+    {
+      last_activity->tv_sec = last_message_time;
+      last_activity->tv_usec = 0;
+    }
+}
+
 /*
  * This function can be called any time when pattern-db is not processing
  * messages, but we expect the correlation timer to move forward.  It
@@ -447,19 +617,21 @@ pattern_db_timer_tick(PatternDB *self)
 {
   GTimeVal now;
   glong diff;
+  GTimeVal last_activity;
   PDBProcessParams process_params = {0};
 
-  g_rw_lock_writer_lock(&self->lock);
+  g_mutex_lock(&self->time_lock);
   cached_g_current_time(&now);
-  diff = g_time_val_diff(&now, &self->last_tick);
+  _get_last_activity(self, &last_activity);
+  diff = g_time_val_diff(&now, &last_activity);
 
   if (diff > 1e6)
     {
       glong diff_sec = (glong) (diff / 1e6);
 
-      timer_wheel_set_time(self->timer_wheel, timer_wheel_get_time(self->timer_wheel) + diff_sec, &process_params);
+      _set_time(self, _get_time(self) + diff_sec, &process_params);
       msg_debug("Advancing patterndb current time because of timer tick",
-                evt_tag_long("utc", timer_wheel_get_time(self->timer_wheel)));
+                evt_tag_long("utc", _get_time(self)));
       /* update last_tick, take the fraction of the seconds not calculated into this update into account */
 
       self->last_tick = now;
@@ -474,11 +646,10 @@ pattern_db_timer_tick(PatternDB *self)
       self->last_tick = now;
     }
 
-  g_rw_lock_writer_unlock(&self->lock);
-  _flush_emitted_messages(self, &process_params);
+  g_mutex_unlock(&self->time_lock);
+  _flush_process_params(self, &process_params);
 }
 
-/* NOTE: lock should be acquired for writing before calling this function. */
 static void
 _advance_time_based_on_message(PatternDB *self, PDBProcessParams *process_params, const UnixTime *ls)
 {
@@ -490,28 +661,34 @@ _advance_time_based_on_message(PatternDB *self, PDBProcessParams *process_params
    * correlation engine too much. */
 
   cached_g_current_time(&now);
-  self->last_tick = now;
+  if (atomic_gssize_racy_get(&self->last_message_time) != now.tv_sec)
+    atomic_gssize_set(&self->last_message_time, now.tv_sec);
 
   if (ls->ut_sec < now.tv_sec)
     now.tv_sec = ls->ut_sec;
 
-  timer_wheel_set_time(self->timer_wheel, now.tv_sec, process_params);
+  /* fast path, time only moves forward once per second, no need to
+   * synchronize the shards otherwise */
+  if (_get_time(self) >= now.tv_sec)
+    return;
+
+  g_mutex_lock(&self->time_lock);
+  _set_time(self, now.tv_sec, process_params);
+  g_mutex_unlock(&self->time_lock);
 
   msg_debug("Advancing patterndb current time because of an incoming message",
-            evt_tag_long("utc", timer_wheel_get_time(self->timer_wheel)));
+            evt_tag_long("utc", _get_time(self)));
 }
 
 void
 pattern_db_advance_time(PatternDB *self, gint timeout)
 {
   PDBProcessParams process_params= {0};
-  time_t new_time;
 
-  g_rw_lock_writer_lock(&self->lock);
-  new_time = timer_wheel_get_time(self->timer_wheel) + timeout;
-  timer_wheel_set_time(self->timer_wheel, new_time, &process_params);
-  g_rw_lock_writer_unlock(&self->lock);
-  _flush_emitted_messages(self, &process_params);
+  g_mutex_lock(&self->time_lock);
+  _set_time(self, _get_time(self) + timeout, &process_params);
+  g_mutex_unlock(&self->time_lock);
+  _flush_process_params(self, &process_params);
 }
 
 gboolean
@@ -579,11 +756,11 @@ static void
 _pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_params)
 {
   PDBContext *context = NULL;
+  PDBCorrelationShard *shard = NULL;
   PDBRule *rule = process_params->rule;
   LogMessage *msg = process_params->msg;
   GString *buffer = g_string_sized_new(32);
 
-  g_rw_lock_writer_lock(&self->lock);
   if (rule->context.id_template)
     {
       CorrelationKey key;
@@ -592,16 +769,19 @@ _pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_par
       log_msg_set_value(msg, context_id_handle, buffer->str, -1);
 
       correlation_key_init(&key, rule->context.scope, msg, buffer->str);
-      context = g_hash_table_lookup(self->correlation.state, &key);
+      shard = _lookup_shard(self, &key);
+
+      g_mutex_lock(&shard->lock);
+      context = g_hash_table_lookup(shard->correlation.state, &key);
       if (!context)
         {
           msg_debug("Correlation context lookup failure, starting a new context",
                     evt_tag_str("rule", rule->rule_id),
                     evt_tag_str("context", buffer->str),
                     evt_tag_int("context_timeout", rule->context.timeout),
-                    evt_tag_int("context_expiration", timer_wheel_get_time(self->timer_wheel) + rule->context.timeout));
+                    evt_tag_int("context_expiration", timer_wheel_get_time(shard->timer_wheel) + rule->context.timeout));
           context = pdb_context_new(&key);
-          g_hash_table_insert(self->correlation.state, &context->super.key, context);
+          g_hash_table_insert(shard->correlation.state, &context->super.key, context);
           g_string_steal(buffer);
         }
       else
@@ -610,7 +790,7 @@ _pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_par
                     evt_tag_str("rule", rule->rule_id),
                     evt_tag_str("context", buffer->str),
                     evt_tag_int("context_timeout", rule->context.timeout),
-                    evt_tag_int("context_expiration", timer_wheel_get_time(self->timer_wheel) + rule->context.timeout),
+                    evt_tag_int("context_expiration", timer_wheel_get_time(shard->timer_wheel) + rule->context.timeout),
                     evt_tag_int("num_messages", context->super.messages->len));
         }
 
@@ -618,11 +798,11 @@ _pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_par
 
       if (context->super.timer)
         {
-          timer_wheel_mod_timer(self->timer_wheel, context->super.timer, rule->context.timeout);
+          timer_wheel_mod_timer(shard->timer_wheel, context->super.timer, rule->context.timeout);
         }
       else
         {
-          context->super.timer = timer_wheel_add_timer(self->timer_wheel, rule->context.timeout, pattern_db_expire_entry,
+          context->super.timer = timer_wheel_add_timer(shard->timer_wheel, rule->context.timeout, pattern_db_expire_entry,
                                                        correlation_context_ref(&context->super),
                                                        (GDestroyNotify) correlation_context_unref);
         }
@@ -646,7 +826,8 @@ _pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_par
   _execute_rule_actions(self, process_params, RAT_MATCH);
 
   pdb_rule_unref(rule);
-  g_rw_lock_writer_unlock(&self->lock);
+  if (shard)
+    g_mutex_unlock(&shard->lock);
 
   if (context)
     log_msg_write_protect(msg);
@@ -659,10 +840,8 @@ _pattern_db_advance_time_and_flush_expired(PatternDB *self, LogMessage *msg)
 {
   PDBProcessParams process_params = {0};
 
-  g_rw_lock_writer_lock(&self->lock);
   _advance_time_based_on_message(self, &process_params, &msg->timestamps[LM_TS_STAMP]);
-  g_rw_lock_writer_unlock(&self->lock);
-  _flush_emitted_messages(self, &process_params);
+  _flush_process_params(self, &process_params);
 }
 
 static void
@@ -696,7 +875,7 @@ _pattern_db_process(PatternDB *self, PDBLookupParams *lookup, GArray *dbg_list)
   else
     _pattern_db_process_unmatching_rule(self, process_params);
 
-  _flush_emitted_messages(self, process_params);
+  _flush_process_params(self, process_params);
 
   return process_params->rule != NULL;
 }
@@ -734,10 +913,15 @@ pattern_db_expire_state(PatternDB *self)
 {
   PDBProcessParams process_params = {0};
 
-  g_rw_lock_writer_lock(&self->lock);
-  timer_wheel_expire_all(self->timer_wheel, &process_params);
-  g_rw_lock_writer_unlock(&self->lock);
-  _flush_emitted_messages(self, &process_params);
+  for (gint i = 0; i < PDB_CORRELATION_SHARDS; i++)
+    {
+      PDBCorrelationShard *shard = &self->shards[i];
+
+      g_mutex_lock(&shard->lock);
+      timer_wheel_expire_all(shard->timer_wheel, &process_params);
+      g_mutex_unlock(&shard->lock);
+    }
+  _flush_process_params(self, &process_params);
 
 }
 
@@ -746,28 +930,57 @@ _init_state(PatternDB *self)
 {
   self->rate_limits = g_hash_table_new_full(correlation_key_hash, correlation_key_equal, NULL,
                                             (GDestroyNotify) pdb_rate_limit_free);
-  correlation_state_init_instance(&self->correlation);
-  self->timer_wheel = timer_wheel_new();
-  timer_wheel_set_associated_data(self->timer_wheel, self, NULL);
+  for (gint i = 0; i < PDB_CORRELATION_SHARDS; i++)
+    {
+      PDBCorrelationShard *shard = &self->shards[i];
+
+      correlation_state_init_instance(&shard->correlation);
+      shard->timer_wheel = timer_wheel_new();
+      timer_wheel_set_associated_data(shard->timer_wheel, shard, NULL);
+    }
+  atomic_gssize_set(&self->now, 0);
 }
 
 static void
 _destroy_state(PatternDB *self)
 {
-  if (self->timer_wheel)
-    timer_wheel_free(self->timer_wheel);
+  for (gint i = 0; i < PDB_CORRELATION_SHARDS; i++)
+    {
+      PDBCorrelationShard *shard = &self->shards[i];
+
+      if (shard->timer_wheel)
+        timer_wheel_free(shard->timer_wheel);
+      correlation_state_deinit_instance(&shard->correlation);
+    }
 
   g_hash_table_destroy(self->rate_limits);
-  correlation_state_deinit_instance(&self->correlation);
+}
+
+static void
+_lock_state(PatternDB *self)
+{
+  g_mutex_lock(&self->time_lock);
+  for (gint i = 0; i < PDB_CORRELATION_SHARDS; i++)
+    g_mutex_lock(&self->shards[i].lock);
+  g_mutex_lock(&self->rate_limits_lock);
+}
+
+static void
+_unlock_state(PatternDB *self)
+{
+  g_mutex_unlock(&self->rate_limits_lock);
+  for (gint i = PDB_CORRELATION_SHARDS - 1; i >= 0; i--)
+    g_mutex_unlock(&self->shards[i].lock);
+  g_mutex_unlock(&self->time_lock);
 }
 
 void
 pattern_db_forget_state(PatternDB *self)
 {
-  g_rw_lock_writer_lock(&self->lock);
+  _lock_state(self);
   _destroy_state(self);
   _init_state(self);
-  g_rw_lock_writer_unlock(&self->lock);
+  _unlock_state(self);
 }
 
 PatternDB *
@@ -776,6 +989,13 @@ pattern_db_new(void)
   PatternDB *self = g_new0(PatternDB, 1);
 
   self->ruleset = pdb_rule_set_new();
+  for (gint i = 0; i < PDB_CORRELATION_SHARDS; i++)
+    {
+      g_mutex_init(&self->shards[i].lock);
+      self->shards[i].pdb = self;
+    }
+  g_mutex_init(&self->rate_limits_lock);
+  g_mutex_init(&self->time_lock);
   _init_state(self);
   cached_g_current_time(&self->last_tick);
   g_rw_lock_init(&self->lock);
@@ -789,6 +1009,10 @@ pattern_db_free(PatternDB *self)
   if (self->ruleset)
     pdb_rule_set_free(self->ruleset);
   _destroy_state(self);
+  for (gint i = 0; i < PDB_CORRELATION_SHARDS; i++)
+    g_mutex_clear(&self->shards[i].lock);
+  g_mutex_clear(&self->rate_limits_lock);
+  g_mutex_clear(&self->time_lock);
   g_rw_lock_clear(&self->lock);
   g_free(self);
 }
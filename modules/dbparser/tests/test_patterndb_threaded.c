@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "apphook.h"
+#include "logmsg/logmsg.h"
+#include "patterndb.h"
+#include "plugin.h"
+#include "cfg.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <glib/gstdio.h>
+
+/*
+ * Feeds messages to the same PatternDB instance from multiple threads and
+ * checks that no message is lost from the correlation contexts.
+ */
+
+#define NUM_THREADS 4
+#define CONTEXTS_PER_THREAD 64
+#define MESSAGES_PER_THREAD 2000
+
+#define pdb_threaded_ruleset "<patterndb version='4' pub_date='2010-02-22'>\
+ <ruleset name='testset' id='1'>\
+  <patterns>\
+   <pattern>prog1</pattern>\
+  </patterns>\
+  <rules>\
+    <rule provider='test' id='1' class='system' context-scope='global' context-id='$PID' context-timeout='3600'>\
+     <patterns>\
+      <pattern>correlated-message @NUMBER:seq@</pattern>\
+     </patterns>\
+     <actions>\
+       <action trigger='timeout'>\
+         <message>\
+           <values>\
+             <value name='MESSAGE'>context-closed ${CONTEXT_ID} $(context-length)</value>\
+           </values>\
+         </message>\
+       </action>\
+     </actions>\
+    </rule>\
+    <rule provider='test' id='2' class='system' context-timeout='3600'>\
+     <patterns>\
+      <pattern>create-shared-context</pattern>\
+     </patterns>\
+     <actions>\
+       <action trigger='match'>\
+         <create-context context-id='shared' context-timeout='3600' context-scope='global'>\
+           <message>\
+             <values>\
+               <value name='MESSAGE'>created-context</value>\
+             </values>\
+           </message>\
+         </create-context>\
+       </action>\
+     </actions>\
+    </rule>\
+    <rule provider='test' id='3' class='system' context-scope='global' context-id='shared' context-timeout='3600'>\
+     <patterns>\
+      <pattern>close-shared-context</pattern>\
+     </patterns>\
+     <actions>\
+       <action trigger='timeout'>\
+         <message>\
+           <values>\
+             <value name='MESSAGE'>context-closed ${CONTEXT_ID} $(context-length)</value>\
+           </values>\
+         </message>\
+       </action>\
+     </actions>\
+    </rule>\
+  </rules>\
+ </ruleset>\
+</patterndb>"
+
+typedef struct _FeedState
+{
+  PatternDB *patterndb;
+  gint thread_index;
+} FeedState;
+
+static gint synthetic_messages;
+static gint correlated_messages;
+
+static void
+_emit_func(LogMessage *msg, gboolean synthetic, gpointer user_data)
+{
+  if (!synthetic)
+    return;
+
+  g_atomic_int_inc(&synthetic_messages);
+  g_atomic_int_add(&correlated_messages, atoi(strrchr(log_msg_get_value(msg, LM_V_MESSAGE, NULL), ' ') + 1));
+}
+
+static PatternDB *
+_create_pattern_db(const gchar *pdb, gchar **filename)
+{
+  PatternDB *patterndb = pattern_db_new();
+
+  pattern_db_set_emit_func(patterndb, _emit_func, NULL);
+
+  g_file_open_tmp("patterndbXXXXXX.xml", filename, NULL);
+  g_file_set_contents(*filename, pdb, strlen(pdb), NULL);
+
+  cr_assert(pattern_db_reload_ruleset(patterndb, configuration, *filename), "Error loading ruleset [[[%s]]]",
+            *filename);
+  return patterndb;
+}
+
+static void
+_destroy_pattern_db(PatternDB *patterndb, gchar *filename)
+{
+  pattern_db_free(patterndb);
+  g_unlink(filename);
+  g_free(filename);
+}
+
+static LogMessage *
+_construct_message(const gchar *message, gint pid)
+{
+  LogMessage *msg = log_msg_new_empty();
+  gchar buf[64];
+
+  log_msg_set_value(msg, LM_V_MESSAGE, message, -1);
+  log_msg_set_value(msg, LM_V_PROGRAM, "prog1", -1);
+  log_msg_set_value(msg, LM_V_HOST, "MYHOST", -1);
+
+  g_snprintf(buf, sizeof(buf), "%d", pid);
+  log_msg_set_value(msg, LM_V_PID, buf, -1);
+  msg->timestamps[LM_TS_STAMP].ut_sec = msg->timestamps[LM_TS_RECVD].ut_sec;
+  return msg;
+}
+
+static void
+_process_message(PatternDB *patterndb, const gchar *message, gint pid)
+{
+  LogMessage *msg = _construct_message(message, pid);
+
+  pattern_db_process(patterndb, msg);
+  log_msg_unref(msg);
+}
+
+static gpointer
+_feed_correlated_messages_thread(gpointer user_data)
+{
+  FeedState *state = (FeedState *) user_data;
+  gchar buf[64];
+
+  for (gint i = 0; i < MESSAGES_PER_THREAD; i++)
+    {
+      gint pid = state->thread_index * CONTEXTS_PER_THREAD + (i % CONTEXTS_PER_THREAD);
+
+      g_snprintf(buf, sizeof(buf), "correlated-message %d", i);
+      _process_message(state->patterndb, buf, pid);
+    }
+  return NULL;
+}
+
+static gpointer
+_feed_create_context_thread(gpointer user_data)
+{
+  FeedState *state = (FeedState *) user_data;
+
+  for (gint i = 0; i < MESSAGES_PER_THREAD; i++)
+    _process_message(state->patterndb, "create-shared-context", state->thread_index);
+  return NULL;
+}
+
+static void
+_run_feeders(PatternDB *patterndb, GThreadFunc feed_func)
+{
+  GThread *threads[NUM_THREADS];
+  FeedState states[NUM_THREADS];
+
+  synthetic_messages = 0;
+  correlated_messages = 0;
+
+  for (gint i = 0; i < NUM_THREADS; i++)
+    {
+      states[i].patterndb = patterndb;
+      states[i].thread_index = i;
+      threads[i] = g_thread_new(NULL, feed_func, &states[i]);
+    }
+
+  for (gint i = 0; i < NUM_THREADS; i++)
+    g_thread_join(threads[i]);
+}
+
+Test(pattern_db_threaded, test_correlation_with_multiple_threads)
+{
+  gchar *filename;
+  PatternDB *patterndb = _create_pattern_db(pdb_threaded_ruleset, &filename);
+
+  _run_feeders(patterndb, _feed_correlated_messages_thread);
+  pattern_db_expire_state(patterndb);
+
+  cr_assert_eq(synthetic_messages, NUM_THREADS * CONTEXTS_PER_THREAD,
+               "Unexpected number of closed contexts, expected=%d, actual=%d",
+               NUM_THREADS * CONTEXTS_PER_THREAD, synthetic_messages);
+  cr_assert_eq(correlated_messages, NUM_THREADS * MESSAGES_PER_THREAD,
+               "Messages were lost from correlation contexts, expected=%d, actual=%d",
+               NUM_THREADS * MESSAGES_PER_THREAD, correlated_messages);
+
+  _destroy_pattern_db(patterndb, filename);
+}
+
+Test(pattern_db_threaded, test_create_context_with_the_same_key_from_multiple_threads)
+{
+  gchar *filename;
+  PatternDB *patterndb = _create_pattern_db(pdb_threaded_ruleset, &filename);
+
+  /* contexts created with the same key are merged, none of them may replace another */
+  _run_feeders(patterndb, _feed_create_context_thread);
+  _process_message(patterndb, "close-shared-context", 0);
+  pattern_db_expire_state(patterndb);
+
+  cr_assert_eq(synthetic_messages, 1, "Unexpected number of closed contexts, expected=1, actual=%d",
+               synthetic_messages);
+  cr_assert_eq(correlated_messages, NUM_THREADS * MESSAGES_PER_THREAD + 1,
+               "Messages were lost from the created context, expected=%d, actual=%d",
+               NUM_THREADS * MESSAGES_PER_THREAD + 1, correlated_messages);
+
+  _destroy_pattern_db(patterndb, filename);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  configuration = cfg_new_snippet();
+  cfg_load_module(configuration, "basicfuncs");
+  cfg_load_module(configuration, "syslogformat");
+  pattern_db_global_init();
+}
+
+static void
+teardown(void)
+{
+  cfg_free(configuration);
+  app_shutdown();
+}
+
+TestSuite(pattern_db_threaded, .init = setup, .fini = teardown);
@@ -46,6 +46,20 @@ disk_queue_options_disk_buf_size_set(DiskQueueOptions *self, gint64 disk_buf_siz
   self->disk_buf_size = disk_buf_size;
 }
 
+void
+disk_queue_options_segment_size_set(DiskQueueOptions *self, gint64 segment_size)
+{
+  if (segment_size > 0 && segment_size < MIN_SEGMENT_SIZE)
+    {
+      msg_warning("WARNING: The configured disk buffer segment size is smaller than the minimum allowed",
+                  evt_tag_long("configured_size", segment_size),
+                  evt_tag_long("minimum_allowed_size", MIN_SEGMENT_SIZE),
+                  evt_tag_long("new_size", MIN_SEGMENT_SIZE));
+      segment_size = MIN_SEGMENT_SIZE;
+    }
+  self->segment_size = segment_size;
+}
+
 void
 disk_queue_options_reliable_set(DiskQueueOptions *self, gboolean reliable)
 {
@@ -58,6 +72,12 @@ disk_queue_options_compaction_set(DiskQueueOptions *self, gboolean compaction)
   self->compaction = compaction;
 }
 
+void
+disk_queue_options_compression_set(DiskQueueOptions *self, gboolean compression)
+{
+  self->compression = compression;
+}
+
 void
 disk_queue_options_mem_buf_size_set(DiskQueueOptions *self, gint mem_buf_size)
 {
@@ -121,6 +141,7 @@ void
 disk_queue_options_set_default_options(DiskQueueOptions *self)
 {
   self->disk_buf_size = -1;
+  self->segment_size = 0;
   self->mem_buf_length = -1;
   self->reliable = FALSE;
   self->mem_buf_size = -1;
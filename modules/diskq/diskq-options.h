@@ -28,14 +28,17 @@
 #include "logmsg/logmsg-serialize.h"
 
 #define MIN_DISK_BUF_SIZE 1024*1024
+#define MIN_SEGMENT_SIZE 1024*1024
 
 typedef struct _DiskQueueOptions
 {
   gint64 disk_buf_size;
+  gint64 segment_size;
   gint qout_size;
   gboolean read_only;
   gboolean reliable;
   gboolean compaction;
+  gboolean compression;
   gint mem_buf_size;
   gint mem_buf_length;
   gchar *dir;
@@ -44,8 +47,10 @@ typedef struct _DiskQueueOptions
 
 void disk_queue_options_qout_size_set(DiskQueueOptions *self, gint qout_size);
 void disk_queue_options_disk_buf_size_set(DiskQueueOptions *self, gint64 disk_buf_size);
+void disk_queue_options_segment_size_set(DiskQueueOptions *self, gint64 segment_size);
 void disk_queue_options_reliable_set(DiskQueueOptions *self, gboolean reliable);
 void disk_queue_options_compaction_set(DiskQueueOptions *self, gboolean compaction);
+void disk_queue_options_compression_set(DiskQueueOptions *self, gboolean compression);
 void disk_queue_options_mem_buf_size_set(DiskQueueOptions *self, gint mem_buf_size);
 void disk_queue_options_mem_buf_length_set(DiskQueueOptions *self, gint mem_buf_length);
 void disk_queue_options_check_plugin_settings(DiskQueueOptions *self);
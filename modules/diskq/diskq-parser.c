@@ -33,8 +33,10 @@ static CfgLexerKeyword diskq_keywords[] =
   { "disk_buffer",       KW_DISK_BUFFER },
   { "mem_buf_length",    KW_MEM_BUF_LENGTH },
   { "disk_buf_size",     KW_DISK_BUF_SIZE },
+  { "segment_size",      KW_SEGMENT_SIZE },
   { "reliable",          KW_RELIABLE },
   { "compaction",        KW_COMPACTION },
+  { "compression",       KW_COMPRESSION },
   { "mem_buf_size",      KW_MEM_BUF_SIZE },
   { "qout_size",         KW_QOUT_SIZE },
   { "dir",               KW_DIR },
@@ -50,6 +50,9 @@ gchar *assign_persist_name;
 gboolean relocate_all;
 gboolean display_version;
 gboolean assign_help;
+gint benchmark_count = 100000;
+gint benchmark_batch_size = 100;
+gboolean benchmark_compression;
 
 static GOptionEntry cat_options[] =
 {
@@ -99,6 +102,23 @@ static GOptionEntry assign_options[] =
   { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL }
 };
 
+static GOptionEntry benchmark_options[] =
+{
+  {
+    "count", 'n', 0, G_OPTION_ARG_INT, &benchmark_count,
+    "Number of messages to write and read back, default: 100000", "<count>"
+  },
+  {
+    "batch-size", 'b', 0, G_OPTION_ARG_INT, &benchmark_batch_size,
+    "Number of messages written with a single write, 1 writes them one by one, default: 100", "<size>"
+  },
+  {
+    "compression", 'z', 0, G_OPTION_ARG_NONE, &benchmark_compression,
+    "Compress the records with zstd", NULL
+  },
+  { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL }
+};
+
 static gboolean
 open_queue(char *filename, LogQueue **lq, DiskQueueOptions *options)
 {
@@ -371,6 +391,52 @@ _move_file(const gchar *from, const gchar *to)
     }
 }
 
+static gboolean
+_is_segment_of(const gchar *entry, const gchar *base)
+{
+  gsize base_len = strlen(base);
+
+  if (strncmp(entry, base, base_len) != 0 || entry[base_len] != '.' || !entry[base_len + 1])
+    return FALSE;
+
+  for (const gchar *p = entry + base_len + 1; *p; p++)
+    {
+      if (!g_ascii_isdigit(*p))
+        return FALSE;
+    }
+  return TRUE;
+}
+
+/* a disk queue with a segmented layout keeps its records in <qfile>.<n> files */
+static gboolean
+_move_segment_files(const gchar *qfile, const gchar *relocated_qfile)
+{
+  gchar *dirname = g_path_get_dirname(qfile);
+  gchar *base = g_path_get_basename(qfile);
+  GDir *dir = g_dir_open(dirname, 0, NULL);
+  const gchar *entry;
+  gboolean result = TRUE;
+
+  while (dir && (entry = g_dir_read_name(dir)))
+    {
+      if (!_is_segment_of(entry, base))
+        continue;
+
+      gchar *from = g_build_filename(dirname, entry, NULL);
+      gchar *to = g_strconcat(relocated_qfile, entry + strlen(base), NULL);
+
+      result = _move_file(from, to) && result;
+      g_free(from);
+      g_free(to);
+    }
+
+  if (dir)
+    g_dir_close(dir);
+  g_free(base);
+  g_free(dirname);
+  return result;
+}
+
 static gboolean
 _file_is_diskq(const gchar *filename)
 {
@@ -445,6 +511,8 @@ _relocate_qfile(PersistState *state, const gchar *name)
 
       if (_move_file(qfile, relocated_qfile))
         {
+          if (!_move_segment_files(qfile, relocated_qfile))
+            fprintf(stderr, "Failed to move some of the segment files of %s\n", qfile);
           printf("new qfile_path: %s\n", relocated_qfile);
           persist_state_alloc_string(state, name, relocated_qfile, -1);
         }
@@ -590,6 +658,125 @@ dqtool_assign(int argc, char *argv[])
   return 0;
 }
 
+#define BENCHMARK_MESSAGE \
+  "Accepted publickey for user from 192.168.1.100 port 52314 ssh2: RSA SHA256:n7VkVl6T0yPMOTCk1jq2oAx5b9yW3fX1Wf0qLw0zH6A " \
+  "session opened for user by (uid=0)"
+
+static void
+_print_benchmark_result(const gchar *operation, gint count, gsize record_len, gint64 elapsed_usec)
+{
+  gdouble elapsed_sec = MAX(elapsed_usec, 1) / 1e6;
+
+  printf("%-6s %d messages in %.3f sec, %.0f msg/sec, %.2f MiB/sec\n", operation, count, elapsed_sec,
+         count / elapsed_sec, count * record_len / elapsed_sec / (1024 * 1024));
+}
+
+static gint
+_benchmark_write(QDisk *qdisk, GString *record)
+{
+  gint i;
+
+  for (i = 0; i < benchmark_count; i++)
+    {
+      if (!qdisk_push_tail(qdisk, record))
+        break;
+
+      if ((i + 1) % benchmark_batch_size == 0 && !qdisk_flush(qdisk))
+        break;
+    }
+  qdisk_flush(qdisk);
+  return i;
+}
+
+static gint
+_benchmark_read(QDisk *qdisk)
+{
+  GString *record = g_string_sized_new(1024);
+  LogMessage *msg;
+  gint count = 0;
+
+  while (qdisk_pop_head(qdisk, record))
+    {
+      if (!qdisk_deserialize_msg(qdisk, record, &msg))
+        break;
+
+      log_msg_unref(msg);
+      count++;
+    }
+
+  g_string_free(record, TRUE);
+  return count;
+}
+
+static gint
+dqtool_benchmark(int argc, char *argv[])
+{
+  if (optind >= argc)
+    {
+      fprintf(stderr, "missing disk queue file name\n");
+      return 1;
+    }
+
+  if (benchmark_count <= 0 || benchmark_batch_size <= 0)
+    {
+      fprintf(stderr, "count and batch-size must be positive\n");
+      return 1;
+    }
+
+#if !SYSLOG_NG_ENABLE_ZSTD
+  if (benchmark_compression)
+    {
+      fprintf(stderr, "dqtool was compiled without zstd support\n");
+      return 1;
+    }
+#endif
+
+  const gchar *filename = argv[optind];
+  if (access(filename, F_OK) == 0)
+    {
+      fprintf(stderr, "File already exists, refusing to overwrite it: %s\n", filename);
+      return 1;
+    }
+
+  DiskQueueOptions options = {0};
+  QDisk *qdisk = qdisk_new(&options, "SLRQ");
+  LogMessage *msg = log_msg_new_empty();
+  GString *record = g_string_sized_new(1024);
+  gint result = 1;
+
+  log_msg_set_value(msg, LM_V_MESSAGE, BENCHMARK_MESSAGE, -1);
+  options.compression = benchmark_compression;
+  if (!qdisk_serialize_msg(qdisk, msg, record))
+    goto exit;
+  printf("record size: %" G_GSIZE_FORMAT " bytes\n", record->len);
+
+  options.reliable = TRUE;
+  options.disk_buf_size = QDISK_RESERVED_SPACE + (gint64) record->len * benchmark_count + 1;
+  if (!qdisk_start(qdisk, filename, NULL, NULL, NULL))
+    {
+      fprintf(stderr, "Error creating disk queue file: %s\n", filename);
+      goto exit;
+    }
+
+  gint64 start = g_get_monotonic_time();
+  gint written = _benchmark_write(qdisk, record);
+  _print_benchmark_result("write", written, record->len, g_get_monotonic_time() - start);
+
+  start = g_get_monotonic_time();
+  gint read_count = _benchmark_read(qdisk);
+  _print_benchmark_result("read", read_count, record->len, g_get_monotonic_time() - start);
+
+  qdisk_stop(qdisk);
+  _remove_file(filename);
+  result = (written == benchmark_count && read_count == written) ? 0 : 1;
+
+exit:
+  g_string_free(record, TRUE);
+  log_msg_unref(msg);
+  qdisk_free(qdisk);
+  return result;
+}
+
 static GOptionEntry dqtool_options[] =
 {
   {
@@ -619,6 +806,7 @@ static struct
   { "info", info_options, "Print infos about the given disk queue file", dqtool_info },
   { "relocate", relocate_options, "Relocate(rename) diskq file. Note that this option modifies the persist file.", dqtool_relocate },
   { "assign", assign_options, "Assign diskq file to the given persist file with the given persist name.", dqtool_assign },
+  { "benchmark", benchmark_options, "Measure the write and read throughput of a new reliable disk queue file.", dqtool_benchmark },
   { NULL, NULL },
 };
 
@@ -167,6 +167,9 @@ _move_messages_from_overflow(LogQueueDiskNonReliable *self)
             }
         }
     }
+
+  /* runs in the output thread, write the moved records in one go */
+  log_queue_disk_flush(&self->super);
 }
 
 static gboolean
@@ -444,7 +447,11 @@ _push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
       goto queued;
     }
 
-  if (self->qoverflow->length != 0 || !_push_tail_disk(self, msg, path_options, serialized_msg))
+  if (self->qoverflow->length == 0 && _push_tail_disk(self, msg, path_options, serialized_msg))
+    {
+      log_queue_disk_schedule_flush(&self->super);
+    }
+  else
     {
       if (HAS_SPACE_IN_QUEUE(self->qoverflow))
         {
@@ -357,7 +357,8 @@ _push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
       goto exit;
     }
 
-  log_msg_ack(msg, path_options, AT_PROCESSED);
+  /* the message is safe once its record is in the file */
+  log_queue_disk_ack_when_flushed(&self->super, msg, path_options);
 
   if (_is_space_available_in_qout(self))
     {
@@ -375,6 +376,7 @@ _push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
   log_msg_unref(msg);
 
 exit:
+  log_queue_disk_schedule_flush(&self->super);
   log_queue_push_notify(s);
   log_queue_queued_messages_inc(s);
   g_mutex_unlock(&s->lock);
@@ -417,7 +419,7 @@ static gboolean
 _save_queue(LogQueueDisk *s, gboolean *persistent)
 {
   *persistent = TRUE;
-  qdisk_stop(s->qdisk);
+  log_queue_disk_stop_qdisk(s);
   return TRUE;
 }
 
@@ -79,12 +79,113 @@ log_queue_disk_get_filename(LogQueue *s)
   return qdisk_get_filename(self->qdisk);
 }
 
+static void
+_ack_unflushed_messages(LogQueueDisk *self, AckType ack_type)
+{
+  LogMessage *msg;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  while ((msg = g_queue_pop_head(self->qunflushed)))
+    {
+      POINTER_TO_LOG_PATH_OPTIONS(g_queue_pop_head(self->qunflushed), &path_options);
+      log_msg_ack(msg, &path_options, ack_type);
+      log_msg_unref(msg);
+    }
+}
+
+/*
+ * Writes the records pushed since the last flush to the file.  Must be
+ * called with the queue lock held.
+ *
+ * The messages waiting for the write are acked only if it succeeds.  On
+ * failure the records are kept by qdisk and the write is retried on the
+ * next flush, the messages stay unacked until then, so flow-control
+ * holds back the sources meanwhile.
+ */
+gboolean
+log_queue_disk_flush(LogQueueDisk *self)
+{
+  if (qdisk_started(self->qdisk) && !qdisk_flush(self->qdisk))
+    return FALSE;
+
+  _ack_unflushed_messages(self, AT_PROCESSED);
+  return TRUE;
+}
+
+/*
+ * Stops qdisk after a last attempt to write the pending records.  If that
+ * fails too, the records are dropped and their messages are acked as
+ * aborted.
+ */
 void
-log_queue_disk_free_method(LogQueueDisk *self)
+log_queue_disk_stop_qdisk(LogQueueDisk *self)
 {
+  if (!log_queue_disk_flush(self))
+    _ack_unflushed_messages(self, AT_ABORTED);
+
   qdisk_stop(self->qdisk);
+}
+
+static gpointer
+_flush_at_the_end_of_batch(gpointer user_data)
+{
+  LogQueueDisk *self = (LogQueueDisk *) user_data;
+  gint thread_id = main_loop_worker_get_thread_id();
+
+  g_mutex_lock(&self->super.lock);
+  log_queue_disk_flush(self);
+  g_mutex_unlock(&self->super.lock);
+
+  self->flush_callbacks[thread_id].registered = FALSE;
+  log_queue_unref(&self->super);
+  return NULL;
+}
+
+/*
+ * Records pushed by an input thread are written when the thread finishes
+ * its current batch, so a whole batch needs only one write.  Records
+ * pushed from other threads are written right away.  Must be called with
+ * the queue lock held.
+ */
+void
+log_queue_disk_schedule_flush(LogQueueDisk *self)
+{
+  gint thread_id = main_loop_worker_get_thread_id();
+
+  /* log_queue_max_threads may have been raised since the queue was created */
+  if (thread_id < 0 || thread_id >= self->num_flush_callbacks)
+    {
+      log_queue_disk_flush(self);
+      return;
+    }
+
+  LogQueueDiskFlushCallback *flush_callback = &self->flush_callbacks[thread_id];
+  if (!flush_callback->registered)
+    {
+      /* the queue must be kept alive until the callback runs */
+      main_loop_worker_register_batch_callback(&flush_callback->cb);
+      flush_callback->registered = TRUE;
+      log_queue_ref(&self->super);
+    }
+}
+
+/* holds back the ack of @msg until its record, pushed last, is written to the file */
+void
+log_queue_disk_ack_when_flushed(LogQueueDisk *self, LogMessage *msg, const LogPathOptions *path_options)
+{
+  g_queue_push_tail(self->qunflushed, log_msg_ref(msg));
+  g_queue_push_tail(self->qunflushed, LOG_PATH_OPTIONS_TO_POINTER(path_options));
+}
+
+void
+log_queue_disk_free_method(LogQueueDisk *self)
+{
+  log_queue_disk_stop_qdisk(self);
   qdisk_free(self->qdisk);
 
+  g_queue_free(self->qunflushed);
+  g_free(self->flush_callbacks);
+
   log_queue_free_method(&self->super);
 }
 
@@ -167,7 +268,7 @@ _restart_diskq(LogQueueDisk *self)
   gchar *filename = g_strdup(qdisk_get_filename(self->qdisk));
   DiskQueueOptions *options = qdisk_get_options(self->qdisk);
 
-  qdisk_stop(self->qdisk);
+  log_queue_disk_stop_qdisk(self);
 
   gchar *new_file = g_strdup_printf("%s.corrupted", filename);
   if (rename(filename, new_file) < 0)
@@ -204,4 +305,14 @@ log_queue_disk_init_instance(LogQueueDisk *self, DiskQueueOptions *options, cons
   self->super.type = log_queue_disk_type;
 
   self->qdisk = qdisk_new(options, qdisk_file_id);
+  self->qunflushed = g_queue_new();
+
+  self->num_flush_callbacks = log_queue_max_threads;
+  self->flush_callbacks = g_new0(LogQueueDiskFlushCallback, self->num_flush_callbacks);
+  for (gint i = 0; i < self->num_flush_callbacks; i++)
+    {
+      worker_batch_callback_init(&self->flush_callbacks[i].cb);
+      self->flush_callbacks[i].cb.func = _flush_at_the_end_of_batch;
+      self->flush_callbacks[i].cb.user_data = self;
+    }
 }
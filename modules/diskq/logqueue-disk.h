@@ -28,13 +28,23 @@
 #include "logqueue.h"
 #include "qdisk.h"
 #include "logmsg/logmsg-serialize.h"
+#include "mainloop-worker.h"
 
 typedef struct _LogQueueDisk LogQueueDisk;
 
+typedef struct _LogQueueDiskFlushCallback
+{
+  WorkerBatchCallback cb;
+  gboolean registered;
+} LogQueueDiskFlushCallback;
+
 struct _LogQueueDisk
 {
   LogQueue super;
   QDisk *qdisk;         /* disk based queue */
+  GQueue *qunflushed;   /* messages to be acked once their records are written to the file */
+  LogQueueDiskFlushCallback *flush_callbacks;   /* per input thread */
+  gint num_flush_callbacks;
   gboolean (*save_queue)(LogQueueDisk *s, gboolean *persistent);
   gboolean (*load_queue)(LogQueueDisk *s, const gchar *filename);
   gboolean (*start)(LogQueueDisk *s, const gchar *filename);
@@ -51,6 +61,11 @@ void log_queue_disk_init_instance(LogQueueDisk *self, DiskQueueOptions *options,
 void log_queue_disk_restart_corrupted(LogQueueDisk *self);
 void log_queue_disk_free_method(LogQueueDisk *self);
 
+gboolean log_queue_disk_flush(LogQueueDisk *self);
+void log_queue_disk_stop_qdisk(LogQueueDisk *self);
+void log_queue_disk_schedule_flush(LogQueueDisk *self);
+void log_queue_disk_ack_when_flushed(LogQueueDisk *self, LogMessage *msg, const LogPathOptions *path_options);
+
 
 LogMessage *log_queue_disk_read_message(LogQueueDisk *self, LogPathOptions *path_options);
 void log_queue_disk_drop_message(LogQueueDisk *self, LogMessage *msg, const LogPathOptions *path_options);
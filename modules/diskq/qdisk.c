@@ -38,6 +38,10 @@
 #include <unistd.h>
 #include <sys/types.h>
 
+#if SYSLOG_NG_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
 /* MADV_RANDOM not defined on legacy Linux systems. Could be removed in the
  * future, when support for Glibc 2.1.X drops.*/
 #ifndef MADV_RANDOM
@@ -46,9 +50,26 @@
 
 #define MAX_RECORD_LENGTH 100 * 1024 * 1024
 
+/* records are collected up to this size before they are written in one go */
+#define QDISK_WRITE_BUFFER_SIZE (64 * 1024)
+/* number of bytes read from the read head at once, records are served from this buffer */
+#define QDISK_READ_AHEAD_SIZE (64 * 1024)
+
+/* Compressed records start with this marker instead of the LogMessage
+ * serialization version (which is always below 0x80), followed by the length
+ * of the uncompressed message as a big endian uint32 and the zstd frame.
+ * Plain and compressed records can be mixed within the same file. */
+#define QDISK_RECORD_ZSTD 0x81
+#define QDISK_COMPRESSED_RECORD_HDR_LEN (1 + sizeof(guint32))
+#define QDISK_ZSTD_LEVEL 1
+
 #define PATH_QDISK              PATH_LOCALSTATEDIR
 
-#define QDISK_HDR_VERSION_CURRENT 2
+/* Files that may contain compressed records are marked with version 4, so
+ * that they are not mistaken for files any reader of version 3 can load. */
+#define QDISK_HDR_VERSION_PLAIN 3
+#define QDISK_HDR_VERSION_COMPRESSED 4
+#define QDISK_HDR_VERSION_CURRENT QDISK_HDR_VERSION_COMPRESSED
 
 typedef union _QDiskFileHeader
 {
@@ -70,10 +91,19 @@ typedef union _QDiskFileHeader
     gint64 backlog_len;
 
     guint8 use_v1_wrap_condition;
+
+    /* 0 for a single ring file, otherwise the size of the segment files */
+    gint64 segment_size;
   };
   gchar _pad2[QDISK_RESERVED_SPACE];
 } QDiskFileHeader;
 
+typedef struct _QDiskSegment
+{
+  gint64 index;
+  gint fd;
+} QDiskSegment;
+
 struct _QDisk
 {
   gchar *filename;
@@ -82,6 +112,31 @@ struct _QDisk
   gint64 file_size;
   QDiskFileHeader *hdr;
   DiskQueueOptions *options;
+
+  /* Records pushed but not yet written to the file. While there are such
+   * records, hdr points to staged_hdr and the mmap()-ed header is only
+   * updated by qdisk_flush(), once the records are in the file, so the
+   * header in the file never refers to data that is not there.
+   */
+  GString *write_buffer;
+  gint64 write_buffer_ofs;
+  gint64 write_buffer_records;
+  QDiskFileHeader *mapped_hdr;
+  QDiskFileHeader staged_hdr;
+
+  /* file contents from read_buffer_ofs, starting at read_buffer_pos */
+  GString *read_buffer;
+  gint64 read_buffer_ofs;
+  gsize read_buffer_pos;
+
+  /* With a segmented layout the file only holds the header (and the saved
+   * in-memory queues of a non-reliable queue), records are appended to
+   * segment files next to it.  Positions grow without wrapping around,
+   * a segment is deleted as soon as the backlog head leaves it.
+   */
+  gint64 first_segment;
+  QDiskSegment read_segment;
+  QDiskSegment write_segment;
 };
 
 static gboolean
@@ -103,6 +158,165 @@ pwrite_strict(gint fd, const void *buf, size_t count, off_t offset)
   return result;
 }
 
+static inline gboolean
+_is_segmented(QDisk *self)
+{
+  return self->hdr->segment_size > 0;
+}
+
+static inline gint64
+_segment_index(QDisk *self, gint64 position)
+{
+  return (position - QDISK_RESERVED_SPACE) / self->hdr->segment_size;
+}
+
+static inline gint64
+_segment_offset(QDisk *self, gint64 position)
+{
+  return (position - QDISK_RESERVED_SPACE) % self->hdr->segment_size;
+}
+
+static gchar *
+_segment_filename(QDisk *self, gint64 index)
+{
+  return g_strdup_printf("%s.%06" G_GINT64_FORMAT, self->filename, index);
+}
+
+static void
+_close_segment(QDiskSegment *segment)
+{
+  if (segment->fd >= 0)
+    close(segment->fd);
+  segment->fd = -1;
+}
+
+static gint
+_open_segment(QDisk *self, QDiskSegment *segment, gint64 index, gint flags)
+{
+  if (segment->fd >= 0 && segment->index == index)
+    return segment->fd;
+
+  _close_segment(segment);
+
+  gchar *filename = _segment_filename(self, index);
+  segment->fd = open(filename, flags | O_LARGEFILE, 0600);
+  segment->index = index;
+  if (segment->fd < 0)
+    {
+      msg_error("Error opening disk-queue segment file",
+                evt_tag_str("filename", filename),
+                evt_tag_error("error"));
+    }
+  g_free(filename);
+  return segment->fd;
+}
+
+static void
+_delete_segment(QDisk *self, gint64 index)
+{
+  if (self->read_segment.index == index)
+    _close_segment(&self->read_segment);
+  if (self->write_segment.index == index)
+    _close_segment(&self->write_segment);
+
+  gchar *filename = _segment_filename(self, index);
+  if (unlink(filename) < 0 && errno != ENOENT)
+    {
+      msg_error("Error deleting disk-queue segment file",
+                evt_tag_str("filename", filename),
+                evt_tag_error("error"));
+    }
+  g_free(filename);
+}
+
+/* only the backlog head in the file counts, the records must survive a crash before it is updated */
+static void
+_delete_unused_segments(QDisk *self)
+{
+  if (!_is_segmented(self) || self->options->read_only)
+    return;
+
+  QDiskFileHeader *committed_hdr = self->mapped_hdr ? self->mapped_hdr : self->hdr;
+  gint64 first_used_segment = _segment_index(self, committed_hdr->backlog_head);
+
+  for (; self->first_segment < first_used_segment; self->first_segment++)
+    _delete_segment(self, self->first_segment);
+}
+
+/* segments may be left behind if syslog-ng stopped between updating the header and deleting them */
+static void
+_delete_segments_left_over(QDisk *self)
+{
+  gint64 index = _segment_index(self, self->hdr->backlog_head);
+
+  self->first_segment = index;
+  while (--index >= 0)
+    {
+      gchar *filename = _segment_filename(self, index);
+      gboolean deleted = unlink(filename) == 0;
+
+      g_free(filename);
+      if (!deleted)
+        break;
+    }
+}
+
+/*
+ * Writes records to their position, splitting them at segment boundaries.
+ * A segment is truncated when it is started, as it may be left over from
+ * before the queue was reset.
+ */
+static gboolean
+_write_records(QDisk *self, const gchar *data, gsize length, gint64 position)
+{
+  if (!_is_segmented(self))
+    return pwrite_strict(self->fd, data, length, position);
+
+  while (length > 0)
+    {
+      gint64 offset = _segment_offset(self, position);
+      gsize chunk = MIN(length, self->hdr->segment_size - offset);
+      gint fd = _open_segment(self, &self->write_segment, _segment_index(self, position),
+                              O_WRONLY | O_CREAT | (offset == 0 ? O_TRUNC : 0));
+
+      if (fd < 0 || !pwrite_strict(fd, data, chunk, offset))
+        return FALSE;
+
+      data += chunk;
+      length -= chunk;
+      position += chunk;
+    }
+  return TRUE;
+}
+
+/* reads records from their position like pread(), continuing in the next segment if needed */
+static gssize
+_read_records(QDisk *self, gpointer buffer, gsize length, gint64 position)
+{
+  if (!_is_segmented(self))
+    return pread(self->fd, buffer, length, position);
+
+  gsize bytes_read = 0;
+  while (bytes_read < length)
+    {
+      gint64 offset = _segment_offset(self, position);
+      gsize chunk = MIN(length - bytes_read, self->hdr->segment_size - offset);
+      gint fd = _open_segment(self, &self->read_segment, _segment_index(self, position), O_RDONLY);
+
+      if (fd < 0)
+        return -1;
+
+      gssize res = pread(fd, (gchar *) buffer + bytes_read, chunk, offset);
+      if (res < 0)
+        return -1;
+
+      bytes_read += res;
+      position += res;
+      if (res < chunk)
+        break;
+    }
+  return bytes_read;
+}
 
 static inline gboolean
 _is_position_after_disk_buf_size(QDisk *self, gint64 position)
@@ -113,6 +327,9 @@ _is_position_after_disk_buf_size(QDisk *self, gint64 position)
 static inline guint64
 _correct_position_if_after_disk_buf_size(QDisk *self, gint64 *position)
 {
+  if (_is_segmented(self))
+    return *position;
+
   if (G_UNLIKELY(self->hdr->use_v1_wrap_condition))
     {
       gboolean position_is_eof = *position >= self->file_size;
@@ -170,7 +387,7 @@ qdisk_started(QDisk *self)
 static inline gboolean
 _is_qdisk_overwritten(QDisk *self)
 {
-  return _is_position_after_disk_buf_size(self, self->hdr->write_head);
+  return !_is_segmented(self) && _is_position_after_disk_buf_size(self, self->hdr->write_head);
 }
 
 static inline gboolean
@@ -203,9 +420,18 @@ qdisk_is_file_empty(QDisk *self)
   return self->hdr->length == 0 && self->hdr->backlog_len == 0;
 }
 
+static inline gint64
+_get_used_space_of_segments(QDisk *self)
+{
+  return self->hdr->write_head - self->hdr->backlog_head;
+}
+
 gboolean
 qdisk_is_space_avail(QDisk *self, gint at_least)
 {
+  if (_is_segmented(self))
+    return _get_used_space_of_segments(self) + at_least <= qdisk_get_maximum_size(self);
+
   /* write follows read (e.g. we are appending to the file) OR
    * there's enough space between write and read.
    *
@@ -289,9 +515,33 @@ qdisk_get_lowest_used_queue_offset(QDisk *self)
   return lowest_offset < G_MAXINT64 ? lowest_offset : 0;
 }
 
+/* In segmented mode the records live in the segment files, the main file
+ * only holds the header and the queues saved at shutdown, which are appended
+ * at its end, so it has to be cut back to the header unconditionally. */
+static gboolean
+_truncate_segmented_main_file(QDisk *self)
+{
+  if (ftruncate(self->fd, (off_t) QDISK_RESERVED_SPACE) != 0)
+    {
+      msg_error("Error truncating disk-queue file",
+                evt_tag_error("error"),
+                evt_tag_str("filename", self->filename));
+      return FALSE;
+    }
+
+  self->file_size = QDISK_RESERVED_SPACE;
+  return TRUE;
+}
+
 static void
 _truncate_file_to_minimal(QDisk *self)
 {
+  if (_is_segmented(self))
+    {
+      _truncate_segmented_main_file(self);
+      return;
+    }
+
   if (qdisk_is_file_empty(self))
     {
       _maybe_truncate_file(self, QDISK_RESERVED_SPACE);
@@ -312,6 +562,9 @@ qdisk_get_empty_space(QDisk *self)
   gint64 wpos = qdisk_get_writer_head(self);
   gint64 bpos = qdisk_get_backlog_head(self);
 
+  if (_is_segmented(self))
+    return qdisk_get_maximum_size(self) - _get_used_space_of_segments(self);
+
   if (wpos > bpos)
     {
       return (qdisk_get_maximum_size(self) - wpos) +
@@ -336,6 +589,125 @@ qdisk_get_next_tail_position(QDisk *self)
   return self->hdr->write_head;
 }
 
+static inline gboolean
+_has_pending_writes(QDisk *self)
+{
+  return self->write_buffer && self->write_buffer->len > 0;
+}
+
+static inline gboolean
+_overlaps_pending_writes(QDisk *self, gint64 position, gsize length)
+{
+  return _has_pending_writes(self) &&
+         position < self->write_buffer_ofs + (gint64) self->write_buffer->len &&
+         position + (gint64) length > self->write_buffer_ofs;
+}
+
+static void
+_stage_header(QDisk *self)
+{
+  self->mapped_hdr = self->hdr;
+  self->staged_hdr = *self->mapped_hdr;
+  self->hdr = &self->staged_hdr;
+  self->write_buffer_records = 0;
+}
+
+/*
+ * Without commit only the writer's changes are thrown away: the records
+ * read, acked or rewound while the header was staged are kept.
+ */
+static void
+_unstage_header(QDisk *self, gboolean commit)
+{
+  if (commit)
+    {
+      *self->mapped_hdr = self->staged_hdr;
+    }
+  else
+    {
+      self->mapped_hdr->read_head = self->staged_hdr.read_head;
+      self->mapped_hdr->backlog_head = self->staged_hdr.backlog_head;
+      self->mapped_hdr->backlog_len = self->staged_hdr.backlog_len;
+      self->mapped_hdr->length = self->staged_hdr.length - self->write_buffer_records;
+    }
+  self->hdr = self->mapped_hdr;
+  self->mapped_hdr = NULL;
+
+  if (commit)
+    _delete_unused_segments(self);
+}
+
+/*
+ * Writes the pending records with a single write and only then updates
+ * the header in the file.  On failure the records stay pending, so the
+ * write is retried on the next flush.
+ */
+gboolean
+qdisk_flush(QDisk *self)
+{
+  if (!_has_pending_writes(self))
+    return TRUE;
+
+  if (!_write_records(self, self->write_buffer->str, self->write_buffer->len, self->write_buffer_ofs))
+    {
+      msg_error("Error writing disk-queue file",
+                evt_tag_str("filename", self->filename),
+                evt_tag_long("pending_bytes", self->write_buffer->len),
+                evt_tag_error("error"));
+      return FALSE;
+    }
+
+  g_string_truncate(self->write_buffer, 0);
+  _unstage_header(self, TRUE);
+  return TRUE;
+}
+
+static void
+_drop_pending_writes(QDisk *self)
+{
+  msg_error("Dropping records not yet written to the disk-queue file",
+            evt_tag_str("filename", self->filename),
+            evt_tag_long("lost_bytes", self->write_buffer->len));
+
+  g_string_truncate(self->write_buffer, 0);
+  _unstage_header(self, FALSE);
+}
+
+static gboolean
+_write_record(QDisk *self, GString *record)
+{
+  gint64 position = self->hdr->write_head;
+
+  if (_has_pending_writes(self) &&
+      (self->write_buffer_ofs + (gint64) self->write_buffer->len != position ||
+       self->write_buffer->len + record->len > QDISK_WRITE_BUFFER_SIZE))
+    {
+      if (!qdisk_flush(self))
+        return FALSE;
+    }
+
+  if (record->len >= QDISK_WRITE_BUFFER_SIZE)
+    return _write_records(self, record->str, record->len, position);
+
+  if (!_has_pending_writes(self))
+    {
+      _stage_header(self);
+      self->write_buffer_ofs = position;
+    }
+  g_string_append_len(self->write_buffer, record->str, record->len);
+  self->write_buffer_records++;
+  return TRUE;
+}
+
+/* the record length comes first, the compression marker follows it */
+static void
+_mark_header_if_record_compressed(QDisk *self, GString *record)
+{
+  if (record->len > sizeof(guint32) && (guchar) record->str[sizeof(guint32)] == QDISK_RECORD_ZSTD)
+    self->hdr->version = MAX(self->hdr->version, QDISK_HDR_VERSION_COMPRESSED);
+}
+
+/* the record is written to the file by qdisk_flush(), at the latest when it is read back */
 gboolean
 qdisk_push_tail(QDisk *self, GString *record)
 {
@@ -355,7 +727,7 @@ qdisk_push_tail(QDisk *self, GString *record)
   if (!qdisk_is_space_avail(self, record->len))
     return FALSE;
 
-  if (!pwrite_strict(self->fd, record->str, record->len, self->hdr->write_head))
+  if (!_write_record(self, record))
     {
       msg_error("Error writing disk-queue file",
                 evt_tag_error("error"));
@@ -363,6 +735,7 @@ qdisk_push_tail(QDisk *self, GString *record)
     }
 
   self->hdr->write_head = self->hdr->write_head + record->len;
+  _mark_header_if_record_compressed(self, record);
 
 
   /* NOTE: we only wrap around if the read head is before the write,
@@ -388,7 +761,7 @@ qdisk_push_tail(QDisk *self, GString *record)
   /* NOTE: if these were equal, that'd mean the queue is empty, so we spoiled something */
   g_assert(self->hdr->write_head != self->hdr->backlog_head);
 
-  if (self->hdr->write_head > MAX(self->hdr->backlog_head, self->hdr->read_head))
+  if (!_is_segmented(self) && self->hdr->write_head > MAX(self->hdr->backlog_head, self->hdr->read_head))
     {
       if (self->file_size > self->hdr->write_head)
         {
@@ -416,10 +789,101 @@ qdisk_push_tail(QDisk *self, GString *record)
   return TRUE;
 }
 
+static inline void
+_drop_read_ahead(QDisk *self)
+{
+  if (self->read_buffer)
+    g_string_truncate(self->read_buffer, 0);
+  self->read_buffer_pos = 0;
+}
+
+static inline gboolean
+_is_in_read_ahead(QDisk *self, gint64 position, gsize length)
+{
+  return self->read_buffer &&
+         position >= self->read_buffer_ofs &&
+         position + (gint64) length <= self->read_buffer_ofs + (gint64) (self->read_buffer->len - self->read_buffer_pos);
+}
+
+/*
+ * Only data that cannot change until the read head passes it is read
+ * ahead: the writer never overwrites unread records, but it may write
+ * beyond the write head or into records still pending in write_buffer.
+ */
+static gsize
+_calculate_read_ahead_size(QDisk *self, gint64 position, gsize at_least)
+{
+  gint64 size = MAX(at_least, QDISK_READ_AHEAD_SIZE);
+
+  if (position < self->hdr->write_head)
+    size = MIN(size, self->hdr->write_head - position);
+
+  if (_has_pending_writes(self) && self->write_buffer_ofs >= position)
+    size = MIN(size, self->write_buffer_ofs - position);
+
+  return MAX(size, at_least);
+}
+
+static gboolean
+_fill_read_ahead(QDisk *self, gint64 position, gsize at_least)
+{
+  gsize size = _calculate_read_ahead_size(self, position, at_least);
+
+  g_string_set_size(self->read_buffer, size);
+  gssize bytes_read = _read_records(self, self->read_buffer->str, size, position);
+  if (bytes_read < 0)
+    {
+      _drop_read_ahead(self);
+      return FALSE;
+    }
+
+  g_string_truncate(self->read_buffer, bytes_read);
+  self->read_buffer_ofs = position;
+  self->read_buffer_pos = 0;
+  return TRUE;
+}
+
+/* reads the records at the read head, returns the number of bytes read like pread() */
+static gssize
+_read_at_read_head(QDisk *self, gpointer buffer, gsize bytes_to_read, gint64 position)
+{
+  if (_overlaps_pending_writes(self, position, bytes_to_read) && !qdisk_flush(self))
+    return -1;
+
+  if (bytes_to_read > QDISK_READ_AHEAD_SIZE)
+    {
+      _drop_read_ahead(self);
+      return _read_records(self, buffer, bytes_to_read, position);
+    }
+
+  if (!_is_in_read_ahead(self, position, bytes_to_read) && !_fill_read_ahead(self, position, bytes_to_read))
+    return -1;
+
+  gsize offset = self->read_buffer_pos + (position - self->read_buffer_ofs);
+  gsize bytes_read = MIN(bytes_to_read, self->read_buffer->len - offset);
+
+  memcpy(buffer, self->read_buffer->str + offset, bytes_read);
+  return bytes_read;
+}
+
+static inline void
+_advance_read_ahead(QDisk *self, gint64 old_read_head, gint64 new_read_head)
+{
+  if (new_read_head > old_read_head && _is_in_read_ahead(self, new_read_head, 0))
+    {
+      self->read_buffer_pos += new_read_head - self->read_buffer_ofs;
+      self->read_buffer_ofs = new_read_head;
+      return;
+    }
+
+  /* the read head wrapped around, the data in the buffer may be overwritten from now on */
+  _drop_read_ahead(self);
+}
+
 static inline gssize
 _read_record_length_from_disk(QDisk *self, guint32 *record_length)
 {
-  gssize bytes_read = pread(self->fd, (gchar *)record_length, sizeof(guint32), self->hdr->read_head);
+  gssize bytes_read = _read_at_read_head(self, (gchar *)record_length, sizeof(guint32), self->hdr->read_head);
 
   *record_length = GUINT32_FROM_BE(*record_length);
 
@@ -483,7 +947,7 @@ _read_record_from_disk(QDisk *self, GString *record, guint32 record_length)
 {
   g_string_set_size(record, record_length);
 
-  gssize bytes_read = pread(self->fd, record->str, record_length, self->hdr->read_head + sizeof(record_length));
+  gssize bytes_read = _read_at_read_head(self, record->str, record_length, self->hdr->read_head + sizeof(record_length));
   if (bytes_read != record_length)
     {
       msg_error("Error reading disk-queue file",
@@ -511,12 +975,16 @@ _calculate_new_read_head_position(QDisk *self, guint32 record_length)
 static inline void
 _update_positions_after_read(QDisk *self, guint32 record_length)
 {
+  gint64 old_read_head = self->hdr->read_head;
+
   self->hdr->read_head = _calculate_new_read_head_position(self, record_length);
+  _advance_read_ahead(self, old_read_head, self->hdr->read_head);
   self->hdr->length--;
 
   if (!self->options->reliable)
     {
       self->hdr->backlog_head = self->hdr->read_head;
+      _delete_unused_segments(self);
 
       g_assert(self->hdr->backlog_len == 0);
       if (!self->options->read_only)
@@ -576,6 +1044,127 @@ _overwrite_with_real_record_length(GString *serialized)
   return TRUE;
 }
 
+static inline gboolean
+_is_record_compressed(GString *record)
+{
+  return record->len > 0 && (guchar) record->str[0] == QDISK_RECORD_ZSTD;
+}
+
+#if SYSLOG_NG_ENABLE_ZSTD
+
+typedef struct _QDiskCompressionContext
+{
+  ZSTD_CCtx *cctx;
+  ZSTD_DCtx *dctx;
+  GString *buffer;
+} QDiskCompressionContext;
+
+static void
+_compression_context_free(gpointer s)
+{
+  QDiskCompressionContext *self = (QDiskCompressionContext *) s;
+
+  ZSTD_freeCCtx(self->cctx);
+  ZSTD_freeDCtx(self->dctx);
+  g_string_free(self->buffer, TRUE);
+  g_free(self);
+}
+
+/* zstd contexts are expensive to create, each thread keeps its own */
+static GPrivate compression_context = G_PRIVATE_INIT(_compression_context_free);
+
+static QDiskCompressionContext *
+_get_compression_context(void)
+{
+  QDiskCompressionContext *self = g_private_get(&compression_context);
+
+  if (!self)
+    {
+      self = g_new0(QDiskCompressionContext, 1);
+      self->cctx = ZSTD_createCCtx();
+      self->dctx = ZSTD_createDCtx();
+      self->buffer = g_string_sized_new(4096);
+      g_private_set(&compression_context, self);
+    }
+  return self;
+}
+
+/* replaces the message after the record length with its compressed form, unless that would not be shorter */
+static gboolean
+_compress_record(GString *serialized)
+{
+  QDiskCompressionContext *context = _get_compression_context();
+  const gchar *message = serialized->str + sizeof(guint32);
+  gsize message_len = serialized->len - sizeof(guint32);
+
+  g_string_set_size(context->buffer, ZSTD_compressBound(message_len));
+  gsize compressed_len = ZSTD_compressCCtx(context->cctx, context->buffer->str, context->buffer->len,
+                                           message, message_len, QDISK_ZSTD_LEVEL);
+  if (ZSTD_isError(compressed_len))
+    return FALSE;
+
+  if (compressed_len + QDISK_COMPRESSED_RECORD_HDR_LEN >= message_len)
+    return TRUE;
+
+  guint32 message_len_be = GUINT32_TO_BE(message_len);
+
+  g_string_truncate(serialized, sizeof(guint32));
+  g_string_append_c(serialized, (gchar) QDISK_RECORD_ZSTD);
+  g_string_append_len(serialized, (const gchar *) &message_len_be, sizeof(message_len_be));
+  g_string_append_len(serialized, context->buffer->str, compressed_len);
+  return TRUE;
+}
+
+/* the returned string is owned by the thread and is valid until the next decompression */
+static GString *
+_decompress_record(QDisk *self, GString *record)
+{
+  QDiskCompressionContext *context = _get_compression_context();
+  guint32 message_len;
+
+  if (record->len < QDISK_COMPRESSED_RECORD_HDR_LEN)
+    goto error;
+
+  memcpy(&message_len, record->str + 1, sizeof(message_len));
+  message_len = GUINT32_FROM_BE(message_len);
+  if (message_len == 0 || _is_record_length_reached_hard_limit(message_len))
+    goto error;
+
+  g_string_set_size(context->buffer, message_len);
+  gsize decompressed_len = ZSTD_decompressDCtx(context->dctx, context->buffer->str, message_len,
+                                               record->str + QDISK_COMPRESSED_RECORD_HDR_LEN,
+                                               record->len - QDISK_COMPRESSED_RECORD_HDR_LEN);
+  if (ZSTD_isError(decompressed_len) || decompressed_len != message_len)
+    goto error;
+
+  return context->buffer;
+
+error:
+  msg_error("Error decompressing record from the disk-queue file",
+            evt_tag_str("filename", qdisk_get_filename(self)),
+            evt_tag_int("record_length", record->len));
+  return NULL;
+}
+
+#else
+
+static gboolean
+_compress_record(GString *serialized)
+{
+  g_assert_not_reached();
+  return FALSE;
+}
+
+static GString *
+_decompress_record(QDisk *self, GString *record)
+{
+  msg_error("Disk-queue file contains a compressed record, but syslog-ng was compiled without zstd support",
+            evt_tag_str("filename", qdisk_get_filename(self)));
+  return NULL;
+}
+
+#endif
+
 gboolean
 qdisk_serialize_msg(QDisk *self, LogMessage *msg, GString *serialized)
 {
@@ -595,6 +1184,12 @@ qdisk_serialize_msg(QDisk *self, LogMessage *msg, GString *serialized)
       goto exit;
     }
 
+  if (self->options->compression && !_compress_record(serialized))
+    {
+      error = "cannot compress LogMessage";
+      goto exit;
+    }
+
   if (!_overwrite_with_real_record_length(serialized))
     {
       error = "message is empty";
@@ -616,6 +1211,13 @@ exit:
 gboolean
 qdisk_deserialize_msg(QDisk *self, GString *serialized, LogMessage **msg)
 {
+  if (_is_record_compressed(serialized))
+    {
+      serialized = _decompress_record(self, serialized);
+      if (!serialized)
+        return FALSE;
+    }
+
   SerializeArchive *sa = serialize_string_archive_new(serialized);
   LogMessage *local_msg = log_msg_new_empty();
 
@@ -702,6 +1304,16 @@ _load_queue(QDisk *self, GQueue *q, gint64 q_ofs, guint32 q_len, guint32 q_count
   return TRUE;
 }
 
+/* the queues are saved after the records, or right after the header with a segmented layout */
+static inline gboolean
+_is_queue_offset_valid(QDisk *self, gint64 ofs)
+{
+  if (_is_segmented(self))
+    return ofs == 0 || ofs >= QDISK_RESERVED_SPACE;
+
+  return !(ofs > 0 && ofs < self->hdr->write_head);
+}
+
 static gboolean
 _try_to_load_queue(QDisk *self, GQueue *queue, QDiskQueuePosition *pos, gchar *type)
 {
@@ -712,7 +1324,7 @@ _try_to_load_queue(QDisk *self, GQueue *queue, QDiskQueuePosition *pos, gchar *t
   len = pos->len;
   ofs = pos->ofs;
 
-  if (!(ofs > 0 && ofs < self->hdr->write_head))
+  if (_is_queue_offset_valid(self, ofs))
     {
       if (!_load_queue(self, queue, ofs, len, count))
         return !self->options->read_only;
@@ -936,8 +1548,14 @@ qdisk_save_state(QDisk *self, GQueue *qout, GQueue *qbacklog, GQueue *qoverflow)
   QDiskQueuePosition qbacklog_pos = { 0 };
   QDiskQueuePosition qoverflow_pos = { 0 };
 
+  if (!qdisk_flush(self))
+    return FALSE;
+
   if (!self->options->reliable)
     {
+      if (_is_segmented(self) && !_truncate_segmented_main_file(self))
+        return FALSE;
+
       qout_pos.count = qout->length / 2;
       qbacklog_pos.count = qbacklog->length / 2;
       qoverflow_pos.count = qoverflow->length / 2;
@@ -978,9 +1596,15 @@ _create_path(const gchar *filename)
 }
 
 static inline gboolean
-_is_header_version_current(QDisk *self)
+_is_header_version_outdated(QDisk *self)
+{
+  return self->hdr->version < QDISK_HDR_VERSION_PLAIN;
+}
+
+static inline gboolean
+_is_header_version_supported(QDisk *self)
 {
-  return self->hdr->version == QDISK_HDR_VERSION_CURRENT;
+  return self->hdr->version <= QDISK_HDR_VERSION_CURRENT;
 }
 
 static void
@@ -1000,7 +1624,10 @@ _upgrade_header(QDisk *self)
       self->hdr->use_v1_wrap_condition = file_was_overwritten;
     }
 
-  self->hdr->version = QDISK_HDR_VERSION_CURRENT;
+  if (self->hdr->version < 3)
+    self->hdr->segment_size = 0;
+
+  self->hdr->version = QDISK_HDR_VERSION_PLAIN;
 }
 
 gboolean
@@ -1020,6 +1647,12 @@ qdisk_start(QDisk *self, const gchar *filename, GQueue *qout, GQueue *qbacklog,
   if (self->options->disk_buf_size <= 0)
     return TRUE;
 
+  if (!self->write_buffer)
+    self->write_buffer = g_string_sized_new(QDISK_WRITE_BUFFER_SIZE);
+  if (!self->read_buffer)
+    self->read_buffer = g_string_sized_new(QDISK_READ_AHEAD_SIZE);
+  self->read_buffer_pos = 0;
+
   if (self->options->read_only && !filename)
     return FALSE;
 
@@ -1101,7 +1734,7 @@ qdisk_start(QDisk *self, const gchar *filename, GQueue *qout, GQueue *qbacklog,
           self->fd = -1;
           return FALSE;
         }
-      self->hdr->version = QDISK_HDR_VERSION_CURRENT;
+      self->hdr->version = self->options->compression ? QDISK_HDR_VERSION_COMPRESSED : QDISK_HDR_VERSION_PLAIN;
       self->hdr->big_endian = (G_BYTE_ORDER == G_BIG_ENDIAN);
 
       self->hdr->read_head = QDISK_RESERVED_SPACE;
@@ -1109,6 +1742,7 @@ qdisk_start(QDisk *self, const gchar *filename, GQueue *qout, GQueue *qbacklog,
       self->hdr->backlog_head = self->hdr->read_head;
       self->hdr->length = 0;
       self->hdr->use_v1_wrap_condition = FALSE;
+      self->hdr->segment_size = self->options->segment_size;
       self->file_size = self->hdr->write_head;
 
       if (!qdisk_save_state(self, qout, qbacklog, qoverflow))
@@ -1137,7 +1771,19 @@ qdisk_start(QDisk *self, const gchar *filename, GQueue *qout, GQueue *qbacklog,
           return FALSE;
         }
 
-      if (!_is_header_version_current(self))
+      if (!_is_header_version_supported(self))
+        {
+          msg_error("Error loading disk-queue file, the file was written by a newer version of syslog-ng",
+                    evt_tag_str("filename", self->filename),
+                    evt_tag_int("version", self->hdr->version));
+          munmap((void *)self->hdr, sizeof(QDiskFileHeader));
+          self->hdr = NULL;
+          close(self->fd);
+          self->fd = -1;
+          return FALSE;
+        }
+
+      if (_is_header_version_outdated(self))
         {
           _upgrade_header(self);
         }
@@ -1159,6 +1805,7 @@ qdisk_start(QDisk *self, const gchar *filename, GQueue *qout, GQueue *qbacklog,
           self->hdr->qoverflow_pos.count = GUINT32_SWAP_LE_BE(self->hdr->qoverflow_pos.count);
           self->hdr->backlog_head = GUINT64_SWAP_LE_BE(self->hdr->backlog_head);
           self->hdr->backlog_len = GUINT64_SWAP_LE_BE(self->hdr->backlog_len);
+          self->hdr->segment_size = GUINT64_SWAP_LE_BE(self->hdr->segment_size);
           self->hdr->big_endian = (G_BYTE_ORDER == G_BIG_ENDIAN);
         }
       if (!_load_state(self, qout, qbacklog, qoverflow))
@@ -1170,6 +1817,8 @@ qdisk_start(QDisk *self, const gchar *filename, GQueue *qout, GQueue *qbacklog,
           return FALSE;
         }
 
+      if (_is_segmented(self) && !self->options->read_only)
+        _delete_segments_left_over(self);
     }
   return TRUE;
 }
@@ -1180,6 +1829,8 @@ qdisk_init_instance(QDisk *self, DiskQueueOptions *options, const gchar *file_id
   self->fd = -1;
   self->file_size = 0;
   self->options = options;
+  self->read_segment.fd = -1;
+  self->write_segment.fd = -1;
 
   self->file_id = file_id;
 }
@@ -1187,6 +1838,21 @@ qdisk_init_instance(QDisk *self, DiskQueueOptions *options, const gchar *file_id
 void
 qdisk_stop(QDisk *self)
 {
+  if (_has_pending_writes(self) && !qdisk_flush(self))
+    _drop_pending_writes(self);
+
+  if (self->write_buffer)
+    {
+      g_string_free(self->write_buffer, TRUE);
+      self->write_buffer = NULL;
+    }
+
+  if (self->read_buffer)
+    {
+      g_string_free(self->read_buffer, TRUE);
+      self->read_buffer = NULL;
+    }
+
   if (self->filename)
     {
       g_free(self->filename);
@@ -1208,6 +1874,10 @@ qdisk_stop(QDisk *self)
       self->fd = -1;
     }
 
+  _close_segment(&self->read_segment);
+  _close_segment(&self->write_segment);
+  self->first_segment = 0;
+
   self->options = NULL;
 }
 
@@ -1215,7 +1885,11 @@ static gssize
 qdisk_read(QDisk *self, gpointer buffer, gsize bytes_to_read, gint64 position)
 {
   gssize res;
-  res = pread(self->fd, buffer, bytes_to_read, position);
+
+  if (_overlaps_pending_writes(self, position, bytes_to_read) && !qdisk_flush(self))
+    return -1;
+
+  res = _read_records(self, buffer, bytes_to_read, position);
   if (res <= 0)
     {
       msg_error("Error reading disk-queue file",
@@ -1240,17 +1914,34 @@ qdisk_skip_record(QDisk *self, guint64 position)
   return new_position;
 }
 
+/* the first segment is kept, it is reused right away */
+static void
+_delete_segments_after_reset(QDisk *self, gint64 old_write_head)
+{
+  gint64 last_segment = _segment_index(self, old_write_head);
+
+  for (gint64 index = MAX(self->first_segment, 1); index <= last_segment; index++)
+    _delete_segment(self, index);
+  self->first_segment = 0;
+}
+
 void
 qdisk_reset_file_if_empty(QDisk *self)
 {
   if (!qdisk_is_file_empty(self))
     return;
 
+  gint64 old_write_head = self->hdr->write_head;
+
   self->hdr->read_head = QDISK_RESERVED_SPACE;
   self->hdr->write_head = QDISK_RESERVED_SPACE;
   self->hdr->backlog_head = QDISK_RESERVED_SPACE;
+  _drop_read_ahead(self);
 
-  _maybe_truncate_file(self, QDISK_RESERVED_SPACE);
+  if (_is_segmented(self))
+    _delete_segments_after_reset(self, old_write_head);
+  else
+    _maybe_truncate_file(self, QDISK_RESERVED_SPACE);
 }
 
 DiskQueueOptions *
@@ -1299,6 +1990,7 @@ void
 qdisk_set_reader_head(QDisk *self, gint64 new_value)
 {
   self->hdr->read_head = new_value;
+  _drop_read_ahead(self);
 }
 
 gint64
@@ -1311,6 +2003,7 @@ void
 qdisk_set_backlog_head(QDisk *self, gint64 new_value)
 {
   self->hdr->backlog_head = new_value;
+  _delete_unused_segments(self);
 }
 
 void
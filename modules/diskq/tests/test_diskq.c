@@ -307,6 +307,217 @@ Test(diskq, testcase_with_threads)
   fprintf(stderr, "Feed speed: %.2lf\n", (double) TEST_RUNS * MESSAGES_SUM * 1000000 / sum_time);
 }
 
+static gint64
+_get_write_head_in_file(const gchar *filename, DiskQueueOptions *options)
+{
+  DiskQueueOptions read_only_options = *options;
+  QDisk *qdisk = qdisk_new(&read_only_options, "SLRQ");
+  gint64 write_head;
+
+  read_only_options.read_only = TRUE;
+  cr_assert(qdisk_start(qdisk, filename, NULL, NULL, NULL));
+  write_head = qdisk_get_writer_head(qdisk);
+  qdisk_stop(qdisk);
+  qdisk_free(qdisk);
+  return write_head;
+}
+
+Test(diskq, testcase_records_of_a_batch_are_written_and_acked_at_the_end_of_the_batch)
+{
+  const gchar *filename = "test-batch.rqf";
+  DiskQueueOptions options = {0};
+  LogQueue *q;
+
+  _construct_options(&options, 10000000, 100000, TRUE);
+  log_queue_set_max_threads(1);
+
+  q = log_queue_disk_reliable_new(&options, NULL);
+  log_queue_set_use_backlog(q, TRUE);
+  unlink(filename);
+  log_queue_disk_load_queue(q, filename);
+
+  main_loop_worker_thread_start(NULL);
+  cr_assert_eq(main_loop_worker_get_thread_id(), 0);
+
+  fed_messages = 0;
+  acked_messages = 0;
+  feed_some_messages(q, 10);
+  cr_assert_eq(acked_messages, 0, "Messages must not be acked before their records are written");
+  cr_assert_eq(_get_write_head_in_file(filename, &options), QDISK_RESERVED_SPACE,
+               "The header in the file must not refer to records not yet written");
+
+  main_loop_worker_invoke_batch_callbacks();
+  cr_assert_eq(acked_messages, 10);
+  cr_assert_eq(_get_write_head_in_file(filename, &options), qdisk_get_writer_head(((LogQueueDisk *) q)->qdisk));
+
+  /* records still pending are written when they are read */
+  feed_some_messages(q, 10);
+  send_some_messages(q, 20);
+  log_queue_ack_backlog(q, 20);
+  main_loop_worker_invoke_batch_callbacks();
+  cr_assert_eq(acked_messages, 20);
+
+  main_loop_worker_thread_stop();
+  log_queue_unref(q);
+  unlink(filename);
+  disk_queue_options_destroy(&options);
+}
+
+static gboolean
+_segment_exists(const gchar *filename, gint index)
+{
+  gchar *segment_filename = g_strdup_printf("%s.%06d", filename, index);
+  gboolean exists = g_file_test(segment_filename, G_FILE_TEST_EXISTS);
+
+  g_free(segment_filename);
+  return exists;
+}
+
+static void
+_pop_records(QDisk *qdisk, gint count)
+{
+  GString *record = g_string_new(NULL);
+  LogMessage *msg;
+
+  for (gint i = 0; i < count; i++)
+    {
+      cr_assert(qdisk_pop_head(qdisk, record));
+      cr_assert(qdisk_deserialize_msg(qdisk, record, &msg));
+      cr_assert_str_eq(log_msg_get_value(msg, LM_V_MESSAGE, NULL), "segmented");
+      log_msg_unref(msg);
+    }
+  g_string_free(record, TRUE);
+}
+
+Test(diskq, testcase_segments_are_deleted_once_the_backlog_head_leaves_them)
+{
+  const gchar *filename = "test-segmented.rqf";
+  DiskQueueOptions options = {0};
+  GString *record = g_string_new(NULL);
+  LogMessage *msg = log_msg_new_empty();
+
+  _construct_options(&options, 10000000, 100000, TRUE);
+  options.segment_size = 1024;
+  QDisk *qdisk = qdisk_new(&options, "SLRQ");
+  unlink(filename);
+  cr_assert(qdisk_start(qdisk, filename, NULL, NULL, NULL));
+
+  log_msg_set_value(msg, LM_V_MESSAGE, "segmented", -1);
+  cr_assert(qdisk_serialize_msg(qdisk, msg, record));
+  for (gint i = 0; i < 40; i++)
+    cr_assert(qdisk_push_tail(qdisk, record));
+  cr_assert(qdisk_flush(qdisk));
+
+  gint last_segment = (qdisk_get_writer_head(qdisk) - QDISK_RESERVED_SPACE - 1) / options.segment_size;
+  cr_assert_gt(last_segment, 2, "Records must span several segments");
+  for (gint i = 0; i <= last_segment; i++)
+    cr_assert(_segment_exists(filename, i));
+
+  _pop_records(qdisk, 20);
+  cr_assert(_segment_exists(filename, 0), "Segments in the backlog must be kept");
+
+  qdisk_set_backlog_head(qdisk, qdisk_get_reader_head(qdisk));
+  qdisk_set_backlog_count(qdisk, 0);
+  cr_assert_not(_segment_exists(filename, 0));
+  cr_assert(_segment_exists(filename, last_segment));
+
+  /* positions are kept across restarts, the remaining records are read from the segments left */
+  qdisk_stop(qdisk);
+  qdisk_init_instance(qdisk, &options, "SLRQ");
+  options.segment_size = 0;
+  cr_assert(qdisk_start(qdisk, filename, NULL, NULL, NULL));
+  _pop_records(qdisk, 20);
+  cr_assert_not(qdisk_pop_head(qdisk, record));
+
+  qdisk_set_backlog_head(qdisk, qdisk_get_reader_head(qdisk));
+  qdisk_set_backlog_count(qdisk, 0);
+  qdisk_reset_file_if_empty(qdisk);
+  for (gint i = 1; i <= last_segment; i++)
+    cr_assert_not(_segment_exists(filename, i));
+
+  qdisk_stop(qdisk);
+  qdisk_free(qdisk);
+  log_msg_unref(msg);
+  g_string_free(record, TRUE);
+  unlink(filename);
+  gchar *first_segment = g_strdup_printf("%s.%06d", filename, 0);
+  unlink(first_segment);
+  g_free(first_segment);
+  disk_queue_options_destroy(&options);
+}
+
+#if SYSLOG_NG_ENABLE_ZSTD
+
+static void
+_assert_record_contains_message(QDisk *qdisk, GString *record, const gchar *expected_message)
+{
+  LogMessage *msg;
+
+  cr_assert(qdisk_deserialize_msg(qdisk, record, &msg));
+  cr_assert_str_eq(log_msg_get_value(msg, LM_V_MESSAGE, NULL), expected_message);
+  log_msg_unref(msg);
+}
+
+/* the version follows the 4 byte magic in the header */
+static guint8
+_get_header_version_in_file(const gchar *filename)
+{
+  guint8 version = 0;
+  FILE *f = fopen(filename, "rb");
+
+  cr_assert_not_null(f);
+  cr_assert_eq(fseek(f, 4, SEEK_SET), 0);
+  cr_assert_eq(fread(&version, 1, 1, f), 1);
+  fclose(f);
+  return version;
+}
+
+Test(diskq, testcase_compressed_and_plain_records_are_read_back_from_the_same_file)
+{
+  const gchar *filename = "test-compression.rqf";
+  const gchar *message = "compressible message compressible message compressible message compressible message";
+  DiskQueueOptions options = {0};
+  GString *plain = g_string_new(NULL);
+  GString *compressed = g_string_new(NULL);
+  GString *record = g_string_new(NULL);
+  LogMessage *msg = log_msg_new_empty();
+
+  _construct_options(&options, 10000000, 100000, TRUE);
+  QDisk *qdisk = qdisk_new(&options, "SLRQ");
+  unlink(filename);
+  cr_assert(qdisk_start(qdisk, filename, NULL, NULL, NULL));
+
+  log_msg_set_value(msg, LM_V_MESSAGE, message, -1);
+  cr_assert(qdisk_serialize_msg(qdisk, msg, plain));
+  disk_queue_options_compression_set(&options, TRUE);
+  cr_assert(qdisk_serialize_msg(qdisk, msg, compressed));
+  cr_assert_lt(compressed->len, plain->len);
+
+  cr_assert(qdisk_push_tail(qdisk, plain));
+  cr_assert(qdisk_flush(qdisk));
+  cr_assert_eq(_get_header_version_in_file(filename), 3, "Files without compressed records must stay readable by older versions");
+  cr_assert(qdisk_push_tail(qdisk, compressed));
+  cr_assert(qdisk_flush(qdisk));
+  cr_assert_eq(_get_header_version_in_file(filename), 4, "Files with compressed records must be marked with a new version");
+
+  cr_assert(qdisk_pop_head(qdisk, record));
+  _assert_record_contains_message(qdisk, record, message);
+  cr_assert(qdisk_pop_head(qdisk, record));
+  _assert_record_contains_message(qdisk, record, message);
+  cr_assert_not(qdisk_pop_head(qdisk, record));
+
+  qdisk_stop(qdisk);
+  qdisk_free(qdisk);
+  log_msg_unref(msg);
+  g_string_free(record, TRUE);
+  g_string_free(compressed, TRUE);
+  g_string_free(plain, TRUE);
+  unlink(filename);
+  disk_queue_options_destroy(&options);
+}
+
+#endif
+
 typedef struct restart_test_parameters
 {
   gchar *filename;
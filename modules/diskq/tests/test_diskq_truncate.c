@@ -225,6 +225,61 @@ Test(diskq_truncate, test_diskq_truncate_without_diskbuffer_used)
   });
 }
 
+static void
+_unlink_segments(const gchar *filename)
+{
+  for (gint i = 0; ; i++)
+    {
+      gchar *segment_filename = g_strdup_printf("%s.%06d", filename, i);
+      gboolean removed = unlink(segment_filename) == 0;
+
+      g_free(segment_filename);
+      if (!removed)
+        break;
+    }
+}
+
+Test(diskq_truncate, test_diskq_segmented_file_does_not_grow_across_restarts)
+{
+  gchar *filename = "test_dq_truncate_segmented.qf";
+  DiskQueueOptions options;
+  const gint number_of_msgs = 100;
+  const gint qout_size = 40;
+  gint64 file_size_after_first_save = 0;
+
+  cr_assert(cfg_init(configuration), "cfg_init failed!");
+  unlink(filename);
+  _construct_options(&options, TEST_DISKQ_SIZE, 0, FALSE);
+  options.qout_size = qout_size;
+  options.segment_size = 1024;
+
+  LogQueue *q = _get_non_reliable_diskqueue(filename, &options);
+  feed_some_messages(q, number_of_msgs);
+
+  for (gint restart = 0; restart < 5; restart++)
+    {
+      _save_diskqueue(q);
+
+      struct stat file_stats;
+      cr_assert(stat(filename, &file_stats) == 0, "Stat call failed, errno:%d", errno);
+      if (restart == 0)
+        file_size_after_first_save = file_stats.st_size;
+      cr_assert_gt(file_size_after_first_save, QDISK_RESERVED_SPACE, "The in-memory queue should have been saved");
+      cr_assert_eq(file_stats.st_size, file_size_after_first_save,
+                   "Segmented disk-queue file grows across restarts; restart: %d, size: %ld, expected: %ld",
+                   restart, (gint64) file_stats.st_size, file_size_after_first_save);
+
+      q = _get_non_reliable_diskqueue(filename, &options);
+      cr_assert_eq(log_queue_get_length(q), number_of_msgs, "Messages were lost across restarts");
+      cr_assert_eq(_get_file_size(q), QDISK_RESERVED_SPACE, "Saved queues were not truncated after load");
+    }
+
+  log_queue_unref(q);
+  unlink(filename);
+  _unlink_segments(filename);
+  disk_queue_options_destroy(&options);
+}
+
 static LogQueue *
 _create_reliable_diskqueue(gchar *filename, DiskQueueOptions *options, gboolean use_backlog,
                            gdouble truncate_size_ratio)
@@ -377,6 +377,46 @@ Test(diskq_reliable, test_rewind_backlog)
   _common_cleanup(dq, file_name);
 }
 
+static void
+_push_mark_records(QDisk *qdisk, gint count)
+{
+  LogMessage *mark_message = log_msg_new_mark();
+  GString *record = g_string_new(NULL);
+
+  cr_assert(qdisk_serialize_msg(qdisk, mark_message, record));
+  for (gint i = 0; i < count; i++)
+    cr_assert(qdisk_push_tail(qdisk, record));
+
+  g_string_free(record, TRUE);
+  log_msg_unref(mark_message);
+}
+
+Test(diskq_reliable, test_dropping_pending_writes_keeps_the_reader_changes)
+{
+  const gchar *filename = "test_pending_writes.qf";
+  LogQueueDiskReliable *dq = _init_diskq_for_test(filename, QDISK_RESERVED_SPACE + 100000, 0);
+  QDisk *qdisk = dq->super.qdisk;
+  GString *record = g_string_new(NULL);
+
+  _push_mark_records(qdisk, 3);
+  cr_assert(qdisk_flush(qdisk));
+  gint64 write_head = qdisk_get_writer_head(qdisk);
+
+  _push_mark_records(qdisk, 2);
+  cr_assert(qdisk_pop_head(qdisk, record));
+  gint64 read_head = qdisk_get_reader_head(qdisk);
+  qdisk_set_backlog_head(qdisk, read_head);
+
+  _drop_pending_writes(qdisk);
+  cr_assert_eq(qdisk_get_writer_head(qdisk), write_head);
+  cr_assert_eq(qdisk_get_reader_head(qdisk), read_head, "The record read while writes were pending must stay read");
+  cr_assert_eq(qdisk_get_backlog_head(qdisk), read_head);
+  cr_assert_eq(qdisk_get_length(qdisk), 2);
+
+  g_string_free(record, TRUE);
+  _common_cleanup(dq, filename);
+}
+
 static void
 setup(void)
 {
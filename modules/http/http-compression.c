@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include "http-compression.h"
+#include "messages.h"
+
+#if SYSLOG_NG_ENABLE_ZLIB
+#include <zlib.h>
+#endif
+#if SYSLOG_NG_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <string.h>
+
+#define HTTP_ZLIB_WINDOW_BITS 15
+/* added to the window bits to have zlib write a gzip header instead of a zlib one */
+#define HTTP_ZLIB_GZIP_WRAPPER 16
+#define HTTP_ZLIB_MEM_LEVEL 8
+#define HTTP_ZSTD_LEVEL 1
+
+struct _HTTPCompressor
+{
+  HTTPCompression compression;
+#if SYSLOG_NG_ENABLE_ZLIB
+  z_stream zstream;
+#endif
+#if SYSLOG_NG_ENABLE_ZSTD
+  ZSTD_CCtx *cctx;
+#endif
+};
+
+static const gchar *http_compression_names[] =
+{
+  [HTTP_COMPRESSION_NONE] = "identity",
+  [HTTP_COMPRESSION_GZIP] = "gzip",
+  [HTTP_COMPRESSION_DEFLATE] = "deflate",
+  [HTTP_COMPRESSION_ZSTD] = "zstd",
+};
+
+gboolean
+http_compression_lookup(const gchar *name, HTTPCompression *compression)
+{
+  for (gint i = 0; i < G_N_ELEMENTS(http_compression_names); i++)
+    {
+      if (strcmp(name, http_compression_names[i]) != 0)
+        continue;
+
+#if !SYSLOG_NG_ENABLE_ZLIB
+      if (i == HTTP_COMPRESSION_GZIP || i == HTTP_COMPRESSION_DEFLATE)
+        return FALSE;
+#endif
+#if !SYSLOG_NG_ENABLE_ZSTD
+      if (i == HTTP_COMPRESSION_ZSTD)
+        return FALSE;
+#endif
+      *compression = i;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* the value of the Content-Encoding header, NULL if the body is sent as is */
+const gchar *
+http_compression_get_content_encoding(HTTPCompression compression)
+{
+  if (compression == HTTP_COMPRESSION_NONE)
+    return NULL;
+
+  return http_compression_names[compression];
+}
+
+#if SYSLOG_NG_ENABLE_ZLIB
+
+static gboolean
+_zlib_init(HTTPCompressor *self)
+{
+  gint window_bits = HTTP_ZLIB_WINDOW_BITS;
+
+  /* "deflate" in HTTP means the zlib format, not the raw deflate stream */
+  if (self->compression == HTTP_COMPRESSION_GZIP)
+    window_bits += HTTP_ZLIB_GZIP_WRAPPER;
+
+  return deflateInit2(&self->zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                      window_bits, HTTP_ZLIB_MEM_LEVEL, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+static gboolean
+_zlib_compress(HTTPCompressor *self, GString *compressed, const GString *body)
+{
+  if (deflateReset(&self->zstream) != Z_OK)
+    return FALSE;
+
+  g_string_set_size(compressed, deflateBound(&self->zstream, body->len));
+
+  self->zstream.next_in = (Bytef *) body->str;
+  self->zstream.avail_in = body->len;
+  self->zstream.next_out = (Bytef *) compressed->str;
+  self->zstream.avail_out = compressed->len;
+
+  if (deflate(&self->zstream, Z_FINISH) != Z_STREAM_END)
+    return FALSE;
+
+  g_string_set_size(compressed, self->zstream.total_out);
+  return TRUE;
+}
+
+#endif
+
+#if SYSLOG_NG_ENABLE_ZSTD
+
+static gboolean
+_zstd_compress(HTTPCompressor *self, GString *compressed, const GString *body)
+{
+  g_string_set_size(compressed, ZSTD_compressBound(body->len));
+  gsize compressed_len = ZSTD_compressCCtx(self->cctx, compressed->str, compressed->len,
+                                           body->str, body->len, HTTP_ZSTD_LEVEL);
+  if (ZSTD_isError(compressed_len))
+    return FALSE;
+
+  g_string_set_size(compressed, compressed_len);
+  return TRUE;
+}
+
+#endif
+
+gboolean
+http_compressor_compress(HTTPCompressor *self, GString *compressed, const GString *body)
+{
+  gboolean success = FALSE;
+
+  switch (self->compression)
+    {
+#if SYSLOG_NG_ENABLE_ZLIB
+    case HTTP_COMPRESSION_GZIP:
+    case HTTP_COMPRESSION_DEFLATE:
+      success = _zlib_compress(self, compressed, body);
+      break;
+#endif
+#if SYSLOG_NG_ENABLE_ZSTD
+    case HTTP_COMPRESSION_ZSTD:
+      success = _zstd_compress(self, compressed, body);
+      break;
+#endif
+    default:
+      g_assert_not_reached();
+    }
+
+  if (!success)
+    {
+      msg_error("http: error compressing request body",
+                evt_tag_str("compression", http_compression_names[self->compression]),
+                evt_tag_int("body_size", body->len));
+      g_string_truncate(compressed, 0);
+    }
+  return success;
+}
+
+HTTPCompressor *
+http_compressor_new(HTTPCompression compression)
+{
+  HTTPCompressor *self = g_new0(HTTPCompressor, 1);
+  gboolean initialized = FALSE;
+
+  self->compression = compression;
+  switch (compression)
+    {
+#if SYSLOG_NG_ENABLE_ZLIB
+    case HTTP_COMPRESSION_GZIP:
+    case HTTP_COMPRESSION_DEFLATE:
+      initialized = _zlib_init(self);
+      break;
+#endif
+#if SYSLOG_NG_ENABLE_ZSTD
+    case HTTP_COMPRESSION_ZSTD:
+      initialized = ((self->cctx = ZSTD_createCCtx()) != NULL);
+      break;
+#endif
+    default:
+      g_assert_not_reached();
+    }
+
+  if (!initialized)
+    {
+      g_free(self);
+      return NULL;
+    }
+  return self;
+}
+
+void
+http_compressor_free(HTTPCompressor *self)
+{
+  if (!self)
+    return;
+
+  switch (self->compression)
+    {
+#if SYSLOG_NG_ENABLE_ZLIB
+    case HTTP_COMPRESSION_GZIP:
+    case HTTP_COMPRESSION_DEFLATE:
+      deflateEnd(&self->zstream);
+      break;
+#endif
+#if SYSLOG_NG_ENABLE_ZSTD
+    case HTTP_COMPRESSION_ZSTD:
+      ZSTD_freeCCtx(self->cctx);
+      break;
+#endif
+    default:
+      break;
+    }
+  g_free(self);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#ifndef HTTP_COMPRESSION_H_INCLUDED
+#define HTTP_COMPRESSION_H_INCLUDED 1
+
+#include "syslog-ng.h"
+
+typedef enum
+{
+  HTTP_COMPRESSION_NONE,
+  HTTP_COMPRESSION_GZIP,
+  HTTP_COMPRESSION_DEFLATE,
+  HTTP_COMPRESSION_ZSTD,
+} HTTPCompression;
+
+gboolean http_compression_lookup(const gchar *name, HTTPCompression *compression);
+const gchar *http_compression_get_content_encoding(HTTPCompression compression);
+
+/* compressors keep their state between requests, they are owned by a single worker */
+typedef struct _HTTPCompressor HTTPCompressor;
+
+HTTPCompressor *http_compressor_new(HTTPCompression compression);
+gboolean http_compressor_compress(HTTPCompressor *self, GString *compressed, const GString *body);
+void http_compressor_free(HTTPCompressor *self);
+
+#endif
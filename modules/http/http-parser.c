@@ -57,6 +57,8 @@ static CfgLexerKeyword http_keywords[] =
   { "tls",              KW_TLS },
   { "flush_bytes",      KW_BATCH_BYTES, KWS_OBSOLETE, "The flush-bytes option is deprecated. Use batch-bytes instead." },
   { "batch_bytes",      KW_BATCH_BYTES },
+  { "content_compression", KW_CONTENT_COMPRESSION },
+  { "concurrent_requests", KW_CONCURRENT_REQUESTS },
   { "flush_lines",      KW_BATCH_LINES, KWS_OBSOLETE, "The flush-lines option is deprecated. Use batch-lines instead."},
   { "flush_timeout",    KW_BATCH_TIMEOUT, KWS_OBSOLETE, "The flush-timeout option is deprecated. Use batch-timeout instead."},
   { "body_prefix",      KW_BODY_PREFIX },
@@ -29,6 +29,7 @@
 #include "http-signals.h"
 
 #define HTTP_HEADER_FORMAT_ERROR http_header_format_error_quark()
+#define HTTP_CURL_MULTI_WAIT_MSEC 1000
 
 static GQuark http_header_format_error_quark(void)
 {
@@ -101,62 +102,62 @@ _curl_write_function(char *ptr, size_t size, size_t nmemb, void *userdata)
  * request specific options will be set separately
  */
 static void
-_setup_static_options_in_curl(HTTPDestinationWorker *self)
+_setup_static_options_in_curl(HTTPDestinationWorker *self, CURL *curl)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
-  curl_easy_reset(self->curl);
+  curl_easy_reset(curl);
 
-  curl_easy_setopt(self->curl, CURLOPT_WRITEFUNCTION, _curl_write_function);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, _curl_write_function);
 
-  curl_easy_setopt(self->curl, CURLOPT_URL, owner->url);
+  curl_easy_setopt(curl, CURLOPT_URL, owner->url);
 
   if (owner->user)
-    curl_easy_setopt(self->curl, CURLOPT_USERNAME, owner->user);
+    curl_easy_setopt(curl, CURLOPT_USERNAME, owner->user);
 
   if (owner->password)
-    curl_easy_setopt(self->curl, CURLOPT_PASSWORD, owner->password);
+    curl_easy_setopt(curl, CURLOPT_PASSWORD, owner->password);
 
   if (owner->user_agent)
-    curl_easy_setopt(self->curl, CURLOPT_USERAGENT, owner->user_agent);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, owner->user_agent);
 
   if (owner->ca_dir)
-    curl_easy_setopt(self->curl, CURLOPT_CAPATH, owner->ca_dir);
+    curl_easy_setopt(curl, CURLOPT_CAPATH, owner->ca_dir);
 
   if (owner->ca_file)
-    curl_easy_setopt(self->curl, CURLOPT_CAINFO, owner->ca_file);
+    curl_easy_setopt(curl, CURLOPT_CAINFO, owner->ca_file);
 
   if (owner->cert_file)
-    curl_easy_setopt(self->curl, CURLOPT_SSLCERT, owner->cert_file);
+    curl_easy_setopt(curl, CURLOPT_SSLCERT, owner->cert_file);
 
   if (owner->key_file)
-    curl_easy_setopt(self->curl, CURLOPT_SSLKEY, owner->key_file);
+    curl_easy_setopt(curl, CURLOPT_SSLKEY, owner->key_file);
 
   if (owner->ciphers)
-    curl_easy_setopt(self->curl, CURLOPT_SSL_CIPHER_LIST, owner->ciphers);
+    curl_easy_setopt(curl, CURLOPT_SSL_CIPHER_LIST, owner->ciphers);
 
   if (owner->proxy)
-    curl_easy_setopt(self->curl, CURLOPT_PROXY, owner->proxy);
+    curl_easy_setopt(curl, CURLOPT_PROXY, owner->proxy);
 
-  curl_easy_setopt(self->curl, CURLOPT_SSLVERSION, owner->ssl_version);
-  curl_easy_setopt(self->curl, CURLOPT_SSL_VERIFYHOST, owner->peer_verify ? 2L : 0L);
-  curl_easy_setopt(self->curl, CURLOPT_SSL_VERIFYPEER, owner->peer_verify ? 1L : 0L);
+  curl_easy_setopt(curl, CURLOPT_SSLVERSION, owner->ssl_version);
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, owner->peer_verify ? 2L : 0L);
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, owner->peer_verify ? 1L : 0L);
 
-  curl_easy_setopt(self->curl, CURLOPT_DEBUGFUNCTION, _curl_debug_function);
-  curl_easy_setopt(self->curl, CURLOPT_DEBUGDATA, self);
-  curl_easy_setopt(self->curl, CURLOPT_VERBOSE, 1L);
+  curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, _curl_debug_function);
+  curl_easy_setopt(curl, CURLOPT_DEBUGDATA, self);
+  curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
 
   if (owner->accept_redirects)
     {
-      curl_easy_setopt(self->curl, CURLOPT_FOLLOWLOCATION, 1);
-      curl_easy_setopt(self->curl, CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL);
-      curl_easy_setopt(self->curl, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
-      curl_easy_setopt(self->curl, CURLOPT_MAXREDIRS, 3);
+      curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
+      curl_easy_setopt(curl, CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL);
+      curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
+      curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 3);
     }
-  curl_easy_setopt(self->curl, CURLOPT_TIMEOUT, owner->timeout);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, owner->timeout);
 
   if (owner->method_type == METHOD_TYPE_PUT)
-    curl_easy_setopt(self->curl, CURLOPT_CUSTOMREQUEST, "PUT");
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
 }
 
 
@@ -200,13 +201,13 @@ _set_error_from_slot_result(const gchar *signal,
 }
 
 static void
-_collect_rest_headers(HTTPDestinationWorker *self, GError **error)
+_collect_rest_headers(HTTPDestinationWorker *self, HTTPRequest *request, GError **error)
 {
   HttpHeaderRequestSignalData signal_data =
   {
     .result = HTTP_SLOT_SUCCESS,
-    .request_headers = self->request_headers,
-    .request_body = self->request_body
+    .request_headers = request->headers,
+    .request_body = request->body
   };
 
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
@@ -217,7 +218,7 @@ _collect_rest_headers(HTTPDestinationWorker *self, GError **error)
 }
 
 static void
-_add_msg_specific_headers(HTTPDestinationWorker *self, LogMessage *msg)
+_add_msg_specific_headers(HTTPDestinationWorker *self, HTTPRequest *request, LogMessage *msg)
 {
   /* NOTE: I have my doubts that these headers make sense at all.  None of
    * the HTTP collectors I know of, extract this information from the
@@ -226,60 +227,61 @@ _add_msg_specific_headers(HTTPDestinationWorker *self, LogMessage *msg)
    * backward compatibility when batching was introduced, however I think
    * this should eventually be removed */
 
-  _add_header(self->request_headers,
+  _add_header(request->headers,
               "X-Syslog-Host",
               log_msg_get_value(msg, LM_V_HOST, NULL));
-  _add_header(self->request_headers,
+  _add_header(request->headers,
               "X-Syslog-Program",
               log_msg_get_value(msg, LM_V_PROGRAM, NULL));
-  _add_header(self->request_headers,
+  _add_header(request->headers,
               "X-Syslog-Facility",
               syslog_name_lookup_facility_by_value(msg->pri & LOG_FACMASK));
-  _add_header(self->request_headers,
+  _add_header(request->headers,
               "X-Syslog-Level",
               syslog_name_lookup_severity_by_value(msg->pri & LOG_PRIMASK));
 }
 
 static void
-_add_common_headers(HTTPDestinationWorker *self)
+_add_common_headers(HTTPDestinationWorker *self, HTTPRequest *request)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
-  _add_header(self->request_headers, "Expect", "");
+  _add_header(request->headers, "Expect", "");
   for (GList *l = owner->headers; l; l = l->next)
-    list_append(self->request_headers, l->data);
+    list_append(request->headers, l->data);
 }
 
 static gboolean
-_try_format_request_headers(HTTPDestinationWorker *self, GError **error)
+_try_format_request_headers(HTTPDestinationWorker *self, HTTPRequest *request, GError **error)
 {
-  _add_common_headers(self);
+  _add_common_headers(self, request);
 
-  _collect_rest_headers(self, error);
+  _collect_rest_headers(self, request, error);
 
   return (*error == NULL);
 }
 
 static void
-_add_message_to_batch(HTTPDestinationWorker *self, LogMessage *msg)
+_add_message_to_batch(HTTPDestinationWorker *self, HTTPRequest *request, LogMessage *msg)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
-  if (self->super.batch_size > 1)
+  if (request->batch_size > 0)
     {
-      g_string_append_len(self->request_body, owner->delimiter->str, owner->delimiter->len);
+      g_string_append_len(request->body, owner->delimiter->str, owner->delimiter->len);
     }
   if (owner->body_template)
     {
       LogTemplateEvalOptions options = {&owner->template_options, LTZ_SEND,
                                         self->super.seq_num, NULL
                                        };
-      log_template_append_format(owner->body_template, msg, &options, self->request_body);
+      log_template_append_format(owner->body_template, msg, &options, request->body);
     }
   else
     {
-      g_string_append(self->request_body, log_msg_get_value(msg, LM_V_MESSAGE, NULL));
+      g_string_append(request->body, log_msg_get_value(msg, LM_V_MESSAGE, NULL));
     }
+  request->batch_size++;
 }
 
 static gboolean
@@ -397,46 +399,77 @@ default_map_http_status_to_worker_status(HTTPDestinationWorker *self, const gcha
 }
 
 static void
-_reinit_request_headers(HTTPDestinationWorker *self)
+_reinit_request_headers(HTTPDestinationWorker *self, HTTPRequest *request)
 {
-  list_remove_all(self->request_headers);
+  list_remove_all(request->headers);
 }
 
 static void
-_reinit_request_body(HTTPDestinationWorker *self)
+_reinit_request_body(HTTPDestinationWorker *self, HTTPRequest *request)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
-  g_string_truncate(self->request_body, 0);
+  g_string_truncate(request->body, 0);
   if (owner->body_prefix->len > 0)
-    g_string_append_len(self->request_body, owner->body_prefix->str, owner->body_prefix->len);
+    g_string_append_len(request->body, owner->body_prefix->str, owner->body_prefix->len);
 
+  request->payload = request->body;
+  request->batch_size = 0;
 }
 
 static void
-_finish_request_body(HTTPDestinationWorker *self)
+_reinit_requests(HTTPDestinationWorker *self)
+{
+  for (gint i = 0; i <= self->current_request; i++)
+    {
+      _reinit_request_headers(self, &self->requests[i]);
+      _reinit_request_body(self, &self->requests[i]);
+    }
+  self->current_request = 0;
+}
+
+static void
+_finish_request_body(HTTPDestinationWorker *self, HTTPRequest *request)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
   if (owner->body_suffix->len > 0)
-    g_string_append_len(self->request_body, owner->body_suffix->str, owner->body_suffix->len);
+    g_string_append_len(request->body, owner->body_suffix->str, owner->body_suffix->len);
+}
+
+/* the uncompressed body is sent if compression fails for some reason */
+static void
+_compress_request_body(HTTPDestinationWorker *self, HTTPRequest *request)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+
+  if (!self->compressor)
+    return;
+
+  if (!http_compressor_compress(self->compressor, request->compressed_body, request->body))
+    return;
+
+  _add_header(request->headers, "Content-Encoding", http_compression_get_content_encoding(owner->compression));
+  request->payload = request->compressed_body;
 }
 
 static void
-_debug_response_info(HTTPDestinationWorker *self, HTTPLoadBalancerTarget *target, glong http_code)
+_debug_response_info(HTTPDestinationWorker *self, HTTPRequest *request, HTTPLoadBalancerTarget *target,
+                     glong http_code)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
   gdouble total_time = 0;
   glong redirect_count = 0;
 
-  curl_easy_getinfo(self->curl, CURLINFO_TOTAL_TIME, &total_time);
-  curl_easy_getinfo(self->curl, CURLINFO_REDIRECT_COUNT, &redirect_count);
+  curl_easy_getinfo(request->curl, CURLINFO_TOTAL_TIME, &total_time);
+  curl_easy_getinfo(request->curl, CURLINFO_REDIRECT_COUNT, &redirect_count);
   msg_debug("curl: HTTP response received",
             evt_tag_str("url", target->url),
             evt_tag_int("status_code", http_code),
-            evt_tag_int("body_size", self->request_body->len),
-            evt_tag_int("batch_size", self->super.batch_size),
+            evt_tag_int("body_size", request->body->len),
+            evt_tag_int("payload_size", request->payload->len),
+            evt_tag_int("batch_size", request->batch_size),
             evt_tag_int("redirected", redirect_count != 0),
             evt_tag_printf("total_time", "%.3f", total_time),
             evt_tag_int("worker_index", self->super.worker_index),
@@ -497,24 +530,28 @@ _custom_map_http_result(HTTPDestinationWorker *self, const gchar *url, HttpRespo
   return LTR_MAX;
 }
 
-static gboolean
-_curl_perform_request(HTTPDestinationWorker *self, HTTPLoadBalancerTarget *target)
+static void
+_setup_request_in_curl(HTTPDestinationWorker *self, HTTPRequest *request, HTTPLoadBalancerTarget *target)
 {
-  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
-
   msg_trace("Sending HTTP request",
             evt_tag_str("url", target->url));
 
-  curl_easy_setopt(self->curl, CURLOPT_URL, target->url);
-  curl_easy_setopt(self->curl, CURLOPT_HTTPHEADER, http_curl_header_list_as_slist(self->request_headers));
-  curl_easy_setopt(self->curl, CURLOPT_POSTFIELDS, self->request_body->str);
+  curl_easy_setopt(request->curl, CURLOPT_URL, target->url);
+  curl_easy_setopt(request->curl, CURLOPT_HTTPHEADER, http_curl_header_list_as_slist(request->headers));
+  curl_easy_setopt(request->curl, CURLOPT_POSTFIELDSIZE, (long) request->payload->len);
+  curl_easy_setopt(request->curl, CURLOPT_POSTFIELDS, request->payload->str);
+}
 
-  CURLcode ret = curl_easy_perform(self->curl);
-  if (ret != CURLE_OK)
+static gboolean
+_curl_check_result(HTTPDestinationWorker *self, HTTPRequest *request, HTTPLoadBalancerTarget *target)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+
+  if (request->curl_result != CURLE_OK)
     {
       msg_error("curl: error sending HTTP request",
                 evt_tag_str("url", target->url),
-                evt_tag_str("error", curl_easy_strerror(ret)),
+                evt_tag_str("error", curl_easy_strerror(request->curl_result)),
                 evt_tag_int("worker_index", self->super.worker_index),
                 evt_tag_str("driver", owner->super.super.super.id),
                 log_pipe_location_tag(&owner->super.super.super.super));
@@ -524,11 +561,19 @@ _curl_perform_request(HTTPDestinationWorker *self, HTTPLoadBalancerTarget *targe
   return TRUE;
 }
 
+static void
+_curl_perform_request(HTTPDestinationWorker *self, HTTPRequest *request, HTTPLoadBalancerTarget *target)
+{
+  _setup_request_in_curl(self, request, target);
+  request->curl_result = curl_easy_perform(request->curl);
+}
+
 static gboolean
-_curl_get_status_code(HTTPDestinationWorker *self, HTTPLoadBalancerTarget *target, glong *http_code)
+_curl_get_status_code(HTTPDestinationWorker *self, HTTPRequest *request, HTTPLoadBalancerTarget *target,
+                      glong *http_code)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
-  CURLcode ret = curl_easy_getinfo(self->curl, CURLINFO_RESPONSE_CODE, http_code);
+  CURLcode ret = curl_easy_getinfo(request->curl, CURLINFO_RESPONSE_CODE, http_code);
 
   if (ret != CURLE_OK)
     {
@@ -569,20 +614,20 @@ _map_http_status_code(HTTPDestinationWorker *self, const gchar *url, glong http_
 }
 
 static LogThreadedResult
-_flush_on_target(HTTPDestinationWorker *self, HTTPLoadBalancerTarget *target)
+_process_response(HTTPDestinationWorker *self, HTTPRequest *request, HTTPLoadBalancerTarget *target)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
-  if (!_curl_perform_request(self, target))
+  if (!_curl_check_result(self, request, target))
     return LTR_NOT_CONNECTED;
 
   glong http_code = 0;
 
-  if (!_curl_get_status_code(self, target, &http_code))
+  if (!_curl_get_status_code(self, request, target, &http_code))
     return LTR_NOT_CONNECTED;
 
   if (debug_flag)
-    _debug_response_info(self, target, http_code);
+    _debug_response_info(self, request, target, http_code);
 
   HttpResponseReceivedSignalData signal_data =
   {
@@ -602,6 +647,13 @@ _flush_on_target(HTTPDestinationWorker *self, HTTPLoadBalancerTarget *target)
   return _map_http_status_code(self, target->url, http_code);
 }
 
+static LogThreadedResult
+_flush_on_target(HTTPDestinationWorker *self, HTTPRequest *request, HTTPLoadBalancerTarget *target)
+{
+  _curl_perform_request(self, request, target);
+  return _process_response(self, request, target);
+}
+
 static gboolean
 _format_request_headers_error_is_critical(GError *error)
 {
@@ -637,42 +689,39 @@ _format_request_headers_catch_error(GError **error)
   return !unhandled;
 }
 
-/* we flush the accumulated data if
- *   1) we reach batch_size,
- *   2) the message queue becomes empty
- */
-static LogThreadedResult
-_flush(LogThreadedDestWorker *s, LogThreadedFlushMode mode)
+static gboolean
+_prepare_request(HTTPDestinationWorker *self, HTTPRequest *request)
 {
-  HTTPDestinationWorker *self = (HTTPDestinationWorker *) s;
-  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) s->owner;
-  HTTPLoadBalancerTarget *target, *alt_target = NULL;
-  LogThreadedResult retval = LTR_NOT_CONNECTED;
-  gint retry_attempts = owner->load_balancer->num_targets;
   GError *error = NULL;
 
-  if (self->super.batch_size == 0)
-    return LTR_SUCCESS;
-
-  if (mode == LTF_FLUSH_EXPEDITE)
-    return LTR_RETRY;
+  _finish_request_body(self, request);
 
-  _finish_request_body(self);
-
-  if (!_try_format_request_headers(self, &error))
+  if (!_try_format_request_headers(self, request, &error))
     {
       if (!_format_request_headers_catch_error(&error))
-        return LTR_NOT_CONNECTED;
+        return FALSE;
     }
 
+  _compress_request_body(self, request);
+  return TRUE;
+}
+
+static LogThreadedResult
+_flush_request(HTTPDestinationWorker *self, HTTPRequest *request)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+  HTTPLoadBalancerTarget *target, *alt_target = NULL;
+  LogThreadedResult retval = LTR_NOT_CONNECTED;
+  gint retry_attempts = owner->load_balancer->num_targets;
+
   target = http_load_balancer_choose_target(owner->load_balancer, &self->lbc);
 
   while (--retry_attempts >= 0)
     {
-      retval = _flush_on_target(self, target);
+      retval = _flush_on_target(self, request, target);
       if (retval == LTR_SUCCESS)
         {
-          gsize msg_length = self->request_body->len;
+          gsize msg_length = request->body->len;
           log_threaded_dest_driver_insert_batch_length_stats(self->super.owner, msg_length);
 
           http_load_balancer_set_target_successful(owner->load_balancer, target);
@@ -701,32 +750,182 @@ _flush(LogThreadedDestWorker *s, LogThreadedFlushMode mode)
       target = alt_target;
     }
 
-  _reinit_request_headers(self);
-  _reinit_request_body(self);
+  return retval;
+}
+
+static void
+_curl_multi_perform_requests(HTTPDestinationWorker *self, gint num_requests, HTTPLoadBalancerTarget *target)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+  CURLMcode ret = CURLM_OK;
+  gint running = 0;
+
+  for (gint i = 0; i < num_requests; i++)
+    {
+      HTTPRequest *request = &self->requests[i];
+
+      _setup_request_in_curl(self, request, target);
+      request->curl_result = CURLE_SEND_ERROR;
+      curl_multi_add_handle(self->multi, request->curl);
+    }
+
+  do
+    {
+      ret = curl_multi_perform(self->multi, &running);
+      if (ret == CURLM_OK && running)
+        ret = curl_multi_wait(self->multi, NULL, 0, HTTP_CURL_MULTI_WAIT_MSEC, NULL);
+    }
+  while (ret == CURLM_OK && running);
+
+  if (ret != CURLM_OK)
+    {
+      msg_error("curl: error sending HTTP requests",
+                evt_tag_str("url", target->url),
+                evt_tag_str("error", curl_multi_strerror(ret)),
+                evt_tag_int("worker_index", self->super.worker_index),
+                evt_tag_str("driver", owner->super.super.super.id),
+                log_pipe_location_tag(&owner->super.super.super.super));
+    }
+
+  CURLMsg *info;
+  gint msgs_left;
+  while ((info = curl_multi_info_read(self->multi, &msgs_left)))
+    {
+      if (info->msg != CURLMSG_DONE)
+        continue;
+
+      for (gint i = 0; i < num_requests; i++)
+        {
+          if (self->requests[i].curl == info->easy_handle)
+            self->requests[i].curl_result = info->data.result;
+        }
+    }
+
+  for (gint i = 0; i < num_requests; i++)
+    curl_multi_remove_handle(self->multi, self->requests[i].curl);
+}
+
+/*
+ * The requests are sent at the same time and the responses are processed
+ * in the order of the requests: the messages of the successful requests
+ * are acknowledged up to the first failed one, whose result applies to the
+ * rest of the batch.  The requests after that are sent again, even if they
+ * succeeded.  There is no failover to other targets within a flush, the
+ * load balancer chooses again when the batch is retried.
+ */
+static LogThreadedResult
+_flush_requests_concurrently(HTTPDestinationWorker *self, gint num_requests)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+  HTTPLoadBalancerTarget *target = http_load_balancer_choose_target(owner->load_balancer, &self->lbc);
+  gboolean target_failed = FALSE;
+
+  _curl_multi_perform_requests(self, num_requests, target);
+
+  for (gint i = 0; i < num_requests; i++)
+    {
+      HTTPRequest *request = &self->requests[i];
+      LogThreadedResult result = _process_response(self, request, target);
+
+      if (result == LTR_SUCCESS)
+        {
+          log_threaded_dest_driver_insert_batch_length_stats(self->super.owner, request->body->len);
+          log_threaded_dest_worker_ack_messages(&self->super, request->batch_size);
+          continue;
+        }
+
+      http_load_balancer_set_target_failed(owner->load_balancer, target);
+      target_failed = TRUE;
+
+      if (result != LTR_DROP)
+        return result;
+
+      log_threaded_dest_worker_drop_messages(&self->super, request->batch_size);
+    }
+
+  if (!target_failed)
+    http_load_balancer_set_target_successful(owner->load_balancer, target);
+  return LTR_SUCCESS;
+}
+
+static gint
+_count_requests_to_flush(HTTPDestinationWorker *self)
+{
+  if (self->requests[self->current_request].batch_size == 0)
+    return self->current_request;
+  return self->current_request + 1;
+}
+
+/* we flush the accumulated data if
+ *   1) we reach batch_size,
+ *   2) the message queue becomes empty
+ */
+static LogThreadedResult
+_flush(LogThreadedDestWorker *s, LogThreadedFlushMode mode)
+{
+  HTTPDestinationWorker *self = (HTTPDestinationWorker *) s;
+  LogThreadedResult retval = LTR_NOT_CONNECTED;
+
+  if (self->super.batch_size == 0)
+    return LTR_SUCCESS;
+
+  if (mode == LTF_FLUSH_EXPEDITE)
+    return LTR_RETRY;
+
+  gint num_requests = _count_requests_to_flush(self);
+  gboolean prepared = TRUE;
+
+  for (gint i = 0; i < num_requests && prepared; i++)
+    prepared = _prepare_request(self, &self->requests[i]);
+
+  if (prepared)
+    {
+      if (num_requests == 1)
+        retval = _flush_request(self, &self->requests[0]);
+      else
+        retval = _flush_requests_concurrently(self, num_requests);
+    }
+
+  _reinit_requests(self);
 
   return retval;
 }
 
 static gboolean
-_should_initiate_flush(HTTPDestinationWorker *self)
+_should_initiate_flush(HTTPDestinationWorker *self, HTTPRequest *request)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
-  return (owner->batch_bytes && self->request_body->len + owner->body_suffix->len >= owner->batch_bytes);
+  if (owner->concurrent_requests > 1 && request->batch_size >= owner->request_batch_lines)
+    return TRUE;
+
+  return (owner->batch_bytes && request->body->len + owner->body_suffix->len >= owner->batch_bytes);
 
 }
 
+/* returns FALSE if all requests are full, and they need to be flushed */
+static gboolean
+_start_next_request(HTTPDestinationWorker *self)
+{
+  if (self->current_request + 1 >= self->num_requests)
+    return FALSE;
+
+  self->current_request++;
+  return TRUE;
+}
+
 static LogThreadedResult
 _insert_batched(LogThreadedDestWorker *s, LogMessage *msg)
 {
   HTTPDestinationWorker *self = (HTTPDestinationWorker *) s;
+  HTTPRequest *request = &self->requests[self->current_request];
 
-  gsize orig_msg_len = self->request_body->len;
-  _add_message_to_batch(self, msg);
-  gsize diff_msg_len = self->request_body->len - orig_msg_len;
+  gsize orig_msg_len = request->body->len;
+  _add_message_to_batch(self, request, msg);
+  gsize diff_msg_len = request->body->len - orig_msg_len;
   log_threaded_dest_driver_insert_msg_length_stats(self->super.owner, diff_msg_len);
 
-  if (_should_initiate_flush(self))
+  if (_should_initiate_flush(self, request) && !_start_next_request(self))
     {
       return log_threaded_dest_worker_flush(&self->super, LTF_FLUSH_NORMAL);
     }
@@ -737,36 +936,87 @@ static LogThreadedResult
 _insert_single(LogThreadedDestWorker *s, LogMessage *msg)
 {
   HTTPDestinationWorker *self = (HTTPDestinationWorker *) s;
+  HTTPRequest *request = &self->requests[self->current_request];
 
-  gsize orig_msg_len = self->request_body->len;
-  _add_message_to_batch(self, msg);
-  gsize diff_msg_len = self->request_body->len - orig_msg_len;
+  gsize orig_msg_len = request->body->len;
+  _add_message_to_batch(self, request, msg);
+  gsize diff_msg_len = request->body->len - orig_msg_len;
   log_threaded_dest_driver_insert_msg_length_stats(self->super.owner, diff_msg_len);
 
-  _add_msg_specific_headers(self, msg);
+  _add_msg_specific_headers(self, request, msg);
 
   return log_threaded_dest_worker_flush(&self->super, LTF_FLUSH_NORMAL);
 }
 
+static gboolean
+_init_request(HTTPDestinationWorker *self, HTTPRequest *request)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+
+  request->body = g_string_sized_new(32768);
+  request->compressed_body = g_string_new(NULL);
+  request->headers = http_curl_header_list_new();
+  if (!(request->curl = curl_easy_init()))
+    {
+      msg_error("curl: cannot initialize libcurl",
+                evt_tag_int("worker_index", self->super.worker_index),
+                evt_tag_str("driver", owner->super.super.super.id),
+                log_pipe_location_tag(&owner->super.super.super.super));
+      return FALSE;
+    }
+  _setup_static_options_in_curl(self, request->curl);
+  _reinit_request_headers(self, request);
+  _reinit_request_body(self, request);
+  return TRUE;
+}
+
+static void
+_deinit_request(HTTPDestinationWorker *self, HTTPRequest *request)
+{
+  if (request->body)
+    g_string_free(request->body, TRUE);
+  if (request->compressed_body)
+    g_string_free(request->compressed_body, TRUE);
+  if (request->headers)
+    list_free(request->headers);
+  if (request->curl)
+    curl_easy_cleanup(request->curl);
+}
+
 static gboolean
 _thread_init(LogThreadedDestWorker *s)
 {
   HTTPDestinationWorker *self = (HTTPDestinationWorker *) s;
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
-  self->request_body = g_string_sized_new(32768);
-  self->request_headers = http_curl_header_list_new();
-  if (!(self->curl = curl_easy_init()))
+  self->num_requests = owner->concurrent_requests;
+  self->current_request = 0;
+  self->requests = g_new0(HTTPRequest, self->num_requests);
+  for (gint i = 0; i < self->num_requests; i++)
     {
-      msg_error("curl: cannot initialize libcurl",
+      if (!_init_request(self, &self->requests[i]))
+        return FALSE;
+    }
+
+  if (self->num_requests > 1 && !(self->multi = curl_multi_init()))
+    {
+      msg_error("curl: cannot initialize libcurl multi interface",
+                evt_tag_int("worker_index", self->super.worker_index),
+                evt_tag_str("driver", owner->super.super.super.id),
+                log_pipe_location_tag(&owner->super.super.super.super));
+      return FALSE;
+    }
+
+  if (owner->compression != HTTP_COMPRESSION_NONE &&
+      !(self->compressor = http_compressor_new(owner->compression)))
+    {
+      msg_error("http: cannot initialize content-compression()",
+                evt_tag_str("compression", http_compression_get_content_encoding(owner->compression)),
                 evt_tag_int("worker_index", self->super.worker_index),
                 evt_tag_str("driver", owner->super.super.super.id),
                 log_pipe_location_tag(&owner->super.super.super.super));
       return FALSE;
     }
-  _setup_static_options_in_curl(self);
-  _reinit_request_headers(self);
-  _reinit_request_body(self);
   return log_threaded_dest_worker_init_method(s);
 }
 
@@ -775,9 +1025,17 @@ _thread_deinit(LogThreadedDestWorker *s)
 {
   HTTPDestinationWorker *self = (HTTPDestinationWorker *) s;
 
-  g_string_free(self->request_body, TRUE);
-  list_free(self->request_headers);
-  curl_easy_cleanup(self->curl);
+  for (gint i = 0; i < self->num_requests; i++)
+    _deinit_request(self, &self->requests[i]);
+  g_free(self->requests);
+  self->requests = NULL;
+  self->num_requests = 0;
+
+  if (self->multi)
+    curl_multi_cleanup(self->multi);
+  self->multi = NULL;
+  http_compressor_free(self->compressor);
+  self->compressor = NULL;
   log_threaded_dest_worker_deinit_method(s);
 }
 
@@ -28,14 +28,32 @@
 #include "logthrdest/logthrdestdrv.h"
 #include "http-loadbalancer.h"
 #include "http-curl-header-list.h"
+#include "http-compression.h"
+
+typedef struct _HTTPRequest
+{
+  CURL *curl;
+  GString *body;
+  GString *compressed_body;
+  /* either body or compressed_body, whichever is sent */
+  GString *payload;
+  List *headers;
+  gint batch_size;
+  CURLcode curl_result;
+} HTTPRequest;
 
 typedef struct _HTTPDestinationWorker
 {
   LogThreadedDestWorker super;
   HTTPLoadBalancerClient lbc;
-  CURL *curl;
-  GString *request_body;
-  List *request_headers;
+  HTTPCompressor *compressor;
+
+  /* concurrent-requests() requests, the ones before the current one are
+   * full and wait for the flush, they are sent together using multi */
+  HTTPRequest *requests;
+  gint num_requests;
+  gint current_request;
+  CURLM *multi;
 } HTTPDestinationWorker;
 
 LogThreadedResult default_map_http_status_to_worker_status(HTTPDestinationWorker *self, const gchar *url,
@@ -279,6 +279,22 @@ http_dd_set_batch_bytes(LogDriver *d, glong batch_bytes)
   self->batch_bytes = batch_bytes;
 }
 
+gboolean
+http_dd_set_compression(LogDriver *d, const gchar *compression)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  return http_compression_lookup(compression, &self->compression);
+}
+
+void
+http_dd_set_concurrent_requests(LogDriver *d, gint concurrent_requests)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  self->concurrent_requests = concurrent_requests;
+}
+
 void
 http_dd_set_body_prefix(LogDriver *d, const gchar *body_prefix)
 {
@@ -356,6 +372,23 @@ http_dd_init(LogPipe *s)
                   evt_tag_int("workers", self->super.num_workers),
                   log_pipe_location_tag(&self->super.super.super.super));
     }
+  if (self->concurrent_requests > 1 && self->request_batch_lines <= 0 && self->super.batch_lines <= 0)
+    {
+      msg_warning("WARNING: concurrent-requests() has no effect without batch-lines(), sending one request at a time",
+                  evt_tag_int("concurrent_requests", self->concurrent_requests),
+                  log_pipe_location_tag(&self->super.super.super.super));
+      self->concurrent_requests = 1;
+    }
+
+  /* a worker flushes once all of its concurrent requests are full, init
+   * may run again on the same instance if a reload is reverted */
+  if (self->concurrent_requests > 1)
+    {
+      if (self->request_batch_lines <= 0)
+        self->request_batch_lines = self->super.batch_lines;
+      self->super.batch_lines = self->request_batch_lines * self->concurrent_requests;
+    }
+
   /* we need to set up url before we call the inherited init method, so our stats key is correct */
   self->url = self->load_balancer->targets[0].url;
 
@@ -423,6 +456,8 @@ http_dd_new(GlobalConfig *cfg)
   /* disable batching even if the global batch_lines is specified */
   self->super.batch_lines = 0;
   self->batch_bytes = 0;
+  self->compression = HTTP_COMPRESSION_NONE;
+  self->concurrent_requests = 1;
   self->body_prefix = g_string_new("");
   self->body_suffix = g_string_new("");
   self->delimiter = g_string_new("\n");
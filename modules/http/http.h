@@ -31,6 +31,7 @@
 #include "logthrdest/logthrdestdrv.h"
 #include "http-loadbalancer.h"
 #include "response-handler.h"
+#include "http-compression.h"
 
 typedef struct
 {
@@ -59,6 +60,10 @@ typedef struct
   short int method_type;
   glong timeout;
   glong batch_bytes;
+  HTTPCompression compression;
+  gint concurrent_requests;
+  /* batch-lines() as configured, batch_lines of the super class covers all concurrent requests */
+  gint request_batch_lines;
   LogTemplate *body_template;
   LogTemplateOptions template_options;
   HttpResponseHandlers *response_handlers;
@@ -86,6 +91,8 @@ gboolean http_dd_set_ssl_version(LogDriver *d, const gchar *value);
 void http_dd_set_peer_verify(LogDriver *d, gboolean verify);
 void http_dd_set_timeout(LogDriver *d, glong timeout);
 void http_dd_set_batch_bytes(LogDriver *d, glong batch_bytes);
+gboolean http_dd_set_compression(LogDriver *d, const gchar *compression);
+void http_dd_set_concurrent_requests(LogDriver *d, gint concurrent_requests);
 void http_dd_set_body_prefix(LogDriver *d, const gchar *body_prefix);
 void http_dd_set_body_suffix(LogDriver *d, const gchar *body_suffix);
 void http_dd_set_delimiter(LogDriver *d, const gchar *delimiter);
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include <criterion/criterion.h>
+
+#include "http-compression.h"
+#include "apphook.h"
+
+#if SYSLOG_NG_ENABLE_ZLIB
+#include <zlib.h>
+
+static GString *
+_create_body(void)
+{
+  GString *body = g_string_new(NULL);
+
+  for (gint i = 0; i < 1000; i++)
+    g_string_append_printf(body, "{\"MESSAGE\":\"message number %d\",\"HOST\":\"localhost\"}\n", i);
+  return body;
+}
+
+static void
+_assert_inflates_to(const GString *compressed, const GString *expected)
+{
+  z_stream zstream = { 0 };
+  GString *inflated = g_string_new(NULL);
+
+  /* detects both the gzip and the zlib header */
+  cr_assert_eq(inflateInit2(&zstream, 15 + 32), Z_OK);
+
+  g_string_set_size(inflated, expected->len + 1);
+  zstream.next_in = (Bytef *) compressed->str;
+  zstream.avail_in = compressed->len;
+  zstream.next_out = (Bytef *) inflated->str;
+  zstream.avail_out = inflated->len;
+
+  cr_assert_eq(inflate(&zstream, Z_FINISH), Z_STREAM_END);
+  g_string_set_size(inflated, zstream.total_out);
+  inflateEnd(&zstream);
+
+  cr_assert_eq(inflated->len, expected->len);
+  cr_assert_str_eq(inflated->str, expected->str);
+  g_string_free(inflated, TRUE);
+}
+
+static void
+_assert_compressor_round_trip(HTTPCompression compression)
+{
+  HTTPCompressor *compressor = http_compressor_new(compression);
+  GString *body = _create_body();
+  GString *compressed = g_string_new(NULL);
+
+  cr_assert_not_null(compressor);
+
+  /* the compressor is reused between requests */
+  for (gint i = 0; i < 2; i++)
+    {
+      cr_assert(http_compressor_compress(compressor, compressed, body));
+      cr_assert_lt(compressed->len, body->len);
+      _assert_inflates_to(compressed, body);
+    }
+
+  g_string_free(compressed, TRUE);
+  g_string_free(body, TRUE);
+  http_compressor_free(compressor);
+}
+
+#endif
+
+TestSuite(http_compression, .init = app_startup, .fini = app_shutdown);
+
+Test(http_compression, test_lookup)
+{
+  HTTPCompression compression = HTTP_COMPRESSION_NONE;
+
+#if SYSLOG_NG_ENABLE_ZLIB
+  cr_assert(http_compression_lookup("gzip", &compression));
+  cr_assert_eq(compression, HTTP_COMPRESSION_GZIP);
+  cr_assert_str_eq(http_compression_get_content_encoding(compression), "gzip");
+
+  cr_assert(http_compression_lookup("deflate", &compression));
+  cr_assert_eq(compression, HTTP_COMPRESSION_DEFLATE);
+  cr_assert_str_eq(http_compression_get_content_encoding(compression), "deflate");
+#else
+  cr_assert_not(http_compression_lookup("gzip", &compression));
+  cr_assert_not(http_compression_lookup("deflate", &compression));
+#endif
+
+  cr_assert(http_compression_lookup("identity", &compression));
+  cr_assert_eq(compression, HTTP_COMPRESSION_NONE);
+  cr_assert_null(http_compression_get_content_encoding(compression));
+
+  cr_assert_not(http_compression_lookup("brotli", &compression));
+  cr_assert_eq(compression, HTTP_COMPRESSION_NONE);
+}
+
+#if SYSLOG_NG_ENABLE_ZLIB
+
+Test(http_compression, test_gzip)
+{
+  HTTPCompressor *compressor = http_compressor_new(HTTP_COMPRESSION_GZIP);
+  GString *body = g_string_new("payload");
+  GString *compressed = g_string_new(NULL);
+
+  cr_assert(http_compressor_compress(compressor, compressed, body));
+  cr_assert_gt(compressed->len, 2);
+  cr_assert_eq((guchar) compressed->str[0], 0x1f);
+  cr_assert_eq((guchar) compressed->str[1], 0x8b);
+
+  g_string_free(compressed, TRUE);
+  g_string_free(body, TRUE);
+  http_compressor_free(compressor);
+
+  _assert_compressor_round_trip(HTTP_COMPRESSION_GZIP);
+}
+
+Test(http_compression, test_deflate)
+{
+  _assert_compressor_round_trip(HTTP_COMPRESSION_DEFLATE);
+}
+
+#endif
@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2021 One Identity
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include <criterion/criterion.h>
+
+#include "http.h"
+#include "http-worker.h"
+#include "response-handler.h"
+#include "apphook.h"
+#include "mainloop.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+
+/*
+ * Drives the http() worker with concurrent-requests() against a minimal
+ * HTTP server on the loopback interface, which records the request bodies
+ * and responds with 200 to each of them.  The outcome of the responses is
+ * decided by a response handler following a script, in the order the
+ * worker processes them.
+ */
+
+#define CONCURRENT_REQUESTS 3
+#define REQUEST_BATCH_LINES 2
+#define NUM_MESSAGES (CONCURRENT_REQUESTS * REQUEST_BATCH_LINES)
+#define MAX_SCRIPTED_RESULTS 8
+
+typedef struct _TestHttpServer
+{
+  gint listen_fd;
+  gint port;
+  GThread *thread;
+  GMutex lock;
+  GPtrArray *bodies;
+} TestHttpServer;
+
+static TestHttpServer server;
+
+static gssize
+_find_content_length(const gchar *headers)
+{
+  gchar *lowercase_headers = g_ascii_strdown(headers, -1);
+  const gchar *value = strstr(lowercase_headers, "content-length:");
+  gssize content_length = value ? atoi(value + strlen("content-length:")) : 0;
+
+  g_free(lowercase_headers);
+  return content_length;
+}
+
+/* returns the body of the request, or NULL if the client went away */
+static gchar *
+_read_request_body(gint fd)
+{
+  GString *request = g_string_new(NULL);
+  gchar buf[1024];
+  gssize header_len = -1;
+  gssize content_length = 0;
+  gchar *body = NULL;
+  gssize rc;
+
+  while ((rc = read(fd, buf, sizeof(buf))) > 0)
+    {
+      g_string_append_len(request, buf, rc);
+      if (header_len < 0)
+        {
+          const gchar *end_of_headers = strstr(request->str, "\r\n\r\n");
+
+          if (!end_of_headers)
+            continue;
+
+          header_len = end_of_headers + 4 - request->str;
+          content_length = _find_content_length(request->str);
+        }
+
+      if (request->len >= header_len + content_length)
+        {
+          body = g_strndup(request->str + header_len, content_length);
+          break;
+        }
+    }
+
+  g_string_free(request, TRUE);
+  return body;
+}
+
+static gpointer
+_server_thread(gpointer user_data)
+{
+  const gchar response[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+  gint fd;
+
+  while ((fd = accept(server.listen_fd, NULL, NULL)) >= 0)
+    {
+      gchar *body = _read_request_body(fd);
+
+      if (body)
+        {
+          g_mutex_lock(&server.lock);
+          g_ptr_array_add(server.bodies, body);
+          g_mutex_unlock(&server.lock);
+
+          if (write(fd, response, sizeof(response) - 1) != sizeof(response) - 1)
+            g_warning("test HTTP server failed to send its response");
+        }
+      close(fd);
+    }
+  return NULL;
+}
+
+static void
+_start_server(void)
+{
+  struct sockaddr_in addr = { 0 };
+  socklen_t addr_len = sizeof(addr);
+
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  server.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  cr_assert(server.listen_fd >= 0);
+  cr_assert(bind(server.listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+  cr_assert(listen(server.listen_fd, CONCURRENT_REQUESTS) == 0);
+  cr_assert(getsockname(server.listen_fd, (struct sockaddr *) &addr, &addr_len) == 0);
+
+  server.port = ntohs(addr.sin_port);
+  g_mutex_init(&server.lock);
+  server.bodies = g_ptr_array_new_with_free_func(g_free);
+  server.thread = g_thread_new(NULL, _server_thread, NULL);
+}
+
+static void
+_stop_server(void)
+{
+  /* makes accept() fail in the server thread */
+  shutdown(server.listen_fd, SHUT_RDWR);
+  g_thread_join(server.thread);
+  close(server.listen_fd);
+
+  g_ptr_array_free(server.bodies, TRUE);
+  g_mutex_clear(&server.lock);
+}
+
+static gint
+_count_requests_with_body(const gchar *body)
+{
+  gint count = 0;
+
+  g_mutex_lock(&server.lock);
+  for (guint i = 0; i < server.bodies->len; i++)
+    {
+      if (strcmp(g_ptr_array_index(server.bodies, i), body) == 0)
+        count++;
+    }
+  g_mutex_unlock(&server.lock);
+  return count;
+}
+
+static gint
+_count_requests(void)
+{
+  gint count;
+
+  g_mutex_lock(&server.lock);
+  count = server.bodies->len;
+  g_mutex_unlock(&server.lock);
+  return count;
+}
+
+/* the responses are processed by the worker thread one by one */
+static HttpResult scripted_results[MAX_SCRIPTED_RESULTS];
+static gint num_scripted_results;
+static gint next_scripted_result;
+
+static HttpResult
+_scripted_response_action(gpointer user_data)
+{
+  if (next_scripted_result >= num_scripted_results)
+    return HTTP_RESULT_SUCCESS;
+
+  return scripted_results[next_scripted_result++];
+}
+
+static void
+_script_results(const HttpResult *results, gint num_results)
+{
+  g_assert(num_results <= MAX_SCRIPTED_RESULTS);
+
+  memcpy(scripted_results, results, num_results * sizeof(results[0]));
+  num_scripted_results = num_results;
+  next_scripted_result = 0;
+}
+
+MainLoop *main_loop;
+MainLoopOptions main_loop_options;
+
+HTTPDestinationDriver *driver;
+
+static void
+_start_driver(void)
+{
+  HttpResponseHandler response_handler =
+  {
+    .status_code = 200,
+    .action = _scripted_response_action,
+  };
+  gchar *url = g_strdup_printf("http://127.0.0.1:%d/", server.port);
+  GList *urls = g_list_append(NULL, url);
+
+  http_dd_set_urls(&driver->super.super.super, urls);
+  http_dd_set_concurrent_requests(&driver->super.super.super, CONCURRENT_REQUESTS);
+  http_dd_insert_response_handler(&driver->super.super.super, &response_handler);
+  log_threaded_dest_driver_set_batch_lines(&driver->super.super.super, REQUEST_BATCH_LINES);
+  log_threaded_dest_driver_set_batch_timeout(&driver->super.super.super, 1000);
+  /* retry failed batches right away */
+  log_threaded_dest_driver_set_time_reopen(&driver->super.super.super, 0);
+
+  cr_assert(log_pipe_init(&driver->super.super.super.super));
+  cr_assert(log_pipe_on_config_inited(&driver->super.super.super.super));
+
+  g_list_free(urls);
+  g_free(url);
+}
+
+static void
+_generate_messages(gint n)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT_NOACK;
+  gchar buf[32];
+
+  for (gint i = 1; i <= n; i++)
+    {
+      LogMessage *msg = log_msg_new_empty();
+
+      g_snprintf(buf, sizeof(buf), "%d", i);
+      log_msg_set_value(msg, LM_V_MESSAGE, buf, -1);
+      log_pipe_queue(&driver->super.super.super.super, msg, &path_options);
+    }
+}
+
+static void
+_sleep_msec(long msec)
+{
+  struct timespec sleep_time = { msec / 1000, (msec % 1000) * 1000000 };
+  nanosleep(&sleep_time, NULL);
+}
+
+static void
+_wait_for_messages_to_be_processed(gint n)
+{
+  const gint MAX_SPIN_ITERATIONS = 10000;
+  gssize processed = 0;
+
+  for (gint c = 0; c < MAX_SPIN_ITERATIONS; c++)
+    {
+      processed = stats_counter_get(driver->super.written_messages) + stats_counter_get(driver->super.dropped_messages);
+      if (processed == n)
+        return;
+      _sleep_msec(1);
+    }
+  cr_assert(processed == n, "messages were not processed in time, expected=%d, processed=%" G_GSSIZE_FORMAT,
+            n, processed);
+}
+
+Test(http_worker, concurrent_requests_are_acked_when_all_of_them_succeed)
+{
+  _start_driver();
+  _generate_messages(NUM_MESSAGES);
+  _wait_for_messages_to_be_processed(NUM_MESSAGES);
+
+  cr_assert_eq(stats_counter_get(driver->super.written_messages), NUM_MESSAGES);
+  cr_assert_eq(stats_counter_get(driver->super.dropped_messages), 0);
+
+  cr_assert_eq(_count_requests(), CONCURRENT_REQUESTS);
+  cr_assert_eq(_count_requests_with_body("1\n2"), 1);
+  cr_assert_eq(_count_requests_with_body("3\n4"), 1);
+  cr_assert_eq(_count_requests_with_body("5\n6"), 1);
+}
+
+Test(http_worker, messages_after_a_failed_request_are_rewound_and_sent_again)
+{
+  const HttpResult results[] = { HTTP_RESULT_SUCCESS, HTTP_RESULT_RETRY };
+
+  _script_results(results, G_N_ELEMENTS(results));
+  _start_driver();
+  _generate_messages(NUM_MESSAGES);
+  _wait_for_messages_to_be_processed(NUM_MESSAGES);
+
+  cr_assert_eq(stats_counter_get(driver->super.written_messages), NUM_MESSAGES);
+  cr_assert_eq(stats_counter_get(driver->super.dropped_messages), 0);
+
+  /* the request before the failed one is acked, the rest are sent again,
+   * even the one that succeeded */
+  cr_assert_eq(_count_requests_with_body("1\n2"), 1);
+  cr_assert_eq(_count_requests_with_body("3\n4"), 2);
+  cr_assert_eq(_count_requests_with_body("5\n6"), 2);
+}
+
+Test(http_worker, dropped_request_does_not_affect_the_rest_of_the_batch)
+{
+  const HttpResult results[] = { HTTP_RESULT_SUCCESS, HTTP_RESULT_DROP, HTTP_RESULT_SUCCESS };
+
+  _script_results(results, G_N_ELEMENTS(results));
+  _start_driver();
+  _generate_messages(NUM_MESSAGES);
+  _wait_for_messages_to_be_processed(NUM_MESSAGES);
+
+  cr_assert_eq(stats_counter_get(driver->super.written_messages), NUM_MESSAGES - REQUEST_BATCH_LINES);
+  cr_assert_eq(stats_counter_get(driver->super.dropped_messages), REQUEST_BATCH_LINES);
+
+  cr_assert_eq(_count_requests(), CONCURRENT_REQUESTS);
+  cr_assert_eq(_count_requests_with_body("1\n2"), 1);
+  cr_assert_eq(_count_requests_with_body("3\n4"), 1);
+  cr_assert_eq(_count_requests_with_body("5\n6"), 1);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  main_loop = main_loop_get_instance();
+  main_loop_init(main_loop, &main_loop_options);
+
+  _start_server();
+  _script_results(NULL, 0);
+  driver = (HTTPDestinationDriver *) http_dd_new(main_loop_get_current_config(main_loop));
+}
+
+static void
+teardown(void)
+{
+  main_loop_sync_worker_startup_and_teardown();
+  log_pipe_deinit(&driver->super.super.super.super);
+  log_pipe_unref(&driver->super.super.super.super);
+
+  _stop_server();
+  main_loop_deinit(main_loop);
+  app_shutdown();
+}
+
+TestSuite(http_worker, .init = setup, .fini = teardown);
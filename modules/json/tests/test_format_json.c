@@ -241,6 +241,24 @@ Test(format_json, test_format_flat_json_with_type_hints)
                          "{\"b\":{\"subkey\":\"bar\"}}");
 }
 
+Test(format_json, test_format_json_performance_with_many_nv_pairs)
+{
+  LogMessage *msg = create_sample_message();
+
+  for (gint i = 0; i < 64; i++)
+    {
+      gchar name[32], value[32];
+
+      g_snprintf(name, sizeof(name), "field%02d", i);
+      g_snprintf(value, sizeof(value), "value of field %d", i);
+      log_msg_set_value_by_name(msg, name, value, -1);
+    }
+
+  perftest_template_msg("$(format-json --scope rfc5424 --scope nv-pairs)\n", msg);
+  perftest_template_msg("$(format-json --scope rfc5424 --scope nv-pairs --exclude field1* --exclude field2*)\n", msg);
+  log_msg_unref(msg);
+}
+
 Test(format_json, test_format_json_performance)
 {
   perftest_template("$(format-json APP.*)\n");
@@ -25,11 +25,13 @@
 
 static gboolean stats_options_reset_is_set = FALSE;
 static gboolean stats_options_remove_orphans = FALSE;
+static gboolean stats_options_openmetrics = FALSE;
 
 GOptionEntry stats_options[] =
 {
   { "reset", 'r', 0, G_OPTION_ARG_NONE, &stats_options_reset_is_set, "reset counters", NULL },
   { "remove-orphans", 'o', 0, G_OPTION_ARG_NONE, &stats_options_remove_orphans, "remove orphaned statistics", NULL},
+  { "openmetrics", 'm', 0, G_OPTION_ARG_NONE, &stats_options_openmetrics, "print the statistics in the OpenMetrics text format", NULL},
   { NULL,    0,   0, G_OPTION_ARG_NONE, NULL,                        NULL,             NULL }
 };
 
@@ -42,6 +44,9 @@ _stats_command_builder(void)
   if (stats_options_remove_orphans)
     return "REMOVE_ORPHANED_STATS";
 
+  if (stats_options_openmetrics)
+    return "STATS OPENMETRICS";
+
   return "STATS";
 }
 
@@ -38,6 +38,7 @@
 #include "plugin.h"
 #include "reloc.h"
 #include "resolved-configurable-paths.h"
+#include "filter/filter-in-list.h"
 
 #include <sys/types.h>
 #include <stdio.h>
@@ -60,6 +61,7 @@
 
 static gboolean display_version = FALSE;
 static gboolean display_module_registry = FALSE;
+static gchar *compile_in_list = NULL;
 static gboolean dummy = FALSE;
 
 static MainLoopOptions main_loop_options;
@@ -73,6 +75,7 @@ static GOptionEntry syslogng_options[] =
   { "version",           'V',         0, G_OPTION_ARG_NONE, &display_version, "Display version number (" SYSLOG_NG_PACKAGE_NAME " " SYSLOG_NG_COMBINED_VERSION ")", NULL },
   { "module-path",         0,         0, G_OPTION_ARG_STRING, &resolvedConfigurablePaths.initial_module_path, "Set the list of colon separated directories to search for modules, default=" SYSLOG_NG_MODULE_PATH, "<path>" },
   { "module-registry",     0,         0, G_OPTION_ARG_NONE, &display_module_registry, "Display module information", NULL },
+  { "compile-in-list",     0,         0, G_OPTION_ARG_STRING, &compile_in_list, "Compile the in-list() filter list file specified into <list-file>.compiled and quit", "<list-file>" },
   { "seed",              'S',         0, G_OPTION_ARG_NONE, &dummy, "Does nothing, the need to seed the random generator is autodetected", NULL},
 #ifdef YYDEBUG
   { "yydebug",           'y',         0, G_OPTION_ARG_NONE, &cfg_parser_debug, "Enable configuration parser debugging", NULL },
@@ -248,6 +251,11 @@ main(int argc, char *argv[])
       plugin_list_modules(stdout, TRUE);
       return 0;
     }
+  if (compile_in_list)
+    {
+      interactive_mode();
+      return filter_in_list_compile(compile_in_list) ? 0 : 1;
+    }
 
   setup_caps();
 
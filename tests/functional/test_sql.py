@@ -44,7 +44,18 @@ destination d_sql {
         flush-lines(25) flush_timeout(100));
 };
 
-log { source(s_tcp); destination(d_sql); };
+destination d_sql_multi_row {
+    sql(type(sqlite3) database("%(current_dir)s/test-sql.db") host(dummy) port(1234) username(dummy) password(dummy)
+        table("logs_multi_row")
+        null("@NULL@")
+        columns("date datetime", "host", "program", "pid", "msg")
+        values("$DATE", "$HOST", "$PROGRAM", "${PID:-@NULL@}", "$MSG")
+        flags(explicit-commits multi-row-inserts)
+        multi-row-insert-max-rows(7)
+        flush-lines(25) flush_timeout(100));
+};
+
+log { source(s_tcp); destination(d_sql); destination(d_sql_multi_row); };
 
 """ % locals()
 
@@ -96,4 +107,6 @@ def test_sql():
     time.sleep(10)
     stopped = stop_syslogng()
     time.sleep(5)
-    return stopped and check_sql_expected("%s/test-sql.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345")
+    return stopped and \
+        check_sql_expected("%s/test-sql.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345") and \
+        check_sql_expected("%s/test-sql.db" % current_dir, "logs_multi_row", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345")
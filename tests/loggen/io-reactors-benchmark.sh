@@ -0,0 +1,68 @@
+#!/bin/sh
+#############################################################################
+# Copyright (c) 2021 One Identity
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License version 2 as published
+# by the Free Software Foundation, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# As an additional exemption you are allowed to compile & link against the
+# OpenSSL libraries as published by the OpenSSL project. See the file
+# COPYING for details.
+#
+#############################################################################
+#
+# Measures the TCP input rate of syslog-ng with the I/O worker pool and with
+# 1, 4, 16 and 64 I/O reactors, using loggen with many active connections.
+#
+# usage: io-reactors-benchmark.sh <syslog-ng binary> <loggen binary> [connections] [seconds]
+
+SYSLOG_NG=${1:?syslog-ng binary is required}
+LOGGEN=${2:?loggen binary is required}
+CONNECTIONS=${3:-256}
+INTERVAL=${4:-10}
+PORT=${PORT:-20514}
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+cat >"$WORKDIR/syslog-ng.conf" <<EOF
+@version: 3.35
+options { threaded(yes); stats-freq(0); };
+source s_tcp { network(transport(tcp) port($PORT) max-connections($((CONNECTIONS + 16))) log-iw-size($((CONNECTIONS * 1000)))); };
+destination d_null { file("/dev/null"); };
+log { source(s_tcp); destination(d_null); };
+EOF
+
+run_benchmark()
+{
+  label=$1
+  shift
+
+  "$SYSLOG_NG" -F -f "$WORKDIR/syslog-ng.conf" -R "$WORKDIR/syslog-ng.persist" \
+    -p "$WORKDIR/syslog-ng.pid" -c "$WORKDIR/syslog-ng.ctl" --no-caps "$@" &
+  pid=$!
+  sleep 2
+
+  rate=$("$LOGGEN" --quiet --stream --inet --rate 1000000 --size 200 --interval "$INTERVAL" \
+           --active-connections "$CONNECTIONS" 127.0.0.1 "$PORT" 2>&1 |
+         sed -n 's/^average rate = \([0-9.]*\).*$/\1/p')
+  printf "%-16s %12s msg/sec\n" "$label" "$rate"
+
+  kill "$pid"
+  wait "$pid" 2>/dev/null
+}
+
+run_benchmark "worker pool"
+for reactors in 1 4 16 64; do
+  run_benchmark "$reactors reactors" --io-reactors "$reactors"
+done
@@ -24,8 +24,10 @@
 #include <criterion/parameterized.h>
 
 #include "find-crlf.h"
+#include "timeutils/misc.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 struct findcrlf_params
 {
@@ -138,3 +140,153 @@ ParameterizedTest(struct findcrlf_params *params, findcrlf, test)
                 "EOM is at wrong location. msg=%s, eom_ofs=%d, eom=%s\n",
                 params->msg, (gint) params->eom_ofs, eom);
 }
+
+static gchar *
+_find_cr_or_lf_bytewise(gchar *s, gsize n)
+{
+  for (gsize i = 0; i < n; i++)
+    {
+      if (s[i] == '\r' || s[i] == '\n')
+        return &s[i];
+      if (s[i] == 0)
+        return NULL;
+    }
+  return NULL;
+}
+
+static const guchar *
+_find_lf_or_nul_bytewise(const guchar *s, gsize n)
+{
+  for (gsize i = 0; i < n; i++)
+    {
+      if (s[i] == '\n' || s[i] == 0)
+        return &s[i];
+    }
+  return NULL;
+}
+
+static void
+_fill_random_buffer(guchar *buffer, gsize len, gint terminator_frequency)
+{
+  for (gsize i = 0; i < len; i++)
+    {
+      gint r = g_random_int_range(0, terminator_frequency);
+
+      if (r == 0)
+        buffer[i] = '\n';
+      else if (r == 1)
+        buffer[i] = '\r';
+      else if (r == 2)
+        buffer[i] = '\0';
+      else
+        buffer[i] = 'a' + r % 26;
+    }
+}
+
+Test(findcrlf, test_vectorized_search_matches_bytewise_search)
+{
+  guchar buffer[512];
+  gsize offsets[16];
+
+  for (gint i = 0; i < 20000; i++)
+    {
+      gsize len = g_random_int_range(0, sizeof(buffer));
+      gsize start = g_random_int_range(0, len + 1);
+      const guchar *s = buffer + start;
+      gsize n = len - start;
+
+      _fill_random_buffer(buffer, len, g_random_int_range(3, 300));
+
+      cr_assert_eq(find_cr_or_lf((gchar *) s, n), _find_cr_or_lf_bytewise((gchar *) s, n));
+      cr_assert_eq(find_lf_or_nul(s, n), _find_lf_or_nul_bytewise(s, n));
+
+      gsize num_offsets = find_lf_or_nul_offsets(s, n, offsets, G_N_ELEMENTS(offsets));
+      const guchar *eol = s;
+      gsize expected = 0;
+
+      while (expected < G_N_ELEMENTS(offsets) && (eol = _find_lf_or_nul_bytewise(eol, s + n - eol)))
+        {
+          cr_assert_eq(offsets[expected], eol - s, "Unexpected EOL offset, index=%d", (gint) expected);
+          expected++;
+          eol++;
+        }
+      cr_assert_eq(num_offsets, expected);
+    }
+}
+
+Test(findcrlf, test_offsets_stop_at_max_offsets)
+{
+  const gchar *lines = "a\nb\nc\n";
+  gsize offsets[2];
+
+  cr_assert_eq(find_lf_or_nul_offsets((const guchar *) lines, strlen(lines), offsets, 2), 2);
+  cr_assert_eq(offsets[0], 1);
+  cr_assert_eq(offsets[1], 3);
+  cr_assert_eq(find_lf_or_nul_offsets((const guchar *) lines, strlen(lines), offsets, 0), 0);
+}
+
+#define PERF_BUFFER_SIZE (16 * 1024 * 1024)
+#define PERF_ITERATIONS 8
+
+static guchar *
+_construct_lines(gsize line_len)
+{
+  guchar *buffer = g_malloc(PERF_BUFFER_SIZE);
+
+  memset(buffer, 'a', PERF_BUFFER_SIZE);
+  for (gsize i = line_len - 1; i < PERF_BUFFER_SIZE; i += line_len)
+    buffer[i] = '\n';
+  return buffer;
+}
+
+static void
+_perftest_line_length(gsize line_len)
+{
+  guchar *buffer = _construct_lines(line_len);
+  gsize offsets[32];
+  gsize num_lines = 0, num_lines_bulk = 0;
+  GTimeVal start, end, end_bulk;
+
+  g_get_current_time(&start);
+  for (gint i = 0; i < PERF_ITERATIONS; i++)
+    {
+      const guchar *p = buffer;
+      const guchar *eol;
+
+      while ((eol = find_lf_or_nul(p, buffer + PERF_BUFFER_SIZE - p)))
+        {
+          num_lines++;
+          p = eol + 1;
+        }
+    }
+  g_get_current_time(&end);
+
+  for (gint i = 0; i < PERF_ITERATIONS; i++)
+    {
+      gsize pos = 0;
+      gsize count;
+
+      while ((count = find_lf_or_nul_offsets(buffer + pos, PERF_BUFFER_SIZE - pos, offsets, G_N_ELEMENTS(offsets))))
+        {
+          num_lines_bulk += count;
+          pos += offsets[count - 1] + 1;
+        }
+    }
+  g_get_current_time(&end_bulk);
+
+  cr_assert_eq(num_lines, num_lines_bulk);
+  cr_assert_eq(num_lines, PERF_ITERATIONS * (PERF_BUFFER_SIZE / line_len));
+
+  printf("      line length: %5d, one by one: %10.3f MB/sec, bulk: %10.3f MB/sec\n", (gint) line_len,
+         PERF_ITERATIONS * (PERF_BUFFER_SIZE / 1e6) * 1e6 / g_time_val_diff(&end, &start),
+         PERF_ITERATIONS * (PERF_BUFFER_SIZE / 1e6) * 1e6 / g_time_val_diff(&end_bulk, &end));
+  g_free(buffer);
+}
+
+Test(findcrlf, test_performance)
+{
+  _perftest_line_length(32);
+  _perftest_line_length(128);
+  _perftest_line_length(1024);
+  _perftest_line_length(16384);
+}